@@ -158,8 +158,11 @@ typedef enum
     AwaResult_NotFound = 404,          /**< indicates the specified object, object instance or resource does not exist */
     AwaResult_MethodNotAllowed = 405,  /**< indicates the requested operation is not allowed for the specified target */
     AwaResult_NotAcceptable = 406,     /**< indicates a requested accept-header was not acceptable by the client daemon */
+    AwaResult_RequestEntityIncomplete = 408, /**< indicates a block of a blockwise write did not follow the blocks received */
+    AwaResult_RequestEntityTooLarge = 413,   /**< indicates a write too large for one message cannot be written block by block */
 
     AwaResult_InternalError = 500,     /**< indicates the handler failed internally while processing a request */
+    AwaResult_ServiceUnavailable = 503, /**< indicates the server is temporarily overloaded and the request should be retried later */
 
     AwaResult_OutOfMemory = 999,       /**< indicates the handler did not have sufficient memory to service the requested operation */
     AwaResult_AlreadyDefined,          /**< indicates an attempt to define an already defined object or resource */
@@ -204,6 +207,30 @@ typedef AwaResult (*AwaStaticClientHandler)(AwaStaticClient * client, AwaOperati
                                             AwaObjectID objectID, AwaObjectInstanceID objectInstanceID, AwaResourceID resourceID, AwaResourceInstanceID resourceInstanceID,
                                             void ** dataPointer, size_t * dataSize, bool * changed);
 
+/**
+ * @brief A user-specified callback handler for a LWM2M Write to a single-instance opaque resource that is too large
+ *        to be sent in one message. Each block of the value is passed to the handler as it arrives, in order,
+ *        so that a large value (for example, a firmware package) need never be held in memory as a whole.
+ *
+ * @param[in] client A pointer to a valid Awa Static Client.
+ * @param[in] objectID Identifies the object for which the write is targeted.
+ * @param[in] objectInstanceID Identifies the object instance for which the write is targeted.
+ * @param[in] resourceID Identifies the resource for which the write is targeted.
+ * @param[in] resourceInstanceID Identifies the resource instance for which the write is targeted.
+ * @param[in] data A pointer to the block of the resource's new value.
+ * @param[in] dataSize The length of the block.
+ * @param[in] offset The position of the block within the resource's new value. The first block is at offset zero.
+ * @param[in] more False if this is the last block of the value.
+ * @param[out] changed Set by the handler to indicate whether the resource's value has been changed by the block.
+ *                If set to true for any block, a notification will be sent when possible to any observers
+ *                of the target object, object instance or resource once the last block has been written.
+ * @return AwaResult_SuccessChanged on a successful write of the block.
+ * @return Various errors on failure, which abandon the write.
+ */
+typedef AwaResult (*AwaStaticClientWriteBlockHandler)(AwaStaticClient * client,
+                                                      AwaObjectID objectID, AwaObjectInstanceID objectInstanceID, AwaResourceID resourceID, AwaResourceInstanceID resourceInstanceID,
+                                                      const void * data, size_t dataSize, size_t offset, bool more, bool * changed);
+
 
 /************************************************************************************************************
  * Awa Static Client Initialisation and Teardown
@@ -509,6 +536,28 @@ AwaError AwaStaticClient_DefineResource(AwaStaticClient * client, AwaObjectID ob
  */
 AwaError AwaStaticClient_SetResourceOperationHandler(AwaStaticClient * client, AwaObjectID objectID, AwaResourceID resourceID, AwaStaticClientHandler handler);
 
+/**
+ * @brief Set a user-specified callback handler that will be called with each block of a LWM2M Write to the resource
+ *        that is too large to be sent in one message. Without a write block handler, such writes are rejected,
+ *        unless the resource's storage was set with ::AwaStaticClient_SetResourceStorageWithPointer or
+ *        ::AwaStaticClient_SetResourceStorageWithPointerArray - each block is then copied into the resource's data as it arrives.
+ *
+ *        The target resource must be a single-instance opaque resource defined with ::AwaStaticClient_DefineResource
+ *        before this function is called.
+ *
+ * @note  This function should be called after ::AwaStaticClient_SetResourceOperationHandler, which removes any write block handler.
+ *
+ * @param[in] client A pointer to a valid Awa Static Client.
+ * @param[in] objectID An ID that uniquely identifies the defined object that contains the defined resource.
+ * @param[in] resourceID An ID that uniquely identifies the defined resource within the object.
+ * @param[in] handler A user-specified callback handler.
+ * @return AwaError_Success on success.
+ * @return AwaError_DefinitionInvalid if @e objectID or @e resourceID is invalid or out of range, the resource is not
+ *         a single-instance opaque resource, or @e handler is NULL.
+ * @return AwaError_StaticClientInvalid if @e client is NULL.
+ */
+AwaError AwaStaticClient_SetResourceWriteBlockHandler(AwaStaticClient * client, AwaObjectID objectID, AwaResourceID resourceID, AwaStaticClientWriteBlockHandler handler);
+
 /**
  * @brief Set a resource's storage with a pointer to the resource's data,
  *        leaving handling of the resource to the LWM2M Client. The resource's value
@@ -174,6 +174,7 @@ typedef enum
     AwaContentType_ApplicationLinkFormat     = 40,      // Object link format
     AwaContentType_ApplicationOctetStream    = 42,      // The new standard uses OctetStream, rather than omg.lwm2m+opaque
     AwaContentType_ApplicationJson           = 50,      // The new standard uses Json, rather than omg.lwm2m+json
+    AwaContentType_ApplicationSenmlJson      = 110,     // application/senml+json, for LwM2M 1.1 composite operations
     AwaContentType_ApplicationOmaLwm2mText   = 1541,    // application/vnd.oma.lwm2m+text (leshan uses 1541)
     AwaContentType_ApplicationOmaLwm2mTLV    = 1542,    // application/vnd.oma.lwm2m+tlv (TBD)??
     AwaContentType_ApplicationOmaLwm2mJson   = 1543,
@@ -47,6 +47,7 @@ typedef int IPCSessionID;
 #define IPC_MESSAGE_SUB_TYPE_DISCONNECT             "Disconnect"
 #define IPC_MESSAGE_SUB_TYPE_DELETE                 "Delete"
 #define IPC_MESSAGE_SUB_TYPE_DEFINE                 "Define"
+#define IPC_MESSAGE_SUB_TYPE_METRICS                "Metrics"
 
 // Client request message sub-types:
 #define IPC_MESSAGE_SUB_TYPE_GET                    "Get"
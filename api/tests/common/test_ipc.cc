@@ -432,4 +432,49 @@ TEST_F(TestIPCWithDaemon, IPC_SendAndReceive_successful_response_code_is_success
     IPCInfo_Free(&info);
 }
 
+TEST_F(TestIPCWithDaemon, IPC_SendAndReceive_metrics_request_returns_metrics)
+{
+    IPCInfo * info = IPCInfo_NewUDP("127.0.0.1", global::clientIpcPort);  EXPECT_TRUE(NULL != info);
+    IPCChannel * channel = IPCChannel_New(info);                          EXPECT_TRUE(NULL != channel);
+    IPCMessage * connectRequest = IPCMessage_New();
+    IPCMessage * connectResponse = NULL;
+    IPCMessage_SetType(connectRequest, IPC_MESSAGE_TYPE_REQUEST, IPC_MESSAGE_SUB_TYPE_CONNECT);
+    ASSERT_EQ(AwaError_Success, IPC_SendAndReceive(channel, connectRequest, &connectResponse, global::timeout));
+    IPCSessionID sessionID = IPCMessage_GetSessionID(connectResponse);
+
+    IPCMessage * request = IPCMessage_NewPlus(IPC_MESSAGE_TYPE_REQUEST, IPC_MESSAGE_SUB_TYPE_METRICS, sessionID);
+    IPCMessage * response = NULL;
+
+    EXPECT_EQ(AwaError_Success, IPC_SendAndReceive(channel, request, &response, global::timeout));
+    ASSERT_TRUE(NULL != response);
+    ASSERT_EQ(IPCResponseCode_Success, IPCMessage_GetResponseCode(response));
+
+    TreeNode metricsNode = TreeNode_Navigate(IPCMessage_GetContentNode(response), "Content/Metrics");
+    ASSERT_TRUE(NULL != metricsNode);
+
+    // the request itself has been counted
+    bool foundIpcRequests = false;
+    for (int index = 0; index < TreeNode_GetChildCount(metricsNode); ++index)
+    {
+        TreeNode metricNode = TreeNode_GetChild(metricsNode, index);
+        TreeNode nameNode = TreeNode_Navigate(metricNode, "Metric/Name");
+        if ((nameNode != NULL) && (strcmp("awa_ipc_requests_total", reinterpret_cast<const char *>(TreeNode_GetValue(nameNode))) == 0))
+        {
+            TreeNode valueNode = TreeNode_Navigate(metricNode, "Metric/Value");
+            ASSERT_TRUE(NULL != valueNode);
+            EXPECT_LT(0, atoi(reinterpret_cast<const char *>(TreeNode_GetValue(valueNode))));
+            foundIpcRequests = true;
+        }
+    }
+    EXPECT_TRUE(foundIpcRequests);
+    EXPECT_TRUE(NULL != TreeNode_Navigate(metricsNode, "Metrics/Histogram/Bucket/Count"));
+
+    IPCMessage_Free(&connectRequest);
+    IPCMessage_Free(&connectResponse);
+    IPCMessage_Free(&request);
+    IPCMessage_Free(&response);
+    IPCChannel_Free(&channel);
+    IPCInfo_Free(&info);
+}
+
 } // namespace Awa
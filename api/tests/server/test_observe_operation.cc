@@ -22,6 +22,7 @@
 
 // TODO: Test observe to multiple objects in a single request, then cancel one of the observations without the others being broken
 
+#include <vector>
 #include <gtest/gtest.h>
 
 #include <lwm2m_tree_node.h>
@@ -1799,6 +1800,62 @@ INSTANTIATE_TEST_CASE_P(
           observeDetail::TestObserveResource {AwaError_Success,  &observeDetail::initialObjectLink1,       &observeDetail::expectedObjectLink1,    sizeof(AwaObjectLink),       "/10000/0/7",  AwaResourceType_ObjectLink}
         ));
 
+class TestObserveManyObservations : public TestAwaObserveChangeSet {};
+
+TEST_F(TestObserveManyObservations, AwaServerObserveOperation_Perform_handles_many_observations_of_one_client)
+{
+    struct CallbackHandler1 : public ObserveWaitCondition
+    {
+        explicit CallbackHandler1(AwaServerSession * session, int callbackCountMax)  : ObserveWaitCondition(session, callbackCountMax) {};
+
+        virtual void callbackHandler(const AwaChangeSet * changeSet)
+        {
+            ASSERT_TRUE(NULL != changeSet);
+        }
+    };
+
+    // more observations than the requester could once hold, with the one that is notified established last
+    const char * paths[] = { "/1", "/1/0", "/3", "/3/0", "/10000/0/2", "/10000/0/3", "/10000/0/4",
+                             "/10000/0/5", "/10000/0/6", "/10000/0/7", "/10000/0/1" };
+    const int numberOfPaths = sizeof(paths) / sizeof(paths[0]);
+    std::vector<CallbackHandler1 *> handlers;
+    std::vector<AwaServerObservation *> observations;
+    std::vector<AwaServerObserveOperation *> operations;
+    for (int i = 0; i < numberOfPaths; i++)
+    {
+        handlers.push_back(new CallbackHandler1(session_, 1));
+        observations.push_back(AwaServerObservation_New(global::clientEndpointName, paths[i], ObserveCallbackRunner, handlers[i]));
+        operations.push_back(AwaServerObserveOperation_New(session_));
+        ASSERT_TRUE(NULL != operations[i]);
+        ASSERT_EQ(AwaError_Success, AwaServerObserveOperation_AddObservation(operations[i], observations[i]));
+        EXPECT_EQ(AwaError_Success, AwaServerObserveOperation_Perform(operations[i], global::timeout)) << paths[i];
+        EXPECT_TRUE(handlers[i]->Wait()) << paths[i];
+    }
+
+    // write via server api, to notify the last observation
+    AwaServerWriteOperation * writeOperation = AwaServerWriteOperation_New(session_, AwaWriteMode_Update);
+    ASSERT_TRUE(NULL != writeOperation);
+    ASSERT_EQ(AwaError_Success, AwaServerWriteOperation_AddValueAsCString(writeOperation, "/10000/0/1", observeDetail::expectedString1));
+    EXPECT_EQ(AwaError_Success, AwaServerWriteOperation_Perform(writeOperation, global::clientEndpointName, global::timeout));
+    AwaServerWriteOperation_Free(&writeOperation);
+
+    handlers[numberOfPaths - 1]->callbackCountMax = 2;
+    EXPECT_TRUE(handlers[numberOfPaths - 1]->Wait());
+
+    for (int i = 0; i < numberOfPaths; i++)
+    {
+        AwaServerObserveOperation * cancelObserveOperation = AwaServerObserveOperation_New(session_);
+        ASSERT_TRUE(NULL != cancelObserveOperation);
+        ASSERT_EQ(AwaError_Success, AwaServerObserveOperation_AddCancelObservation(cancelObserveOperation, observations[i]));
+        EXPECT_EQ(AwaError_Success, AwaServerObserveOperation_Perform(cancelObserveOperation, global::timeout)) << paths[i];
+        ASSERT_EQ(AwaError_Success, AwaServerObserveOperation_Free(&cancelObserveOperation));
+
+        ASSERT_EQ(AwaError_Success, AwaServerObservation_Free(&observations[i]));
+        ASSERT_EQ(AwaError_Success, AwaServerObserveOperation_Free(&operations[i]));
+        delete handlers[i];
+    }
+}
+
 
 ///***********************************************************************************************************
 // * GetValueArray parameterised tests
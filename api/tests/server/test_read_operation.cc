@@ -26,6 +26,7 @@
 #include <string>
 #include <algorithm>
 #include <cstring>
+#include <pthread.h>
 
 #include <lwm2m_tree_node.h>
 
@@ -241,6 +242,69 @@ TEST_F(TestReadOperationWithConnectedSession, AwaServerReadOperation_Perform_hon
     AwaServerSession_Free(&session);
 }
 
+namespace detail {
+
+struct ConcurrentRead
+{
+    const char * Path;
+    AwaServerReadOperation * Operation;
+    AwaError Result;
+};
+
+static void * PerformConcurrentRead(void * arg)
+{
+    ConcurrentRead * read = static_cast<ConcurrentRead *>(arg);
+    read->Result = AwaServerReadOperation_Perform(read->Operation, global::timeout);
+    return NULL;
+}
+
+} // namespace detail
+
+TEST_F(TestReadOperationWithConnectedSession, AwaServerReadOperation_Perform_handles_concurrent_operations)
+{
+    // More reads than the server allows in flight to one client - the rest are queued by the server until responses arrive
+    detail::ConcurrentRead reads[] = {
+        { "/3/0/0" }, { "/3/0/1" }, { "/3/0/2" }, { "/3/0/3" }, { "/3/0/6" }, { "/3/0/9" },
+        { "/3/0/13" }, { "/3/0/14" }, { "/3/0/15" }, { "/3/0" }, { "/3" },
+    };
+    const size_t numReads = sizeof(reads) / sizeof(reads[0]);
+    pthread_t threads[numReads];
+
+    // Each read has its own session, so that the server handles them concurrently
+    AwaServerSession * sessions[numReads];
+    for (size_t i = 0; i < numReads; i++)
+    {
+        sessions[i] = AwaServerSession_New();
+        ASSERT_EQ(AwaError_Success, AwaServerSession_SetIPCAsUDP(sessions[i], "127.0.0.1", global::serverIpcPort));
+        ASSERT_EQ(AwaError_Success, AwaServerSession_Connect(sessions[i]));
+        reads[i].Operation = AwaServerReadOperation_New(sessions[i]);
+        ASSERT_TRUE(NULL != reads[i].Operation);
+        ASSERT_EQ(AwaError_Success, AwaServerReadOperation_AddPath(reads[i].Operation, global::clientEndpointName, reads[i].Path));
+    }
+
+    // Hold the client so that all requests are outstanding at once
+    TestClientWithDaemonBase::daemon_.Pause();
+    for (size_t i = 0; i < numReads; i++)
+    {
+        pthread_create(&threads[i], NULL, detail::PerformConcurrentRead, &reads[i]);
+    }
+    usleep(global::timeout * 1000 / 4);
+    TestClientWithDaemonBase::daemon_.Unpause();
+
+    for (size_t i = 0; i < numReads; i++)
+    {
+        pthread_join(threads[i], NULL);
+        EXPECT_EQ(AwaError_Success, reads[i].Result) << reads[i].Path;
+
+        const AwaServerReadResponse * readResponse = AwaServerReadOperation_GetResponse(reads[i].Operation, global::clientEndpointName);
+        ASSERT_TRUE(NULL != readResponse);
+        EXPECT_TRUE(AwaServerReadResponse_ContainsPath(readResponse, reads[i].Path)) << reads[i].Path;
+
+        AwaServerReadOperation_Free(&reads[i].Operation);
+        AwaServerSession_Free(&sessions[i]);
+    }
+}
+
 TEST_F(TestReadOperationWithConnectedSession, AwaServerReadOperation_Perform_handles_invalid_operation_no_content)
 {
     // Test behaviour when operation has no content
@@ -322,6 +386,49 @@ TEST_F(TestReadOperationWithConnectedServerAndClientSession, AwaServerReadOperat
     AwaServerReadOperation_Free(&readOperation);
 }
 
+TEST_F(TestReadOperationWithConnectedServerAndClientSession, AwaServerReadOperation_Perform_handles_resource_larger_than_a_block)
+{
+    // the response is transferred block by block
+    ObjectDescription object = { 1000, "Object1000", 0, 1, {
+            ResourceDescription(0, "Resource0", AwaResourceType_Opaque, 0, 1, AwaResourceOperations_ReadWrite),
+        }};
+    EXPECT_EQ(AwaError_Success, Define(client_session_, object));
+    EXPECT_EQ(AwaError_Success, Define(server_session_, object));
+
+    WaitForClientDefinition(AwaObjectDefinition_GetID(object.GetDefinition()));
+
+    std::vector<uint8_t> data(5000);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = i % 251;
+    }
+    AwaOpaque opaque = { data.data(), data.size() };
+
+    AwaClientSetOperation * clientSet = AwaClientSetOperation_New(client_session_);
+    EXPECT_TRUE(clientSet != NULL);
+    EXPECT_EQ(AwaError_Success, AwaClientSetOperation_CreateObjectInstance(clientSet, "/1000/0"));
+    EXPECT_EQ(AwaError_Success, AwaClientSetOperation_CreateOptionalResource(clientSet, "/1000/0/0"));
+    EXPECT_EQ(AwaError_Success, AwaClientSetOperation_AddValueAsOpaque(clientSet, "/1000/0/0", opaque));
+    EXPECT_EQ(AwaError_Success, AwaClientSetOperation_Perform(clientSet, global::timeout));
+    AwaClientSetOperation_Free(&clientSet);
+
+    AwaServerReadOperation * readOperation = AwaServerReadOperation_New(server_session_);
+    ASSERT_TRUE(NULL != readOperation);
+
+    EXPECT_EQ(AwaError_Success, AwaServerReadOperation_AddPath(readOperation, global::clientEndpointName, "/1000/0/0"));
+    EXPECT_EQ(AwaError_Success, AwaServerReadOperation_Perform(readOperation, global::timeout));
+
+    const AwaServerReadResponse * readResponse = AwaServerReadOperation_GetResponse(readOperation, global::clientEndpointName);
+    ASSERT_TRUE(NULL != readResponse);
+
+    AwaOpaque receivedOpaque = { NULL, 0 };
+    EXPECT_EQ(AwaError_Success, AwaServerReadResponse_GetValueAsOpaque(readResponse, "/1000/0/0", &receivedOpaque));
+    ASSERT_EQ(data.size(), receivedOpaque.Size);
+    EXPECT_EQ(0, memcmp(data.data(), receivedOpaque.Data, data.size()));
+
+    AwaServerReadOperation_Free(&readOperation);
+}
+
 TEST_F(TestReadOperationWithConnectedSession, AwaServerReadOperation_Perform_handles_object_instance)
 {
     AwaServerReadOperation * readOperation = AwaServerReadOperation_New(server_session_);
@@ -0,0 +1,86 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "support/support.h"
+#include "awa/server.h"
+
+namespace Awa {
+
+class TestServerAdmissionControl : public TestServerWithConnectedSession
+{
+protected:
+    int CountRegisteredClients(const std::vector<std::string> & clientIDs) {
+        int count = 0;
+        AwaServerListClientsOperation * operation = AwaServerListClientsOperation_New(session_);
+        EXPECT_EQ(AwaError_Success, AwaServerListClientsOperation_Perform(operation, global::timeout));
+        for (auto it = clientIDs.begin(); it != clientIDs.end(); ++it)
+        {
+            if (AwaServerListClientsOperation_GetResponse(operation, it->c_str()) != NULL)
+            {
+                count++;
+            }
+        }
+        AwaServerListClientsOperation_Free(&operation);
+        return count;
+    }
+};
+
+class TestServerAdmissionControlNoBacklog : public TestServerAdmissionControl
+{
+protected:
+    virtual void SetUp() {
+        daemon_.SetAdditionalOptions({ "--regRate", "1", "--regBurst", "1", "--regBacklog", "0" });
+        TestServerAdmissionControl::SetUp();
+    }
+};
+
+TEST_F(TestServerAdmissionControlNoBacklog, registrations_over_rate_limit_are_refused)
+{
+    AwaClientDaemonHorde horde( { "TestClient1", "TestClient2", "TestClient3", "TestClient4" }, 61000);
+    EXPECT_FALSE(WaitForRegistration(session_, horde.GetClientIDs(), 1000));
+
+    int registered = CountRegisteredClients(horde.GetClientIDs());
+    EXPECT_LE(1, registered);
+    EXPECT_GT(4, registered);
+}
+
+class TestServerAdmissionControlHighRate : public TestServerAdmissionControl
+{
+protected:
+    virtual void SetUp() {
+        daemon_.SetAdditionalOptions({ "--regRate", "100" });
+        TestServerAdmissionControl::SetUp();
+    }
+};
+
+TEST_F(TestServerAdmissionControlHighRate, registrations_under_rate_limit_are_accepted)
+{
+    AwaClientDaemonHorde horde( { "TestClient1", "TestClient2", "TestClient3", "TestClient4" }, 61000);
+    ASSERT_TRUE(WaitForRegistration(session_, horde.GetClientIDs(), 1000));
+    EXPECT_EQ(4, CountRegisteredClients(horde.GetClientIDs()));
+}
+
+} // namespace Awa
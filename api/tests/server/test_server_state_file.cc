@@ -0,0 +1,127 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <string>
+#include <cstdio>
+
+#include "support/support.h"
+#include "support/file_resource.h"
+#include "awa/server.h"
+
+namespace Awa {
+
+class TestServerStateFile : public TestServerWithConnectedSession
+{
+public:
+    TestServerStateFile() : stateFile_(TempFilename().GetFilename()) {}
+
+protected:
+    virtual void SetUp() {
+        daemon_.SetAdditionalOptions({ "--stateFile", stateFile_ });
+        TestServerWithConnectedSession::SetUp();
+    }
+
+    virtual void TearDown() {
+        TestServerWithConnectedSession::TearDown();
+        std::remove(stateFile_.c_str());
+    }
+
+    void Restart() {
+        this->Disconnect();
+        daemon_.Stop();
+        ASSERT_TRUE(daemon_.Start());
+        this->Connect();
+    }
+
+    bool IsClientRegistered(const char * clientID) {
+        AwaServerListClientsOperation * operation = AwaServerListClientsOperation_New(session_);
+        EXPECT_EQ(AwaError_Success, AwaServerListClientsOperation_Perform(operation, global::timeout));
+        bool registered = AwaServerListClientsOperation_GetResponse(operation, clientID) != NULL;
+        AwaServerListClientsOperation_Free(&operation);
+        return registered;
+    }
+
+    std::string stateFile_;
+};
+
+TEST_F(TestServerStateFile, registration_is_restored_after_server_restart)
+{
+    AwaClientDaemonHorde horde( { "TestClient1" }, 61000);
+    ASSERT_TRUE(WaitForRegistration(session_, horde.GetClientIDs(), 1000));
+
+    // stop the client so that it cannot register again while the server is restarting
+    horde.Pause();
+    Restart();
+    EXPECT_TRUE(IsClientRegistered("TestClient1"));
+    horde.Unpause();
+}
+
+TEST_F(TestServerStateFile, registered_objects_are_restored_after_server_restart)
+{
+    AwaClientDaemonHorde horde( { "TestClient1" }, 61000);
+    ASSERT_TRUE(WaitForRegistration(session_, horde.GetClientIDs(), 1000));
+
+    horde.Pause();
+    Restart();
+
+    AwaServerListClientsOperation * operation = AwaServerListClientsOperation_New(session_);
+    ASSERT_EQ(AwaError_Success, AwaServerListClientsOperation_Perform(operation, global::timeout));
+    const AwaServerListClientsResponse * response = AwaServerListClientsOperation_GetResponse(operation, "TestClient1");
+    ASSERT_TRUE(NULL != response);
+
+    bool foundDevice = false;
+    AwaRegisteredEntityIterator * iterator = AwaServerListClientsResponse_NewRegisteredEntityIterator(response);
+    while (AwaRegisteredEntityIterator_Next(iterator))
+    {
+        if (strcmp(AwaRegisteredEntityIterator_GetPath(iterator), "/3/0") == 0)
+        {
+            foundDevice = true;
+        }
+    }
+    EXPECT_TRUE(foundDevice);
+
+    AwaRegisteredEntityIterator_Free(&iterator);
+    AwaServerListClientsOperation_Free(&operation);
+    horde.Unpause();
+}
+
+TEST_F(TestServerStateFile, deregistered_client_is_not_restored_after_server_restart)
+{
+    {
+        AwaClientDaemonHorde horde( { "TestClient1" }, 61000);
+        ASSERT_TRUE(WaitForRegistration(session_, horde.GetClientIDs(), 1000));
+    }
+
+    // client deregisters when it exits
+    int maxOperations = 10;
+    while (IsClientRegistered("TestClient1") && (maxOperations-- > 0))
+    {
+        usleep(100000);
+    }
+    ASSERT_FALSE(IsClientRegistered("TestClient1"));
+
+    Restart();
+    EXPECT_FALSE(IsClientRegistered("TestClient1"));
+}
+
+} // namespace Awa
@@ -563,6 +563,56 @@ TEST_F(TestWriteOperationWithConnectedServerAndClientSession, AwaServerWriteOper
     AwaServerWriteOperation_Free(&writeOperation);
 }
 
+TEST_F(TestWriteOperationWithConnectedServerAndClientSession, AwaServerWriteOperation_Perform_put_resource_larger_than_a_block_should_succeed)
+{
+    // the request is transferred block by block, and each block written to the resource as it arrives
+    ObjectDescription object = { 1000, "Object1000", 0, 1,
+    {
+        ResourceDescription(0, "Resource0", AwaResourceType_Opaque, 0, 1, AwaResourceOperations_ReadWrite),
+    }};
+    EXPECT_EQ(AwaError_Success, Define(client_session_, object));
+    EXPECT_EQ(AwaError_Success, Define(server_session_, object));
+
+    WaitForClientDefinition(AwaObjectDefinition_GetID(object.GetDefinition()));
+
+    AwaClientSetOperation * setOperation = AwaClientSetOperation_New(client_session_);
+    EXPECT_TRUE(setOperation != NULL);
+    EXPECT_EQ(AwaError_Success, AwaClientSetOperation_CreateObjectInstance(setOperation, "/1000/0"));
+    EXPECT_EQ(AwaError_Success, AwaClientSetOperation_CreateOptionalResource(setOperation, "/1000/0/0"));
+    EXPECT_EQ(AwaError_Success, AwaClientSetOperation_Perform(setOperation, global::timeout));
+    AwaClientSetOperation_Free(&setOperation);
+
+    std::vector<uint8_t> data(5000);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = i % 251;
+    }
+
+    // a shorter value written after a longer one replaces it
+    for (size_t size : { data.size(), data.size() - 2000 })
+    {
+        const char * path = "/1000/0/0";
+        AwaOpaque opaque = { data.data(), size };
+        AwaServerWriteOperation * writeOperation = AwaServerWriteOperation_New(server_session_, AwaWriteMode_Replace); ASSERT_TRUE(NULL != writeOperation);
+        EXPECT_EQ(AwaError_Success, AwaServerWriteOperation_AddValueAsOpaque(writeOperation, path, opaque));
+        EXPECT_EQ(AwaError_Success, AwaServerWriteOperation_Perform(writeOperation, global::clientEndpointName, global::timeout));
+        AwaServerWriteOperation_Free(&writeOperation);
+
+        AwaClientGetOperation * getOperation = AwaClientGetOperation_New(client_session_);
+        ASSERT_TRUE(NULL != getOperation);
+        EXPECT_EQ(AwaError_Success, AwaClientGetOperation_AddPath(getOperation, path));
+        EXPECT_EQ(AwaError_Success, AwaClientGetOperation_Perform(getOperation, global::timeout));
+        const AwaClientGetResponse * getResponse = AwaClientGetOperation_GetResponse(getOperation);
+        ASSERT_TRUE(NULL != getResponse);
+
+        AwaOpaque receivedOpaque = { NULL, 0 };
+        EXPECT_EQ(AwaError_Success, AwaClientGetResponse_GetValueAsOpaque(getResponse, path, &receivedOpaque));
+        ASSERT_EQ(size, receivedOpaque.Size);
+        EXPECT_EQ(0, memcmp(data.data(), receivedOpaque.Data, size));
+        AwaClientGetOperation_Free(&getOperation);
+    }
+}
+
 TEST_F(TestWriteOperationWithConnectedServerAndClientSession, AwaServerWriteOperation_Perform_put_on_multiple_instance_resource_instance_should_replace)
 {
     ObjectDescription object = { 1000, "Object1000", 0, 1,
@@ -21,6 +21,7 @@
 ************************************************************************************************************************/
 
 #include <pthread.h>
+#include <vector>
 #include <gtest/gtest.h>
 #include "awa/static.h"
 #include "awa/server.h"
@@ -59,6 +60,37 @@ TEST_F(TestStaticClientHandler, AwaStaticClient_SetResourceOperationHandler_Inva
     AwaStaticClient_Free(&client);
 }
 
+static AwaResult writeBlockHandler(AwaStaticClient * client, AwaObjectID objectID, AwaObjectInstanceID objectInstanceID, AwaResourceID resourceID, AwaResourceInstanceID resourceInstanceID,
+                                   const void * data, size_t dataSize, size_t offset, bool more, bool * changed);
+
+TEST_F(TestStaticClientHandler, AwaStaticClient_SetResourceWriteBlockHandler_Invalid)
+{
+    auto client = AwaStaticClient_New();
+    ASSERT_TRUE(client != NULL);
+
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_SetBootstrapServerURI(client, "coap://127.0.0.1:15683/"));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_SetEndPointName(client, "imagination1"));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_SetCoAPListenAddressPort(client, "0.0.0.0", 5683));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_Init(client));
+
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_DefineObject(client, 9999, "TestObject", 0, 1));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_DefineResource(client, 9999, 1, "Opaque", AwaResourceType_Opaque, 1, 1, AwaResourceOperations_ReadWrite));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_DefineResource(client, 9999, 2, "Integer", AwaResourceType_Integer, 1, 1, AwaResourceOperations_ReadWrite));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_DefineResource(client, 9999, 3, "OpaqueArray", AwaResourceType_OpaqueArray, 1, 5, AwaResourceOperations_ReadWrite));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_DefineResource(client, 9999, 4, "MultipleOpaque", AwaResourceType_Opaque, 0, 5, AwaResourceOperations_ReadWrite));
+
+    EXPECT_EQ(AwaError_StaticClientInvalid, AwaStaticClient_SetResourceWriteBlockHandler(NULL,   9999, 1, writeBlockHandler));
+    EXPECT_EQ(AwaError_DefinitionInvalid,   AwaStaticClient_SetResourceWriteBlockHandler(client, 9999, 1, NULL));
+    EXPECT_EQ(AwaError_DefinitionInvalid,   AwaStaticClient_SetResourceWriteBlockHandler(client, 9998, 1, writeBlockHandler));
+    EXPECT_EQ(AwaError_DefinitionInvalid,   AwaStaticClient_SetResourceWriteBlockHandler(client, 9999, 5, writeBlockHandler));
+    EXPECT_EQ(AwaError_DefinitionInvalid,   AwaStaticClient_SetResourceWriteBlockHandler(client, 9999, 2, writeBlockHandler));
+    EXPECT_EQ(AwaError_DefinitionInvalid,   AwaStaticClient_SetResourceWriteBlockHandler(client, 9999, 3, writeBlockHandler));
+    EXPECT_EQ(AwaError_DefinitionInvalid,   AwaStaticClient_SetResourceWriteBlockHandler(client, 9999, 4, writeBlockHandler));
+    EXPECT_EQ(AwaError_Success,             AwaStaticClient_SetResourceWriteBlockHandler(client, 9999, 1, writeBlockHandler));
+
+    AwaStaticClient_Free(&client);
+}
+
 class TestStaticClientHandlerWithServer : public TestStaticClientWithServer {};
 
 TEST_F(TestStaticClientHandlerWithServer, AwaStaticClient_Create_and_Write_Operation_for_Object_and_Resource)
@@ -419,6 +451,103 @@ TEST_F(TestStaticClientHandlerWithServer, AwaStaticClient_Create_and_Execute_Ope
     AwaServerExecuteOperation_Free(&executeOperation);
 }
 
+struct WriteBlockCallback : public StaticClientCallbackWaitCondition
+{
+    std::vector<uint8_t> received;
+    int blocks = 0;
+
+    WriteBlockCallback(AwaStaticClient * StaticClient, int milliseconds) : StaticClientCallbackWaitCondition(StaticClient, milliseconds) {};
+
+    AwaResult handler(AwaStaticClient * context, AwaOperation operation, AwaObjectID objectID, AwaObjectInstanceID objectInstanceID, AwaResourceID resourceID, AwaResourceInstanceID resourceInstanceID, void ** dataPointer, size_t * dataSize, bool * changed)
+    {
+        AwaResult result = AwaResult_InternalError;
+        switch(operation)
+        {
+            case AwaOperation_CreateObjectInstance:
+            case AwaOperation_CreateResource:
+                result = AwaResult_SuccessCreated;
+                break;
+            case AwaOperation_Read:
+                *dataPointer = received.data();
+                *dataSize = received.size();
+                result = AwaResult_SuccessContent;
+                break;
+            default:
+                result = AwaResult_InternalError;
+                break;
+        }
+        return result;
+    }
+
+    AwaResult writeBlock(const void * data, size_t dataSize, size_t offset, bool more, bool * changed)
+    {
+        EXPECT_EQ(received.size(), offset);
+        received.insert(received.end(), (const uint8_t *)data, (const uint8_t *)data + dataSize);
+        blocks++;
+        *changed = true;
+        complete = !more;
+        return AwaResult_SuccessChanged;
+    }
+};
+
+static AwaResult writeBlockHandler(AwaStaticClient * client, AwaObjectID objectID, AwaObjectInstanceID objectInstanceID, AwaResourceID resourceID, AwaResourceInstanceID resourceInstanceID,
+                                   const void * data, size_t dataSize, size_t offset, bool more, bool * changed)
+{
+    EXPECT_EQ(9999, objectID);
+    EXPECT_EQ(0, objectInstanceID);
+    EXPECT_EQ(1, resourceID);
+    WriteBlockCallback * callback = static_cast<WriteBlockCallback *>(AwaStaticClient_GetApplicationContext(client));
+    return callback->writeBlock(data, dataSize, offset, more, changed);
+}
+
+TEST_F(TestStaticClientHandlerWithServer, AwaStaticClient_Write_Operation_larger_than_a_block_is_streamed_to_WriteBlock_handler)
+{
+    WriteBlockCallback cbHandler(client_, global::timeout);
+
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_SetApplicationContext(client_, &cbHandler));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_DefineObject(client_, 9999, "TestObject", 0, 1));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_SetObjectOperationHandler(client_, 9999, handler));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_DefineResource(client_, 9999, 1, "TestResource", AwaResourceType_Opaque, 1, 1, AwaResourceOperations_ReadWrite));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_SetResourceOperationHandler(client_, 9999, 1, handler));
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_SetResourceWriteBlockHandler(client_, 9999, 1, writeBlockHandler));
+
+    EXPECT_EQ(AwaError_Success, AwaStaticClient_CreateObjectInstance(client_, 9999, 0));
+
+    SingleStaticClientWaitCondition condition(client_, session_, global::clientEndpointName, global::timeout);
+    EXPECT_TRUE(condition.Wait());
+
+    AwaServerDefineOperation * defineOperation = AwaServerDefineOperation_New(session_);
+    EXPECT_TRUE(defineOperation != NULL);
+    AwaObjectDefinition * objectDefinition = AwaObjectDefinition_New(9999, "TestObject", 0, 1);
+    EXPECT_TRUE(objectDefinition != NULL);
+    EXPECT_EQ(AwaError_Success, AwaObjectDefinition_AddResourceDefinitionAsOpaque(objectDefinition, 1, "TestResource", true, AwaResourceOperations_ReadWrite, AwaOpaque {0}));
+    EXPECT_EQ(AwaError_Success, AwaServerDefineOperation_Add(defineOperation, objectDefinition));
+    EXPECT_EQ(AwaError_Success, AwaServerDefineOperation_Perform(defineOperation, global::timeout));
+    AwaServerDefineOperation_Free(&defineOperation);
+    AwaObjectDefinition_Free(&objectDefinition);
+
+    std::vector<uint8_t> data(5000);
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = i % 251;
+    }
+    AwaOpaque value = { data.data(), data.size() };
+
+    AwaServerWriteOperation * writeOperation = AwaServerWriteOperation_New(session_, AwaWriteMode_Replace);
+    EXPECT_TRUE(writeOperation != NULL);
+    EXPECT_EQ(AwaError_Success, AwaServerWriteOperation_AddValueAsOpaque(writeOperation, "/9999/0/1", value));
+
+    pthread_t t;
+    pthread_create(&t, NULL, do_write_operation, (void *)writeOperation);
+    ASSERT_TRUE(cbHandler.Wait());
+    pthread_join(t, NULL);
+
+    EXPECT_EQ(5, cbHandler.blocks);
+    EXPECT_EQ(data, cbHandler.received);
+
+    AwaServerWriteOperation_Free(&writeOperation);
+}
+
 
 namespace writeDetail
 {
@@ -37,6 +37,7 @@
 #include "lwm2m_endpoints.h"
 #include "lwm2m_json.h"
 #include "lwm2m_plaintext.h"
+#include "lwm2m_senml_json.h"
 #include "lwm2m_tree_builder.h"
 #include "lwm2m_server_object.h"
 #include "lwm2m_result.h"
@@ -46,6 +47,22 @@
 #include "lwm2m_prettyprint.h" /*DEBUG*/
 
 #define MAX_ENDPOINT_NAME_LENGTH 128
+#define MAX_COMPOSITE_PATHS 32
+#define MAX_COMPOSITE_PAYLOAD_LENGTH 4096
+
+// A blockwise (Block1) write in progress - only one at a time. Each block is written through to the resource as it arrives.
+typedef struct
+{
+    bool InProgress;
+    AddressType Address;                      // Address of the server performing the write
+    ObjectIDType ObjectID;
+    ObjectInstanceIDType ObjectInstanceID;
+    ResourceIDType ResourceID;
+    size_t NextOffset;                        // Position of the next block in the request payload
+    size_t HeaderLength;                      // Length of the TLV header preceding the value in the payload, if any
+    size_t ValueLength;                       // Length of the value given in the TLV header, or zero for an opaque payload
+    bool Changed;                             // The value has been changed by a block written so far
+} Lwm2mBlockWriteType;
 
 struct _Lwm2mContextType
 {
@@ -62,7 +79,10 @@ struct _Lwm2mContextType
     char EndPointName[MAX_ENDPOINT_NAME_LENGTH];  // Client EndPoint name
     bool UseFactoryBootstrap;                 // Factory bootstrap information has been loaded from file.
     struct ListHead ObserverList;
+    HashTable ObserverIndex;                  // Observers by object / instance / resource, see lwm2m_observers.c
+    Heap ObserverDeadlines;                   // Observers by when they are next due
     void * ApplicationContext;
+    Lwm2mBlockWriteType BlockWrite;           // Blockwise write in progress
 };
 
 static Lwm2mContextType Lwm2mContext;
@@ -75,6 +95,9 @@ static int ObjectStoreReadHandler(void * context, ObjectIDType objectID, ObjectI
 static int ObjectStoreWriteHandler(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID,
         ResourceInstanceIDType resourceInstanceID, uint8_t * srcBuffer, size_t srcBufferLen, bool * changed);
 
+static int ObjectStoreWriteBlockHandler(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID,
+        ResourceInstanceIDType resourceInstanceID, uint8_t * srcBuffer, size_t srcBufferLen, size_t offset, bool more, bool * changed);
+
 static int ObjectStoreDeleteHandler(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID,
         ResourceInstanceIDType resourceInstanceID);
 static int ObjectStoreCreateInstanceHandler(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID);
@@ -91,7 +114,8 @@ ObjectOperationHandlers defaultObjectOperationHandlers =
 ResourceOperationHandlers defaultResourceOperationHandlers =
 { .Read = ObjectStoreReadHandler,    //default handler, read from object store
         .Write = ObjectStoreWriteHandler,  //default handler, write to object store.
-        .Execute = NULL, .CreateOptionalResource = ObjectStoreCreateOptionalResourceHandler, };
+        .Execute = NULL, .CreateOptionalResource = ObjectStoreCreateOptionalResourceHandler,
+        .WriteBlock = ObjectStoreWriteBlockHandler, };
 
 // Serialise the Object referenced by OIR into the provided buffer. Return number of bytes serialised, negative on failure
 static int SerialiseOIR(Lwm2mTreeNode * root, AwaContentType acceptContentType, int oir[], int oirLength,
@@ -275,6 +299,19 @@ static int ObjectStoreWriteHandler(void * context, ObjectIDType objectID, Object
                                                 srcBufferLen, changed);
 }
 
+// This function is called with each block of a large write to a resource that uses the "default" write handler. The value
+// in the object store grows as each block arrives. Return -1 on error, or the size of the block written.
+static int ObjectStoreWriteBlockHandler(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID,
+        ResourceInstanceIDType resourceInstanceID, uint8_t * srcBuffer, size_t srcBufferLen, size_t offset, bool more, bool * changed)
+{
+    return ObjectStore_SetResourceInstanceValueBlock(((Lwm2mContextType *) (context))->Store,
+                                                     objectID, objectInstanceID,
+                                                     resourceID,
+                                                     resourceInstanceID,
+                                                     srcBuffer, offset,
+                                                     srcBufferLen, changed);
+}
+
 // This function is called when a delete is performed for an object/object instance that uses the "default" handler.
 // Return -1 on error, or 0 on success.
 static int ObjectStoreDeleteHandler(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID,
@@ -1168,6 +1205,52 @@ int Lwm2mCore_SetResourceInstanceValue(Lwm2mContextType * context, ObjectIDType
     return lwm2mResult == AwaResult_SuccessChanged ? 0 : -1;
 }
 
+// Write one block of a value too large to be written at once to a resource instance. Returns AwaResult_SuccessChanged
+// on success, or various errors on failure.
+static AwaResult SetResourceInstanceValueBlock(Lwm2mContextType * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
+        ResourceIDType resourceID, ResourceInstanceIDType resourceInstanceID, const void * value, size_t valueSize, size_t offset, bool more,
+        bool * changed)
+{
+    AwaResult lwm2mResult = AwaResult_RequestEntityTooLarge;
+
+    *changed = false;
+
+    ResourceDefinition * definition = Definition_LookupResourceDefinition(context->Definitions, objectID, resourceID);
+    if (definition == NULL)
+    {
+        Lwm2m_Error("No resource definition for object ID %d resource ID %d\n", objectID, resourceID);
+        lwm2mResult = AwaResult_NotFound;
+    }
+    else if (definition->Handlers.WriteBlock != NULL)
+    {
+        lwm2mResult = (definition->Handlers.WriteBlock(context, objectID, objectInstanceID, resourceID, resourceInstanceID, (uint8_t *) value,
+                                                       valueSize, offset, more, changed) >= 0) ? AwaResult_SuccessChanged : AwaResult_InternalError;
+    }
+    else if (definition->WriteBlockHandler != NULL)
+    {
+        lwm2mResult = definition->WriteBlockHandler(Lwm2mCore_GetApplicationContext(context), objectID, objectInstanceID, resourceID,
+                                                    resourceInstanceID, value, valueSize, offset, more, changed);
+    }
+    else
+    {
+        Lwm2m_Error("Resource /%d/%d/%d cannot be written block by block\n", objectID, objectInstanceID, resourceID);
+    }
+
+    if (lwm2mResult == AwaResult_SuccessChanged)
+    {
+        if (offset == 0)
+        {
+            Lwm2mObjectTree_AddResourceInstance(&context->ObjectTree, objectID, objectInstanceID, resourceID, resourceInstanceID);
+        }
+    }
+    else if (lwm2mResult != AwaResult_RequestEntityTooLarge)
+    {
+        Lwm2m_Error("Write of block at %zu to %d/%d/%d failed, handler returned %d (expected %d)\n", offset, objectID, objectInstanceID,
+                    resourceID, lwm2mResult, AwaResult_SuccessChanged);
+    }
+    return lwm2mResult;
+}
+
 // Execute a resource and pass in the provided value. Return -1 on error, 0 or greater on success.
 static int ResourceExecute(Lwm2mContextType * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
         ResourceIDType resourceID, ResourceInstanceIDType resourceInstanceID, const void * value, size_t valueSize)
@@ -1511,6 +1594,170 @@ static int HandleCancelObserveRequest(void * ctxt, AddressType * addr, const cha
     return 0;
 }
 
+// Decode the paths named in the payload of a composite request, and check they exist. Return the number of paths, or negative on failure.
+static int DeserialiseCompositePaths(Lwm2mContextType * context, AwaContentType contentType, const char * requestContent, size_t requestContentLen,
+        ObjectInstanceResourceKey * paths, AwaResult * result)
+{
+    int numberOfPaths = -1;
+    *result = AwaResult_BadRequest;
+
+    if ((contentType == AwaContentType_ApplicationSenmlJson) || (contentType == AwaContentType_None))
+    {
+        numberOfPaths = SenMLJson_DeserialisePaths(requestContent, requestContentLen, paths, MAX_COMPOSITE_PATHS);
+    }
+
+    int i;
+    for (i = 0; i < numberOfPaths; i++)
+    {
+        if (!Lwm2mCore_Exists(context, paths[i].ObjectID, paths[i].InstanceID, paths[i].ResourceID))
+        {
+            *result = AwaResult_NotFound;
+            return -1;
+        }
+    }
+
+    if (numberOfPaths > 0)
+    {
+        *result = AwaResult_Success;
+    }
+    return numberOfPaths;
+}
+
+// Read the paths of a composite operation into one SenML JSON pack. Paths that cannot be read, such as those in an instance deleted
+// since they were observed, are left out, and removed from paths. Return the length of the pack, negative on failure or if no path
+// can be read.
+static int SerialiseComposite(Lwm2mContextType * context, Lwm2mRequestOrigin origin, ObjectInstanceResourceKey * paths, int * numberOfPaths,
+        char * buffer, size_t size, AwaResult * result)
+{
+    Lwm2mTreeNode * nodes[MAX_COMPOSITE_PATHS] = { NULL };
+    int numberRead = 0;
+    int len = -1;
+    int i;
+
+    *result = AwaResult_NotFound;
+    for (i = 0; (i < *numberOfPaths) && (i < MAX_COMPOSITE_PATHS); i++)
+    {
+        int oir[3] = { paths[i].ObjectID, paths[i].InstanceID, paths[i].ResourceID };
+        int oirLength = (oir[1] == -1) ? 1 : ((oir[2] == -1) ? 2 : 3);
+        Lwm2mTreeNode * node = NULL;
+        AwaResult pathResult = TreeBuilder_CreateTreeFromOIR(&node, context, origin, oir, oirLength);
+        if (pathResult == AwaResult_Success)
+        {
+            nodes[numberRead] = node;
+            paths[numberRead] = paths[i];
+            numberRead++;
+        }
+        else
+        {
+            Lwm2m_Debug("Composite path /%d/%d/%d cannot be read: %d\n", oir[0], oir[1], oir[2], pathResult);
+            Lwm2mTreeNode_DeleteRecursive(node);
+            *result = pathResult;
+        }
+    }
+    *numberOfPaths = numberRead;
+
+    if (numberRead > 0)
+    {
+        *result = AwaResult_Success;
+        len = SenMLJson_SerialisePaths(nodes, paths, numberRead, buffer, size);
+        if (len < 0)
+        {
+            *result = AwaResult_InternalError;
+        }
+    }
+
+    for (i = 0; i < numberRead; i++)
+    {
+        Lwm2mTreeNode_DeleteRecursive(nodes[i]);
+    }
+    return len;
+}
+
+// Handle LwM2M Observe-Composite notifications, sending the paths that are due in one CoAP message. Return 0 on success, non-zero on error.
+static int HandleCompositeNotification(void * ctxt, AddressType * addr, int sequence, const char * token, int tokenLength,
+        const ObjectInstanceResourceKey * duePaths, int numberOfDuePaths, AwaContentType contentType, void * ContextData)
+{
+    Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
+    enum
+    {
+        PATH_LEN = 128
+    };
+    char path[PATH_LEN] =
+    { 0 };
+    static char payload[MAX_COMPOSITE_PAYLOAD_LENGTH];
+    ObjectInstanceResourceKey paths[MAX_COMPOSITE_PATHS];
+    int numberOfPaths = (numberOfDuePaths < MAX_COMPOSITE_PATHS) ? numberOfDuePaths : MAX_COMPOSITE_PATHS;
+    AwaResult result;
+    Lwm2mRequestOrigin origin = Lwm2mCore_ServerIsBootstrap(context, addr) ? Lwm2mRequestOrigin_BootstrapServer : Lwm2mRequestOrigin_Server;
+
+    Lwm2mCore_AddressTypeToPath(path, PATH_LEN, addr);
+    strncat(path, "/", PATH_LEN - strlen(path));
+
+    memcpy(paths, duePaths, numberOfPaths * sizeof(ObjectInstanceResourceKey));
+    int payloadLen = SerialiseComposite(context, origin, paths, &numberOfPaths, payload, sizeof(payload), &result);
+    if (payloadLen >= 0)
+    {
+        Lwm2m_Debug("Send composite Notify to %s\n", path);
+        coap_SendNotify(addr, path, token, tokenLength, contentType, payload, payloadLen, sequence);
+    }
+    return 0;
+}
+
+// Handle CoAP FETCH Requests with Observe, Maps to LWM2M Observe-Composite. Return 0 on success, non-zero on error.
+static int HandleObserveCompositeRequest(void * ctxt, AddressType * addr, const char * token, int tokenLength, AwaContentType contentType,
+        const char * requestContent, size_t requestContentLen, AwaContentType * responseContentType, char * responseContent,
+        size_t * responseContentLen, int * responseCode)
+{
+    Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
+    ObjectInstanceResourceKey paths[MAX_COMPOSITE_PATHS];
+    Lwm2mRequestOrigin origin = Lwm2mCore_ServerIsBootstrap(context, addr) ? Lwm2mRequestOrigin_BootstrapServer : Lwm2mRequestOrigin_Server;
+    AwaResult result;
+    int len = -1;
+
+    int numberOfPaths = DeserialiseCompositePaths(context, contentType, requestContent, requestContentLen, paths, &result);
+    if (numberOfPaths > 0)
+    {
+        // Only paths that can be read are observed
+        len = SerialiseComposite(context, origin, paths, &numberOfPaths, responseContent, *responseContentLen, &result);
+        if ((len >= 0) && (Lwm2m_ObserveComposite(context, addr, token, tokenLength, paths, numberOfPaths, AwaContentType_ApplicationSenmlJson,
+                                                  HandleCompositeNotification, NULL) != 0))
+        {
+            len = -1;
+            result = AwaResult_InternalError;
+        }
+    }
+
+    *responseContentType = (len >= 0) ? AwaContentType_ApplicationSenmlJson : AwaContentType_None;
+    *responseContentLen = (len >= 0) ? len : 0;
+    *responseCode = (len >= 0) ? AwaResult_SuccessContent : result;
+    return 0;
+}
+
+// Handle CoAP FETCH Requests with Cancel Observe, Maps to LWM2M Cancel Observe-Composite. Return 0 on success, non-zero on error.
+static int HandleCancelObserveCompositeRequest(void * ctxt, AddressType * addr, const char * token, int tokenLength, AwaContentType contentType,
+        const char * requestContent, size_t requestContentLen, AwaContentType * responseContentType, char * responseContent,
+        size_t * responseContentLen, int * responseCode)
+{
+    Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
+    ObjectInstanceResourceKey paths[MAX_COMPOSITE_PATHS];
+    Lwm2mRequestOrigin origin = Lwm2mCore_ServerIsBootstrap(context, addr) ? Lwm2mRequestOrigin_BootstrapServer : Lwm2mRequestOrigin_Server;
+    AwaResult result;
+    int len = -1;
+
+    // The observation is identified by its token, and its paths are read as for the observation itself
+    int numberOfPaths = DeserialiseCompositePaths(context, contentType, requestContent, requestContentLen, paths, &result);
+    if (numberOfPaths > 0)
+    {
+        Lwm2m_CancelObserveComposite(context, addr, token, tokenLength);
+        len = SerialiseComposite(context, origin, paths, &numberOfPaths, responseContent, *responseContentLen, &result);
+    }
+
+    *responseContentType = (len >= 0) ? AwaContentType_ApplicationSenmlJson : AwaContentType_None;
+    *responseContentLen = (len >= 0) ? len : 0;
+    *responseCode = (len >= 0) ? AwaResult_SuccessContent : result;
+    return 0;
+}
+
 // Handler CoAP GET Requests, maps onto LWM2M READ and DISCOVER operations. Return 0 on success, non-zero on error.
 static int HandleGetRequest(void * ctxt, AddressType * addr, const char * path, const char * query, AwaContentType acceptContentType,
         const char * requestContent, size_t requestContentLen, AwaContentType * responseContentType, char * responseContent,
@@ -1708,13 +1955,20 @@ static int HandleWriteAttributesRequest(void * ctxt, AddressType * addr, const c
         goto error;
     }
 
-    NotificationAttributes * attributes = AttributeStore_LookupNotificationAttributes(context->AttributeStore,
-            Lwm2mSecurity_GetShortServerID(context, addr), oir[0], oir[1], oir[2]);
-    if (attributes != NULL )
+    if (context->AttributeStore != NULL )
     {
         // Store changes in a temporary object and only write them on success.
         NotificationAttributes temp;
-        memcpy(&temp, attributes, sizeof(NotificationAttributes));
+        NotificationAttributes * attributes = AttributeStore_LookupNotificationAttributes(context->AttributeStore,
+                Lwm2mSecurity_GetShortServerID(context, addr), oir[0], oir[1], oir[2]);
+        if (attributes != NULL )
+        {
+            memcpy(&temp, attributes, sizeof(NotificationAttributes));
+        }
+        else
+        {
+            memset(&temp, 0, sizeof(NotificationAttributes));
+        }
 
         int numPairs = 0;
         QueryPair * pairs = Lwm2mCore_SplitQuery(query, &numPairs);
@@ -1848,9 +2102,16 @@ static int HandleWriteAttributesRequest(void * ctxt, AddressType * addr, const c
             }
             else
             {
-                // Query was fully checked - copy attributes
-                memcpy(attributes, &temp, sizeof(NotificationAttributes));
-                *responseCode = AwaResult_SuccessChanged;
+                // Query was fully checked - store attributes
+                if (AttributeStore_SetNotificationAttributes(context->AttributeStore, shortServerID, oir[0], oir[1], oir[2], &temp) == 0)
+                {
+                    Lwm2m_RescheduleObservers(context);
+                    *responseCode = AwaResult_SuccessChanged;
+                }
+                else
+                {
+                    *responseCode = AwaResult_InternalError;
+                }
             }
             Lwm2mCore_FreeQueryPairs(pairs, numPairs);
             pairs = NULL;
@@ -2149,6 +2410,162 @@ static int HandleDeleteRequest(void * ctxt, AddressType * addr, const char * pat
     return 0;
 }
 
+// Start a blockwise write with its first block: only a write of a single-instance opaque resource, as an opaque or
+// single resource TLV payload, is written block by block. Sets value and valueLength to the part of the block holding
+// the start of the value. Return AwaResult_SuccessChanged on success, or various errors on failure.
+static AwaResult StartBlockwiseWrite(Lwm2mContextType * context, CoapRequest * request, const uint8_t ** value, size_t * valueLength)
+{
+    Lwm2mBlockWriteType * write = &context->BlockWrite;
+    Lwm2mRequestOrigin origin = Lwm2mCore_ServerIsBootstrap(context, &request->addr) ? Lwm2mRequestOrigin_BootstrapServer : Lwm2mRequestOrigin_Server;
+    int oir[3] = { -1, -1, -1 };
+    ResourceDefinition * definition;
+
+    write->InProgress = false;
+
+    if ((sscanf(request->path, "/%5d/%5d/%5d", &oir[0], &oir[1], &oir[2]) != 3) ||
+        ((definition = Definition_LookupResourceDefinition(context->Definitions, oir[0], oir[2])) == NULL) ||
+        (definition->Type != AwaResourceType_Opaque) || IS_MULTIPLE_INSTANCE(definition))
+    {
+        Lwm2m_Error("Write to %s is too large to be written at once\n", request->path);
+        return AwaResult_RequestEntityTooLarge;
+    }
+
+    if ((origin == Lwm2mRequestOrigin_Server) && ((oir[0] == LWM2M_SECURITY_OBJECT) || !Operations_IsResourceTypeWritable(definition->Operation)))
+    {
+        Lwm2m_Error("Permissions do not allow writing to %s\n", request->path);
+        return (oir[0] == LWM2M_SECURITY_OBJECT) ? AwaResult_Unauthorized : AwaResult_MethodNotAllowed;
+    }
+
+    if (!Lwm2mCore_Exists(context, oir[0], oir[1], -1))
+    {
+        return AwaResult_NotFound;
+    }
+
+    if (!Lwm2mCore_Exists(context, oir[0], oir[1], oir[2]))
+    {
+        // Replace requires the resource to exist, partial update may create an optional resource
+        if (((request->type == COAP_PUT_REQUEST) && (origin == Lwm2mRequestOrigin_Server)) ||
+            (Lwm2mCore_CreateOptionalResource(context, oir[0], oir[1], oir[2]) == -1))
+        {
+            return AwaResult_NotFound;
+        }
+    }
+
+    write->HeaderLength = 0;
+    write->ValueLength = 0;
+
+    switch (request->contentType)
+    {
+    case AwaContentType_ApplicationOctetStream:
+    case AwaContentType_ApplicationOmaLwm2mOpaque:
+        break;
+
+    case AwaContentType_ApplicationOmaLwm2mTLV:
+    {
+        ResourceIDType resourceID;
+        int length;
+        int headerLength = TlvDecodeResourceHeader(&resourceID, &length, *value, *valueLength);
+        if ((headerLength < 0) || (resourceID != oir[2]) || (length <= 0))
+        {
+            Lwm2m_Error("Write to %s is not a single resource TLV\n", request->path);
+            return AwaResult_RequestEntityTooLarge;
+        }
+        write->HeaderLength = headerLength;
+        write->ValueLength = length;
+        *value += headerLength;
+        *valueLength -= headerLength;
+        break;
+    }
+
+    default:
+        Lwm2m_Error("Write to %s with content type %d cannot be written block by block\n", request->path, request->contentType);
+        return AwaResult_RequestEntityTooLarge;
+    }
+
+    memcpy(&write->Address, &request->addr, sizeof(write->Address));
+    write->ObjectID = oir[0];
+    write->ObjectInstanceID = oir[1];
+    write->ResourceID = oir[2];
+    write->NextOffset = 0;
+    write->Changed = false;
+    write->InProgress = true;
+    return AwaResult_SuccessChanged;
+}
+
+// Handle a block of a blockwise (Block1) write. Rather than reassembling the request, each block is written through to
+// the resource as it arrives, so a large value (e.g. a firmware package) is never held in memory as a whole.
+static int HandleBlockwiseWriteRequest(Lwm2mContextType * context, CoapRequest * request, CoapResponse * response)
+{
+    Lwm2mBlockWriteType * write = &context->BlockWrite;
+    const uint8_t * value = (const uint8_t *) request->requestContent;
+    size_t valueLength = request->requestContentLen;
+    int oir[3] = { -1, -1, -1 };
+
+    response->responseContentType = AwaContentType_None;
+    response->responseContentLen = 0;
+
+    Lwm2m_Debug("WRITE (block at %zu): %s\n", request->requestContentOffset, request->path);
+
+    sscanf(request->path, "/%5d/%5d/%5d", &oir[0], &oir[1], &oir[2]);
+
+    if (request->requestContentOffset == 0)
+    {
+        response->responseCode = StartBlockwiseWrite(context, request, &value, &valueLength);
+    }
+    else if (!write->InProgress || (request->requestContentOffset != write->NextOffset) ||
+             (Lwm2mCore_CompareAddresses(&write->Address, &request->addr) != 0) ||
+             (oir[0] != write->ObjectID) || (oir[1] != write->ObjectInstanceID) || (oir[2] != write->ResourceID))
+    {
+        Lwm2m_Error("Block at %zu of write to %s does not follow the blocks received\n", request->requestContentOffset, request->path);
+        response->responseCode = AwaResult_RequestEntityIncomplete;
+        return 0;
+    }
+    else
+    {
+        response->responseCode = AwaResult_SuccessChanged;
+    }
+
+    if (response->responseCode == AwaResult_SuccessChanged)
+    {
+        size_t offset = (request->requestContentOffset > 0) ? request->requestContentOffset - write->HeaderLength : 0;
+        bool more = request->requestContentMore;
+        bool changed = false;
+
+        // A TLV value must end with the last block
+        if ((write->ValueLength > 0) && ((offset + valueLength > write->ValueLength) || (more != (offset + valueLength < write->ValueLength))))
+        {
+            Lwm2m_Error("Block at %zu of write to %s does not match the length of the value\n", request->requestContentOffset, request->path);
+            response->responseCode = AwaResult_BadRequest;
+        }
+        else
+        {
+            response->responseCode = SetResourceInstanceValueBlock(context, write->ObjectID, write->ObjectInstanceID, write->ResourceID, 0,
+                                                                   value, valueLength, offset, more, &changed);
+        }
+
+        if (response->responseCode == AwaResult_SuccessChanged)
+        {
+            write->NextOffset = request->requestContentOffset + request->requestContentLen;
+            write->Changed = write->Changed || changed;
+
+            if (!more)
+            {
+                // Opaque values have no notification attributes to check, so the last block stands in for the value
+                if (write->Changed)
+                {
+                    Lwm2m_MarkObserversChanged(context, write->ObjectID, write->ObjectInstanceID, write->ResourceID, value, valueLength);
+                }
+                write->InProgress = false;
+            }
+        }
+        else
+        {
+            write->InProgress = false;
+        }
+    }
+    return 0;
+}
+
 // Handler for all "lwm2m" endpoints
 static int DeviceManagmentEndpointHandler(int type, void * ctxt, AddressType * addr, const char * path, const char * query,
         const char * token, int tokenLength, AwaContentType contentType, const char * requestContent, size_t requestContentLen,
@@ -2208,6 +2625,20 @@ static int Lwm2mCore_HandleRequest(CoapRequest * request, CoapResponse * respons
 {
     Lwm2mContextType * context = (Lwm2mContextType *) request->ctxt;
 
+    // Composite operations are addressed to the root, rather than to an endpoint
+    if (request->type == COAP_OBSERVE_COMPOSITE_REQUEST)
+    {
+        return HandleObserveCompositeRequest(context, &request->addr, request->token, request->tokenLength, request->contentType,
+                request->requestContent, request->requestContentLen, &response->responseContentType, response->responseContent,
+                &response->responseContentLen, &response->responseCode);
+    }
+    else if (request->type == COAP_CANCEL_OBSERVE_COMPOSITE_REQUEST)
+    {
+        return HandleCancelObserveCompositeRequest(context, &request->addr, request->token, request->tokenLength, request->contentType,
+                request->requestContent, request->requestContentLen, &response->responseContentType, response->responseContent,
+                &response->responseContentLen, &response->responseCode);
+    }
+
     // Look up the supplied path to determine what type of resource endpoint we are handling here.
     // There is a bit of a catch 22 here, because we need to lookup the endpoint type to determine how to lookup the endpoint
     // type. Therefore assume that GET requests are only ever valid for resources that exist, whereas POST/PUT/DELETE
@@ -2231,6 +2662,12 @@ static int Lwm2mCore_HandleRequest(CoapRequest * request, CoapResponse * respons
         return 0;
     }
 
+    if (((request->type == COAP_PUT_REQUEST) || (request->type == COAP_POST_REQUEST)) &&
+        ((request->requestContentOffset > 0) || request->requestContentMore) && (endPoint->Handler == DeviceManagmentEndpointHandler))
+    {
+        return HandleBlockwiseWriteRequest(context, request, response);
+    }
+
     return endPoint->Handler(request->type, request->ctxt, &request->addr, request->path, request->query, request->token,
             request->tokenLength, request->contentType, request->requestContent, request->requestContentLen, &response->responseContentType,
             response->responseContent, &response->responseContentLen, &response->responseCode);
@@ -2287,7 +2724,12 @@ int Lwm2mCore_Process(Lwm2mContextType * context)
         Lwm2m_UpdateBootStrapState(context);
     }
 
-    Lwm2m_UpdateObservers(context);
+    // wake up in time for the next notification
+    int observersTimeout = Lwm2m_UpdateObservers(context);
+    if ((observersTimeout >= 0) && (observersTimeout < nextTick))
+    {
+        nextTick = observersTimeout;
+    }
     return nextTick;
 }
 
@@ -2337,6 +2779,16 @@ struct ListHead * Lwm2mCore_GetObserverList(Lwm2mContextType * context)
     return &context->ObserverList;
 }
 
+HashTable * Lwm2mCore_GetObserverIndex(Lwm2mContextType * context)
+{
+    return &context->ObserverIndex;
+}
+
+Heap * Lwm2mCore_GetObserverDeadlines(Lwm2mContextType * context)
+{
+    return &context->ObserverDeadlines;
+}
+
 AttributeStore * Lwm2mCore_GetAttributes(Lwm2mContextType * context)
 {
     return context->AttributeStore;
@@ -2382,6 +2834,8 @@ Lwm2mContextType * Lwm2mCore_New()
     Lwm2mContextType * context = &Lwm2mContext;
 
     ListInit(&context->ObserverList);
+    HashTable_Init(&context->ObserverIndex, 64);
+    Heap_Init(&context->ObserverDeadlines, 0);
     ListInit(&context->ServerList);
     Lwm2mObjectTree_Init(&context->ObjectTree);
 
@@ -2477,4 +2931,6 @@ void Lwm2mCore_Destroy(Lwm2mContextType * context)
     AttributeStore_Destroy(context->AttributeStore);
     DefinitionRegistry_Destroy(context->Definitions);
     Lwm2m_FreeObservers(context);
+    HashTable_Destroy(&context->ObserverIndex);
+    Heap_Destroy(&context->ObserverDeadlines);
 }
@@ -98,7 +98,7 @@ AwaError AwaStaticClient_Init(AwaStaticClient * client)
     {
         if (client->CoAPConfigured && client->BootstrapConfigured && client->EndpointNameConfigured)
         {
-            client->CoAPInfo = coap_Init(client->CoAPListenAddress, client->CoAPListenPort, false, Lwm2m_GetLogLevel());
+            client->CoAPInfo = coap_Init(client->CoAPListenAddress, client->CoAPListenPort, false, false, Lwm2m_GetLogLevel());
 
             if (client->CoAPInfo != NULL)
             {
@@ -501,6 +501,43 @@ static AwaResult DefaultHandler(AwaStaticClient * client, AwaOperation operation
     return result;
 }
 
+// Copy each block of a large write into the resource's data as it arrives
+static AwaResult DefaultWriteBlockHandler(AwaStaticClient * client,
+                                          AwaObjectID objectID, AwaObjectInstanceID objectInstanceID, AwaResourceID resourceID, AwaResourceInstanceID resourceInstanceID,
+                                          const void * data, size_t dataSize, size_t offset, bool more, bool * changed)
+{
+    AwaResult result = AwaResult_BadRequest;
+
+    ObjectDefinition * objectDefinition = Definition_LookupObjectDefinition(Lwm2mCore_GetDefinitions(client->Context), objectID);
+    ResourceDefinition * resourceDefinition = (objectDefinition != NULL) ? Definition_LookupResourceDefinitionFromObjectDefinition(objectDefinition, resourceID) : NULL;
+
+    if ((resourceDefinition != NULL) && (objectInstanceID >= 0) && (objectInstanceID < objectDefinition->MaximumInstances))
+    {
+        uint8_t * element;
+
+        if (resourceDefinition->IsPointerArray)
+        {
+            element = resourceDefinition->DataPointers + (objectInstanceID * sizeof(void*));
+        }
+        else
+        {
+            element = resourceDefinition->DataPointers + (resourceDefinition->DataStepSize * objectInstanceID);
+        }
+
+        if ((offset <= resourceDefinition->DataElementSize) && (dataSize <= resourceDefinition->DataElementSize - offset))
+        {
+            if (offset == 0)
+            {
+                memset(element, 0, resourceDefinition->DataElementSize);
+            }
+            memcpy(element + offset, data, dataSize);
+            *changed = true;
+            result = AwaResult_SuccessChanged;
+        }
+    }
+    return result;
+}
+
 AwaError AwaStaticClient_DefineObject(AwaStaticClient * client, AwaObjectID objectID, const char * objectName,
                                       uint16_t minimumInstances, uint16_t maximumInstances)
 {
@@ -780,6 +817,7 @@ static AwaError SetResourceStorage(AwaStaticClient * client, AwaObjectID objectI
             if (resourceDefinition != NULL)
             {
                 resourceDefinition->Handler = (LWM2MHandler)handler;
+                resourceDefinition->WriteBlockHandler = (handler == DefaultHandler) ? (LWM2MWriteBlockHandler)DefaultWriteBlockHandler : NULL;
                 resourceDefinition->DataPointers = dataPointers;
                 resourceDefinition->IsPointerArray = isPointerArray;
                 resourceDefinition->DataElementSize = dataElementSize;
@@ -835,6 +873,39 @@ AwaError AwaStaticClient_SetResourceOperationHandler(AwaStaticClient * client, A
     return result;
 }
 
+AwaError AwaStaticClient_SetResourceWriteBlockHandler(AwaStaticClient * client, AwaObjectID objectID, AwaResourceID resourceID, AwaStaticClientWriteBlockHandler handler)
+{
+    AwaError result = AwaError_Unspecified;
+    if (client == NULL)
+    {
+        result = AwaError_StaticClientInvalid;
+    }
+    else if (handler == NULL)
+    {
+        result = AwaError_DefinitionInvalid;
+    }
+    else
+    {
+        ResourceDefinition * resourceDefinition = Definition_LookupResourceDefinition(Lwm2mCore_GetDefinitions(client->Context), objectID, resourceID);
+        if (resourceDefinition == NULL)
+        {
+            Lwm2m_Warning("resourceDefinition is NULL\n");
+            result = AwaError_DefinitionInvalid;
+        }
+        else if ((resourceDefinition->Type != AwaResourceType_Opaque) || IS_MULTIPLE_INSTANCE(resourceDefinition))
+        {
+            Lwm2m_Warning("Write block handlers are only supported for single-instance opaque resources\n");
+            result = AwaError_DefinitionInvalid;
+        }
+        else
+        {
+            resourceDefinition->WriteBlockHandler = (LWM2MWriteBlockHandler)handler;
+            result = AwaError_Success;
+        }
+    }
+    return result;
+}
+
 AwaError AwaStaticClient_SetResourceStorageWithPointer(AwaStaticClient * client, AwaObjectID objectID, AwaResourceID resourceID, void * dataPointer, size_t dataElementSize, size_t dataStepSize)
 {
     AwaError result = AwaError_Unspecified;
@@ -37,6 +37,8 @@ extern "C" {
 #define COAP_DELETE_REQUEST 3
 #define COAP_OBSERVE_REQUEST 4
 #define COAP_CANCEL_OBSERVE_REQUEST 5
+#define COAP_OBSERVE_COMPOSITE_REQUEST 6         // FETCH with Observe, for the paths named in the payload
+#define COAP_CANCEL_OBSERVE_COMPOSITE_REQUEST 7
 
 typedef struct
 {
@@ -50,6 +52,8 @@ typedef struct
     AwaContentType contentType;
     const char * requestContent;
     size_t requestContentLen;
+    size_t requestContentOffset;       // position of requestContent in a blockwise (Block1) request payload
+    bool requestContentMore;           // further blocks of the request payload follow
 
 } CoapRequest;
 
@@ -61,6 +65,7 @@ typedef struct
     char * responseLocation;
     size_t responseLocationLen;
     int responseCode;
+    uint32_t responseMaxAge;           // Max-Age option in seconds, omitted if zero
 
 } CoapResponse;
 
@@ -75,14 +80,21 @@ typedef struct
 
 extern const char * coap_LibraryName;
 
-CoapInfo * coap_Init(const char * ipAddress, int port, bool secure, int logLevel);
+/* If tcp is set, CoAP over TCP (RFC 8323) connections are also accepted on port. Requests to coap+tcp:// URIs are
+ * sent over a connection either way.
+ */
+CoapInfo * coap_Init(const char * ipAddress, int port, bool secure, bool tcp, int logLevel);
 
 void coap_Reset(const char * uri);
 void coap_SetCertificate(const uint8_t * cert, int certLength, AwaCertificateFormat format);
 void coap_SetPSK(const char * identity, const uint8_t * key, int keyLength);
 
 int coap_Destroy(void);
-void coap_Process(void);
+
+/* Handle CoAP timers such as retransmissions. Returns the time in milliseconds until it should next be called,
+ * or -1 if there are no pending timers.
+ */
+int coap_Process(void);
 void coap_HandleMessage(void);
 
 void coap_SetLogLevel(int logLevel);
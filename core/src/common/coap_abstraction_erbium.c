@@ -20,29 +20,86 @@
  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  ************************************************************************************************************************/
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include "coap_abstraction.h"
 #include "lwm2m_debug.h"
+#include "lwm2m_hash.h"
+#include "lwm2m_list.h"
+#include "lwm2m_metrics.h"
+#include "lwm2m_util.h"
 #include "network_abstraction.h"
 #include "dtls_abstraction.h"
 
 #include "er-resource.h"
 #include "er-coap-engine.h"
 #include "er-coap.h"
+#include "er-coap-dedup.h"
+#include "er-coap-block2.h"
 
 #ifndef MAX_COAP_PATH
 #define MAX_COAP_PATH 64
 #endif
 
+#ifndef MAX_COAP_REQUESTS_PER_DESTINATION
+#define MAX_COAP_REQUESTS_PER_DESTINATION (8)
+#endif
+
+// Time to wait for a separate response after the request was acknowledged (MAX_TRANSMIT_WAIT, RFC 7252 section 4.8.2)
+#ifndef COAP_SEPARATE_RESPONSE_TIMEOUT
+#define COAP_SEPARATE_RESPONSE_TIMEOUT (93 * 1000)
+#endif
+
+#define COAP_REQUEST_TOKEN_LENGTH (sizeof(uint32_t))
+
+// Each destination may have up to MAX_COAP_REQUESTS_PER_DESTINATION requests in flight - further requests
+// are queued and sent in order as responses (or timeouts) free up a slot.
+typedef struct
+{
+    HashTableNode Node;
+    NetworkAddress * Address;
+    int RequestsInFlight;
+    struct ListHead Queue;
+} DestinationType;
+
+typedef enum
+{
+    RequestState_Queued,                // waiting for a free slot, not sent
+    RequestState_InFlight,              // sent, waiting for the response or an acknowledgement
+    RequestState_AwaitingResponse,      // acknowledged, waiting for a separate response
+
+} RequestState;
+
 typedef struct
 {
+    HashTableNode TokenNode;
+    struct ListHead list;               // destination queue, or separate response list
+    RequestState State;
+    DestinationType * Destination;
+    uint16_t MID;
+    uint8_t Token[COAP_REQUEST_TOKEN_LENGTH];
     AddressType Address;
     char Path[MAX_COAP_PATH];
     TransactionCallback Callback;
     void * Context;
-    bool TransactionUsed;
     coap_transaction_t * TransactionPtr;
+    uint64_t SendTime;
+    uint8_t * Packet;                   // serialised request while queued
+    uint16_t PacketLength;
+    char * Query;                       // URI query, repeated in requests for further blocks
+    int Observation;                    // token of the observation whose notification is being fetched, or zero
+    uint8_t * Payload;                  // blocks of a blockwise response received so far
+    size_t PayloadLength;
+    int PayloadContentType;
+    uint8_t ETag[COAP_ETAG_LEN];
+    uint8_t ETagLength;
+    coap_method_t Method;
+    int ContentType;
+    uint8_t * Content;                  // request payload too large for one message, sent a block at a time
+    size_t ContentLength;
+    size_t ContentOffset;               // position of the block in flight
+    uint16_t ContentBlockSize;
 } TransactionType;
 
 #define COAP_OPTION_TO_RESPONSE_CODE(N) (((N >> 5) * 100) | (N & 0x1f))
@@ -55,55 +112,80 @@ static RequestHandler requestHandler = NULL;
 
 const char * coap_LibraryName = "Erbium";
 
-#ifndef MAX_COAP_TRANSACTIONS
-#define MAX_COAP_TRANSACTIONS (2)
-#endif
-
-int CurrentTransactionIndex = 0;
-TransactionType CurrentTransaction[MAX_COAP_TRANSACTIONS];
+static HashTable requestsByToken;           // outstanding requests, by token
+static HashTable destinations;              // destinations with requests in flight or queued, by address
+static struct ListHead awaitingResponses;   // acknowledged requests waiting for a separate response
+static uint32_t nextToken = 0;
 
 static NetworkSocket * networkSocket = NULL;
 extern NetworkAddress * sourceAddress;
 
+// GET responses are rendered here, so that a response too large for one block can be kept and sent block by block
+static char blockwiseBuffer[COAP_MAX_BLOCKWISE_SIZE];
+
+// Requests and notifications are serialised here - a message over a connection may carry a BERT block
+static uint8_t messageBuffer[COAP_MAX_MESSAGE_SIZE_TCP + 1];
+
 typedef enum
 {
     ObserveState_None, ObserveState_Establish, ObserveState_Cancel
 } ObserveState;
 
+// Observations established by this end point, indexed by token (to match notifications) and by address and
+// path (to cancel them). The path is allocated with the observation, so each costs sizeof(Observation) plus
+// the length of its path - see Metric_CoapObservationBytes.
 typedef struct
 {
+    HashTableNode TokenNode;
+    HashTableNode PathNode;
     NetworkAddress * Address;
-    char Path[MAX_COAP_PATH];
     int Token;
     TransactionCallback Callback;
     void * Context;
+    char Path[];
 } Observation;
 
-#ifndef MAX_COAP_OBSERVATIONS
-#define MAX_COAP_OBSERVATIONS (10)
-#endif
+typedef struct
+{
+    NetworkAddress * Address;
+    const char * Path;
+    int Token;
+} ObservationKey;
 
-Observation Observations[MAX_COAP_OBSERVATIONS];
+static HashTable observationsByToken;
+static HashTable observationsByPath;
 
 static int coap_HandleRequest(void *packet, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+static void coap_CoapRequestCallback(void *callback_data, void *response);
 static int addObserve(NetworkAddress * remoteAddress, char * path, TransactionCallback callback, void * context);
 static int removeObserve(NetworkAddress * remoteAddress, char * path);
+static Observation * findObservation(int token, NetworkAddress * remoteAddress);
+static void freeObservation(Observation * observation);
 
-CoapInfo * coap_Init(const char * ipAddress, int port, bool secure, int logLevel)
+CoapInfo * coap_Init(const char * ipAddress, int port, bool secure, bool tcp, int logLevel)
 {
     CoapInfo * result = NULL;
-    memset(CurrentTransaction, 0, sizeof(CurrentTransaction));
-    memset(Observations, 0, sizeof(Observations));
+    HashTable_Init(&requestsByToken, 0);
+    HashTable_Init(&destinations, 0);
+    ListInit(&awaitingResponses);
+    nextToken = rand();
+    HashTable_Init(&observationsByToken, 0);
+    HashTable_Init(&observationsByPath, 0);
     coap_init_connection(port);
     coap_init_transactions();
+    coap_init_dedup();
+    coap_init_block2();
     coap_set_service_callback(coap_HandleRequest);
     DTLS_Init();
+    NetworkSocketType socketType = NetworkSocketType_UDP;
     if (secure)
-    	networkSocket = NetworkSocket_New(ipAddress, NetworkSocketType_UDP | NetworkSocketType_Secure, port);
-    else
-    	networkSocket = NetworkSocket_New(ipAddress, NetworkSocketType_UDP, port);
+        socketType |= NetworkSocketType_Secure;
+    if (tcp)
+        socketType |= NetworkSocketType_TCP;
+    networkSocket = NetworkSocket_New(ipAddress, socketType, port);
     if (networkSocket)
     {
+        NetworkSocket_SetMaxMessageSize(networkSocket, COAP_MAX_MESSAGE_SIZE_TCP);
         if (NetworkSocket_StartListening(networkSocket))
         {
             Lwm2m_Info("Bind port: %d\n", port);
@@ -146,11 +228,25 @@ void coap_SetLogLevel(int logLevel)
 
 int coap_WaitMessage(int timeout, int fd)
 {
-    coap_receive(networkSocket);
-    coap_check_transactions();
+    // Messages that arrived together over a connection are all handled, as only the first makes the descriptor readable
+    do
+    {
+        coap_receive(networkSocket);
+    } while (NetworkSocket_HasPendingMessages(networkSocket));
+    int retransmitTimeout = coap_check_transactions();
+    if ((retransmitTimeout >= 0) && (retransmitTimeout < timeout))
+    {
+        timeout = retransmitTimeout;
+    }
     return timeout;
 }
 
+// Responses are kept for blockwise transfer by the path and query of the request
+static void coap_GetBlockUri(char * blockUri, size_t size, const char * path, int pathLength, const char * query, int queryLength)
+{
+    snprintf(blockUri, size, "%.*s%s%.*s", pathLength, path, (queryLength > 0) ? "?" : "", queryLength, query);
+}
+
 static int coap_HandleRequest(void *packet, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
 {
     int result = 1;
@@ -162,15 +258,19 @@ static int coap_HandleRequest(void *packet, void *response, uint8_t *buffer, uin
 
     coap_packet_t * const request = (coap_packet_t *) packet;
 
+    Metrics_Increment(Metric_CoapRequestsReceived);
+
     CoapResponse coapResponse =
     { .responseContent = buffer, .responseContentLen = preferred_size, .responseCode = 400, };
 
     payloadLen = coap_get_payload(request, &payload);
+    urlLen = coap_get_header_uri_path(request, &url);
+    rest_resource_flags_t method = (rest_resource_flags_t) (1 << (((coap_packet_t *) packet)->code - 1)); //coap_get_rest_method(request);
 
-    if ((urlLen = coap_get_header_uri_path(request, &url)))
+    // Composite operations are addressed to the root, and name their paths in the payload
+    if ((urlLen > 0) || (method == METHOD_FETCH))
     {
         char uriBuf[MAX_COAP_PATH] = { 0 };
-        rest_resource_flags_t method = (rest_resource_flags_t) (1 << (((coap_packet_t *) packet)->code - 1)); //coap_get_rest_method(request);
 
         uriBuf[0] = '/';
         memcpy(&uriBuf[1], url, urlLen);
@@ -191,6 +291,24 @@ static int coap_HandleRequest(void *packet, void *response, uint8_t *buffer, uin
 
         NetworkAddress_SetAddressType(sourceAddress, &coapRequest.addr);
 
+        char blockUri[MAX_COAP_PATH + sizeof(queryBuf)];
+        coap_block2_entry_t * block = NULL;
+
+        // Each block of a blockwise (Block1) request is passed to the handler as it arrives, rather than reassembled
+        uint32_t block1Num = 0;
+        uint8_t block1More = 0;
+        uint16_t block1Size = 0;
+        uint32_t block1Offset = 0;
+        bool block1 = coap_get_header_block1(request, &block1Num, &block1More, &block1Size, &block1Offset);
+        if (block1)
+        {
+            Metrics_Increment(Metric_CoapBlocksReceived);
+            coapRequest.requestContentOffset = block1Offset;
+            coapRequest.requestContentMore = block1More;
+        }
+
+        int32_t observe;
+
         switch (method)
         {
         case METHOD_GET:
@@ -198,14 +316,27 @@ static int coap_HandleRequest(void *packet, void *response, uint8_t *buffer, uin
             coap_get_header_accept(request, &content);
             coapRequest.contentType = content;
 
-            int32_t observe;
-
             if (!coap_get_header_observe(request, &observe))
                 observe = -1;
 
+            coapResponse.responseContent = blockwiseBuffer;
+            coapResponse.responseContentLen = sizeof(blockwiseBuffer);
+            coap_GetBlockUri(blockUri, sizeof(blockUri), url, urlLen, (queryLength > 0) ? query : "", queryLength);
+
             switch (observe)
             {
             case -1:
+                // Later blocks of a large response are served from the copy kept when the first block was sent
+                if ((*offset > 0) && ((block = coap_block2_find(sourceAddress, blockUri)) != NULL) &&
+                    ((content == -1) || (content == block->content_format)))
+                {
+                    Lwm2m_Debug("Coap GET for %s, block at %d\n", uriBuf, *offset);
+                    coapResponse.responseContentType = block->content_format;
+                    coapResponse.responseContentLen = block->length;
+                    coapResponse.responseCode = 205;
+                    break;
+                }
+                block = NULL;
                 Lwm2m_Debug("Coap GET for %s\n", uriBuf);
                 coapRequest.type = COAP_GET_REQUEST;
                 requestHandler(&coapRequest, &coapResponse);
@@ -258,19 +389,101 @@ static int coap_HandleRequest(void *packet, void *response, uint8_t *buffer, uin
             requestHandler(&coapRequest, &coapResponse);
             break;
 
+        case METHOD_FETCH:
+            // Only Observe-Composite and its cancellation are supported - the paths are in the payload, in its content format
+            coap_get_header_content_format(request, &content);
+            coapRequest.contentType = content;
+
+            if (!coap_get_header_observe(request, &observe))
+                observe = -1;
+
+            switch (observe)
+            {
+            case 0:
+                Lwm2m_Debug("Coap OBSERVE COMPOSITE for %s\n", uriBuf);
+
+                coapRequest.type = COAP_OBSERVE_COMPOSITE_REQUEST;
+                requestHandler(&coapRequest, &coapResponse);
+                // the observation is only registered if the paths were read
+                if (coapResponse.responseCode == 205)
+                {
+                    coap_set_header_observe(response, 1);
+                }
+                break;
+            case 1:
+                Lwm2m_Debug("Coap CANCEL OBSERVE COMPOSITE for %s\n", uriBuf);
+
+                coapRequest.type = COAP_CANCEL_OBSERVE_COMPOSITE_REQUEST;
+                requestHandler(&coapRequest, &coapResponse);
+                break;
+            default:
+                coapResponse.responseCode = 405;
+                break;
+            }
+            coap_set_header_content_format(response, coapResponse.responseContentType);
+            break;
+
         default:
             break;
         }
 
+        if (block1 && ((method == METHOD_POST) || (method == METHOD_PUT)) && (coapResponse.responseCode < 400))
+        {
+            // Acknowledge the block - the handler's response is only sent for the last block
+            if (block1More)
+            {
+                coapResponse.responseCode = 231;
+                coapResponse.responseContentLen = 0;
+            }
+            coap_set_header_block1(response, block1Num, block1More, block1Size);
+        }
+
         Lwm2m_Debug("Coap Response code %d\n", coapResponse.responseCode);
 
         if (coapResponse.responseContentLen > 0 && coapResponse.responseCode == 205)
         {
-            coap_set_payload(response, coapResponse.responseContent, coapResponse.responseContentLen);
+            if (method != METHOD_GET)
+            {
+                coap_set_payload(response, coapResponse.responseContent, coapResponse.responseContentLen);
+            }
+            else if ((block == NULL) && (*offset == 0) && (coapResponse.responseContentLen <= preferred_size))
+            {
+                memcpy(buffer, coapResponse.responseContent, coapResponse.responseContentLen);
+                coap_set_bert_payload(response, buffer, coapResponse.responseContentLen);
+            }
+            else
+            {
+                // Too large for one block - keep the response, and send the requested block. The engine sets the Block2 option.
+                if (block == NULL)
+                {
+                    block = coap_block2_add(sourceAddress, blockUri, coapResponse.responseContentType,
+                                            (const uint8_t *)coapResponse.responseContent, coapResponse.responseContentLen);
+                }
+                if (block == NULL)
+                {
+                    coapResponse.responseCode = 500;
+                }
+                else
+                {
+                    int32_t nextOffset = coap_block2_serve(block, response, *offset, preferred_size, buffer);
+                    if (nextOffset == -2)
+                    {
+                        coapResponse.responseCode = 402;
+                    }
+                    else
+                    {
+                        *offset = nextOffset;
+                    }
+                }
+            }
         }
     }
 
     coap_set_status_code(response, COAP_RESPONSE_CODE(coapResponse.responseCode));
+    if (coapResponse.responseMaxAge > 0)
+    {
+        coap_set_header_max_age(response, coapResponse.responseMaxAge);
+    }
     return result;
 }
 
@@ -319,47 +532,495 @@ bool coap_ResolveAddressByURI(unsigned char * address, AddressType * addr)
     return result;
 }
 
-void coap_CoapRequestCallback(void *callback_data, void *response)
+static bool coap_MatchDestination(const HashTableNode * node, const void * key)
 {
-    TransactionType * transaction = (TransactionType *) callback_data;
-    coap_packet_t * coap_response = (coap_packet_t *) response;
-    int ContentType = 0;
-    const char *url = NULL;
-    char * payload = NULL;
-    char uriBuf[64] =
-    { 0 };
+    return NetworkAddress_Compare(HashTableEntry(node, DestinationType, Node)->Address, (NetworkAddress *)key) == 0;
+}
+
+static bool coap_MatchRequestToken(const HashTableNode * node, const void * key)
+{
+    return memcmp(HashTableEntry(node, TransactionType, TokenNode)->Token, key, COAP_REQUEST_TOKEN_LENGTH) == 0;
+}
 
-    if (transaction != NULL)
+static DestinationType * coap_GetDestination(NetworkAddress * remoteAddress)
+{
+    DestinationType * destination = NULL;
+    uint32_t hash = NetworkAddress_Hash(remoteAddress);
+    HashTableNode * node = HashTable_Find(&destinations, hash, coap_MatchDestination, remoteAddress);
+    if (node != NULL)
+    {
+        destination = HashTableEntry(node, DestinationType, Node);
+    }
+    else
+    {
+        destination = (DestinationType *)malloc(sizeof(DestinationType));
+        if (destination != NULL)
+        {
+            memset(destination, 0, sizeof(DestinationType));
+            destination->Address = remoteAddress;
+            ListInit(&destination->Queue);
+            HashTable_Add(&destinations, &destination->Node, hash);
+        }
+    }
+    return destination;
+}
+
+static TransactionType * coap_FindRequestByToken(const uint8_t * token, size_t tokenLength, NetworkAddress * remoteAddress)
+{
+    TransactionType * result = NULL;
+    if (tokenLength == COAP_REQUEST_TOKEN_LENGTH)
+    {
+        HashTableNode * node = HashTable_Find(&requestsByToken, Hash_Bytes(token, tokenLength, HASH_SEED), coap_MatchRequestToken, token);
+        while (node != NULL)
+        {
+            TransactionType * request = HashTableEntry(node, TransactionType, TokenNode);
+            if (NetworkAddress_Compare(request->Destination->Address, remoteAddress) == 0)
+            {
+                result = request;
+                break;
+            }
+            node = HashTable_FindNext(node, coap_MatchRequestToken, token);
+        }
+    }
+    return result;
+}
+
+static void coap_NewRequestToken(NetworkAddress * remoteAddress, uint8_t * token)
+{
+    // Tokens only need to be unique per destination, but a counter keeps them unique for all outstanding requests
+    do
+    {
+        if (++nextToken == 0)
+            nextToken++;
+        memcpy(token, &nextToken, COAP_REQUEST_TOKEN_LENGTH);
+    } while (coap_FindRequestByToken(token, COAP_REQUEST_TOKEN_LENGTH, remoteAddress) != NULL);
+}
+
+// Send a request, given either as a message to serialise or as one serialised when it was queued. A message is built
+// straight into the packet of its transaction, with the MID it is sent with.
+static bool coap_SendRequest(TransactionType * request, coap_packet_t * message, const uint8_t * packet, uint16_t packetLength)
+{
+    bool result = false;
+    coap_transaction_t * transaction;
+
+    request->MID = coap_get_mid();
+    if (message != NULL)
+    {
+        message->mid = request->MID;
+    }
+    if (NetworkAddress_IsReliable(request->Destination->Address))
+    {
+        if (message != NULL)
+        {
+            packet = messageBuffer;
+            packetLength = coap_serialize_message(message, messageBuffer);
+        }
+        // A connection delivers the request, so there is nothing to retransmit - wait for the response as for a separate response
+        if (NetworkSocket_Send(networkSocket, request->Destination->Address, (uint8_t *)packet, packetLength))
+        {
+            request->State = RequestState_AwaitingResponse;
+            request->TransactionPtr = NULL;
+            request->SendTime = Lwm2mCore_GetTickCountMs();
+            ListAdd(&request->list, &awaitingResponses);
+            request->Destination->RequestsInFlight++;
+            Metrics_Increment(Metric_CoapRequestsInFlight);
+            Metrics_Increment(Metric_CoapRequestsSent);
+            result = true;
+        }
+    }
+    else if ((transaction = coap_new_transaction(networkSocket, request->MID, request->Destination->Address)))
+    {
+        transaction->callback = coap_CoapRequestCallback;
+        transaction->callback_data = request;
+        if (message != NULL)
+        {
+            transaction->packet_len = coap_serialize_message(message, transaction->packet);
+        }
+        else
+        {
+            memcpy(transaction->packet, packet, packetLength);
+            transaction->packet_len = packetLength;
+
+            // The MID is assigned when the request is actually sent, so patch it into the serialised header
+            transaction->packet[2] = (uint8_t)(request->MID >> 8);
+            transaction->packet[3] = (uint8_t)(request->MID);
+        }
+
+        request->State = RequestState_InFlight;
+        request->TransactionPtr = transaction;
+        request->SendTime = Lwm2mCore_GetTickCountMs();
+        request->Destination->RequestsInFlight++;
+        Metrics_Increment(Metric_CoapRequestsInFlight);
+
+        Lwm2m_Debug("Sending transaction %u: %p\n", request->MID, transaction);
+        Metrics_Increment(Metric_CoapRequestsSent);
+        coap_send_transaction(transaction);
+        result = true;
+    }
+    return result;
+}
+
+static void coap_ReleaseRequest(TransactionType * request)
+{
+    free(request->Packet);
+    free(request->Query);
+    free(request->Payload);
+    free(request->Content);
+    free(request);
+}
+
+static void coap_FreeRequest(TransactionType * request)
+{
+    HashTable_Remove(&requestsByToken, &request->TokenNode);
+    coap_ReleaseRequest(request);
+}
+
+// Send the request if its destination has a free slot, otherwise queue it
+static bool coap_SubmitRequest(TransactionType * request, coap_packet_t * message)
+{
+    bool result = false;
+    DestinationType * destination = request->Destination;
+
+    if (destination->RequestsInFlight < MAX_COAP_REQUESTS_PER_DESTINATION)
     {
-        if (transaction->Callback)
+        result = coap_SendRequest(request, message, NULL, 0);
+    }
+    else
+    {
+        // Keep a copy of the serialised request until a slot is free
+        uint16_t packetLength = coap_serialize_message(message, messageBuffer);
+        if ((request->Packet = (uint8_t *)malloc(packetLength)) != NULL)
         {
-            if (response != NULL )
+            memcpy(request->Packet, messageBuffer, packetLength);
+            request->PacketLength = packetLength;
+            request->State = RequestState_Queued;
+            ListAdd(&request->list, &destination->Queue);
+            Metrics_Increment(Metric_CoapRequestsQueued);
+            Lwm2m_Debug("Queued request for %s (%d in flight)\n", request->Path, destination->RequestsInFlight);
+            result = true;
+        }
+    }
+    return result;
+}
+
+// Ask for a further block of a large response (RFC 7959) - the request is repeated with a Block2 option, but without Observe
+static bool coap_RequestBlock(TransactionType * request, uint32_t num, uint16_t size)
+{
+    coap_packet_t blockRequest;
+
+    coap_init_message(&blockRequest, COAP_TYPE_CON, COAP_GET, 0);
+    coap_set_header_uri_path(&blockRequest, request->Path);
+    if (request->Query != NULL)
+        coap_set_header_uri_query(&blockRequest, request->Query);
+    if (request->PayloadContentType != -1)
+        coap_set_header_accept(&blockRequest, request->PayloadContentType);
+    coap_set_token(&blockRequest, request->Token, COAP_REQUEST_TOKEN_LENGTH);
+    coap_set_header_block2(&blockRequest, num, 0, size);
+
+    return coap_SubmitRequest(request, &blockRequest);
+}
+
+// Send a block of a request payload too large for one message (RFC 7959) - each block is a request of its own, repeating the
+// method, path, query and token of the request, with a Block1 option. The total size is given in a Size1 option.
+static bool coap_SendRequestBlock(TransactionType * request, size_t offset, uint16_t size)
+{
+    coap_packet_t blockRequest;
+    size_t length = MIN(request->ContentLength - offset, size);
+
+    coap_init_message(&blockRequest, COAP_TYPE_CON, request->Method, 0);
+    coap_set_header_uri_path(&blockRequest, request->Path);
+    if (request->Query != NULL)
+        coap_set_header_uri_query(&blockRequest, request->Query);
+    coap_set_header_content_format(&blockRequest, request->ContentType);
+    coap_set_token(&blockRequest, request->Token, COAP_REQUEST_TOKEN_LENGTH);
+    // BERT blocks are numbered in 1024 byte blocks
+    coap_set_header_block1(&blockRequest, offset / MIN(size, COAP_BERT_BLOCK_SIZE), offset + length < request->ContentLength, size);
+    coap_set_header_size1(&blockRequest, request->ContentLength);
+    coap_set_bert_payload(&blockRequest, &request->Content[offset], length);
+
+    request->ContentOffset = offset;
+    request->ContentBlockSize = size;
+    Metrics_Increment(Metric_CoapBlocksSent);
+    return coap_SubmitRequest(request, &blockRequest);
+}
+
+// Send the next block of a blockwise request once the last has been accepted. Returns 1 if the next block has been sent,
+// 0 if the response is the final response to the request, or -1 if the transfer failed.
+static int coap_SendNextRequestBlock(TransactionType * request, coap_packet_t * response)
+{
+    int result = 0;
+    uint32_t num = 0;
+    uint16_t size = 0;
+
+    if ((request->Content != NULL) && (response->code == CONTINUE_2_31))
+    {
+        // The peer may ask for smaller blocks in its response - later blocks are sent in the size asked for
+        if (!coap_get_header_block1(response, &num, NULL, &size, NULL) ||
+            (num != request->ContentOffset / MIN(request->ContentBlockSize, COAP_BERT_BLOCK_SIZE)))
+        {
+            Lwm2m_Error("Unexpected response to block of request for %s\n", request->Path);
+            result = -1;
+        }
+        else
+        {
+            size_t offset = request->ContentOffset + request->ContentBlockSize;
+            // A BERT block is acknowledged as a 1024 byte block
+            size = (size >= COAP_BERT_BLOCK_SIZE) ? request->ContentBlockSize : MIN(size, request->ContentBlockSize);
+            if ((offset < request->ContentLength) && coap_SendRequestBlock(request, offset, size))
+            {
+                result = 1;
+            }
+            else
             {
-                int urlLen = 0;
-                if ((urlLen = coap_get_header_location_path(response, &url)))
+                Lwm2m_Error("Failed to send block of request for %s\n", request->Path);
+                result = -1;
+            }
+        }
+    }
+    return result;
+}
+
+// Collect a block of a blockwise response. Returns 1 if the next block has been requested, 0 if the response is
+// complete (the payload of a blockwise response is then in request->Payload), or -1 if the transfer failed.
+static int coap_ReceiveBlock(TransactionType * request, coap_packet_t * response)
+{
+    int result = 0;
+    uint32_t num = 0;
+    uint8_t more = 0;
+    uint16_t size = 0;
+    uint32_t offset = 0;
+
+    if ((response->code != CONTENT_2_05) || !coap_get_header_block2(response, &num, &more, &size, &offset) || ((offset == 0) && !more))
+    {
+        // A complete response in one message
+        free(request->Payload);
+        request->Payload = NULL;
+        request->PayloadLength = 0;
+    }
+    else
+    {
+        const uint8_t * payload = NULL;
+        const uint8_t * etag = NULL;
+        int payloadLength = coap_get_payload(response, &payload);
+        int etagLength = coap_get_header_etag(response, &etag);
+        uint8_t * blocks = NULL;
+
+        Metrics_Increment(Metric_CoapBlocksReceived);
+        if (offset == 0)
+        {
+            if (!coap_get_header_content_format(response, &request->PayloadContentType))
+                request->PayloadContentType = -1;
+            request->ETagLength = etagLength;
+            if (etagLength > 0)
+                memcpy(request->ETag, etag, etagLength);
+        }
+
+        // Every block must follow on from the last, from the same representation of the resource
+        if ((offset != request->PayloadLength) || (etagLength != request->ETagLength) ||
+            ((etagLength > 0) && (memcmp(etag, request->ETag, etagLength) != 0)))
+        {
+            Lwm2m_Error("Block %u of response for %s does not follow the blocks received\n", num, request->Path);
+            result = -1;
+        }
+        else if ((offset + payloadLength > COAP_MAX_BLOCKWISE_SIZE) || ((blocks = (uint8_t *)realloc(request->Payload, offset + payloadLength)) == NULL))
+        {
+            Lwm2m_Error("Response for %s is too large\n", request->Path);
+            result = -1;
+        }
+        else
+        {
+            memcpy(&blocks[offset], payload, payloadLength);
+            request->Payload = blocks;
+            request->PayloadLength = offset + payloadLength;
+
+            if (more)
+            {
+                // Blocks larger than we can receive are asked for in smaller blocks. A BERT block carries several 1024 byte
+                // blocks, and the rest are asked for in BERT blocks too.
+                uint16_t blockSize = (size >= COAP_MAX_BLOCK_SIZE) ? coap_get_max_block_size(networkSocket, request->Destination->Address) : size;
+                if ((payloadLength > 0) && (payloadLength % size == 0) &&
+                    coap_RequestBlock(request, request->PayloadLength / MIN(blockSize, COAP_BERT_BLOCK_SIZE), blockSize))
                 {
-                    uriBuf[0] = '/';
-                    memcpy(&uriBuf[1], url, urlLen);
+                    result = 1;
                 }
                 else
                 {
-                    uriBuf[0] = '/';
-                    urlLen = strlen(transaction->Path);
-                    memcpy(&uriBuf[1], transaction->Path, urlLen);
+                    Lwm2m_Error("Failed to request block of response for %s\n", request->Path);
+                    result = -1;
                 }
-                coap_get_header_content_format(response, &ContentType);
-                int payloadLen = coap_get_payload(response,
-                                                  (const uint8_t **) &payload);
+            }
+        }
+    }
+    return result;
+}
+
+// Send queued requests to the destination while it has free slots, and forget the destination once it is idle
+static void coap_SendQueuedRequests(DestinationType * destination)
+{
+    while ((destination->RequestsInFlight < MAX_COAP_REQUESTS_PER_DESTINATION) && !ListEmpty(&destination->Queue))
+    {
+        TransactionType * request = ListEntry(destination->Queue.Next, TransactionType, list);
+        ListRemove(&request->list);
+        Metrics_Decrement(Metric_CoapRequestsQueued);
+
+        if (coap_SendRequest(request, NULL, request->Packet, request->PacketLength))
+        {
+            free(request->Packet);
+            request->Packet = NULL;
+        }
+        else
+        {
+            Lwm2m_Error("Failed to send queued request to %s\n", request->Path);
+            Metrics_Increment(Metric_CoapTransactionTimeouts);
+            if (request->Callback)
+            {
+                request->Callback(request->Context, NULL, NULL, 0, 0, NULL, 0);
+            }
+            coap_FreeRequest(request);
+        }
+    }
+
+    if ((destination->RequestsInFlight == 0) && ListEmpty(&destination->Queue))
+    {
+        HashTable_Remove(&destinations, &destination->Node);
+        free(destination);
+    }
+}
+
+static void coap_CompleteRequest(TransactionType * request, coap_packet_t * coap_response)
+{
+    int ContentType = 0;
+    const char *url = NULL;
+    char * payload = NULL;
+    char uriBuf[64] =
+    { 0 };
+    DestinationType * destination = request->Destination;
+
+    if (request->State == RequestState_AwaitingResponse)
+    {
+        ListRemove(&request->list);
+    }
+    request->TransactionPtr = NULL;
+    destination->RequestsInFlight--;
+    Metrics_Decrement(Metric_CoapRequestsInFlight);
+
+    if (coap_response != NULL)
+    {
+        int block = coap_SendNextRequestBlock(request, coap_response);
+        if (block == 0)
+            block = coap_ReceiveBlock(request, coap_response);
+        if (block > 0)
+        {
+            // The request continues with the next block
+            return;
+        }
+        else if (block < 0)
+        {
+            coap_response = NULL;
+        }
+    }
 
-                transaction->Callback(transaction->Context, &transaction->Address, uriBuf, COAP_OPTION_TO_RESPONSE_CODE(coap_response->code),
-                        ContentType, payload, payloadLen);
+    if (coap_response != NULL)
+    {
+        Metrics_Increment(Metric_CoapResponsesReceived);
+        Metrics_Observe(Histogram_CoapTransactionDuration, Lwm2mCore_GetTickCountMs() - request->SendTime);
+    }
+    else
+    {
+        Metrics_Increment(Metric_CoapTransactionTimeouts);
+    }
+
+    // Remove the request from the table before the callback, as the callback may create new requests
+    HashTable_Remove(&requestsByToken, &request->TokenNode);
+
+    if (request->Observation != 0)
+    {
+        // The rest of a notification too large for one block has been fetched - the observation may have been cancelled meanwhile
+        Observation * observation = findObservation(request->Observation, destination->Address);
+        if ((coap_response != NULL) && (observation != NULL) && (observation->Callback != NULL))
+        {
+            Metrics_Increment(Metric_CoapNotificationsReceived);
+            coap_get_header_content_format(coap_response, &ContentType);
+            observation->Callback(observation->Context, &request->Address, observation->Path, COAP_OPTION_TO_RESPONSE_CODE(coap_response->code),
+                    ContentType, (char *)request->Payload, request->PayloadLength);
+        }
+    }
+    else if (request->Callback)
+    {
+        if (coap_response != NULL)
+        {
+            int urlLen = 0;
+            if ((urlLen = coap_get_header_location_path(coap_response, &url)))
+            {
+                uriBuf[0] = '/';
+                memcpy(&uriBuf[1], url, urlLen);
             }
             else
             {
-                transaction->Callback(transaction->Context, NULL, NULL, 0, 0, NULL, 0);
+                uriBuf[0] = '/';
+                urlLen = strlen(request->Path);
+                memcpy(&uriBuf[1], request->Path, urlLen);
+            }
+            coap_get_header_content_format(coap_response, &ContentType);
+            int payloadLen = coap_get_payload(coap_response,
+                                              (const uint8_t **) &payload);
+            if (request->Payload != NULL)
+            {
+                // Blockwise response
+                payload = (char *)request->Payload;
+                payloadLen = request->PayloadLength;
             }
+
+            request->Callback(request->Context, &request->Address, uriBuf, COAP_OPTION_TO_RESPONSE_CODE(coap_response->code),
+                    ContentType, payload, payloadLen);
+        }
+        else
+        {
+            request->Callback(request->Context, NULL, NULL, 0, 0, NULL, 0);
+        }
+    }
+    coap_ReleaseRequest(request);
+
+    coap_SendQueuedRequests(destination);
+}
+
+static void coap_CoapRequestCallback(void *callback_data, void *response)
+{
+    TransactionType * request = (TransactionType *) callback_data;
+    coap_packet_t * coap_response = (coap_packet_t *) response;
+
+    if (request != NULL)
+    {
+        if ((coap_response != NULL) && (coap_response->type == COAP_TYPE_ACK) && (coap_response->code == 0))
+        {
+            // Empty ACK - the response will follow in a separate message with the same token
+            Lwm2m_Debug("Request %u acknowledged, waiting for separate response\n", request->MID);
+            request->State = RequestState_AwaitingResponse;
+            request->TransactionPtr = NULL;
+            request->SendTime = Lwm2mCore_GetTickCountMs();
+            ListAdd(&request->list, &awaitingResponses);
+        }
+        else
+        {
+            coap_CompleteRequest(request, coap_response);
+        }
+    }
+}
+
+static void coap_CheckSeparateResponses(void)
+{
+    struct ListHead * current = NULL;
+    struct ListHead * next = NULL;
+    uint64_t now = Lwm2mCore_GetTickCountMs();
+
+    ListForEachSafe(current, next, &awaitingResponses)
+    {
+        TransactionType * request = ListEntry(current, TransactionType, list);
+        if (now - request->SendTime >= COAP_SEPARATE_RESPONSE_TIMEOUT)
+        {
+            Lwm2m_Warning("No separate response for request %u\n", request->MID);
+            coap_CompleteRequest(request, NULL);
         }
-        transaction->TransactionUsed = false;
     }
 }
 
@@ -367,11 +1028,11 @@ void coap_createCoapRequest(coap_method_t method, const char * uri, AwaContentTy
         const char * payload, int payloadLen, TransactionCallback callback, void * context)
 {
     coap_packet_t request;
-    char path[MAX_COAP_PATH] =
-    { 0 };
     char query[128] =
     { 0 };
-    coap_transaction_t *transaction;
+    uint16_t blockSize;
+    TransactionType * transaction;
+    DestinationType * destination;
     NetworkAddress * remoteAddress = NetworkAddress_New(uri, strlen(uri));
 
     if (!remoteAddress)
@@ -386,13 +1047,29 @@ void coap_createCoapRequest(coap_method_t method, const char * uri, AwaContentTy
         return;
     }
 
+    destination = coap_GetDestination(remoteAddress);
+    transaction = (TransactionType *)malloc(sizeof(TransactionType));
+    if ((destination == NULL) || (transaction == NULL))
+    {
+        Lwm2m_Error("Failed to allocate request to %s\n", uri);
+        free(transaction);
+        if (destination != NULL)
+        {
+            coap_SendQueuedRequests(destination);
+        }
+        return;
+    }
+    memset(transaction, 0, sizeof(TransactionType));
+
+    // The path is kept with the request, to repeat for blocks, so it is parsed straight into it
+    char * path = transaction->Path;
     coap_getPathQueryFromURI(uri, path, query);
 
     Lwm2m_Info("Coap request: %s\n", uri);
     //Lwm2m_Debug("Coap request path: %s\n", path);
     //Lwm2m_Debug("Coap request query: %s\n", query);
 
-    coap_init_message(&request, COAP_TYPE_CON, method, coap_get_mid());
+    coap_init_message(&request, COAP_TYPE_CON, method, 0);
 
     coap_set_header_uri_path(&request, path);
     if (strlen(query) > 0)
@@ -404,7 +1081,29 @@ void coap_createCoapRequest(coap_method_t method, const char * uri, AwaContentTy
         if ((method == COAP_POST) || (method == COAP_PUT))
         {
             coap_set_header_content_format(&request, contentType);
-            coap_set_payload(&request, payload, payloadLen);
+            blockSize = coap_get_max_block_size(networkSocket, remoteAddress);
+            if (payloadLen > blockSize)
+            {
+                // Too large for one message - keep a copy to send a block at a time
+                if ((transaction->Content = (uint8_t *)malloc(payloadLen)) == NULL)
+                {
+                    Lwm2m_Error("Failed to allocate request to %s\n", uri);
+                    free(transaction);
+                    coap_SendQueuedRequests(destination);
+                    return;
+                }
+                memcpy(transaction->Content, payload, payloadLen);
+                transaction->ContentLength = payloadLen;
+                transaction->ContentBlockSize = blockSize;
+                coap_set_header_block1(&request, 0, 1, blockSize);
+                coap_set_header_size1(&request, payloadLen);
+                coap_set_bert_payload(&request, payload, blockSize);
+                Metrics_Increment(Metric_CoapBlocksSent);
+            }
+            else
+            {
+                coap_set_bert_payload(&request, payload, payloadLen);
+            }
         }
         else
         {
@@ -412,65 +1111,79 @@ void coap_createCoapRequest(coap_method_t method, const char * uri, AwaContentTy
         }
     }
 
-
+    int token = 0;
     if (method == COAP_GET)
     {
         if (observeState == ObserveState_Establish)
         {
             coap_set_header_observe(&request, 0);
-            int token = addObserve(remoteAddress, path, callback, context);
-            if (token != 0)
-                coap_set_token(&request, (const uint8_t *) &token,
-                               sizeof(token));
-
+            token = addObserve(remoteAddress, path, callback, context);
         }
         else if (observeState == ObserveState_Cancel)
         {
             coap_set_header_observe(&request, 1);
-            int token = removeObserve(remoteAddress, path);
-            if (token != 0)
-                coap_set_token(&request, (const uint8_t *) &token,
-                               sizeof(token));
+            token = removeObserve(remoteAddress, path);
         }
     }
 
-//    if (CurrentTransaction[CurrentTransactionIndex].TransactionUsed && CurrentTransaction[CurrentTransactionIndex].TransactionPtr)
-//    {
-//        Lwm2m_Warning("Canceled previous transaction [%d]: %p\n", CurrentTransactionIndex,
-//                CurrentTransaction[CurrentTransactionIndex].TransactionPtr);
-//        coap_clear_transaction(&CurrentTransaction[CurrentTransactionIndex].TransactionPtr);
-//    }
+    // Observe requests carry the token of the observation, other requests get a token of their own
+    if (token != 0)
+        memcpy(transaction->Token, &token, sizeof(token));
+    else
+        coap_NewRequestToken(remoteAddress, transaction->Token);
+    coap_set_token(&request, transaction->Token, COAP_REQUEST_TOKEN_LENGTH);
 
-    //if ((transaction = coap_new_transaction(request.mid, remote_ipaddr, uip_htons(remote_port))))
-    if ((transaction = coap_new_transaction(networkSocket, request.mid, remoteAddress)))
+    if (strlen(query) > 0)
+        transaction->Query = strdup(query);
+    transaction->Method = method;
+    transaction->ContentType = contentType;
+    transaction->Callback = callback;
+    transaction->Context = context;
+    transaction->Destination = destination;
+    NetworkAddress_SetAddressType(remoteAddress, &transaction->Address);
+    HashTable_Add(&requestsByToken, &transaction->TokenNode, Hash_Bytes(transaction->Token, COAP_REQUEST_TOKEN_LENGTH, HASH_SEED));
+
+    if (!coap_SubmitRequest(transaction, &request))
     {
-        transaction->callback = coap_CoapRequestCallback;
-        memcpy(CurrentTransaction[CurrentTransactionIndex].Path, path, MAX_COAP_PATH);
-        CurrentTransaction[CurrentTransactionIndex].Callback = callback;
-        CurrentTransaction[CurrentTransactionIndex].Context = context;
-        CurrentTransaction[CurrentTransactionIndex].TransactionUsed = true;
-        CurrentTransaction[CurrentTransactionIndex].TransactionPtr = transaction;
-        NetworkAddress_SetAddressType(remoteAddress, &CurrentTransaction[CurrentTransactionIndex].Address);
-
-        transaction->callback_data = &CurrentTransaction[CurrentTransactionIndex];
-
-        transaction->packet_len = coap_serialize_message(&request, transaction->packet);
-
-        Lwm2m_Debug("Sending transaction [%d]: %p\n", CurrentTransactionIndex, CurrentTransaction[CurrentTransactionIndex].TransactionPtr);
-        coap_send_transaction(transaction);
-
-        CurrentTransactionIndex++;
-
-        if (CurrentTransactionIndex >= MAX_COAP_TRANSACTIONS)
-        {
-            CurrentTransactionIndex = 0;
-        }
+        Lwm2m_Error("Failed to send request to %s\n", uri);
+        coap_FreeRequest(transaction);
+        coap_SendQueuedRequests(destination);
     }
 }
 
 int coap_Destroy(void)
 {
+    HashTableNode * node;
+    HashTableNode * next;
+    size_t bucket;
+
     Lwm2m_Info("Close port: \n");     //  TODO - remove
+
+    // Abandon outstanding requests without calling back - the owners are being torn down too
+    HashTableForEachSafe(node, next, bucket, &requestsByToken)
+    {
+        TransactionType * request = HashTableEntry(node, TransactionType, TokenNode);
+        coap_clear_transaction(&request->TransactionPtr);
+        coap_ReleaseRequest(request);
+    }
+    HashTableForEachSafe(node, next, bucket, &destinations)
+    {
+        free(HashTableEntry(node, DestinationType, Node));
+    }
+    HashTableForEachSafe(node, next, bucket, &observationsByToken)
+    {
+        freeObservation(HashTableEntry(node, Observation, TokenNode));
+    }
+    HashTable_Destroy(&requestsByToken);
+    HashTable_Destroy(&destinations);
+    HashTable_Destroy(&observationsByToken);
+    HashTable_Destroy(&observationsByPath);
+    ListInit(&awaitingResponses);
+    Metrics_Set(Metric_CoapRequestsInFlight, 0);
+    Metrics_Set(Metric_CoapRequestsQueued, 0);
+    coap_destroy_dedup();
+    coap_destroy_block2();
+
     if (networkSocket)
         NetworkSocket_Free(&networkSocket);
     // TODO - close any open sessions
@@ -479,14 +1192,19 @@ int coap_Destroy(void)
     return 0;
 }
 
-void coap_Process(void)
+int coap_Process(void)
 {
-    coap_check_transactions();
+    int timeout = coap_check_transactions();
+    coap_CheckSeparateResponses();
+    return timeout;
 }
 
 void coap_HandleMessage(void)
 {
-    coap_receive(networkSocket);
+    do
+    {
+        coap_receive(networkSocket);
+    } while (NetworkSocket_HasPendingMessages(networkSocket));
 }
 
 void coap_GetRequest(void * context, const char * path, AwaContentType contentType, TransactionCallback callback)
@@ -542,19 +1260,47 @@ void coap_SendNotify(AddressType * addr, const char * path, const char * token,
 
         coap_init_message(&notify, COAP_TYPE_NON, CONTENT_2_05, coap_get_mid());
 
+        uint16_t blockSize = coap_get_max_block_size(networkSocket, remoteAddress);
         if (contentType != AwaContentType_None)
         {
             coap_set_header_content_format(&notify, contentType);
-            coap_set_payload(&notify, payload, payloadLen);
+            coap_set_bert_payload(&notify, payload, MIN(payloadLen, blockSize));
+        }
+
+        // A notification too large for one block is kept, and sent as its first block - the observer asks for the rest (RFC 7959 section 2.6)
+        coap_block2_entry_t * block = NULL;
+        if ((contentType != AwaContentType_None) && (payloadLen > blockSize))
+        {
+            char notifyPath[MAX_COAP_PATH] = { 0 };
+            char notifyQuery[128] = { 0 };
+            char blockUri[MAX_COAP_PATH + sizeof(notifyQuery)];
+
+            coap_getPathQueryFromURI(path, notifyPath, notifyQuery);
+            coap_GetBlockUri(blockUri, sizeof(blockUri), notifyPath, strlen(notifyPath), notifyQuery, strlen(notifyQuery));
+            if ((block = coap_block2_add(remoteAddress, blockUri, contentType, (const uint8_t *)payload, payloadLen)) == NULL)
+            {
+                Lwm2m_Error("Failed to keep notification for %s\n", path);
+                return;
+            }
+            coap_block2_serve(block, &notify, 0, blockSize, &messageBuffer[COAP_MAX_HEADER_SIZE]);
+            coap_set_header_block2(&notify, 0, 1, blockSize);
         }
 
         coap_set_token(&notify, token, tokenSize);
         coap_set_header_observe(&notify, sequence);
 
-        if ((transaction = coap_new_transaction(networkSocket, notify.mid, remoteAddress)))
+        if (NetworkAddress_IsReliable(remoteAddress))
+        {
+            // Serialised in place, as the first block was served to the end of the buffer
+            size_t length = coap_serialize_message(&notify, messageBuffer);
+            Metrics_Increment(Metric_CoapNotificationsSent);
+            NetworkSocket_Send(networkSocket, remoteAddress, messageBuffer, length);
+        }
+        else if ((transaction = coap_new_transaction(networkSocket, notify.mid, remoteAddress)))
         {
             transaction->packet_len = coap_serialize_message(&notify, transaction->packet);
 
+            Metrics_Increment(Metric_CoapNotificationsSent);
             coap_send_transaction(transaction); // for NON confirmable messages this will call coap_clear_transaction();
         }
     }
@@ -582,86 +1328,148 @@ int coap_DeregisterUri(const char * path)
     return 0;
 }
 
+static bool coap_MatchObservationToken(const HashTableNode * node, const void * key)
+{
+    const Observation * observation = HashTableEntry(node, Observation, TokenNode);
+    const ObservationKey * observationKey = (const ObservationKey *)key;
+    return (observation->Token == observationKey->Token) &&
+           ((observationKey->Address == NULL) || (NetworkAddress_Compare(observation->Address, observationKey->Address) == 0));
+}
+
+static bool coap_MatchObservationPath(const HashTableNode * node, const void * key)
+{
+    const Observation * observation = HashTableEntry(node, Observation, PathNode);
+    const ObservationKey * observationKey = (const ObservationKey *)key;
+    return (NetworkAddress_Compare(observation->Address, observationKey->Address) == 0) && (strcmp(observation->Path, observationKey->Path) == 0);
+}
+
+static uint32_t coap_HashObservationPath(NetworkAddress * remoteAddress, const char * path)
+{
+    return Hash_String(path, NetworkAddress_Hash(remoteAddress));
+}
+
 static int addObserve(NetworkAddress * remoteAddress, char * path, TransactionCallback callback, void * context)
 {
     int result = 0;
-    int index;
-    Observation * observation = NULL;
-    for (index = 0; index < MAX_COAP_OBSERVATIONS; index++)
-    {
-        if (Observations[index].Token == 0)
-        {
-            observation = &Observations[index];
-            break;
-        }
-    }
+    size_t length = strlen(path) + 1;
+    size_t size = sizeof(Observation) + length;
+    Observation * observation = (Observation *)malloc(size);
     if (observation)
     {
         observation->Address = remoteAddress;
-        int length = strlen(path);
         memcpy(observation->Path, path, length);
-        observation->Path[length] = '\0';
-        bool found;
+
+        // Tokens are random, and unique among observations so a notification is never mistaken for another
+        ObservationKey key = { .Address = NULL };
         do
         {
-            result = rand();
-            if (result == 0)
-                found = true;
-            else
-            {
-                found = false;
-                for (index = 0; index < MAX_COAP_OBSERVATIONS; index++)
-                {
-                    if (Observations[index].Token == result)
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-            }
-        } while (found);
+            key.Token = rand();
+        } while ((key.Token == 0) || (HashTable_Find(&observationsByToken, Hash_Bytes(&key.Token, sizeof(key.Token), HASH_SEED),
+                                                     coap_MatchObservationToken, &key) != NULL));
+        result = key.Token;
         observation->Token = result;
-        observation->Callback =  callback;
+        observation->Callback = callback;
         observation->Context = context;
+        HashTable_Add(&observationsByToken, &observation->TokenNode, Hash_Bytes(&result, sizeof(result), HASH_SEED));
+        HashTable_Add(&observationsByPath, &observation->PathNode, coap_HashObservationPath(remoteAddress, path));
+        Metrics_Increment(Metric_CoapObservations);
+        Metrics_Add(Metric_CoapObservationBytes, size);
+    }
+    else
+    {
+        Lwm2m_Error("Failed to allocate observation of %s\n", path);
     }
     return result;
 }
 
+static void freeObservation(Observation * observation)
+{
+    HashTable_Remove(&observationsByToken, &observation->TokenNode);
+    HashTable_Remove(&observationsByPath, &observation->PathNode);
+    Metrics_Decrement(Metric_CoapObservations);
+    Metrics_Add(Metric_CoapObservationBytes, -(int64_t)(sizeof(Observation) + strlen(observation->Path) + 1));
+    free(observation);
+}
+
 static int removeObserve(NetworkAddress * remoteAddress, char * path)
 {
     int result = 0;
-    int index;
-    for (index = 0; index < MAX_COAP_OBSERVATIONS; index++)
+    ObservationKey key = { .Address = remoteAddress, .Path = path };
+    HashTableNode * node = HashTable_Find(&observationsByPath, coap_HashObservationPath(remoteAddress, path), coap_MatchObservationPath, &key);
+    if (node != NULL)
     {
-        if ((NetworkAddress_Compare(Observations[index].Address, sourceAddress) == 0) && (strcmp(Observations[index].Path,path) == 0))
-        {
-            result = Observations[index].Token;
-            memset(&Observations[index],0, sizeof(Observation));
-            break;
-        }
+        Observation * observation = HashTableEntry(node, Observation, PathNode);
+        result = observation->Token;
+        freeObservation(observation);
+    }
+    return result;
+}
+
+static Observation * findObservation(int token, NetworkAddress * remoteAddress)
+{
+    Observation * result = NULL;
+    ObservationKey key = { .Address = remoteAddress, .Token = token };
+    HashTableNode * node = HashTable_Find(&observationsByToken, Hash_Bytes(&token, sizeof(token), HASH_SEED), coap_MatchObservationToken, &key);
+    if (node != NULL)
+    {
+        result = HashTableEntry(node, Observation, TokenNode);
     }
     return result;
 }
 
+// A notification too large for one block carries only the first block - fetch the rest before notifying the observer
+static void coap_FetchNotification(Observation * observation, coap_packet_t * message)
+{
+    DestinationType * destination = coap_GetDestination(observation->Address);
+    TransactionType * request = (TransactionType *)malloc(sizeof(TransactionType));
+    if ((destination == NULL) || (request == NULL))
+    {
+        Lwm2m_Error("Failed to allocate request for notification of %s\n", observation->Path);
+        free(request);
+        if (destination != NULL)
+        {
+            coap_SendQueuedRequests(destination);
+        }
+        return;
+    }
+    memset(request, 0, sizeof(TransactionType));
+
+    strncpy(request->Path, observation->Path, MAX_COAP_PATH - 1);
+    request->Observation = observation->Token;
+    request->Destination = destination;
+    NetworkAddress_SetAddressType(observation->Address, &request->Address);
+    coap_NewRequestToken(observation->Address, request->Token);
+    HashTable_Add(&requestsByToken, &request->TokenNode, Hash_Bytes(request->Token, COAP_REQUEST_TOKEN_LENGTH, HASH_SEED));
+
+    if (coap_ReceiveBlock(request, message) <= 0)
+    {
+        Lwm2m_Error("Failed to fetch notification of %s\n", observation->Path);
+        coap_FreeRequest(request);
+        coap_SendQueuedRequests(destination);
+    }
+}
 
 void coap_handle_notification(NetworkAddress * sourceAddress, coap_packet_t * message)
 {
-    if (message->token_len == sizeof(int))
+    TransactionType * request = coap_FindRequestByToken(message->token, message->token_len, sourceAddress);
+    if ((request != NULL) && (request->State == RequestState_AwaitingResponse))
+    {
+        coap_CompleteRequest(request, message);
+    }
+    else if (IS_OPTION(message, COAP_OPTION_OBSERVE) && (message->token_len == sizeof(int)))
     {
         int token;
         memcpy(&token, message->token, sizeof(int));
-        Observation * observation = NULL;
-        int index;
-        for (index = 0; index < MAX_COAP_OBSERVATIONS; index++)
+        Observation * observation = findObservation(token, sourceAddress);
+        uint8_t more = 0;
+        if (observation && observation->Callback && coap_get_header_block2(message, NULL, &more, NULL, NULL) && more)
         {
-            if ((Observations[index].Token == token) && (NetworkAddress_Compare(Observations[index].Address, sourceAddress) == 0))
-            {
-                observation = &Observations[index];
-                break;
-            }
+            coap_FetchNotification(observation, message);
         }
-        if (observation && observation->Callback)
+        else if (observation && observation->Callback)
         {
+            Metrics_Increment(Metric_CoapNotificationsReceived);
+
             AddressType address;
             int ContentType = 0;
             char * payload = NULL;
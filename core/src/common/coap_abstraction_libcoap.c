@@ -270,6 +270,15 @@ static int remove_Transaction(TransactionType * transaction)
     return 0;
 }
 
+static void AddMaxAgeOption(coap_pdu_t * response, uint32_t maxAge)
+{
+    if (maxAge > 0)
+    {
+        unsigned char optbuf[4];
+        coap_add_option(response, COAP_OPTION_MAXAGE, coap_encode_var_bytes(optbuf, maxAge), optbuf);
+    }
+}
+
 static void HandleGetRequest(void * context, coap_address_t * addr, const char * path, const char * query, AwaContentType contentType, coap_pdu_t * request, coap_pdu_t * response)
 {
     char responseContent[4096];
@@ -448,6 +457,7 @@ static void HandlePutRequest(void * context, coap_address_t * addr, const char *
         // Nothing to do here.
     }
 
+    AddMaxAgeOption(response, coapResponse.responseMaxAge);
     response->hdr->code = COAP_RESPONSE_CODE(coapResponse.responseCode);
     Lwm2m_Debug("COAP_REQUEST_PUT: responseCode %d\n", coapResponse.responseCode);
 }
@@ -514,6 +524,7 @@ static void HandlePostRequest(void * context, coap_address_t * addr, const char
         }
     }
 
+    AddMaxAgeOption(response, coapResponse.responseMaxAge);
     response->hdr->code = COAP_RESPONSE_CODE(coapResponse.responseCode);
     Lwm2m_Debug("COAP_REQUEST_POST: responseCode %d\n", coapResponse.responseCode);
 }
@@ -859,7 +870,7 @@ void coap_HandleMessage(void)
 #endif
 }
 
-void coap_Process(void)
+int coap_Process(void)
 {
     coap_context_t * ctx = coapContext;
 
@@ -896,6 +907,13 @@ void coap_Process(void)
 
         nextpdu = coap_peek_next( ctx );
     }
+
+    int timeout = -1;
+    if (nextpdu != NULL)
+    {
+        timeout = ((nextpdu->t - (now - ctx->sendqueue_basetime)) * 1000) / COAP_TICKS_PER_SECOND;
+    }
+    return timeout;
 }
 
 static void coap_SendRequest(int messageType, void * context, char * token, int tokenSize, const char * path, AwaContentType contentType,
@@ -1134,8 +1152,12 @@ void coap_SendNotify(AddressType * addr, const char * path, const char * token,
     }
 }
 
-CoapInfo * coap_Init(const char * ipAddress, int port, bool secure, int logLevel)
+CoapInfo * coap_Init(const char * ipAddress, int port, bool secure, bool tcp, int logLevel)
 {
+    if (tcp)
+    {
+        Lwm2m_Error("CoAP over TCP is not supported by %s\n", coap_LibraryName);
+    }
 
     coap_SetLogLevel(logLevel);
 
@@ -65,6 +65,30 @@ void DTLS_SetNetworkSendCallback(DTLS_NetworkSendCallback sendCallback);
 
 void DTLS_SetPSK(const char * identity, const uint8_t * key, int keyLength);
 
+// Limit the number of sessions kept (0 for the default, MAX_DTLS_SESSIONS), and evict sessions idle for longer than
+// idleTimeoutSeconds (0 to keep idle sessions until the table is full). Only the GnuTLS backend keeps its sessions in
+// the shared session table and honours these limits and DTLS_SetHandshakeWorkers; the mbedTLS, CyaSSL and TinyDTLS
+// backends still keep a fixed array of MAX_DTLS_SESSIONS (3) sessions.
+void DTLS_SetSessionLimits(int maxSessions, int idleTimeoutSeconds);
+
+// Process handshake flights on up to workers threads, off the main loop (0 to handshake inline, the default)
+void DTLS_SetHandshakeWorkers(int workers);
+
+// Readable when handshakes processed by the workers are done and DTLS_CompleteHandshakes should be called to send
+// their flights and hand the sessions back, or -1 if there are no workers
+int DTLS_GetHandshakeFileDescriptor(void);
+void DTLS_CompleteHandshakes(void);
+
+/* Authenticate PSK clients by the key for their identity in a key store file (see dtls_keystore.h), rather than by the
+ * one key given to DTLS_SetPSK. Call again to reload the file - if it cannot be read, the keys loaded before are kept.
+ * NULL stops using a key store.
+ */
+bool DTLS_LoadKeyStore(const char * fileName);
+
+// Copy the key for an identity from the key store to key. Returns the length of the key, 0 if the identity is not in the
+// key store, or -1 if no key store is loaded.
+int DTLS_FindPSK(const char * identity, size_t identityLength, uint8_t * key, size_t keySize);
+
 #ifdef __cplusplus
 }
 #endif
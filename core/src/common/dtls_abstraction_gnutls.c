@@ -21,12 +21,18 @@
 ************************************************************************************************************************/
 
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "lwm2m_debug.h"
 #include "dtls_abstraction.h"
+#include "dtls_handshake_pool.h"
+#include "dtls_keystore.h"
+#include "dtls_sessions.h"
+#include "lwm2m_metrics.h"
 
 #include <errno.h>
+#include <pthread.h>
 
 #include <gnutls/gnutls.h>
 #include <gnutls/x509.h>
@@ -44,27 +50,37 @@ typedef enum
     CredentialType_ServerPSK
 }CredentialType;
 
+typedef struct
+{
+    struct ListHead List;
+    size_t Length;
+    uint8_t Data[];
+} Record;
+
 
 typedef struct
 {
-    NetworkAddress * NetworkAddress;
+    DTLS_SessionEntry Entry;
     gnutls_session_t Session;
     void * Credentials;
     uint8_t CredentialType;
+    bool Client;
     bool SessionEstablished;
     void * UserContext;
     uint8_t * Buffer;
     int BufferLength;
+    DTLS_HandshakeJob Job;
+    bool Busy;                      // a handshake worker has the session
+    bool Closed;                    // freed while busy - released once the worker is done
+    bool HandshakeDone;             // set by the worker
+    bool Rejected;                  // handshake done, but the session must not be used
+    struct ListHead Input;          // records for the worker
+    struct ListHead Output;         // records sent by the worker, sent on from the main loop when it is done
+    struct ListHead Received;       // records received while busy, for the next job
 }DTLS_Session;
 
-#ifndef MAX_DTLS_SESSIONS
-    #define MAX_DTLS_SESSIONS 3
-#endif
-
 const char * DTLS_LibraryName = "GnuTLS";
 
-static DTLS_Session sessions[MAX_DTLS_SESSIONS];
-
 static uint8_t * certificate = NULL;
 static int certificateLength = 0;
 static AwaCertificateFormat certificateFormat;
@@ -79,11 +95,30 @@ static  DTLS_NetworkSendCallback NetworkSend = NULL;
 //static gnutls_dh_params_t _DHParameters;
 static gnutls_priority_t _PriorityCache;
 static gnutls_certificate_credentials_t _CertCredentials = NULL;
+static gnutls_datum_t _TicketKey = { NULL, 0 };
+
+// The session cache is also used by handshake workers
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
 
 
 static DTLS_Session * GetSession(NetworkAddress * address);
-static void SetupNewSession(int index, NetworkAddress * networkAddress, bool client);
+static DTLS_Session * NewSession(NetworkAddress * networkAddress, bool client);
+static void SetupNewSession(DTLS_Session * session, bool client);
 static void FreeSession(DTLS_Session * session);
+static void ReleaseSession(DTLS_Session * session);
+static void FreeSessionEntry(DTLS_SessionEntry * entry);
+static bool Handshake(DTLS_Session * session);
+static bool HandshakeComplete(DTLS_Session * session);
+static void StartHandshake(DTLS_Session * session, uint8_t * record, int recordLength);
+static void ForgetResumableSessions(void);
+static void FreeTicketKey(void);
+static void RunHandshake(DTLS_HandshakeJob * job);
+static void CompleteHandshake(DTLS_HandshakeJob * job);
+static bool QueueRecord(struct ListHead * records, const void * data, size_t length);
+static void FreeRecords(struct ListHead * records);
+static int StoreSessionCallBack(void * context, gnutls_datum_t key, gnutls_datum_t data);
+static gnutls_datum_t RetrieveSessionCallBack(void * context, gnutls_datum_t key);
+static int RemoveSessionCallBack(void * context, gnutls_datum_t key);
 static ssize_t DecryptCallBack(gnutls_transport_ptr_t context, void *recieveBuffer, size_t receiveBufferLegth);
 static ssize_t EncryptCallBack(gnutls_transport_ptr_t context, const void * sendBuffer,size_t sendBufferLength);
 static int PSKClientCallBack(gnutls_session_t session, char **username, gnutls_datum_t * key);
@@ -98,7 +133,7 @@ static int CertificateVerify(gnutls_session_t session);
 
 void DTLS_Init(void)
 {
-    memset(sessions,0,sizeof(DTLS_Session) * MAX_DTLS_SESSIONS);
+    DTLSSessions_Init(FreeSessionEntry);
     gnutls_global_init();
     //    unsigned int bits = gnutls_sec_param_to_pk_bits(GNUTLS_PK_DH, GNUTLS_SEC_PARAM_LEGACY);
     //    gnutls_dh_params_init(&_DHParameters);
@@ -108,18 +143,17 @@ void DTLS_Init(void)
 #else
     gnutls_priority_init(&_PriorityCache, "NONE:+VERS-TLS-ALL:+ECDHE-ECDSA:+ECDHE-PSK:+PSK:+CURVE-ALL:+AES-128-CBC:+MAC-ALL:-SHA1:+COMP-ALL:+SIGN-ALL:+CTYPE-X.509", NULL);
 #endif
+    if (_TicketKey.data == NULL)
+    {
+        gnutls_session_ticket_key_generate(&_TicketKey);
+    }
+    DTLSKeyStore_SetKeysRevokedCallback(ForgetResumableSessions);
 }
 
 void DTLS_Shutdown(void)
 {
-    int index;
-    for (index = 0;index < MAX_DTLS_SESSIONS; index++)
-    {
-        if (sessions[index].Session)
-        {
-            FreeSession(&sessions[index]);
-        }
-    }
+    DTLSHandshakePool_Stop();
+    DTLSSessions_Destroy();
     if (_CertCredentials)
     {
         gnutls_certificate_free_credentials(_CertCredentials);
@@ -127,9 +161,40 @@ void DTLS_Shutdown(void)
     }
 //  gnutls_dh_params_deinit(_DHParameters);
     gnutls_priority_deinit(_PriorityCache);
+    DTLSKeyStore_SetKeysRevokedCallback(NULL);
+    FreeTicketKey();
     gnutls_global_deinit();
 }
 
+static void FreeTicketKey(void)
+{
+    if (_TicketKey.data)
+    {
+        gnutls_memset(_TicketKey.data, 0, _TicketKey.size);
+        gnutls_free(_TicketKey.data);
+        _TicketKey.data = NULL;
+        _TicketKey.size = 0;
+    }
+}
+
+// Keys in the key store were changed or removed, so no session established before must be resumed - neither from the
+// session cache, nor from a ticket, which a new ticket key makes unreadable. Sessions are only set up on the main loop,
+// as is the key store reloaded, so the ticket key can be replaced here.
+static void ForgetResumableSessions(void)
+{
+    pthread_mutex_lock(&cacheLock);
+    DTLSSessionCache_Clear();
+    pthread_mutex_unlock(&cacheLock);
+
+    FreeTicketKey();
+    if (gnutls_session_ticket_key_generate(&_TicketKey) != GNUTLS_E_SUCCESS)
+    {
+        Lwm2m_Error("Failed to generate a DTLS session ticket key - session tickets are disabled\n");
+        _TicketKey.data = NULL;
+        _TicketKey.size = 0;
+    }
+}
+
 void DTLS_Reset(NetworkAddress * address)
 {
     DTLS_Session * session = GetSession(address);
@@ -171,10 +236,19 @@ bool DTLS_Decrypt(NetworkAddress * sourceAddress, uint8_t * encrypted, int encry
     DTLS_Session * session = GetSession(sourceAddress);
     if (session)
     {
-        session->Buffer = encrypted;
-        session->BufferLength = encryptedLength;
-        if (session->SessionEstablished)
+        if (session->Busy)
         {
+            // keep the record for when the worker is done
+            *decryptedLength = 0;
+            if (ListCount(&session->Received) < MAX_DTLS_HANDSHAKE_BACKLOG)
+            {
+                QueueRecord(&session->Received, encrypted, encryptedLength);
+            }
+        }
+        else if (session->SessionEstablished)
+        {
+            session->Buffer = encrypted;
+            session->BufferLength = encryptedLength;
             *decryptedLength = gnutls_read(session->Session, decryptBuffer, decryptBufferLength);
             result = (*decryptedLength > 0);
             if (!result)
@@ -186,27 +260,18 @@ bool DTLS_Decrypt(NetworkAddress * sourceAddress, uint8_t * encrypted, int encry
         else
         {
             *decryptedLength = 0;
-            session->SessionEstablished = (gnutls_handshake(session->Session) == GNUTLS_E_SUCCESS);
-            if (session->SessionEstablished)
-                Lwm2m_Info("Session established");
+            StartHandshake(session, encrypted, encryptedLength);
         }
     }
 
     if (!session)
     {
-        int index;
-        for (index = 0;index < MAX_DTLS_SESSIONS; index++)
+        session = NewSession(sourceAddress, false);
+        if (session)
         {
-            if (!sessions[index].Session)
-            {
-                SetupNewSession(index, sourceAddress, false);
-                sessions[index].UserContext = context;
-                gnutls_transport_set_push_function(sessions[index].Session, SSLSendCallBack);
-                sessions[index].Buffer = encrypted;
-                sessions[index].BufferLength = encryptedLength;
-                sessions[index].SessionEstablished = (gnutls_handshake(sessions[index].Session) == GNUTLS_E_SUCCESS);
-                break;
-            }
+            session->UserContext = context;
+            gnutls_transport_set_push_function(session->Session, SSLSendCallBack);
+            StartHandshake(session, encrypted, encryptedLength);
         }
     }
     return result;
@@ -230,28 +295,21 @@ bool DTLS_Encrypt(NetworkAddress * destAddress, uint8_t * plainText, int plainTe
                 result = (*encryptedLength > 0);
             }
         }
-        else
+        else if (!session->Busy)
         {
             session->UserContext = context;
             gnutls_transport_set_push_function(session->Session, SSLSendCallBack);
-            session->SessionEstablished = (gnutls_handshake(session->Session) == GNUTLS_E_SUCCESS);
-            if (session->SessionEstablished)
-                Lwm2m_Info("DTLS Session established\n");
+            session->SessionEstablished = Handshake(session);
         }
     }
     else
     {
-        int index;
-        for (index = 0;index < MAX_DTLS_SESSIONS; index++)
+        session = NewSession(destAddress, true);
+        if (session)
         {
-            if (!sessions[index].Session)
-            {
-                SetupNewSession(index, destAddress, true);
-                sessions[index].UserContext = context;
-                gnutls_transport_set_push_function(sessions[index].Session, SSLSendCallBack);
-                sessions[index].SessionEstablished = (gnutls_handshake(sessions[index].Session) == GNUTLS_E_SUCCESS);
-                break;
-            }
+            session->UserContext = context;
+            gnutls_transport_set_push_function(session->Session, SSLSendCallBack);
+            session->SessionEstablished = Handshake(session);
         }
     }
     return result;
@@ -260,22 +318,33 @@ bool DTLS_Encrypt(NetworkAddress * destAddress, uint8_t * plainText, int plainTe
 static DTLS_Session * GetSession(NetworkAddress * address)
 {
     DTLS_Session * result = NULL;
-    int index;
-    for (index = 0;index < MAX_DTLS_SESSIONS; index++)
+    DTLS_SessionEntry * entry = DTLSSessions_Find(address);
+    if (entry)
     {
-        if (NetworkAddress_Compare(sessions[index].NetworkAddress,address) == 0)
-        {
-            result = &sessions[index];
-            break;
-        }
+        result = DTLSSessionEntry(entry, DTLS_Session, Entry);
     }
     return result;
 }
 
-static void SetupNewSession(int index, NetworkAddress * networkAddress, bool client)
+static DTLS_Session * NewSession(NetworkAddress * networkAddress, bool client)
+{
+    DTLS_Session * session = (DTLS_Session *)malloc(sizeof(DTLS_Session));
+    if (session)
+    {
+        memset(session, 0, sizeof(DTLS_Session));
+        ListInit(&session->Input);
+        ListInit(&session->Output);
+        ListInit(&session->Received);
+        session->Job.Run = RunHandshake;
+        session->Job.Complete = CompleteHandshake;
+        DTLSSessions_Add(&session->Entry, networkAddress);
+        SetupNewSession(session, client);
+    }
+    return session;
+}
+
+static void SetupNewSession(DTLS_Session * session, bool client)
 {
-    DTLS_Session * session = &sessions[index];
-    session->NetworkAddress = networkAddress;
     unsigned int flags;
 #if GNUTLS_VERSION_MAJOR >= 3
     if (client)
@@ -288,6 +357,7 @@ static void SetupNewSession(int index, NetworkAddress * networkAddress, bool cli
     else
         flags = GNUTLS_SERVER;
 #endif
+    session->Client = client;
     if (gnutls_init(&session->Session, flags) == GNUTLS_E_SUCCESS)
     {
         gnutls_transport_set_pull_function(session->Session, DecryptCallBack);
@@ -375,10 +445,265 @@ static void SetupNewSession(int index, NetworkAddress * networkAddress, bool cli
 #if GNUTLS_VERSION_MAJOR >= 3
         gnutls_handshake_set_timeout(session->Session, GNUTLS_DEFAULT_HANDSHAKE_TIMEOUT);
 #endif
+
+        // Resume the last session with this server, or let clients resume their sessions with us - from the session
+        // cache, or from a ticket the client kept
+        if (client)
+        {
+            size_t dataLength;
+            pthread_mutex_lock(&cacheLock);
+            const void * data = DTLSSessionCache_FindForPeer(session->Entry.NetworkAddress, &dataLength);
+            if (data)
+            {
+                gnutls_session_set_data(session->Session, data, dataLength);
+            }
+            pthread_mutex_unlock(&cacheLock);
+            gnutls_session_ticket_enable_client(session->Session);
+        }
+        else
+        {
+            gnutls_db_set_store_function(session->Session, StoreSessionCallBack);
+            gnutls_db_set_retrieve_function(session->Session, RetrieveSessionCallBack);
+            gnutls_db_set_remove_function(session->Session, RemoveSessionCallBack);
+            gnutls_db_set_ptr(session->Session, session);
+            gnutls_db_set_cache_expiration(session->Session, DTLS_SESSION_CACHE_LIFETIME);
+            if (_TicketKey.data)
+            {
+                gnutls_session_ticket_enable_server(session->Session, &_TicketKey);
+            }
+        }
+    }
+}
+
+static bool Handshake(DTLS_Session * session)
+{
+    bool result = (gnutls_handshake(session->Session) == GNUTLS_E_SUCCESS);
+    if (result)
+    {
+        result = HandshakeComplete(session);
+    }
+    return result;
+}
+
+// Returns false, marking the session as rejected, if the session must not be used
+static bool HandshakeComplete(DTLS_Session * session)
+{
+    bool resumed = gnutls_session_is_resumed(session->Session);
+
+    // a resumed session skips the key exchange, so check the client's identity has not been removed from the key store
+    if (resumed && !session->Client && (gnutls_auth_get_type(session->Session) == GNUTLS_CRD_PSK))
+    {
+        const char * identity = gnutls_psk_server_get_username(session->Session);
+        uint8_t key[DTLS_MAX_PSK_LENGTH];
+        if ((identity != NULL) && (DTLS_FindPSK(identity, strlen(identity), key, sizeof(key)) == 0))
+        {
+            Lwm2m_Warning("Rejected resumed DTLS session of removed PSK identity %s\n", identity);
+            session->Rejected = true;
+            return false;
+        }
+        gnutls_memset(key, 0, sizeof(key));
+    }
+
+    if (resumed)
+    {
+        Lwm2m_Info("DTLS session resumed\n");
+        Metrics_Increment(Metric_DtlsHandshakesResumed);
+    }
+    else
+    {
+        Lwm2m_Info("DTLS session established\n");
+        Metrics_Increment(Metric_DtlsHandshakesFull);
     }
+
+    if (session->Client)
+    {
+        gnutls_datum_t data;
+        if (gnutls_session_get_data2(session->Session, &data) == GNUTLS_E_SUCCESS)
+        {
+            pthread_mutex_lock(&cacheLock);
+            DTLSSessionCache_StoreForPeer(session->Entry.NetworkAddress, data.data, data.size);
+            pthread_mutex_unlock(&cacheLock);
+            gnutls_free(data.data);
+        }
+    }
+    return true;
+}
+
+// Process a handshake flight on a worker if there are any, else inline
+static void StartHandshake(DTLS_Session * session, uint8_t * record, int recordLength)
+{
+    bool offloaded = false;
+    if ((DTLS_GetHandshakeFileDescriptor() >= 0) && QueueRecord(&session->Input, record, recordLength))
+    {
+        session->Busy = true;
+        offloaded = DTLSHandshakePool_Submit(&session->Job);
+        if (!offloaded)
+        {
+            session->Busy = false;
+            FreeRecords(&session->Input);
+        }
+    }
+
+    if (!offloaded)
+    {
+        session->Buffer = record;
+        session->BufferLength = recordLength;
+        session->SessionEstablished = Handshake(session);
+        if (session->Rejected)
+        {
+            FreeSession(session);
+        }
+    }
+}
+
+// On a worker - only the session's own state may be used, and the records it sends are queued in Output
+static void RunHandshake(DTLS_HandshakeJob * job)
+{
+    DTLS_Session * session = ListEntry(job, DTLS_Session, Job);
+    while (!session->HandshakeDone && !ListEmpty(&session->Input))
+    {
+        Record * record = ListEntry(session->Input.Next, Record, List);
+        session->Buffer = record->Data;
+        session->BufferLength = record->Length;
+        session->HandshakeDone = (gnutls_handshake(session->Session) == GNUTLS_E_SUCCESS);
+        ListRemove(&record->List);
+        free(record);
+    }
+}
+
+// Back on the main loop
+static void CompleteHandshake(DTLS_HandshakeJob * job)
+{
+    DTLS_Session * session = ListEntry(job, DTLS_Session, Job);
+    session->Busy = false;
+    FreeRecords(&session->Input);
+    if (session->Closed)
+    {
+        ReleaseSession(session);
+    }
+    else
+    {
+        while (!ListEmpty(&session->Output))
+        {
+            Record * record = ListEntry(session->Output.Next, Record, List);
+            if (NetworkSend)
+            {
+                NetworkSend(session->Entry.NetworkAddress, record->Data, record->Length, session->UserContext);
+            }
+            ListRemove(&record->List);
+            free(record);
+        }
+
+        if (session->HandshakeDone)
+        {
+            // application data that arrived with the last flight is dropped, and retransmitted by the peer
+            FreeRecords(&session->Received);
+            session->SessionEstablished = HandshakeComplete(session);
+            if (session->Rejected)
+            {
+                FreeSession(session);
+            }
+        }
+        else if (!ListEmpty(&session->Received))
+        {
+            while (!ListEmpty(&session->Received))
+            {
+                Record * record = ListEntry(session->Received.Next, Record, List);
+                ListRemove(&record->List);
+                ListAdd(&record->List, &session->Input);
+            }
+            session->Busy = true;
+            if (!DTLSHandshakePool_Submit(&session->Job))
+            {
+                // the workers have stopped
+                session->Busy = false;
+                RunHandshake(&session->Job);
+                FreeRecords(&session->Input);
+                session->SessionEstablished = session->HandshakeDone && HandshakeComplete(session);
+                if (session->Rejected)
+                {
+                    FreeSession(session);
+                }
+            }
+        }
+    }
+}
+
+static bool QueueRecord(struct ListHead * records, const void * data, size_t length)
+{
+    Record * record = (Record *)malloc(sizeof(Record) + length);
+    if (record)
+    {
+        record->Length = length;
+        memcpy(record->Data, data, length);
+        ListAdd(&record->List, records);
+    }
+    return record != NULL;
+}
+
+static void FreeRecords(struct ListHead * records)
+{
+    while (!ListEmpty(records))
+    {
+        Record * record = ListEntry(records->Next, Record, List);
+        ListRemove(&record->List);
+        free(record);
+    }
+}
+
+static int StoreSessionCallBack(void * context, gnutls_datum_t key, gnutls_datum_t data)
+{
+    (void)context;
+    pthread_mutex_lock(&cacheLock);
+    bool stored = DTLSSessionCache_Store(key.data, key.size, data.data, data.size);
+    pthread_mutex_unlock(&cacheLock);
+    return stored ? 0 : -1;
+}
+
+static gnutls_datum_t RetrieveSessionCallBack(void * context, gnutls_datum_t key)
+{
+    (void)context;
+    gnutls_datum_t result = { NULL, 0 };
+    size_t dataLength;
+    pthread_mutex_lock(&cacheLock);
+    const void * data = DTLSSessionCache_Find(key.data, key.size, &dataLength);
+    if (data)
+    {
+        result.data = gnutls_malloc(dataLength);
+        if (result.data)
+        {
+            memcpy(result.data, data, dataLength);
+            result.size = dataLength;
+        }
+    }
+    pthread_mutex_unlock(&cacheLock);
+    return result;
+}
+
+static int RemoveSessionCallBack(void * context, gnutls_datum_t key)
+{
+    (void)context;
+    pthread_mutex_lock(&cacheLock);
+    DTLSSessionCache_Remove(key.data, key.size);
+    pthread_mutex_unlock(&cacheLock);
+    return 0;
 }
 
 static void FreeSession(DTLS_Session * session)
+{
+    DTLSSessions_Remove(&session->Entry);
+    if (session->Busy)
+    {
+        // a worker still has the session - released when it is done
+        session->Closed = true;
+    }
+    else
+    {
+        ReleaseSession(session);
+    }
+}
+
+static void ReleaseSession(DTLS_Session * session)
 {
     if (session->Credentials)
     {
@@ -389,8 +714,15 @@ static void FreeSession(DTLS_Session * session)
 
     }
     gnutls_deinit(session->Session);
-    memset(session,0, sizeof(DTLS_Session));
+    FreeRecords(&session->Input);
+    FreeRecords(&session->Output);
+    FreeRecords(&session->Received);
+    free(session);
+}
 
+static void FreeSessionEntry(DTLS_SessionEntry * entry)
+{
+    FreeSession(DTLSSessionEntry(entry, DTLS_Session, Entry));
 }
 
 #if GNUTLS_VERSION_MAJOR >= 3
@@ -467,11 +799,29 @@ static int PSKClientCallBack(gnutls_session_t session, char **username, gnutls_d
 static int PSKCallBack(gnutls_session_t session, const char *username, gnutls_datum_t * key)
 {
     (void)session;
-    (void)username;
-    key->data = gnutls_malloc(pskKey.size);
-    key->size = pskKey.size;
-    memcpy(key->data, pskKey.data, pskKey.size);
-    return 0;
+    int result = 0;
+    uint8_t storedKey[DTLS_MAX_PSK_LENGTH];
+    int keyLength = DTLS_FindPSK(username, strlen(username), storedKey, sizeof(storedKey));
+    if (keyLength < 0)
+    {
+        // no key store - every client has the one key
+        key->data = gnutls_malloc(pskKey.size);
+        key->size = pskKey.size;
+        memcpy(key->data, pskKey.data, pskKey.size);
+    }
+    else if (keyLength > 0)
+    {
+        key->data = gnutls_malloc(keyLength);
+        key->size = keyLength;
+        memcpy(key->data, storedKey, keyLength);
+        gnutls_memset(storedKey, 0, keyLength);
+    }
+    else
+    {
+        Lwm2m_Warning("Unknown PSK identity %s\n", username);
+        result = -1;
+    }
+    return result;
 }
 
 #if GNUTLS_VERSION_MAJOR >= 3
@@ -501,9 +851,14 @@ static ssize_t SSLSendCallBack(gnutls_transport_ptr_t context, const void * send
 {
     ssize_t result;
     DTLS_Session * session = (DTLS_Session *)context;
-    if (NetworkSend)
+    if (session->Busy)
+    {
+        // on a handshake worker - sent from the main loop when the worker is done
+        result = QueueRecord(&session->Output, sendBuffer, sendBufferLength) ? (ssize_t)sendBufferLength : 0;
+    }
+    else if (NetworkSend)
     {
-        NetworkTransmissionError error = NetworkSend(session->NetworkAddress, sendBuffer, sendBufferLength, session->UserContext);
+        NetworkTransmissionError error = NetworkSend(session->Entry.NetworkAddress, sendBuffer, sendBufferLength, session->UserContext);
         if (error == NetworkTransmissionError_None)
             result = sendBufferLength;
         else
@@ -0,0 +1,192 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "dtls_handshake_pool.h"
+#include "dtls_abstraction.h"
+#include "lwm2m_debug.h"
+#include "lwm2m_metrics.h"
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobQueued = PTHREAD_COND_INITIALIZER;
+static struct ListHead queuedJobs = LIST_INIT(queuedJobs);     // waiting for a worker
+static struct ListHead doneJobs = LIST_INIT(doneJobs);         // waiting for DTLS_CompleteHandshakes
+static pthread_t threads[MAX_DTLS_HANDSHAKE_WORKERS];
+static int numberOfWorkers = 0;
+static bool stopping = false;
+static int wakeFds[2] = { -1, -1 };                            // written by the workers when a job is done
+
+static void * RunWorker(void * arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    while (true)
+    {
+        while (ListEmpty(&queuedJobs) && !stopping)
+        {
+            pthread_cond_wait(&jobQueued, &lock);
+        }
+        if (ListEmpty(&queuedJobs))
+        {
+            break;
+        }
+
+        DTLS_HandshakeJob * job = ListEntry(queuedJobs.Next, DTLS_HandshakeJob, List);
+        ListRemove(&job->List);
+        pthread_mutex_unlock(&lock);
+
+        job->Run(job);
+
+        pthread_mutex_lock(&lock);
+        bool wake = ListEmpty(&doneJobs);
+        ListAdd(&job->List, &doneJobs);
+        if (wake)
+        {
+            // one byte wakes the main loop for every job done until it calls DTLS_CompleteHandshakes
+            const char signal = 0;
+            if (write(wakeFds[1], &signal, sizeof(signal)) < 0)
+            {
+                Lwm2m_Error("Failed to wake the main loop for a DTLS handshake: %d\n", errno);
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+static bool StartWorkers(int workers)
+{
+    if (wakeFds[0] < 0)
+    {
+        if (pipe(wakeFds) != 0)
+        {
+            Lwm2m_Error("Failed to create the DTLS handshake pipe: %d\n", errno);
+            return false;
+        }
+        fcntl(wakeFds[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakeFds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(wakeFds[1], F_SETFD, FD_CLOEXEC);
+    }
+
+    stopping = false;
+    for (numberOfWorkers = 0; numberOfWorkers < workers; numberOfWorkers++)
+    {
+        if (pthread_create(&threads[numberOfWorkers], NULL, RunWorker, NULL) != 0)
+        {
+            Lwm2m_Error("Failed to start DTLS handshake worker %d\n", numberOfWorkers);
+            break;
+        }
+    }
+    return numberOfWorkers > 0;
+}
+
+void DTLS_SetHandshakeWorkers(int workers)
+{
+    DTLSHandshakePool_Stop();
+    if (workers > MAX_DTLS_HANDSHAKE_WORKERS)
+    {
+        workers = MAX_DTLS_HANDSHAKE_WORKERS;
+    }
+    if ((workers > 0) && StartWorkers(workers))
+    {
+        Lwm2m_Info("DTLS handshakes on %d worker threads\n", numberOfWorkers);
+    }
+}
+
+int DTLS_GetHandshakeFileDescriptor(void)
+{
+    return (numberOfWorkers > 0) ? wakeFds[0] : -1;
+}
+
+void DTLS_CompleteHandshakes(void)
+{
+    struct ListHead done;
+    ListInit(&done);
+
+    if (wakeFds[0] >= 0)
+    {
+        char signals[64];
+        while (read(wakeFds[0], signals, sizeof(signals)) > 0)
+        {
+            // drain
+        }
+    }
+
+    pthread_mutex_lock(&lock);
+    if (!ListEmpty(&doneJobs))
+    {
+        // take the whole list, so workers can carry on while the jobs are completed
+        done.Next = doneJobs.Next;
+        done.Prev = doneJobs.Prev;
+        done.Next->Prev = &done;
+        done.Prev->Next = &done;
+        ListInit(&doneJobs);
+    }
+    pthread_mutex_unlock(&lock);
+
+    while (!ListEmpty(&done))
+    {
+        DTLS_HandshakeJob * job = ListEntry(done.Next, DTLS_HandshakeJob, List);
+        ListRemove(&job->List);
+        Metrics_Decrement(Metric_DtlsHandshakeJobs);
+        job->Complete(job);
+    }
+}
+
+bool DTLSHandshakePool_Submit(DTLS_HandshakeJob * job)
+{
+    bool result = false;
+    if (numberOfWorkers > 0)
+    {
+        pthread_mutex_lock(&lock);
+        ListAdd(&job->List, &queuedJobs);
+        pthread_cond_signal(&jobQueued);
+        pthread_mutex_unlock(&lock);
+        Metrics_Increment(Metric_DtlsHandshakeJobs);
+        result = true;
+    }
+    return result;
+}
+
+void DTLSHandshakePool_Stop(void)
+{
+    if (numberOfWorkers > 0)
+    {
+        int i;
+        pthread_mutex_lock(&lock);
+        stopping = true;
+        pthread_cond_broadcast(&jobQueued);
+        pthread_mutex_unlock(&lock);
+        for (i = 0; i < numberOfWorkers; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        numberOfWorkers = 0;
+        DTLS_CompleteHandshakes();
+    }
+}
@@ -0,0 +1,82 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#ifndef DTLS_HANDSHAKE_POOL_H_
+#define DTLS_HANDSHAKE_POOL_H_
+
+#include <stdbool.h>
+
+#include "lwm2m_list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Worker threads for DTLS handshakes, so that the asymmetric crypto of a handshake flight does not stall the main
+ *  loop. A backend embeds a DTLS_HandshakeJob in its session and submits it with the records received; Run is called
+ *  on a worker thread, and Complete back on the main loop from DTLS_CompleteHandshakes once the descriptor from
+ *  DTLS_GetHandshakeFileDescriptor is readable. The backend must not touch the session on the main loop between
+ *  submitting the job and its completion.
+ *
+ *  example usage:
+ *
+ *     session->Job.Run = RunHandshake;             // worker thread - only the session's own state
+ *     session->Job.Complete = CompleteHandshake;   // main loop - send the flight, update the session table
+ *     if (!DTLSHandshakePool_Submit(&session->Job))
+ *     {
+ *         ... no workers - handshake inline ...
+ *     }
+ */
+
+#ifndef MAX_DTLS_HANDSHAKE_WORKERS
+    #define MAX_DTLS_HANDSHAKE_WORKERS      (64)
+#endif
+
+// Records kept for a session while a worker has it - more are dropped, and retransmitted by the peer
+#ifndef MAX_DTLS_HANDSHAKE_BACKLOG
+    #define MAX_DTLS_HANDSHAKE_BACKLOG      (16)
+#endif
+
+typedef struct DTLS_HandshakeJob DTLS_HandshakeJob;
+
+typedef void (*DTLS_HandshakeJobCallback)(DTLS_HandshakeJob * job);
+
+struct DTLS_HandshakeJob
+{
+    struct ListHead List;
+    DTLS_HandshakeJobCallback Run;          // on a worker thread
+    DTLS_HandshakeJobCallback Complete;     // on the main loop
+};
+
+// Queue a job for the workers. Returns false, without queuing it, if there are no workers.
+bool DTLSHandshakePool_Submit(DTLS_HandshakeJob * job);
+
+// Wait for the workers to finish the jobs queued, complete them, and stop the workers
+void DTLSHandshakePool_Stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DTLS_HANDSHAKE_POOL_H_ */
@@ -0,0 +1,411 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtls_keystore.h"
+#include "dtls_abstraction.h"
+#include "lwm2m_debug.h"
+#include "lwm2m_hash.h"
+#include "lwm2m_metrics.h"
+
+#define MIN_KEYSTORE_SLOTS          (64)
+#define MIN_KEYSTORE_ENTRIES_SIZE   (4096)
+
+// An entry is a two byte identity length, a one byte key length, the identity and the key
+#define ENTRY_HEADER_SIZE           (3)
+
+typedef struct
+{
+    uint32_t Hash;
+    uint32_t Offset;                // of the entry plus one - zero for an empty slot
+} Slot;
+
+struct _DTLS_KeyStore
+{
+    Slot * Slots;
+    size_t NumberOfSlots;           // always a power of two, and at most three quarters full
+    size_t Count;
+    uint8_t * Entries;
+    size_t EntriesSize;
+    size_t EntriesCapacity;
+};
+
+// The key store used by DTLS_FindPSK - replaced as a whole on reload, so lookups on handshake workers see either store
+static DTLS_KeyStore * keyStore = NULL;
+static pthread_rwlock_t keyStoreLock = PTHREAD_RWLOCK_INITIALIZER;
+static DTLS_KeysRevokedCallback keysRevokedCallback = NULL;
+
+static size_t IdentityLength(const uint8_t * entry)
+{
+    return ((size_t)entry[0] << 8) | entry[1];
+}
+
+static const uint8_t * FindEntry(const DTLS_KeyStore * store, uint32_t hash, const char * identity, size_t identityLength, Slot ** slot)
+{
+    const uint8_t * result = NULL;
+    size_t mask = store->NumberOfSlots - 1;
+    size_t index = hash & mask;
+    while (store->Slots[index].Offset != 0)
+    {
+        if (store->Slots[index].Hash == hash)
+        {
+            const uint8_t * entry = &store->Entries[store->Slots[index].Offset - 1];
+            if ((IdentityLength(entry) == identityLength) && (memcmp(&entry[ENTRY_HEADER_SIZE], identity, identityLength) == 0))
+            {
+                result = entry;
+                break;
+            }
+        }
+        index = (index + 1) & mask;
+    }
+    *slot = &store->Slots[index];
+    return result;
+}
+
+static bool Grow(DTLS_KeyStore * store)
+{
+    size_t numberOfSlots = (store->NumberOfSlots == 0) ? MIN_KEYSTORE_SLOTS : store->NumberOfSlots * 2;
+    Slot * slots = (Slot *)calloc(numberOfSlots, sizeof(Slot));
+    if (slots == NULL)
+    {
+        return false;
+    }
+
+    size_t i;
+    for (i = 0; i < store->NumberOfSlots; i++)
+    {
+        if (store->Slots[i].Offset != 0)
+        {
+            size_t index = store->Slots[i].Hash & (numberOfSlots - 1);
+            while (slots[index].Offset != 0)
+            {
+                index = (index + 1) & (numberOfSlots - 1);
+            }
+            slots[index] = store->Slots[i];
+        }
+    }
+    free(store->Slots);
+    store->Slots = slots;
+    store->NumberOfSlots = numberOfSlots;
+    return true;
+}
+
+DTLS_KeyStore * DTLSKeyStore_New(void)
+{
+    DTLS_KeyStore * store = (DTLS_KeyStore *)calloc(1, sizeof(DTLS_KeyStore));
+    if ((store != NULL) && !Grow(store))
+    {
+        free(store);
+        store = NULL;
+    }
+    return store;
+}
+
+void DTLSKeyStore_Free(DTLS_KeyStore ** store)
+{
+    if ((store != NULL) && (*store != NULL))
+    {
+        if ((*store)->Entries != NULL)
+        {
+            // don't leave keys behind in freed memory
+            memset((*store)->Entries, 0, (*store)->EntriesSize);
+        }
+        free((*store)->Entries);
+        free((*store)->Slots);
+        free(*store);
+        *store = NULL;
+    }
+}
+
+bool DTLSKeyStore_Add(DTLS_KeyStore * store, const char * identity, size_t identityLength, const uint8_t * key, size_t keyLength)
+{
+    if ((store == NULL) || (identity == NULL) || (identityLength == 0) || (identityLength > DTLS_MAX_PSK_IDENTITY_LENGTH) ||
+        (key == NULL) || (keyLength == 0) || (keyLength > DTLS_MAX_PSK_LENGTH))
+    {
+        return false;
+    }
+
+    size_t entrySize = ENTRY_HEADER_SIZE + identityLength + keyLength;
+    if (store->EntriesSize + entrySize >= UINT32_MAX)
+    {
+        return false;
+    }
+    if (((store->Count + 1) * 4 > store->NumberOfSlots * 3) && !Grow(store))
+    {
+        return false;
+    }
+
+    uint32_t hash = Hash_Bytes(identity, identityLength, HASH_SEED);
+    Slot * slot;
+    uint8_t * entry = (uint8_t *)FindEntry(store, hash, identity, identityLength, &slot);
+    if ((entry != NULL) && (entry[2] == keyLength))
+    {
+        memcpy(&entry[ENTRY_HEADER_SIZE + identityLength], key, keyLength);
+        return true;
+    }
+
+    if (store->EntriesSize + entrySize > store->EntriesCapacity)
+    {
+        size_t capacity = (store->EntriesCapacity == 0) ? MIN_KEYSTORE_ENTRIES_SIZE : store->EntriesCapacity;
+        while (capacity < store->EntriesSize + entrySize)
+        {
+            capacity *= 2;
+        }
+        uint8_t * entries = (uint8_t *)realloc(store->Entries, capacity);
+        if (entries == NULL)
+        {
+            return false;
+        }
+        store->Entries = entries;
+        store->EntriesCapacity = capacity;
+    }
+
+    // a key of another length is appended, and the old entry left unused
+    entry = &store->Entries[store->EntriesSize];
+    entry[0] = (uint8_t)(identityLength >> 8);
+    entry[1] = (uint8_t)identityLength;
+    entry[2] = (uint8_t)keyLength;
+    memcpy(&entry[ENTRY_HEADER_SIZE], identity, identityLength);
+    memcpy(&entry[ENTRY_HEADER_SIZE + identityLength], key, keyLength);
+    if (slot->Offset == 0)
+    {
+        store->Count++;
+    }
+    slot->Hash = hash;
+    slot->Offset = store->EntriesSize + 1;
+    store->EntriesSize += entrySize;
+    return true;
+}
+
+const uint8_t * DTLSKeyStore_Find(const DTLS_KeyStore * store, const char * identity, size_t identityLength, size_t * keyLength)
+{
+    const uint8_t * result = NULL;
+    if ((store != NULL) && (identity != NULL))
+    {
+        Slot * slot;
+        const uint8_t * entry = FindEntry(store, Hash_Bytes(identity, identityLength, HASH_SEED), identity, identityLength, &slot);
+        if (entry != NULL)
+        {
+            result = &entry[ENTRY_HEADER_SIZE + identityLength];
+            if (keyLength != NULL)
+            {
+                *keyLength = entry[2];
+            }
+        }
+    }
+    return result;
+}
+
+size_t DTLSKeyStore_Count(const DTLS_KeyStore * store)
+{
+    return (store != NULL) ? store->Count : 0;
+}
+
+size_t DTLSKeyStore_Size(const DTLS_KeyStore * store)
+{
+    return (store != NULL) ? sizeof(DTLS_KeyStore) + store->NumberOfSlots * sizeof(Slot) + store->EntriesCapacity : 0;
+}
+
+static int HexDigit(char digit)
+{
+    int result = -1;
+    if ((digit >= '0') && (digit <= '9'))
+        result = digit - '0';
+    else if ((digit >= 'A') && (digit <= 'F'))
+        result = 10 + (digit - 'A');
+    else if ((digit >= 'a') && (digit <= 'f'))
+        result = 10 + (digit - 'a');
+    return result;
+}
+
+// Parse "identity:key" - the identity may itself contain colons, the hex key cannot
+static bool ParseLine(DTLS_KeyStore * store, char * line)
+{
+    size_t length = strlen(line);
+    while ((length > 0) && ((line[length - 1] == '\n') || (line[length - 1] == '\r') || (line[length - 1] == ' ') || (line[length - 1] == '\t')))
+    {
+        line[--length] = '\0';
+    }
+
+    char * separator = strrchr(line, ':');
+    if ((separator == NULL) || (separator == line))
+    {
+        return false;
+    }
+
+    const char * hex = separator + 1;
+    size_t hexLength = strlen(hex);
+    if ((hexLength == 0) || ((hexLength % 2) != 0) || (hexLength / 2 > DTLS_MAX_PSK_LENGTH))
+    {
+        return false;
+    }
+
+    uint8_t key[DTLS_MAX_PSK_LENGTH];
+    size_t i;
+    for (i = 0; i < hexLength / 2; i++)
+    {
+        int high = HexDigit(hex[2 * i]);
+        int low = HexDigit(hex[2 * i + 1]);
+        if ((high < 0) || (low < 0))
+        {
+            return false;
+        }
+        key[i] = (uint8_t)((high << 4) | low);
+    }
+
+    bool result = DTLSKeyStore_Add(store, line, separator - line, key, hexLength / 2);
+    memset(key, 0, sizeof(key));
+    return result;
+}
+
+DTLS_KeyStore * DTLSKeyStore_Load(const char * fileName)
+{
+    FILE * f = fopen(fileName, "r");
+    if (f == NULL)
+    {
+        Lwm2m_Error("Failed to open key store %s: %s\n", fileName, strerror(errno));
+        return NULL;
+    }
+
+    DTLS_KeyStore * store = DTLSKeyStore_New();
+    char * line = NULL;
+    size_t length = 0;
+    int lineNumber = 0;
+    while ((store != NULL) && (getline(&line, &length, f) != -1))
+    {
+        lineNumber++;
+        if ((line[0] == '#') || (line[strspn(line, " \t\r\n")] == '\0'))
+        {
+            continue;
+        }
+        if (!ParseLine(store, line))
+        {
+            Lwm2m_Error("Skipping malformed line %d in key store %s\n", lineNumber, fileName);
+        }
+    }
+    if (line != NULL)
+    {
+        memset(line, 0, length);
+        free(line);
+    }
+    fclose(f);
+
+    if (store == NULL)
+    {
+        Lwm2m_Error("Out of memory loading key store %s\n", fileName);
+    }
+    else if ((store->EntriesSize > 0) && (store->EntriesSize < store->EntriesCapacity))
+    {
+        // a loaded store is not added to, so give back the room left for growth
+        uint8_t * entries = (uint8_t *)realloc(store->Entries, store->EntriesSize);
+        if (entries != NULL)
+        {
+            store->Entries = entries;
+            store->EntriesCapacity = store->EntriesSize;
+        }
+    }
+    return store;
+}
+
+bool DTLSKeyStore_KeysRevoked(const DTLS_KeyStore * previous, const DTLS_KeyStore * store)
+{
+    if ((previous == NULL) || (store == NULL))
+    {
+        return previous != store;
+    }
+
+    size_t i;
+    for (i = 0; i < previous->NumberOfSlots; i++)
+    {
+        if (previous->Slots[i].Offset != 0)
+        {
+            const uint8_t * entry = &previous->Entries[previous->Slots[i].Offset - 1];
+            const char * identity = (const char *)&entry[ENTRY_HEADER_SIZE];
+            size_t identityLength = IdentityLength(entry);
+            size_t keyLength;
+            const uint8_t * key = DTLSKeyStore_Find(store, identity, identityLength, &keyLength);
+            if ((key == NULL) || (keyLength != entry[2]) || (memcmp(key, &entry[ENTRY_HEADER_SIZE + identityLength], keyLength) != 0))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void DTLSKeyStore_SetKeysRevokedCallback(DTLS_KeysRevokedCallback callback)
+{
+    keysRevokedCallback = callback;
+}
+
+bool DTLS_LoadKeyStore(const char * fileName)
+{
+    DTLS_KeyStore * store = NULL;
+    if (fileName != NULL)
+    {
+        store = DTLSKeyStore_Load(fileName);
+        if (store == NULL)
+        {
+            return false;
+        }
+        Lwm2m_Info("Loaded %zu PSK identities from %s\n", DTLSKeyStore_Count(store), fileName);
+    }
+
+    pthread_rwlock_wrlock(&keyStoreLock);
+    DTLS_KeyStore * previous = keyStore;
+    keyStore = store;
+    pthread_rwlock_unlock(&keyStoreLock);
+
+    if ((keysRevokedCallback != NULL) && DTLSKeyStore_KeysRevoked(previous, store))
+    {
+        Lwm2m_Info("PSKs changed or removed - clients must perform a full handshake\n");
+        keysRevokedCallback();
+    }
+    DTLSKeyStore_Free(&previous);
+    Metrics_Set(Metric_DtlsPskIdentities, DTLSKeyStore_Count(store));
+    return true;
+}
+
+int DTLS_FindPSK(const char * identity, size_t identityLength, uint8_t * key, size_t keySize)
+{
+    int result = -1;
+    pthread_rwlock_rdlock(&keyStoreLock);
+    if (keyStore != NULL)
+    {
+        size_t keyLength;
+        const uint8_t * storedKey = DTLSKeyStore_Find(keyStore, identity, identityLength, &keyLength);
+        result = 0;
+        if ((storedKey != NULL) && (keyLength <= keySize))
+        {
+            memcpy(key, storedKey, keyLength);
+            result = keyLength;
+        }
+    }
+    pthread_rwlock_unlock(&keyStoreLock);
+    return result;
+}
@@ -0,0 +1,92 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#ifndef DTLS_KEYSTORE_H_
+#define DTLS_KEYSTORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Pre-shared keys by identity, for servers that give each device its own PSK. Entries are packed back to back in
+ *  one buffer, indexed by an open addressing hash table of 8-byte slots, so a store of a million identities takes a
+ *  few bytes per entry beyond the identities and keys themselves, and a lookup is one hash and usually one probe.
+ *
+ *  A key store file has one identity per line, followed by a colon and the key as a hex string - blank lines and
+ *  lines starting with '#' are ignored:
+ *
+ *     # identity:key
+ *     device-0001:2646188672F6CCD4AAEA476C645F2565
+ *
+ *  example usage:
+ *
+ *     DTLS_KeyStore * store = DTLSKeyStore_Load("keys.psk");
+ *     size_t keyLength;
+ *     const uint8_t * key = DTLSKeyStore_Find(store, identity, identityLength, &keyLength);
+ *     DTLSKeyStore_Free(&store);
+ */
+
+#ifndef DTLS_MAX_PSK_LENGTH
+    #define DTLS_MAX_PSK_LENGTH     (64)
+#endif
+
+#define DTLS_MAX_PSK_IDENTITY_LENGTH    (65535)
+
+typedef struct _DTLS_KeyStore DTLS_KeyStore;
+
+DTLS_KeyStore * DTLSKeyStore_New(void);
+void DTLSKeyStore_Free(DTLS_KeyStore ** store);
+
+// Load a key store file, skipping malformed lines. Returns NULL if the file cannot be read.
+DTLS_KeyStore * DTLSKeyStore_Load(const char * fileName);
+
+// Add the key for an identity, replacing any key it already has
+bool DTLSKeyStore_Add(DTLS_KeyStore * store, const char * identity, size_t identityLength, const uint8_t * key, size_t keyLength);
+
+// The key for an identity, or NULL if it has none - valid until the store is changed or freed
+const uint8_t * DTLSKeyStore_Find(const DTLS_KeyStore * store, const char * identity, size_t identityLength, size_t * keyLength);
+
+size_t DTLSKeyStore_Count(const DTLS_KeyStore * store);
+
+// Bytes allocated for the store
+size_t DTLSKeyStore_Size(const DTLS_KeyStore * store);
+
+/* Returns true if an identity with a key in previous has no key, or another key, in store - so sessions established
+ * with the keys in previous must not be resumed. Either store may be NULL, for the single PSK used without a key store.
+ */
+bool DTLSKeyStore_KeysRevoked(const DTLS_KeyStore * previous, const DTLS_KeyStore * store);
+
+// Called by DTLS_LoadKeyStore when a reload revokes keys, so the backend can forget the sessions it would resume
+typedef void (*DTLS_KeysRevokedCallback)(void);
+void DTLSKeyStore_SetKeysRevokedCallback(DTLS_KeysRevokedCallback callback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DTLS_KEYSTORE_H_ */
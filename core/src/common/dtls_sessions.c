@@ -0,0 +1,280 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtls_sessions.h"
+#include "dtls_abstraction.h"
+#include "lwm2m_debug.h"
+#include "lwm2m_metrics.h"
+#include "lwm2m_util.h"
+
+static HashTable sessions = {0};
+static struct ListHead leastRecentlyUsed = LIST_INIT(leastRecentlyUsed);
+static DTLS_FreeSessionCallback freeSessionCallback = NULL;
+static size_t maxSessions = MAX_DTLS_SESSIONS;
+static uint64_t idleTimeoutMs = DTLS_SESSION_IDLE_TIMEOUT * 1000ULL;
+
+typedef struct
+{
+    HashTableNode Node;
+    struct ListHead LeastRecentlyUsed;
+    uint64_t Stored;                    // tick count in milliseconds
+    size_t KeyLength;
+    size_t DataLength;
+    uint8_t Bytes[];                    // key, followed by data
+} CachedSession;
+
+typedef struct
+{
+    const void * Key;
+    size_t KeyLength;
+} CacheKey;
+
+static HashTable cache = {0};
+static struct ListHead cacheLeastRecentlyUsed = LIST_INIT(cacheLeastRecentlyUsed);
+
+static bool MatchSession(const HashTableNode * node, const void * key)
+{
+    return NetworkAddress_Compare(HashTableEntry(node, DTLS_SessionEntry, Node)->NetworkAddress, (NetworkAddress *)key) == 0;
+}
+
+static void EvictSession(DTLS_SessionEntry * entry)
+{
+    DTLSSessions_Remove(entry);
+    Metrics_Increment(Metric_DtlsSessionsEvicted);
+    if (freeSessionCallback)
+    {
+        freeSessionCallback(entry);
+    }
+}
+
+void DTLS_SetSessionLimits(int maximum, int idleTimeoutSeconds)
+{
+    maxSessions = (maximum > 0) ? maximum : MAX_DTLS_SESSIONS;
+    idleTimeoutMs = (idleTimeoutSeconds > 0) ? idleTimeoutSeconds * 1000ULL : 0;
+}
+
+void DTLSSessions_Init(DTLS_FreeSessionCallback freeSession)
+{
+    freeSessionCallback = freeSession;
+    HashTable_Init(&sessions, 0);
+    ListInit(&leastRecentlyUsed);
+}
+
+void DTLSSessions_Destroy(void)
+{
+    while (!ListEmpty(&leastRecentlyUsed))
+    {
+        DTLS_SessionEntry * entry = ListEntry(leastRecentlyUsed.Next, DTLS_SessionEntry, LeastRecentlyUsed);
+        DTLSSessions_Remove(entry);
+        if (freeSessionCallback)
+        {
+            freeSessionCallback(entry);
+        }
+    }
+    HashTable_Destroy(&sessions);
+
+    DTLSSessionCache_Clear();
+    HashTable_Destroy(&cache);
+}
+
+DTLS_SessionEntry * DTLSSessions_Find(NetworkAddress * address)
+{
+    DTLS_SessionEntry * result = NULL;
+    HashTableNode * node = HashTable_Find(&sessions, NetworkAddress_Hash(address), MatchSession, address);
+    if (node != NULL)
+    {
+        result = HashTableEntry(node, DTLS_SessionEntry, Node);
+        result->LastUsed = Lwm2mCore_GetTickCountMs();
+        ListRemove(&result->LeastRecentlyUsed);
+        ListAdd(&result->LeastRecentlyUsed, &leastRecentlyUsed);
+    }
+    return result;
+}
+
+void DTLSSessions_Add(DTLS_SessionEntry * entry, NetworkAddress * address)
+{
+    DTLSSessions_EvictIdle();
+    while ((HashTable_Count(&sessions) >= maxSessions) && !ListEmpty(&leastRecentlyUsed))
+    {
+        Lwm2m_Debug("DTLS session table full - evicting least recently used session\n");
+        EvictSession(ListEntry(leastRecentlyUsed.Next, DTLS_SessionEntry, LeastRecentlyUsed));
+    }
+
+    entry->NetworkAddress = address;
+    entry->LastUsed = Lwm2mCore_GetTickCountMs();
+    HashTable_Add(&sessions, &entry->Node, NetworkAddress_Hash(address));
+    ListAdd(&entry->LeastRecentlyUsed, &leastRecentlyUsed);
+    Metrics_Set(Metric_DtlsSessions, HashTable_Count(&sessions));
+}
+
+void DTLSSessions_Remove(DTLS_SessionEntry * entry)
+{
+    if (HashTable_Remove(&sessions, &entry->Node))
+    {
+        ListRemove(&entry->LeastRecentlyUsed);
+        Metrics_Set(Metric_DtlsSessions, HashTable_Count(&sessions));
+    }
+}
+
+void DTLSSessions_EvictIdle(void)
+{
+    if (idleTimeoutMs > 0)
+    {
+        uint64_t now = Lwm2mCore_GetTickCountMs();
+        while (!ListEmpty(&leastRecentlyUsed))
+        {
+            DTLS_SessionEntry * entry = ListEntry(leastRecentlyUsed.Next, DTLS_SessionEntry, LeastRecentlyUsed);
+            if (now - entry->LastUsed < idleTimeoutMs)
+            {
+                break;
+            }
+            Lwm2m_Debug("DTLS session idle for %llu ms - evicting\n", (unsigned long long)(now - entry->LastUsed));
+            EvictSession(entry);
+        }
+    }
+}
+
+size_t DTLSSessions_Count(void)
+{
+    return HashTable_Count(&sessions);
+}
+
+static bool MatchCachedSession(const HashTableNode * node, const void * key)
+{
+    const CachedSession * cached = HashTableEntry(node, CachedSession, Node);
+    const CacheKey * cacheKey = (const CacheKey *)key;
+    return (cached->KeyLength == cacheKey->KeyLength) && (memcmp(cached->Bytes, cacheKey->Key, cacheKey->KeyLength) == 0);
+}
+
+static CachedSession * FindCachedSession(const void * key, size_t keyLength)
+{
+    CacheKey cacheKey = { key, keyLength };
+    HashTableNode * node = HashTable_Find(&cache, Hash_Bytes(key, keyLength, HASH_SEED), MatchCachedSession, &cacheKey);
+    return (node != NULL) ? HashTableEntry(node, CachedSession, Node) : NULL;
+}
+
+static void RemoveCachedSession(CachedSession * cached)
+{
+    HashTable_Remove(&cache, &cached->Node);
+    ListRemove(&cached->LeastRecentlyUsed);
+    free(cached);
+    Metrics_Set(Metric_DtlsSessionCacheEntries, HashTable_Count(&cache));
+}
+
+bool DTLSSessionCache_Store(const void * key, size_t keyLength, const void * data, size_t dataLength)
+{
+    bool result = false;
+    CachedSession * cached = FindCachedSession(key, keyLength);
+    if (cached != NULL)
+    {
+        RemoveCachedSession(cached);
+    }
+    while ((HashTable_Count(&cache) >= MAX_DTLS_SESSION_CACHE) && !ListEmpty(&cacheLeastRecentlyUsed))
+    {
+        RemoveCachedSession(ListEntry(cacheLeastRecentlyUsed.Next, CachedSession, LeastRecentlyUsed));
+    }
+
+    cached = (CachedSession *)malloc(sizeof(CachedSession) + keyLength + dataLength);
+    if (cached != NULL)
+    {
+        cached->Stored = Lwm2mCore_GetTickCountMs();
+        cached->KeyLength = keyLength;
+        cached->DataLength = dataLength;
+        memcpy(cached->Bytes, key, keyLength);
+        memcpy(cached->Bytes + keyLength, data, dataLength);
+        HashTable_Add(&cache, &cached->Node, Hash_Bytes(key, keyLength, HASH_SEED));
+        ListAdd(&cached->LeastRecentlyUsed, &cacheLeastRecentlyUsed);
+        Metrics_Set(Metric_DtlsSessionCacheEntries, HashTable_Count(&cache));
+        result = true;
+    }
+    return result;
+}
+
+const void * DTLSSessionCache_Find(const void * key, size_t keyLength, size_t * dataLength)
+{
+    const void * result = NULL;
+    CachedSession * cached = FindCachedSession(key, keyLength);
+    if ((cached != NULL) && (Lwm2mCore_GetTickCountMs() - cached->Stored >= DTLS_SESSION_CACHE_LIFETIME * 1000ULL))
+    {
+        RemoveCachedSession(cached);
+        cached = NULL;
+    }
+
+    if (cached != NULL)
+    {
+        ListRemove(&cached->LeastRecentlyUsed);
+        ListAdd(&cached->LeastRecentlyUsed, &cacheLeastRecentlyUsed);
+        *dataLength = cached->DataLength;
+        result = cached->Bytes + cached->KeyLength;
+        Metrics_Increment(Metric_DtlsSessionCacheHits);
+    }
+    else
+    {
+        Metrics_Increment(Metric_DtlsSessionCacheMisses);
+    }
+    return result;
+}
+
+void DTLSSessionCache_Remove(const void * key, size_t keyLength)
+{
+    CachedSession * cached = FindCachedSession(key, keyLength);
+    if (cached != NULL)
+    {
+        RemoveCachedSession(cached);
+    }
+}
+
+static void GetPeerKey(NetworkAddress * address, AddressType * key)
+{
+    memset(key, 0, sizeof(*key));
+    NetworkAddress_SetAddressType(address, key);
+}
+
+void DTLSSessionCache_Clear(void)
+{
+    while (!ListEmpty(&cacheLeastRecentlyUsed))
+    {
+        RemoveCachedSession(ListEntry(cacheLeastRecentlyUsed.Next, CachedSession, LeastRecentlyUsed));
+    }
+}
+
+bool DTLSSessionCache_StoreForPeer(NetworkAddress * address, const void * data, size_t dataLength)
+{
+    AddressType key;
+    GetPeerKey(address, &key);
+    return DTLSSessionCache_Store(&key, sizeof(key), data, dataLength);
+}
+
+const void * DTLSSessionCache_FindForPeer(NetworkAddress * address, size_t * dataLength)
+{
+    AddressType key;
+    GetPeerKey(address, &key);
+    return DTLSSessionCache_Find(&key, sizeof(key), dataLength);
+}
+
+size_t DTLSSessionCache_Count(void)
+{
+    return HashTable_Count(&cache);
+}
@@ -0,0 +1,142 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#ifndef DTLS_SESSIONS_H_
+#define DTLS_SESSIONS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "lwm2m_hash.h"
+#include "lwm2m_list.h"
+#include "network_abstraction.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Sessions of the DTLS backends, indexed by peer address. Each backend embeds a DTLS_SessionEntry in its own session
+ *  struct. Sessions idle for longer than the idle timeout are evicted, and when the table is full the least recently
+ *  used session makes way for a new one - evicted sessions are released through the backend's free callback.
+ *
+ *  example usage:
+ *
+ *     typedef struct {
+ *         DTLS_SessionEntry Entry;
+ *         ... backend session ...
+ *     } DTLS_Session;
+ *
+ *     DTLSSessions_Init(FreeSessionEntry);
+ *
+ *     DTLS_SessionEntry * entry = DTLSSessions_Find(address);
+ *     if (entry != NULL)
+ *     {
+ *         DTLS_Session * session = DTLSSessionEntry(entry, DTLS_Session, Entry);
+ *     }
+ *     else
+ *     {
+ *         DTLS_Session * session = malloc(sizeof(DTLS_Session));
+ *         DTLSSessions_Add(&session->Entry, address);
+ *     }
+ */
+
+#ifndef MAX_DTLS_SESSIONS
+    #define MAX_DTLS_SESSIONS               (1024)
+#endif
+
+// Idle sessions are kept until the table is full, unless a timeout is set
+#ifndef DTLS_SESSION_IDLE_TIMEOUT
+    #define DTLS_SESSION_IDLE_TIMEOUT       (0)
+#endif
+
+typedef struct
+{
+    HashTableNode Node;                 // by peer address
+    struct ListHead LeastRecentlyUsed;  // least recently used first
+    NetworkAddress * NetworkAddress;
+    uint64_t LastUsed;                  // tick count in milliseconds
+} DTLS_SessionEntry;
+
+#define DTLSSessionEntry(ptr, type, member) \
+    ({(type *)((char *)ptr - ((size_t) &((type*)0)->member));})
+
+typedef void (*DTLS_FreeSessionCallback)(DTLS_SessionEntry * entry);
+
+void DTLSSessions_Init(DTLS_FreeSessionCallback freeSession);
+
+// Free every session, through the free callback
+void DTLSSessions_Destroy(void);
+
+// Find the session with a peer, marking it as used
+DTLS_SessionEntry * DTLSSessions_Find(NetworkAddress * address);
+
+// Add the session with a peer, evicting idle sessions and, if the table is still full, the least recently used one
+void DTLSSessions_Add(DTLS_SessionEntry * entry, NetworkAddress * address);
+
+// Remove a session from the table, without freeing it
+void DTLSSessions_Remove(DTLS_SessionEntry * entry);
+
+// Evict sessions idle for longer than the idle timeout
+void DTLSSessions_EvictIdle(void);
+
+size_t DTLSSessions_Count(void);
+
+/*
+ *  Resumption cache: the state of established sessions, kept after the session itself is gone so that the peer can
+ *  resume it with an abbreviated handshake. Servers keep the state by session ID, and clients by server address. The
+ *  least recently used state is dropped when the cache is full, and state older than the lifetime is never returned.
+ */
+
+#ifndef MAX_DTLS_SESSION_CACHE
+    #define MAX_DTLS_SESSION_CACHE          (4096)
+#endif
+
+// Lifetime of cached session state, in seconds
+#ifndef DTLS_SESSION_CACHE_LIFETIME
+    #define DTLS_SESSION_CACHE_LIFETIME     (86400)
+#endif
+
+// Store a copy of the session state under a key, replacing any state already stored under it
+bool DTLSSessionCache_Store(const void * key, size_t keyLength, const void * data, size_t dataLength);
+
+// Find the session state stored under a key - the result is valid until the cache is next changed
+const void * DTLSSessionCache_Find(const void * key, size_t keyLength, size_t * dataLength);
+
+void DTLSSessionCache_Remove(const void * key, size_t keyLength);
+
+// Forget all cached session state
+void DTLSSessionCache_Clear(void);
+
+// As above, keyed by the address of a peer
+bool DTLSSessionCache_StoreForPeer(NetworkAddress * address, const void * data, size_t dataLength);
+const void * DTLSSessionCache_FindForPeer(NetworkAddress * address, size_t * dataLength);
+
+size_t DTLSSessionCache_Count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DTLS_SESSIONS_H_ */
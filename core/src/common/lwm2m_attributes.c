@@ -58,53 +58,30 @@ const AttributeCharacteristics * Lwm2mAttributes_GetAttributeCharacteristics(cha
     return characteristics;
 }
 
-static NotificationAttributes * LookupNotificationAttributes(struct ListHead * attributesList, int shortServerID, ObjectIDType objectID,
-                                                             ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
+typedef struct
 {
-    NotificationAttributes * result = NULL;
-    if (attributesList != NULL)
-    {
-        struct ListHead * i;
-        ListForEach(i, attributesList)
-        {
-            NotificationAttributes * attributes = ListEntry(i, NotificationAttributes, list);
-            if ((attributes != NULL) &&
-                (attributes->ShortServerID == shortServerID) &&
-                (attributes->ObjectID == objectID) &&
-                (attributes->ObjectInstanceID == objectInstanceID) &&
-                (attributes->ResourceID == resourceID))
-            {
-                result = attributes;
-                break;
-            }
-        }
-        if (result == NULL)
-        {
-            // doesn't exist yet, so create
-            result = malloc(sizeof(NotificationAttributes));
-            memset(result, 0, sizeof(NotificationAttributes));
-            memset(result->Valid, 0, sizeof(result->Valid));
-            result->ObjectID = objectID;
-            result->ObjectInstanceID = objectInstanceID;
-            result->ResourceID = resourceID;
-            result->ShortServerID = shortServerID;
-            ListAdd(&result->list, attributesList);
-        }
-    }
-    return result;
+    int ShortServerID;
+    ObjectIDType ObjectID;
+    ObjectInstanceIDType ObjectInstanceID;
+    ResourceIDType ResourceID;
+} AttributesKey;
+
+static uint32_t HashAttributesKey(const AttributesKey * key)
+{
+    uint32_t hash = Hash_Bytes(&key->ShortServerID, sizeof(key->ShortServerID), HASH_SEED);
+    hash = Hash_Bytes(&key->ObjectID, sizeof(key->ObjectID), hash);
+    hash = Hash_Bytes(&key->ObjectInstanceID, sizeof(key->ObjectInstanceID), hash);
+    return Hash_Bytes(&key->ResourceID, sizeof(key->ResourceID), hash);
 }
 
-static void DestroyAttributesList(struct ListHead * serverNotificationAttributesList)
+static bool MatchAttributes(const HashTableNode * node, const void * key)
 {
-    if (serverNotificationAttributesList != NULL)
-    {
-        struct ListHead * i, * n;
-        ListForEachSafe(i, n, serverNotificationAttributesList)
-        {
-            NotificationAttributes * attributes = ListEntry(i, NotificationAttributes, list);
-            free(attributes);
-        }
-    }
+    const NotificationAttributes * attributes = HashTableEntry(node, NotificationAttributes, Node);
+    const AttributesKey * attributesKey = (const AttributesKey *)key;
+    return (attributes->ShortServerID == attributesKey->ShortServerID) &&
+           (attributes->ObjectID == attributesKey->ObjectID) &&
+           (attributes->ObjectInstanceID == attributesKey->ObjectInstanceID) &&
+           (attributes->ResourceID == attributesKey->ResourceID);
 }
 
 AttributeStore * AttributeStore_Create(void)
@@ -118,7 +95,12 @@ AttributeStore * AttributeStore_Create(void)
 
     memset(store, 0, sizeof(AttributeStore));
 
-    ListInit(&store->ServerNotificationAttributes);
+    if (HashTable_Init(&store->ServerNotificationAttributes, 16) != 0)
+    {
+        free(store);
+        AwaResult_SetResult(AwaResult_OutOfMemory);
+        return NULL;
+    }
 
     AwaResult_SetResult(AwaResult_Success);
     return store;
@@ -129,18 +111,87 @@ void AttributeStore_Destroy(AttributeStore * store)
     if (store != NULL)
     {
         // loop through all objects and free them
-        DestroyAttributesList(&store->ServerNotificationAttributes);
+        HashTableNode * node, * next;
+        size_t bucket;
+        HashTableForEachSafe(node, next, bucket, &store->ServerNotificationAttributes)
+        {
+            free(HashTableEntry(node, NotificationAttributes, Node));
+        }
+        HashTable_Destroy(&store->ServerNotificationAttributes);
         free(store);
     }
 }
 
-NotificationAttributes * AttributeStore_LookupNotificationAttributes(AttributeStore * store, int shortServerID, ObjectIDType objectID,
+NotificationAttributes * AttributeStore_LookupNotificationAttributes(const AttributeStore * store, int shortServerID, ObjectIDType objectID,
                                                                      ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
 {
     NotificationAttributes * attributes = NULL;
     if (store != NULL)
     {
-        attributes = LookupNotificationAttributes(&store->ServerNotificationAttributes, shortServerID, objectID, objectInstanceID, resourceID);
+        AttributesKey key = { shortServerID, objectID, objectInstanceID, resourceID };
+        HashTableNode * node = HashTable_Find(&store->ServerNotificationAttributes, HashAttributesKey(&key), MatchAttributes, &key);
+        if (node != NULL)
+        {
+            attributes = HashTableEntry(node, NotificationAttributes, Node);
+        }
     }
     return attributes;
 }
+
+int AttributeStore_SetNotificationAttributes(AttributeStore * store, int shortServerID, ObjectIDType objectID,
+                                             ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, const NotificationAttributes * attributes)
+{
+    if ((store == NULL) || (attributes == NULL))
+    {
+        return -1;
+    }
+
+    bool valid = false;
+    int i;
+    for (i = 0; i < AttributeTypeEnum_LAST; i++)
+    {
+        valid = valid || attributes->Valid[i];
+    }
+
+    NotificationAttributes * stored = AttributeStore_LookupNotificationAttributes(store, shortServerID, objectID, objectInstanceID, resourceID);
+    if (!valid)
+    {
+        // nothing left to store
+        if (stored != NULL)
+        {
+            HashTable_Remove(&store->ServerNotificationAttributes, &stored->Node);
+            free(stored);
+        }
+        return 0;
+    }
+
+    if (stored == NULL)
+    {
+        stored = malloc(sizeof(NotificationAttributes));
+        if (stored == NULL)
+        {
+            return -1;
+        }
+        memset(stored, 0, sizeof(NotificationAttributes));
+        stored->ShortServerID = shortServerID;
+        stored->ObjectID = objectID;
+        stored->ObjectInstanceID = objectInstanceID;
+        stored->ResourceID = resourceID;
+
+        AttributesKey key = { shortServerID, objectID, objectInstanceID, resourceID };
+        HashTable_Add(&store->ServerNotificationAttributes, &stored->Node, HashAttributesKey(&key));
+    }
+
+    stored->MinimumPeriod = attributes->MinimumPeriod;
+    stored->MaximumPeriod = attributes->MaximumPeriod;
+    stored->GreaterThan = attributes->GreaterThan;
+    stored->LessThan = attributes->LessThan;
+    stored->Step = attributes->Step;
+    memcpy(stored->Valid, attributes->Valid, sizeof(stored->Valid));
+    return 0;
+}
+
+size_t AttributeStore_Count(const AttributeStore * store)
+{
+    return (store != NULL) ? HashTable_Count(&store->ServerNotificationAttributes) : 0;
+}
@@ -26,7 +26,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "lwm2m_list.h"
+#include <stddef.h>
+#include "lwm2m_hash.h"
 #include "lwm2m_types.h"
 
 #ifdef __cplusplus
@@ -47,7 +48,7 @@ typedef enum
 
 typedef struct
 {
-    struct ListHead list; // prev/next pointers
+    HashTableNode Node; // in the attribute store, keyed by short server ID / object / instance / resource
 
     int MinimumPeriod;  // CoRE param "pmin", default: 1 second, restarted for each notification
     int MaximumPeriod;  // CoRE param "pmax"
@@ -80,16 +81,25 @@ typedef struct
 
 typedef struct
 {
-    struct ListHead ServerNotificationAttributes;
+    HashTable ServerNotificationAttributes;
 } AttributeStore;
 
 const AttributeCharacteristics * Lwm2mAttributes_GetAttributeCharacteristics(char * coreLinkParam);
 
 AttributeStore * AttributeStore_Create(void);
 void AttributeStore_Destroy(AttributeStore * store);
-NotificationAttributes * AttributeStore_LookupNotificationAttributes(AttributeStore * store, int shortServerID, ObjectIDType objectID,
+
+// Return the attributes a server has written for the specified path, or NULL if it has written none. Does not allocate.
+NotificationAttributes * AttributeStore_LookupNotificationAttributes(const AttributeStore * store, int shortServerID, ObjectIDType objectID,
                                                                      ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID);
 
+// Store the attribute values and Valid flags of "attributes" for the specified path, replacing any stored before.
+// The entry is removed when no attribute is valid. Returns 0 on success, or -1 on error.
+int AttributeStore_SetNotificationAttributes(AttributeStore * store, int shortServerID, ObjectIDType objectID,
+                                             ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, const NotificationAttributes * attributes);
+
+size_t AttributeStore_Count(const AttributeStore * store);
+
 #ifdef __cplusplus
 }
 #endif
@@ -52,6 +52,12 @@ typedef int (*GetLengthHandler)(void * context, ObjectIDType objectID, ObjectIns
 typedef int (*WriteHandler)(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID,
                             ResourceInstanceIDType resourceInstanceID, uint8_t * srcBuffer, size_t srcBufferLen, bool * changed);
 
+// handler to call to write one block of a value too large to be written at once - blocks are written in order, and the
+// value is complete when a block is written with more set to false
+typedef int (*WriteBlockHandler)(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID,
+                                 ResourceInstanceIDType resourceInstanceID, uint8_t * srcBuffer, size_t srcBufferLen, size_t offset,
+                                 bool more, bool * changed);
+
 // handler to call to execute a resource
 typedef int (*ExecuteHandler)(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID,
                               uint8_t * srcBuffer, size_t srcBufferLen);
@@ -66,6 +72,7 @@ typedef int (*CreateInstanceHandler)(void * context, ObjectIDType objectID, Obje
 typedef int (*CreateOptionalResourceHandler)(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID);
 
 typedef AwaResult (*LWM2MHandler)(void * context, AwaOperation operation, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, ResourceInstanceIDType resourceInstanceID, void ** dataPointer, size_t * dataSize, bool * changed);
+typedef AwaResult (*LWM2MWriteBlockHandler)(void * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, ResourceInstanceIDType resourceInstanceID, const void * data, size_t dataSize, size_t offset, bool more, bool * changed);
 
 typedef struct
 {
@@ -74,6 +81,7 @@ typedef struct
     ExecuteHandler Execute;
     //GetLengthHandler GetLength;
     CreateOptionalResourceHandler CreateOptionalResource;
+    WriteBlockHandler WriteBlock;
 } ResourceOperationHandlers;
 
 typedef struct
@@ -96,6 +104,7 @@ struct  _ResourceDefinition
     AwaResourceOperations Operation;
     ResourceOperationHandlers Handlers;
     LWM2MHandler Handler;
+    LWM2MWriteBlockHandler WriteBlockHandler;
 
     Lwm2mTreeNode * DefaultValueNode;
 
@@ -0,0 +1,194 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lwm2m_hash.h"
+
+#define HASH_MIN_BUCKETS  (16)
+#define HASH_MAX_LOAD     (2)     // grow when the average chain is longer than this
+
+#define FNV_PRIME (16777619u)
+
+static size_t RoundUpToPowerOfTwo(size_t value)
+{
+    size_t result = HASH_MIN_BUCKETS;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+static void Resize(HashTable * table, size_t numberOfBuckets)
+{
+    HashTableNode ** buckets = calloc(numberOfBuckets, sizeof(HashTableNode *));
+    if (buckets != NULL)
+    {
+        size_t i;
+        for (i = 0; i < table->NumberOfBuckets; i++)
+        {
+            HashTableNode * node = table->Buckets[i];
+            while (node != NULL)
+            {
+                HashTableNode * next = node->Next;
+                size_t index = node->Hash & (numberOfBuckets - 1);
+                node->Next = buckets[index];
+                buckets[index] = node;
+                node = next;
+            }
+        }
+        free(table->Buckets);
+        table->Buckets = buckets;
+        table->NumberOfBuckets = numberOfBuckets;
+    }
+    // otherwise keep the existing buckets - lookups are slower, but still correct
+}
+
+int HashTable_Init(HashTable * table, size_t numberOfBuckets)
+{
+    int result = -1;
+    if (table != NULL)
+    {
+        table->Count = 0;
+        table->NumberOfBuckets = RoundUpToPowerOfTwo(numberOfBuckets);
+        table->Buckets = calloc(table->NumberOfBuckets, sizeof(HashTableNode *));
+        if (table->Buckets != NULL)
+        {
+            result = 0;
+        }
+        else
+        {
+            table->NumberOfBuckets = 0;
+        }
+    }
+    return result;
+}
+
+void HashTable_Destroy(HashTable * table)
+{
+    if (table != NULL)
+    {
+        free(table->Buckets);
+        table->Buckets = NULL;
+        table->NumberOfBuckets = 0;
+        table->Count = 0;
+    }
+}
+
+void HashTable_Add(HashTable * table, HashTableNode * node, uint32_t hash)
+{
+    if (table->Count >= table->NumberOfBuckets * HASH_MAX_LOAD)
+    {
+        Resize(table, (table->NumberOfBuckets > 0) ? table->NumberOfBuckets * 2 : HASH_MIN_BUCKETS);
+    }
+
+    size_t index = hash & (table->NumberOfBuckets - 1);
+    node->Hash = hash;
+    node->Next = table->Buckets[index];
+    table->Buckets[index] = node;
+    table->Count++;
+}
+
+bool HashTable_Remove(HashTable * table, HashTableNode * node)
+{
+    bool removed = false;
+    if ((table != NULL) && (table->NumberOfBuckets > 0) && (node != NULL))
+    {
+        HashTableNode ** link = &table->Buckets[node->Hash & (table->NumberOfBuckets - 1)];
+        while (*link != NULL)
+        {
+            if (*link == node)
+            {
+                *link = node->Next;
+                node->Next = NULL;
+                table->Count--;
+                removed = true;
+                break;
+            }
+            link = &(*link)->Next;
+        }
+    }
+    return removed;
+}
+
+HashTableNode * HashTable_Find(const HashTable * table, uint32_t hash, HashTableMatchFunction match, const void * key)
+{
+    HashTableNode * node = NULL;
+    if ((table != NULL) && (table->NumberOfBuckets > 0))
+    {
+        for (node = table->Buckets[hash & (table->NumberOfBuckets - 1)]; node != NULL; node = node->Next)
+        {
+            if ((node->Hash == hash) && match(node, key))
+            {
+                break;
+            }
+        }
+    }
+    return node;
+}
+
+HashTableNode * HashTable_FindNext(const HashTableNode * node, HashTableMatchFunction match, const void * key)
+{
+    HashTableNode * next = NULL;
+    if (node != NULL)
+    {
+        for (next = node->Next; next != NULL; next = next->Next)
+        {
+            if ((next->Hash == node->Hash) && match(next, key))
+            {
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+size_t HashTable_Count(const HashTable * table)
+{
+    return (table != NULL) ? table->Count : 0;
+}
+
+uint32_t Hash_Bytes(const void * data, size_t length, uint32_t hash)
+{
+    const uint8_t * bytes = (const uint8_t *)data;
+    size_t i;
+    for (i = 0; i < length; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint32_t Hash_String(const char * string, uint32_t hash)
+{
+    for (; (string != NULL) && (*string != '\0'); string++)
+    {
+        hash ^= (uint8_t)*string;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
@@ -0,0 +1,126 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef LWM2M_HASH_H
+#define LWM2M_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Intrusive chained hash table. The table does not own its entries or compute hashes itself - embed a
+ *  HashTableNode in the entry, hash the key with one of the Hash_ functions, and supply a match function to
+ *  compare an entry with a key.
+ *
+ *  example usage:
+ *
+ *     typedef struct {
+ *         HashTableNode Node;
+ *         int Key;
+ *         ... other content ...
+ *     } Entry;
+ *
+ *     static bool MatchEntry(const HashTableNode * node, const void * key)
+ *     {
+ *         return HashTableEntry(node, Entry, Node)->Key == *(const int *)key;
+ *     }
+ *
+ *     HashTable table;
+ *     HashTable_Init(&table, 64);
+ *
+ *     Entry * newEntry = malloc(sizeof(Entry));
+ *     newEntry->Key = 42;
+ *     HashTable_Add(&table, &newEntry->Node, Hash_Bytes(&newEntry->Key, sizeof(int), HASH_SEED));
+ *
+ *     int key = 42;
+ *     HashTableNode * node = HashTable_Find(&table, Hash_Bytes(&key, sizeof(int), HASH_SEED), MatchEntry, &key);
+ *     if (node != NULL)
+ *     {
+ *         Entry * entry = HashTableEntry(node, Entry, Node);
+ *         HashTable_Remove(&table, &entry->Node);
+ *         free(entry);
+ *     }
+ */
+
+#define HASH_SEED (2166136261u)   // FNV-1a offset basis
+
+typedef struct _HashTableNode
+{
+    struct _HashTableNode * Next;
+    uint32_t Hash;
+} HashTableNode;
+
+typedef struct
+{
+    HashTableNode ** Buckets;
+    size_t NumberOfBuckets;       // always a power of two
+    size_t Count;
+} HashTable;
+
+// Returns true if the entry containing node has the specified key
+typedef bool (*HashTableMatchFunction)(const HashTableNode * node, const void * key);
+
+/* locate the structure of type "type" containing the HashTableNode named "member" */
+#define HashTableEntry(ptr, type, member) \
+    ({(type *)((char *)ptr - ((size_t) &((type*)0)->member));})
+
+#define HashTableForEach(pos, bucket, table) \
+    for (bucket = 0; bucket < (table)->NumberOfBuckets; bucket++) \
+        for (pos = (table)->Buckets[bucket]; pos != NULL; pos = pos->Next)
+
+#define HashTableForEachSafe(pos, n, bucket, table) \
+    for (bucket = 0; bucket < (table)->NumberOfBuckets; bucket++) \
+        for (pos = (table)->Buckets[bucket], n = (pos != NULL) ? pos->Next : NULL; pos != NULL; \
+                pos = n, n = (pos != NULL) ? pos->Next : NULL)
+
+int HashTable_Init(HashTable * table, size_t numberOfBuckets);
+
+// Free the bucket array. Entries still in the table are not freed.
+void HashTable_Destroy(HashTable * table);
+
+// Add an entry. The table grows as entries are added, to keep chains short.
+void HashTable_Add(HashTable * table, HashTableNode * node, uint32_t hash);
+bool HashTable_Remove(HashTable * table, HashTableNode * node);
+
+HashTableNode * HashTable_Find(const HashTable * table, uint32_t hash, HashTableMatchFunction match, const void * key);
+
+// Find the next entry after node with the same key, for tables that hold more than one entry per key
+HashTableNode * HashTable_FindNext(const HashTableNode * node, HashTableMatchFunction match, const void * key);
+
+size_t HashTable_Count(const HashTable * table);
+
+// FNV-1a hash - pass HASH_SEED to start a new hash, or the previous result to combine several fields
+uint32_t Hash_Bytes(const void * data, size_t length, uint32_t hash);
+uint32_t Hash_String(const char * string, uint32_t hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LWM2M_HASH_H
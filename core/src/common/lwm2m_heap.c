@@ -0,0 +1,215 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdlib.h>
+
+#include "lwm2m_heap.h"
+
+#define HEAP_MIN_CAPACITY  (16)
+
+static void Place(Heap * heap, HeapNode * node, size_t position)
+{
+    heap->Nodes[position] = node;
+    node->Index = position + 1;
+}
+
+static void SiftUp(Heap * heap, size_t position)
+{
+    HeapNode * node = heap->Nodes[position];
+    while (position > 0)
+    {
+        size_t parent = (position - 1) / 2;
+        if (heap->Nodes[parent]->Key <= node->Key)
+        {
+            break;
+        }
+        Place(heap, heap->Nodes[parent], position);
+        position = parent;
+    }
+    Place(heap, node, position);
+}
+
+static void SiftDown(Heap * heap, size_t position)
+{
+    HeapNode * node = heap->Nodes[position];
+    for (;;)
+    {
+        size_t child = (2 * position) + 1;
+        if (child >= heap->Count)
+        {
+            break;
+        }
+        if ((child + 1 < heap->Count) && (heap->Nodes[child + 1]->Key < heap->Nodes[child]->Key))
+        {
+            child++;
+        }
+        if (node->Key <= heap->Nodes[child]->Key)
+        {
+            break;
+        }
+        Place(heap, heap->Nodes[child], position);
+        position = child;
+    }
+    Place(heap, node, position);
+}
+
+int Heap_Init(Heap * heap, size_t capacity)
+{
+    int result = -1;
+    if (heap != NULL)
+    {
+        heap->Count = 0;
+        heap->Capacity = (capacity > HEAP_MIN_CAPACITY) ? capacity : HEAP_MIN_CAPACITY;
+        heap->Nodes = malloc(heap->Capacity * sizeof(HeapNode *));
+        if (heap->Nodes != NULL)
+        {
+            result = 0;
+        }
+        else
+        {
+            heap->Capacity = 0;
+        }
+    }
+    return result;
+}
+
+void Heap_Destroy(Heap * heap)
+{
+    if (heap != NULL)
+    {
+        size_t i;
+        for (i = 0; i < heap->Count; i++)
+        {
+            heap->Nodes[i]->Index = 0;
+        }
+        free(heap->Nodes);
+        heap->Nodes = NULL;
+        heap->Count = 0;
+        heap->Capacity = 0;
+    }
+}
+
+bool Heap_Push(Heap * heap, HeapNode * node, uint64_t key)
+{
+    bool result = false;
+    if ((heap != NULL) && (node != NULL) && !Heap_Contains(node))
+    {
+        if (heap->Count == heap->Capacity)
+        {
+            size_t capacity = (heap->Capacity > 0) ? heap->Capacity * 2 : HEAP_MIN_CAPACITY;
+            HeapNode ** nodes = realloc(heap->Nodes, capacity * sizeof(HeapNode *));
+            if (nodes != NULL)
+            {
+                heap->Nodes = nodes;
+                heap->Capacity = capacity;
+            }
+        }
+        if (heap->Count < heap->Capacity)
+        {
+            node->Key = key;
+            heap->Nodes[heap->Count] = node;
+            heap->Count++;
+            SiftUp(heap, heap->Count - 1);
+            result = true;
+        }
+    }
+    return result;
+}
+
+bool Heap_Remove(Heap * heap, HeapNode * node)
+{
+    bool removed = false;
+    if ((heap != NULL) && (node != NULL) && Heap_Contains(node) && (node->Index <= heap->Count) && (heap->Nodes[node->Index - 1] == node))
+    {
+        size_t position = node->Index - 1;
+        HeapNode * last = heap->Nodes[--heap->Count];
+        node->Index = 0;
+        if (last != node)
+        {
+            Place(heap, last, position);
+            if ((position > 0) && (last->Key < heap->Nodes[(position - 1) / 2]->Key))
+            {
+                SiftUp(heap, position);
+            }
+            else
+            {
+                SiftDown(heap, position);
+            }
+        }
+        removed = true;
+    }
+    return removed;
+}
+
+bool Heap_Update(Heap * heap, HeapNode * node, uint64_t key)
+{
+    bool result = false;
+    if ((heap != NULL) && (node != NULL))
+    {
+        if (Heap_Contains(node))
+        {
+            uint64_t oldKey = node->Key;
+            node->Key = key;
+            if (key < oldKey)
+            {
+                SiftUp(heap, node->Index - 1);
+            }
+            else
+            {
+                SiftDown(heap, node->Index - 1);
+            }
+            result = true;
+        }
+        else
+        {
+            result = Heap_Push(heap, node, key);
+        }
+    }
+    return result;
+}
+
+HeapNode * Heap_Peek(const Heap * heap)
+{
+    return ((heap != NULL) && (heap->Count > 0)) ? heap->Nodes[0] : NULL;
+}
+
+HeapNode * Heap_Pop(Heap * heap)
+{
+    HeapNode * node = Heap_Peek(heap);
+    if (node != NULL)
+    {
+        Heap_Remove(heap, node);
+    }
+    return node;
+}
+
+size_t Heap_Count(const Heap * heap)
+{
+    return (heap != NULL) ? heap->Count : 0;
+}
+
+bool Heap_Contains(const HeapNode * node)
+{
+    return (node != NULL) && (node->Index != 0);
+}
@@ -0,0 +1,102 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef LWM2M_HEAP_H
+#define LWM2M_HEAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  Intrusive binary min-heap, ordered by a 64-bit key (typically a deadline in milliseconds). Embed a HeapNode
+ *  in the entry - the node records its position, so entries can be removed or rescheduled in O(log n).
+ *
+ *  example usage:
+ *
+ *     typedef struct {
+ *         HeapNode Node;
+ *         ... other content ...
+ *     } Timer;
+ *
+ *     Heap timers;
+ *     Heap_Init(&timers, 0);
+ *
+ *     Timer * timer = malloc(sizeof(Timer));
+ *     Heap_Push(&timers, &timer->Node, now + 1000);
+ *
+ *     HeapNode * node;
+ *     while (((node = Heap_Peek(&timers)) != NULL) && (node->Key <= now))
+ *     {
+ *         Heap_Pop(&timers);
+ *         Timer * expired = HeapEntry(node, Timer, Node);
+ *         ... handle expired timer ...
+ *     }
+ */
+
+typedef struct
+{
+    uint64_t Key;
+    size_t Index;                 // position in the heap plus one, zero when not in a heap
+} HeapNode;
+
+typedef struct
+{
+    HeapNode ** Nodes;
+    size_t Count;
+    size_t Capacity;
+} Heap;
+
+/* locate the structure of type "type" containing the HeapNode named "member" */
+#define HeapEntry(ptr, type, member) \
+    ({(type *)((char *)ptr - ((size_t) &((type*)0)->member));})
+
+int Heap_Init(Heap * heap, size_t capacity);
+
+// Free the node array. Entries still in the heap are not freed.
+void Heap_Destroy(Heap * heap);
+
+// Add an entry with the specified key. Returns false if the heap could not grow.
+bool Heap_Push(Heap * heap, HeapNode * node, uint64_t key);
+bool Heap_Remove(Heap * heap, HeapNode * node);
+
+// Change the key of an entry, adding it if it is not already in the heap
+bool Heap_Update(Heap * heap, HeapNode * node, uint64_t key);
+
+// Return the entry with the smallest key, or NULL if the heap is empty
+HeapNode * Heap_Peek(const Heap * heap);
+HeapNode * Heap_Pop(Heap * heap);
+
+size_t Heap_Count(const Heap * heap);
+bool Heap_Contains(const HeapNode * node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LWM2M_HEAP_H
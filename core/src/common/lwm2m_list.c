@@ -25,18 +25,13 @@
 
 void ListAdd(struct ListHead * newEntry, struct ListHead * head)
 {
-    struct ListHead * pos;
-    struct ListHead * next = head;
-
-    ListForEach(pos, head)
-    {
-        next = pos;
-    }
+    // the list is circular, so the last entry is the one before the head
+    struct ListHead * last = head->Prev;
 
-    //next->Prev     = newEntry;
     newEntry->Next = head;
-    newEntry->Prev = next;
-    next->Next     = newEntry;
+    newEntry->Prev = last;
+    last->Next     = newEntry;
+    head->Prev     = newEntry;
 }
 
 
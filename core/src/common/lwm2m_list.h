@@ -71,6 +71,8 @@ struct ListHead
 
 #define LIST_INIT(list) { &(list), &(list) }
 
+#define ListEmpty(head) ((head)->Next == (head))
+
 void ListAdd(struct ListHead * newEntry, struct ListHead * head);
 void ListInsertAfter(struct ListHead * newEntry, struct ListHead * afterEntry);
 void ListRemove(struct ListHead * entry);
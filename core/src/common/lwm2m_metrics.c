@@ -0,0 +1,284 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "lwm2m_metrics.h"
+
+// Daemons are single threaded, but metrics may also be updated from application threads using the static API
+#if defined(__GNUC__) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)
+#define ATOMIC_ADD(ptr, value)   __atomic_add_fetch((ptr), (value), __ATOMIC_RELAXED)
+#define ATOMIC_STORE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(ptr)         __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#else
+#define ATOMIC_ADD(ptr, value)   (*(ptr) += (value))
+#define ATOMIC_STORE(ptr, value) (*(ptr) = (value))
+#define ATOMIC_LOAD(ptr)         (*(ptr))
+#endif
+
+typedef struct
+{
+    const char * Name;
+    const char * Labels;
+    const char * Help;
+    MetricType Type;
+
+} MetricDescriptor;
+
+typedef struct
+{
+    const char * Name;
+    const char * Help;
+
+} HistogramDescriptor;
+
+static const MetricDescriptor metricDescriptors[Metric_Count] =
+{
+    [Metric_CoapRequestsReceived]         = { "awa_coap_requests_received_total", NULL, "CoAP requests received", MetricType_Counter },
+    [Metric_CoapRequestsSent]             = { "awa_coap_requests_sent_total", NULL, "CoAP requests sent", MetricType_Counter },
+    [Metric_CoapResponsesReceived]        = { "awa_coap_responses_received_total", NULL, "Responses received to CoAP requests", MetricType_Counter },
+    [Metric_CoapTransactionTimeouts]      = { "awa_coap_transaction_timeouts_total", NULL, "CoAP requests that failed without a response", MetricType_Counter },
+    [Metric_CoapRetransmissions]          = { "awa_coap_retransmissions_total", NULL, "CoAP messages sent again after a failed or unacknowledged transmission", MetricType_Counter },
+    [Metric_CoapNotificationsSent]        = { "awa_coap_notifications_sent_total", NULL, "CoAP observe notifications sent", MetricType_Counter },
+    [Metric_CoapNotificationsReceived]    = { "awa_coap_notifications_received_total", NULL, "CoAP observe notifications received", MetricType_Counter },
+    [Metric_CoapRequestsInFlight]         = { "awa_coap_requests_in_flight", NULL, "CoAP requests sent and waiting for a response", MetricType_Gauge },
+    [Metric_CoapRequestsQueued]           = { "awa_coap_requests_queued", NULL, "CoAP requests waiting for a free slot to their destination", MetricType_Gauge },
+    [Metric_CoapMessagesQueued]           = { "awa_coap_messages_queued", NULL, "Confirmable CoAP messages waiting for the congestion window to their peer", MetricType_Gauge },
+    [Metric_CoapDuplicatesReceived]       = { "awa_coap_duplicates_received_total", NULL, "Retransmitted CoAP requests answered from the duplicate detection cache", MetricType_Counter },
+    [Metric_CoapDuplicateCacheEntries]    = { "awa_coap_duplicate_cache_entries", NULL, "Recently received CoAP requests remembered for duplicate detection", MetricType_Gauge },
+    [Metric_CoapBlocksSent]               = { "awa_coap_blocks_sent_total", NULL, "Blocks of large CoAP responses sent", MetricType_Counter },
+    [Metric_CoapBlocksReceived]           = { "awa_coap_blocks_received_total", NULL, "Blocks of large CoAP responses received", MetricType_Counter },
+    [Metric_CoapBlockCacheEntries]        = { "awa_coap_block_cache_entries", NULL, "Large CoAP responses kept for serving block by block", MetricType_Gauge },
+    [Metric_CoapObservations]             = { "awa_coap_observations", NULL, "Observations established with remote CoAP end points", MetricType_Gauge },
+    [Metric_CoapObservationBytes]         = { "awa_coap_observation_bytes", NULL, "Memory held by observations established with remote CoAP end points", MetricType_Gauge },
+    [Metric_DtlsSessions]                 = { "awa_dtls_sessions", NULL, "DTLS sessions with peers, established or in progress", MetricType_Gauge },
+    [Metric_DtlsSessionsEvicted]          = { "awa_dtls_sessions_evicted_total", NULL, "DTLS sessions dropped for being idle, or to make way for new sessions", MetricType_Counter },
+    [Metric_DtlsHandshakesFull]           = { "awa_dtls_handshakes_total", "type=\"full\"", "DTLS handshakes completed, by whether a previous session was resumed", MetricType_Counter },
+    [Metric_DtlsHandshakesResumed]        = { "awa_dtls_handshakes_total", "type=\"resumed\"", "DTLS handshakes completed, by whether a previous session was resumed", MetricType_Counter },
+    [Metric_DtlsHandshakeJobs]            = { "awa_dtls_handshake_jobs", NULL, "DTLS handshake flights queued for or being processed by the handshake workers", MetricType_Gauge },
+    [Metric_DtlsSessionCacheHits]         = { "awa_dtls_session_cache_lookups_total", "result=\"hit\"", "Lookups of previous DTLS sessions to resume, by result", MetricType_Counter },
+    [Metric_DtlsSessionCacheMisses]       = { "awa_dtls_session_cache_lookups_total", "result=\"miss\"", "Lookups of previous DTLS sessions to resume, by result", MetricType_Counter },
+    [Metric_DtlsSessionCacheEntries]      = { "awa_dtls_session_cache_entries", NULL, "Previous DTLS sessions kept for resumption", MetricType_Gauge },
+    [Metric_DtlsPskIdentities]            = { "awa_dtls_psk_identities", NULL, "PSK identities in the key store", MetricType_Gauge },
+
+    [Metric_Registrations]                = { "awa_registrations_total", NULL, "Client registrations accepted", MetricType_Counter },
+    [Metric_RegistrationUpdates]          = { "awa_registration_updates_total", NULL, "Client registration updates accepted", MetricType_Counter },
+    [Metric_Deregistrations]              = { "awa_deregistrations_total", NULL, "Client deregistrations", MetricType_Counter },
+    [Metric_RegistrationExpiries]         = { "awa_registration_expiries_total", NULL, "Client registrations removed because their lifetime expired", MetricType_Counter },
+    [Metric_RegisteredClients]            = { "awa_registered_clients", NULL, "Clients currently registered", MetricType_Gauge },
+    [Metric_AdmissionAccepted]            = { "awa_registration_admissions_total", "result=\"accepted\"", "Registration and update requests by admission control result", MetricType_Counter },
+    [Metric_AdmissionDeferred]            = { "awa_registration_admissions_total", "result=\"deferred\"", "Registration and update requests by admission control result", MetricType_Counter },
+    [Metric_AdmissionRejected]            = { "awa_registration_admissions_total", "result=\"rejected\"", "Registration and update requests by admission control result", MetricType_Counter },
+
+    [Metric_IpcRequests]                  = { "awa_ipc_requests_total", NULL, "IPC requests received", MetricType_Counter },
+    [Metric_IpcInvalidRequests]           = { "awa_ipc_invalid_requests_total", NULL, "IPC requests that could not be handled", MetricType_Counter },
+    [Metric_IpcReceiveQueueBytes]         = { "awa_ipc_receive_queue_bytes", NULL, "Bytes waiting in the IPC socket receive queue", MetricType_Gauge },
+
+    [Metric_Observations]                 = { "awa_observations", NULL, "Active observations", MetricType_Gauge },
+    [Metric_ObserveNotifications]         = { "awa_observe_notifications_total", NULL, "Notifications generated for observers", MetricType_Counter },
+
+    [Metric_ObjectStoreInstances]         = { "awa_object_store_instances", NULL, "Object instances in the object store", MetricType_Gauge },
+    [Metric_ObjectStoreResourceInstances] = { "awa_object_store_resource_instances", NULL, "Resource instances in the object store", MetricType_Gauge },
+    [Metric_ObjectStoreValueBytes]        = { "awa_object_store_value_bytes", NULL, "Bytes of resource values held in the object store", MetricType_Gauge },
+};
+
+static const HistogramDescriptor histogramDescriptors[Histogram_Count] =
+{
+    [Histogram_CoapTransactionDuration]   = { "awa_coap_transaction_duration_seconds", "Time from sending a CoAP request to receiving its response" },
+    [Histogram_IpcRequestDuration]        = { "awa_ipc_request_duration_seconds", "Time taken to handle an IPC request" },
+};
+
+static const uint32_t histogramBounds[METRICS_HISTOGRAM_NUM_BUCKETS - 1] = METRICS_HISTOGRAM_BOUNDS;
+
+static int64_t metrics[Metric_Count];
+static MetricsHistogram histograms[Histogram_Count];
+
+void Metrics_Increment(MetricID metric)
+{
+    ATOMIC_ADD(&metrics[metric], 1);
+}
+
+void Metrics_Decrement(MetricID metric)
+{
+    ATOMIC_ADD(&metrics[metric], -1);
+}
+
+void Metrics_Add(MetricID metric, int64_t value)
+{
+    ATOMIC_ADD(&metrics[metric], value);
+}
+
+void Metrics_Set(MetricID metric, int64_t value)
+{
+    ATOMIC_STORE(&metrics[metric], value);
+}
+
+int64_t Metrics_Get(MetricID metric)
+{
+    return ATOMIC_LOAD(&metrics[metric]);
+}
+
+void Metrics_Observe(HistogramID histogram, uint32_t valueMs)
+{
+    int bucket = 0;
+    while ((bucket < METRICS_HISTOGRAM_NUM_BUCKETS - 1) && (valueMs > histogramBounds[bucket]))
+    {
+        bucket++;
+    }
+    ATOMIC_ADD(&histograms[histogram].Buckets[bucket], 1);
+    ATOMIC_ADD(&histograms[histogram].Count, 1);
+    ATOMIC_ADD(&histograms[histogram].SumMs, valueMs);
+}
+
+void Metrics_GetHistogram(HistogramID histogram, MetricsHistogram * snapshot)
+{
+    int bucket;
+    for (bucket = 0; bucket < METRICS_HISTOGRAM_NUM_BUCKETS; bucket++)
+    {
+        snapshot->Buckets[bucket] = ATOMIC_LOAD(&histograms[histogram].Buckets[bucket]);
+    }
+    snapshot->Count = ATOMIC_LOAD(&histograms[histogram].Count);
+    snapshot->SumMs = ATOMIC_LOAD(&histograms[histogram].SumMs);
+}
+
+uint32_t Metrics_GetHistogramBound(int bucket)
+{
+    return (bucket < METRICS_HISTOGRAM_NUM_BUCKETS - 1) ? histogramBounds[bucket] : UINT32_MAX;
+}
+
+const char * Metrics_GetName(MetricID metric)
+{
+    return metricDescriptors[metric].Name;
+}
+
+const char * Metrics_GetLabels(MetricID metric)
+{
+    return metricDescriptors[metric].Labels;
+}
+
+const char * Metrics_GetHelp(MetricID metric)
+{
+    return metricDescriptors[metric].Help;
+}
+
+MetricType Metrics_GetType(MetricID metric)
+{
+    return metricDescriptors[metric].Type;
+}
+
+const char * Metrics_GetHistogramName(HistogramID histogram)
+{
+    return histogramDescriptors[histogram].Name;
+}
+
+const char * Metrics_GetHistogramHelp(HistogramID histogram)
+{
+    return histogramDescriptors[histogram].Help;
+}
+
+void Metrics_Reset(void)
+{
+    memset(metrics, 0, sizeof(metrics));
+    memset(histograms, 0, sizeof(histograms));
+}
+
+// Append to the output, keeping track of the length the complete output would need
+static void Append(char * buffer, size_t bufferSize, int * length, const char * format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    size_t offset = (size_t)*length < bufferSize ? (size_t)*length : bufferSize;
+    int rc = vsnprintf(buffer + offset, bufferSize - offset, format, args);
+    va_end(args);
+    if (rc > 0)
+    {
+        *length += rc;
+    }
+}
+
+int Metrics_WritePrometheus(char * buffer, size_t bufferSize)
+{
+    int length = 0;
+    const char * lastName = NULL;
+    int metric, histogram, bucket;
+
+    if ((buffer != NULL) && (bufferSize > 0))
+    {
+        buffer[0] = '\0';
+    }
+    else
+    {
+        bufferSize = 0;
+    }
+
+    for (metric = 0; metric < Metric_Count; metric++)
+    {
+        const MetricDescriptor * descriptor = &metricDescriptors[metric];
+        if ((lastName == NULL) || (strcmp(lastName, descriptor->Name) != 0))
+        {
+            Append(buffer, bufferSize, &length, "# HELP %s %s\n# TYPE %s %s\n", descriptor->Name, descriptor->Help,
+                   descriptor->Name, (descriptor->Type == MetricType_Counter) ? "counter" : "gauge");
+            lastName = descriptor->Name;
+        }
+
+        if (descriptor->Labels != NULL)
+        {
+            Append(buffer, bufferSize, &length, "%s{%s} %" PRId64 "\n", descriptor->Name, descriptor->Labels, Metrics_Get(metric));
+        }
+        else
+        {
+            Append(buffer, bufferSize, &length, "%s %" PRId64 "\n", descriptor->Name, Metrics_Get(metric));
+        }
+    }
+
+    for (histogram = 0; histogram < Histogram_Count; histogram++)
+    {
+        const HistogramDescriptor * descriptor = &histogramDescriptors[histogram];
+        MetricsHistogram snapshot;
+        uint64_t cumulative = 0;
+
+        Metrics_GetHistogram(histogram, &snapshot);
+
+        Append(buffer, bufferSize, &length, "# HELP %s %s\n# TYPE %s histogram\n", descriptor->Name, descriptor->Help, descriptor->Name);
+        for (bucket = 0; bucket < METRICS_HISTOGRAM_NUM_BUCKETS; bucket++)
+        {
+            cumulative += snapshot.Buckets[bucket];
+            if (bucket < METRICS_HISTOGRAM_NUM_BUCKETS - 1)
+            {
+                Append(buffer, bufferSize, &length, "%s_bucket{le=\"%g\"} %" PRIu64 "\n", descriptor->Name, histogramBounds[bucket] / 1000.0, cumulative);
+            }
+            else
+            {
+                Append(buffer, bufferSize, &length, "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", descriptor->Name, cumulative);
+            }
+        }
+        Append(buffer, bufferSize, &length, "%s_sum %.3f\n", descriptor->Name, snapshot.SumMs / 1000.0);
+        Append(buffer, bufferSize, &length, "%s_count %" PRIu64 "\n", descriptor->Name, snapshot.Count);
+    }
+
+    return length;
+}
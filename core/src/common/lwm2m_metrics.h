@@ -0,0 +1,152 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef LWM2M_METRICS_H
+#define LWM2M_METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Lightweight process-wide metrics: counters, gauges and fixed-bucket latency histograms.
+ * Updates are atomic and never allocate, so they are cheap enough to leave enabled on hot paths.
+ */
+
+typedef enum
+{
+    Metric_CoapRequestsReceived,
+    Metric_CoapRequestsSent,
+    Metric_CoapResponsesReceived,
+    Metric_CoapTransactionTimeouts,
+    Metric_CoapRetransmissions,
+    Metric_CoapNotificationsSent,
+    Metric_CoapNotificationsReceived,
+    Metric_CoapRequestsInFlight,
+    Metric_CoapRequestsQueued,
+    Metric_CoapMessagesQueued,
+    Metric_CoapDuplicatesReceived,
+    Metric_CoapDuplicateCacheEntries,
+    Metric_CoapBlocksSent,
+    Metric_CoapBlocksReceived,
+    Metric_CoapBlockCacheEntries,
+    Metric_CoapObservations,
+    Metric_CoapObservationBytes,
+
+    Metric_DtlsSessions,
+    Metric_DtlsSessionsEvicted,
+    Metric_DtlsHandshakesFull,
+    Metric_DtlsHandshakesResumed,
+    Metric_DtlsHandshakeJobs,
+    Metric_DtlsSessionCacheHits,
+    Metric_DtlsSessionCacheMisses,
+    Metric_DtlsSessionCacheEntries,
+    Metric_DtlsPskIdentities,
+
+    Metric_Registrations,
+    Metric_RegistrationUpdates,
+    Metric_Deregistrations,
+    Metric_RegistrationExpiries,
+    Metric_RegisteredClients,
+    Metric_AdmissionAccepted,
+    Metric_AdmissionDeferred,
+    Metric_AdmissionRejected,
+
+    Metric_IpcRequests,
+    Metric_IpcInvalidRequests,
+    Metric_IpcReceiveQueueBytes,
+
+    Metric_Observations,
+    Metric_ObserveNotifications,
+
+    Metric_ObjectStoreInstances,
+    Metric_ObjectStoreResourceInstances,
+    Metric_ObjectStoreValueBytes,
+
+    Metric_Count
+
+} MetricID;
+
+typedef enum
+{
+    Histogram_CoapTransactionDuration,
+    Histogram_IpcRequestDuration,
+
+    Histogram_Count
+
+} HistogramID;
+
+typedef enum
+{
+    MetricType_Counter,
+    MetricType_Gauge,
+    MetricType_Histogram,
+
+} MetricType;
+
+// Histogram bucket upper bounds in milliseconds; the last bucket has no upper bound
+#define METRICS_HISTOGRAM_BOUNDS { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000 }
+#define METRICS_HISTOGRAM_NUM_BUCKETS (14)
+
+typedef struct
+{
+    uint64_t Buckets[METRICS_HISTOGRAM_NUM_BUCKETS];    // count of observations in each bucket (not cumulative)
+    uint64_t Count;
+    uint64_t SumMs;
+
+} MetricsHistogram;
+
+void Metrics_Increment(MetricID metric);
+void Metrics_Decrement(MetricID metric);
+void Metrics_Add(MetricID metric, int64_t value);
+void Metrics_Set(MetricID metric, int64_t value);
+int64_t Metrics_Get(MetricID metric);
+
+// Record an observation, in milliseconds
+void Metrics_Observe(HistogramID histogram, uint32_t valueMs);
+void Metrics_GetHistogram(HistogramID histogram, MetricsHistogram * snapshot);
+uint32_t Metrics_GetHistogramBound(int bucket);
+
+// Descriptions of each metric, for exporting. Labels may be NULL.
+const char * Metrics_GetName(MetricID metric);
+const char * Metrics_GetLabels(MetricID metric);
+const char * Metrics_GetHelp(MetricID metric);
+MetricType Metrics_GetType(MetricID metric);
+const char * Metrics_GetHistogramName(HistogramID histogram);
+const char * Metrics_GetHistogramHelp(HistogramID histogram);
+
+void Metrics_Reset(void);
+
+/* Write all metrics in the Prometheus text exposition format. Behaves like snprintf: returns the length
+ * of the complete output, which is truncated if it does not fit in the buffer.
+ */
+int Metrics_WritePrometheus(char * buffer, size_t bufferSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LWM2M_METRICS_H
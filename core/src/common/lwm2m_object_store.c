@@ -33,6 +33,7 @@
 #include "lwm2m_object_store.h"
 #include "lwm2m_list.h"
 #include "lwm2m_debug.h"
+#include "lwm2m_metrics.h"
 #include "lwm2m_util.h"
 #include "lwm2m_result.h"
 
@@ -248,6 +249,7 @@ static ObjectInstance * CreateObjectInstance(ObjectStore * store, Object * objec
 
     // Add instance to object
     ListAdd(&instance->list, &object->Instance);
+    Metrics_Increment(Metric_ObjectStoreInstances);
 
     Lwm2m_Debug("CreateObjectInstance %d %d\n", object->ID, objectInstanceID);
 
@@ -268,6 +270,8 @@ static int DeleteResourceInstance(ObjectStore * store, ObjectIDType objectID, Ob
             ResourceInstance * rInst = ListEntry(pos, ResourceInstance, list);
             if (rInst->ID == resourceInstanceID)
             {
+                Metrics_Decrement(Metric_ObjectStoreResourceInstances);
+                Metrics_Add(Metric_ObjectStoreValueBytes, -rInst->Size);
                 free(rInst->Value);
                 ListRemove(pos);
                 free(rInst);
@@ -292,6 +296,8 @@ static int DeleteResource(ObjectStore * store, ObjectIDType objectID, ObjectInst
     ListForEachSafe(pos, n, &resource->Instance)
     {
         ResourceInstance * rInst = ListEntry(pos, ResourceInstance, list);
+        Metrics_Decrement(Metric_ObjectStoreResourceInstances);
+        Metrics_Add(Metric_ObjectStoreValueBytes, -rInst->Size);
         free(rInst->Value);
         ListRemove(pos);
         free(rInst);
@@ -319,6 +325,7 @@ static int DeleteInstance(ObjectStore * store, ObjectIDType objectID, ObjectInst
     }
     ListRemove(&instance->list);
     free(instance);
+    Metrics_Decrement(Metric_ObjectStoreInstances);
 
     return 0;
 }
@@ -444,6 +451,8 @@ int ObjectStore_SetResourceInstanceValue(ObjectStore * store, ObjectIDType objec
         memset(rInst->Value, 0, valueSize);
 
         rInst->Size = valueSize;
+        Metrics_Increment(Metric_ObjectStoreResourceInstances);
+        Metrics_Add(Metric_ObjectStoreValueBytes, valueSize);
 
         struct ListHead * i;
         struct ListHead * addPostion = &r->Instance;
@@ -471,6 +480,7 @@ int ObjectStore_SetResourceInstanceValue(ObjectStore * store, ObjectIDType objec
                 return -1;
             }
 
+            Metrics_Add(Metric_ObjectStoreValueBytes, valueSize - rInst->Size);
             rInst->Value = temp;
             rInst->Size = valueSize;
 
@@ -496,6 +506,62 @@ int ObjectStore_SetResourceInstanceValue(ObjectStore * store, ObjectIDType objec
     return -1;
 }
 
+int ObjectStore_SetResourceInstanceValueBlock(ObjectStore * store, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
+                                              ResourceIDType resourceID, ResourceInstanceIDType resourceInstanceID,
+                                              const void * valueBuffer, int valueBufferPos, int valueBufferLen, bool * changed)
+{
+    Resource * r;
+    ResourceInstance * rInst;
+    int valueSize = valueBufferPos + valueBufferLen;
+
+    if (valueBufferPos == 0)
+    {
+        bool sizeChanged = ((r = LookupResource(store, objectID, objectInstanceID, resourceID)) != NULL) &&
+                           ((rInst = GetResourceInstance(r, resourceInstanceID)) != NULL) && (rInst->Size != valueSize);
+
+        int result = ObjectStore_SetResourceInstanceValue(store, objectID, objectInstanceID, resourceID, resourceInstanceID, valueSize,
+                                                          valueBuffer, 0, valueBufferLen, changed);
+        *changed = *changed || sizeChanged;
+        return result;
+    }
+
+    *changed = false;
+
+    r = LookupResource(store, objectID, objectInstanceID, resourceID);
+    rInst = (r != NULL) ? GetResourceInstance(r, resourceInstanceID) : NULL;
+    if ((rInst == NULL) || (valueBufferPos < 0) || (valueBufferPos > rInst->Size))
+    {
+        Lwm2m_Error("Block at %d does not follow value of object %d instance %d resource %d\n", valueBufferPos, objectID, objectInstanceID, resourceID);
+        AwaResult_SetResult(AwaResult_BadRequest);
+        return -1;
+    }
+
+    if (rInst->Size != valueSize)
+    {
+        void * temp = realloc(rInst->Value, valueSize);
+        if (temp == NULL)
+        {
+            Lwm2m_Error("Failed to realloc memory\n");
+            AwaResult_SetResult(AwaResult_OutOfMemory);
+            return -1;
+        }
+
+        Metrics_Add(Metric_ObjectStoreValueBytes, valueSize - rInst->Size);
+        *changed = true;
+        rInst->Value = temp;
+        rInst->Size = valueSize;
+    }
+    else if (memcmp((char *)(rInst->Value) + valueBufferPos, valueBuffer, valueBufferLen))
+    {
+        *changed = true;
+    }
+
+    memcpy((char *)(rInst->Value) + valueBufferPos, valueBuffer, valueBufferLen);
+
+    AwaResult_SetResult(AwaResult_Success);
+    return valueBufferLen;
+}
+
 ObjectStore * ObjectStore_Create(void)
 {
     ObjectStore * store = (ObjectStore *)malloc(sizeof(ObjectStore));
@@ -523,6 +589,8 @@ static void DestroyResourceInstanceList(struct ListHead * resourceInstanceList)
             ResourceInstance * resourceInstance = ListEntry(i, ResourceInstance, list);
             if (resourceInstance != NULL)
             {
+                Metrics_Decrement(Metric_ObjectStoreResourceInstances);
+                Metrics_Add(Metric_ObjectStoreValueBytes, -resourceInstance->Size);
                 free(resourceInstance->Value);
                 free(resourceInstance);
             }
@@ -559,6 +627,7 @@ static void DestroyInstanceList(struct ListHead * instanceList)
             {
                 DestroyResourceList(&objectInstance->Resource);
                 free(objectInstance);
+                Metrics_Decrement(Metric_ObjectStoreInstances);
             }
         }
     }
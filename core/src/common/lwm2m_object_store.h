@@ -49,6 +49,12 @@ int ObjectStore_SetResourceInstanceValue(ObjectStore * store, ObjectIDType objec
                                          ResourceIDType resourceID, ResourceInstanceIDType resourceInstanceID, int valueSize,
                                          const void * valueBuffer, int valueBufferPos, int valueBufferLen, bool * changed);
 
+// Write a block of a value at valueBufferPos, and truncate the value at the end of the block - a value written in order,
+// block by block, grows as each block arrives. Return -1 on error, or the length of the block written.
+int ObjectStore_SetResourceInstanceValueBlock(ObjectStore * store, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
+                                              ResourceIDType resourceID, ResourceInstanceIDType resourceInstanceID,
+                                              const void * valueBuffer, int valueBufferPos, int valueBufferLen, bool * changed);
+
 int ObjectStore_GetResourceNumInstances(ObjectStore * store, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID);
 bool ObjectStore_Exists(ObjectStore * store, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID);
 int ObjectStore_GetInstanceNumResources(ObjectStore * store, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID);
@@ -28,6 +28,8 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <math.h>
 
 #include "lwm2m_types.h"
 #include "lwm2m_limits.h"
@@ -38,21 +40,56 @@
 #include "lwm2m_debug.h"
 #include "lwm2m_util.h"
 #include "lwm2m_result.h"
+#include "lwm2m_metrics.h"
 #include "lwm2m_security_object.h"
 #include "lwm2m_server_object.h"
+#include "lwm2m_objects.h"
 
-static Lwm2mObserverType * LookupObserver(void * ctxt, AddressType * addr, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
+// Observers are indexed by the path they observe, so that a change only visits the observers of that path and its parents
+typedef struct
+{
+    ObjectIDType ObjectID;
+    ObjectInstanceIDType ObjectInstanceID;
+    ResourceIDType ResourceID;
+} ObserverKey;
+
+static uint32_t HashObserverKey(const ObserverKey * key)
+{
+    uint32_t hash = Hash_Bytes(&key->ObjectID, sizeof(key->ObjectID), HASH_SEED);
+    hash = Hash_Bytes(&key->ObjectInstanceID, sizeof(key->ObjectInstanceID), hash);
+    return Hash_Bytes(&key->ResourceID, sizeof(key->ResourceID), hash);
+}
+
+static bool MatchObserver(const HashTableNode * node, const void * key)
+{
+    const Lwm2mObserverType * observer = HashTableEntry(node, Lwm2mObserverType, IndexNode);
+    const ObserverKey * observerKey = (const ObserverKey *)key;
+    return (observer->ObjectID == observerKey->ObjectID) &&
+           (observer->ObjectInstanceID == observerKey->ObjectInstanceID) &&
+           (observer->ResourceID == observerKey->ResourceID);
+}
+
+static Lwm2mObserverType * FindFirstObserver(void * ctxt, const ObserverKey * key)
 {
     Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
-    struct ListHead * i, *n;
-    ListForEachSafe(i, n, Lwm2mCore_GetObserverList(context))
-    {
-        Lwm2mObserverType * observer = ListEntry(i, Lwm2mObserverType, list);
+    HashTableNode * node = HashTable_Find(Lwm2mCore_GetObserverIndex(context), HashObserverKey(key), MatchObserver, key);
+    return (node != NULL) ? HashTableEntry(node, Lwm2mObserverType, IndexNode) : NULL;
+}
+
+static Lwm2mObserverType * FindNextObserver(Lwm2mObserverType * observer, const ObserverKey * key)
+{
+    HashTableNode * node = HashTable_FindNext(&observer->IndexNode, MatchObserver, key);
+    return (node != NULL) ? HashTableEntry(node, Lwm2mObserverType, IndexNode) : NULL;
+}
 
-        if ((observer->ObjectID == objectID) &&
-            (observer->ObjectInstanceID == objectInstanceID) &&
-            (observer->ResourceID == resourceID) &&
-            (memcmp(&observer->Address, addr, sizeof(AddressType)) == 0))
+static Lwm2mObserverType * LookupObserver(void * ctxt, AddressType * addr, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
+{
+    ObserverKey key = { objectID, objectInstanceID, resourceID };
+    Lwm2mObserverType * observer;
+    for (observer = FindFirstObserver(ctxt, &key); observer != NULL; observer = FindNextObserver(observer, &key))
+    {
+        // the paths of a composite observation are only reached through its token
+        if ((observer->Composite == NULL) && (memcmp(&observer->Address, addr, sizeof(AddressType)) == 0))
         {
             return observer;
         }
@@ -60,6 +97,90 @@ static Lwm2mObserverType * LookupObserver(void * ctxt, AddressType * addr, Objec
     return NULL;
 }
 
+static Lwm2mCompositeObserverType * LookupCompositeObserver(void * ctxt, AddressType * addr, const char * token, int tokenLength)
+{
+    Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
+    struct ListHead * observerItem;
+    ListForEach(observerItem, Lwm2mCore_GetObserverList(context))
+    {
+        Lwm2mObserverType * observer = ListEntry(observerItem, Lwm2mObserverType, list);
+        Lwm2mCompositeObserverType * composite = observer->Composite;
+        if ((composite != NULL) && (memcmp(&composite->Address, addr, sizeof(AddressType)) == 0) &&
+            (composite->TokenLength == tokenLength) && (memcmp(composite->Token, token, tokenLength) == 0))
+        {
+            return composite;
+        }
+    }
+    return NULL;
+}
+
+static void FreeObserver(void * ctxt, Lwm2mObserverType * observer);
+
+static void FreeCompositeObserver(void * ctxt, Lwm2mCompositeObserverType * composite)
+{
+    while (!ListEmpty(&composite->Members))
+    {
+        Lwm2mObserverType * observer = ListEntry(composite->Members.Next, Lwm2mObserverType, CompositeMember);
+        ListRemove(&observer->CompositeMember);
+        observer->Composite = NULL;
+        FreeObserver(ctxt, observer);
+    }
+    free(composite->DuePaths);
+    free(composite->ContextData);
+    free(composite);
+}
+
+static void FreeObserver(void * ctxt, Lwm2mObserverType * observer)
+{
+    Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
+    ListRemove(&observer->list);
+    HashTable_Remove(Lwm2mCore_GetObserverIndex(context), &observer->IndexNode);
+    Heap_Remove(Lwm2mCore_GetObserverDeadlines(context), &observer->Deadline);
+    Metrics_Decrement(Metric_Observations);
+    if (observer->Composite != NULL)
+    {
+        // a composite observation ends with the last of its paths
+        ListRemove(&observer->CompositeMember);
+        if (ListEmpty(&observer->Composite->Members))
+        {
+            FreeCompositeObserver(ctxt, observer->Composite);
+        }
+    }
+    free(observer->OldValueBuffer);
+    free(observer->ContextData);
+    free(observer);
+}
+
+// Keep a copy of the last value, without allocating unless it is longer than any seen before and too long to keep inline
+static void SetOldValue(Lwm2mObserverType * observer, const void * value, size_t valueLength)
+{
+    observer->OldValue = NULL;
+    observer->OldValueLength = 0;
+
+    if (value != NULL)
+    {
+        void * buffer = &observer->InlineValue;
+        if (valueLength > sizeof(observer->InlineValue))
+        {
+            if (valueLength > observer->OldValueBufferSize)
+            {
+                void * newBuffer = realloc(observer->OldValueBuffer, valueLength);
+                if (newBuffer == NULL)
+                {
+                    Lwm2m_Error("Error allocating memory\n");
+                    return;
+                }
+                observer->OldValueBuffer = newBuffer;
+                observer->OldValueBufferSize = valueLength;
+            }
+            buffer = observer->OldValueBuffer;
+        }
+        memcpy(buffer, value, valueLength);
+        observer->OldValue = buffer;
+        observer->OldValueLength = valueLength;
+    }
+}
+
 static bool NotificationAttributesValid(AttributeTypeEnum attributeType, NotificationAttributes * attributes)
 {
     return (attributes != NULL) && attributes->Valid[attributeType];
@@ -86,166 +207,267 @@ static NotificationAttributes * GetHighestValidAttributesForType(AttributeTypeEn
     }
 }
 
-void Lwm2m_MarkObserversChanged(void * ctxt, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
-                                ResourceIDType resourceID, const void * newValue, size_t newValueLength)
+// Resolve the attributes a server has written that apply to a path - each attribute is inherited from the object instance
+// or object if it is not set on the path itself
+static void ResolveAttributes(Lwm2mContextType * context, int shortServerID, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
+                              ResourceIDType resourceID, NotificationAttributes * resolved)
 {
-    Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
-    struct ListHead * observerItem;
-    ListForEach(observerItem, Lwm2mCore_GetObserverList(context))
+    AttributeStore * store = Lwm2mCore_GetAttributes(context);
+    NotificationAttributes * resourceAttributes = (resourceID == -1) ? NULL :
+            AttributeStore_LookupNotificationAttributes(store, shortServerID, objectID, objectInstanceID, resourceID);
+    NotificationAttributes * objectInstanceAttributes = (objectInstanceID == -1) ? NULL :
+            AttributeStore_LookupNotificationAttributes(store, shortServerID, objectID, objectInstanceID, -1);
+    NotificationAttributes * objectAttributes = AttributeStore_LookupNotificationAttributes(store, shortServerID, objectID, -1, -1);
+
+    memset(resolved, 0, sizeof(*resolved));
+    resolved->ShortServerID = shortServerID;
+    resolved->ObjectID = objectID;
+    resolved->ObjectInstanceID = objectInstanceID;
+    resolved->ResourceID = resourceID;
+
+    AttributeTypeEnum attributeType;
+    for (attributeType = AttributeTypeEnum_MinimumPeriod; attributeType <= AttributeTypeEnum_Step; attributeType++)
     {
-        Lwm2mObserverType * observer = ListEntry(observerItem, Lwm2mObserverType, list);
+        NotificationAttributes * attributes = GetHighestValidAttributesForType(attributeType, resourceAttributes, objectInstanceAttributes, objectAttributes);
+        if (attributes != NULL)
+        {
+            switch (attributeType)
+            {
+                case AttributeTypeEnum_MinimumPeriod:
+                    resolved->MinimumPeriod = attributes->MinimumPeriod;
+                    break;
+                case AttributeTypeEnum_MaximumPeriod:
+                    resolved->MaximumPeriod = attributes->MaximumPeriod;
+                    break;
+                case AttributeTypeEnum_GreaterThan:
+                    resolved->GreaterThan = attributes->GreaterThan;
+                    break;
+                case AttributeTypeEnum_LessThan:
+                    resolved->LessThan = attributes->LessThan;
+                    break;
+                case AttributeTypeEnum_Step:
+                    resolved->Step = attributes->Step;
+                    break;
+                default:
+                    break;
+            }
+            resolved->Valid[attributeType] = true;
+        }
+    }
+}
+
+// Cache the observer's resolved attributes, so they are not looked up for every change and tick. When pmin or pmax
+// are not set, the periods are the server's defaults.
+static void UpdateObserverAttributes(Lwm2mContextType * context, Lwm2mObserverType * observer)
+{
+    int shortServerID = Lwm2mSecurity_GetShortServerID(context, &observer->Address);
+    ResolveAttributes(context, shortServerID, observer->ObjectID, observer->ObjectInstanceID, observer->ResourceID, &observer->Attributes);
+
+    if (!observer->Attributes.Valid[AttributeTypeEnum_MinimumPeriod])
+    {
+        observer->Attributes.MinimumPeriod = Lwm2mServerObject_GetDefaultMinimumPeriod(context, shortServerID);
+    }
+    if (!observer->Attributes.Valid[AttributeTypeEnum_MaximumPeriod])
+    {
+        observer->Attributes.MaximumPeriod = Lwm2mServerObject_GetDefaultMaximumPeriod(context, shortServerID);
+    }
+}
+
+// Schedule the observer for when its pmin gate opens, if it has a change to report, or its pmax deadline, whichever is first.
+// A notification is due once more than the period has elapsed since the last one.
+static void ScheduleObserver(Lwm2mContextType * context, Lwm2mObserverType * observer)
+{
+    bool due = false;
+    uint64_t deadline = 0;
+
+    if (observer->Changed)
+    {
+        int minimumPeriod = (observer->Attributes.MinimumPeriod > 0) ? observer->Attributes.MinimumPeriod : 0;
+        deadline = observer->LastUpdate + (uint64_t)minimumPeriod * 1000 + 1;
+        due = true;
+    }
 
-        if ((observer->ObjectID == objectID) &&
-            ((observer->ObjectInstanceID == objectInstanceID) || (observer->ObjectInstanceID == -1)) &&
-            ((observer->ResourceID == resourceID) || (observer->ResourceID == -1)))
+    if (observer->Attributes.MaximumPeriod >= 0)
+    {
+        uint64_t maximumDeadline = observer->LastUpdate + (uint64_t)observer->Attributes.MaximumPeriod * 1000 + 1;
+        if (!due || (maximumDeadline < deadline))
         {
+            deadline = maximumDeadline;
+        }
+        due = true;
+    }
+
+    if (due)
+    {
+        Heap_Update(Lwm2mCore_GetObserverDeadlines(context), &observer->Deadline, deadline);
+    }
+    else
+    {
+        Heap_Remove(Lwm2mCore_GetObserverDeadlines(context), &observer->Deadline);
+    }
+}
 
-            int shortServerID = Lwm2mSecurity_GetShortServerID(context, &observer->Address);
+static void MarkObserverChanged(Lwm2mContextType * context, Lwm2mObserverType * observer, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
+                                ResourceIDType resourceID, const void * newValue, size_t newValueLength)
+{
+    int shortServerID = observer->Attributes.ShortServerID;
 
-            NotificationAttributes * resourceAttributes = (resourceID == -1) ? NULL :
-                    AttributeStore_LookupNotificationAttributes(Lwm2mCore_GetAttributes(context), shortServerID, objectID, objectInstanceID, resourceID);
-            NotificationAttributes * objectInstanceAttributes = (objectInstanceID == -1) ? NULL :
-                    AttributeStore_LookupNotificationAttributes(Lwm2mCore_GetAttributes(context), shortServerID, objectID, objectInstanceID, -1);
-            NotificationAttributes * objectAttributes = AttributeStore_LookupNotificationAttributes(Lwm2mCore_GetAttributes(context), shortServerID, objectID, -1, -1);
+    // the observer's cached attributes apply to changes to its own path, but a change below it has its own
+    NotificationAttributes * attributes = &observer->Attributes;
+    NotificationAttributes changedAttributes;
+    if ((observer->ObjectInstanceID != objectInstanceID) || (observer->ResourceID != resourceID))
+    {
+        ResolveAttributes(context, shortServerID, objectID, objectInstanceID, resourceID, &changedAttributes);
+        attributes = &changedAttributes;
+    }
 
-            ResourceDefinition * definition = Definition_LookupResourceDefinition(Lwm2mCore_GetDefinitions(context), objectID, resourceID);
+    ResourceDefinition * definition = Definition_LookupResourceDefinition(Lwm2mCore_GetDefinitions(context), objectID, resourceID);
 
-            bool passedAttributeChecks = false;
-            if ((definition != NULL) && (!IS_MULTIPLE_INSTANCE(definition)) && (observer->OldValue != NULL) && (newValue != NULL))
+    bool passedAttributeChecks = false;
+    if ((definition != NULL) && (!IS_MULTIPLE_INSTANCE(definition)) && (observer->OldValue != NULL) && (newValue != NULL))
+    {
+        switch (definition->Type)
+        {
+            case AwaResourceType_Integer: // no-break
+            case AwaResourceType_Float:   // no-break
+            case AwaResourceType_Time:
             {
+                NotificationAttributes * greaterThanAttributes = NotificationAttributesValid(AttributeTypeEnum_GreaterThan, attributes) ? attributes : NULL;
+                NotificationAttributes * lessThanAttributes = NotificationAttributesValid(AttributeTypeEnum_LessThan, attributes) ? attributes : NULL;
+                NotificationAttributes * stepAttributes = NotificationAttributesValid(AttributeTypeEnum_Step, attributes) ? attributes : NULL;
+
                 switch (definition->Type)
                 {
+                    // FIXME: Remove duplication if possible
                     case AwaResourceType_Integer: // no-break
-                    case AwaResourceType_Float:   // no-break
                     case AwaResourceType_Time:
                     {
-                        NotificationAttributes * greaterThanAttributes = GetHighestValidAttributesForType(AttributeTypeEnum_GreaterThan, resourceAttributes,
-                                                                                                          objectInstanceAttributes, objectAttributes);
-                        NotificationAttributes * lessThanAttributes = GetHighestValidAttributesForType(AttributeTypeEnum_LessThan, resourceAttributes,
-                                                                                                       objectInstanceAttributes, objectAttributes);
-                        NotificationAttributes * stepAttributes = GetHighestValidAttributesForType(AttributeTypeEnum_Step, resourceAttributes,
-                                                                                                   objectInstanceAttributes, objectAttributes);
-
-                        switch (definition->Type)
+                        AwaInteger oldValueAsInteger = observer->OldValueLength == sizeof(AwaInteger) ? *((AwaInteger *)observer->OldValue) : 0;
+                        AwaInteger newValueAsInteger = newValueLength == sizeof(AwaInteger) ? *((AwaInteger *)newValue) : 0;
+
+                        if ((greaterThanAttributes != NULL) &&
+                                ((oldValueAsInteger > greaterThanAttributes->GreaterThan) == (newValueAsInteger > greaterThanAttributes->GreaterThan)))
                         {
-                            // FIXME: Remove duplication if possible
-                            case AwaResourceType_Integer: // no-break
-                            case AwaResourceType_Time:
-                            {
-                                AwaInteger oldValueAsInteger = observer->OldValueLength == sizeof(AwaInteger) ? *((AwaInteger *)observer->OldValue) : 0;
-                                AwaInteger newValueAsInteger = newValueLength == sizeof(AwaInteger) ? *((AwaInteger *)newValue) : 0;
-
-                                if ((greaterThanAttributes != NULL) &&
-                                        ((oldValueAsInteger > greaterThanAttributes->GreaterThan) == (newValueAsInteger > greaterThanAttributes->GreaterThan)))
-                                {
-                                    Lwm2m_Error("/%d/%d/%d changed but did not cross over threshold high value; not notifying observer for server %d", objectID, objectInstanceID, resourceID, shortServerID);
-                                }
-                                else if ((lessThanAttributes != NULL) &&
-                                        ((oldValueAsInteger > lessThanAttributes->LessThan) == (newValueAsInteger > lessThanAttributes->LessThan)))
-                                {
-                                    Lwm2m_Error("/%d/%d/%d changed but did not cross over threshold low value; not notifying observer for server %d", objectID, objectInstanceID, resourceID, shortServerID);
-                                }
-                                else if ((stepAttributes != NULL) && stepAttributes->Step > labs(oldValueAsInteger - newValueAsInteger))
-                                {
-                                    Lwm2m_Error("/%d/%d/%d changed but not by the step amount (Old value = %" PRId64 ", new value = %" PRId64 "); not notifying observer for server %d", objectID, objectInstanceID, resourceID, oldValueAsInteger, newValueAsInteger, shortServerID);
-                                }
-                                else
-                                {
-                                    passedAttributeChecks = true;
-                                }
-                                break;
-                            }
-                            case AwaResourceType_Float:
-                            {
-                                AwaFloat oldValueAsFloat = observer->OldValueLength == sizeof(AwaInteger) ? *((AwaFloat *)observer->OldValue) : 0;
-                                AwaFloat newValueAsFloat = newValueLength == sizeof(AwaInteger) ? *((AwaFloat *)newValue) : 0;
-
-                                if ((greaterThanAttributes != NULL) &&
-                                        ((oldValueAsFloat > greaterThanAttributes->GreaterThan) == (newValueAsFloat > greaterThanAttributes->GreaterThan)))
-                                {
-                                    Lwm2m_Error("/%d/%d/%d changed but did not cross over threshold high value; not notifying observer for server %d", objectID, objectInstanceID, resourceID, shortServerID);
-                                }
-                                else if ((lessThanAttributes != NULL) &&
-                                        ((oldValueAsFloat > lessThanAttributes->LessThan) == (newValueAsFloat > lessThanAttributes->LessThan)))
-                                {
-                                    Lwm2m_Error("/%d/%d/%d changed but did not cross over threshold low value; not notifying observer for server %d", objectID, objectInstanceID, resourceID, shortServerID);
-                                }
-                                else if ((stepAttributes != NULL) && stepAttributes->Step > labs(oldValueAsFloat - newValueAsFloat))
-                                {
-                                    Lwm2m_Error("/%d/%d/%d changed but not by the step amount (Old value = %f, new value = %f); not notifying observer for server %d", objectID, objectInstanceID, resourceID, oldValueAsFloat, newValueAsFloat, shortServerID);
-                                }
-                                else
-                                {
-                                    passedAttributeChecks = true;
-                                }
-                                break;
-                            }
-                            default:
-                                Lwm2m_Error("Unsupported resource type for checking gt/lt/stp attributes: %d\n", definition->Type);
-                                break;
+                            Lwm2m_Error("/%d/%d/%d changed but did not cross over threshold high value; not notifying observer for server %d", objectID, objectInstanceID, resourceID, shortServerID);
+                        }
+                        else if ((lessThanAttributes != NULL) &&
+                                ((oldValueAsInteger > lessThanAttributes->LessThan) == (newValueAsInteger > lessThanAttributes->LessThan)))
+                        {
+                            Lwm2m_Error("/%d/%d/%d changed but did not cross over threshold low value; not notifying observer for server %d", objectID, objectInstanceID, resourceID, shortServerID);
+                        }
+                        else if ((stepAttributes != NULL) && stepAttributes->Step > labs(oldValueAsInteger - newValueAsInteger))
+                        {
+                            Lwm2m_Error("/%d/%d/%d changed but not by the step amount (Old value = %" PRId64 ", new value = %" PRId64 "); not notifying observer for server %d", objectID, objectInstanceID, resourceID, oldValueAsInteger, newValueAsInteger, shortServerID);
+                        }
+                        else
+                        {
+                            passedAttributeChecks = true;
                         }
                         break;
                     }
-                    default:
-                        // Other resource types do not support stp/gt/lt attributes
-                        passedAttributeChecks = true;
+                    case AwaResourceType_Float:
+                    {
+                        AwaFloat oldValueAsFloat = observer->OldValueLength == sizeof(AwaFloat) ? *((AwaFloat *)observer->OldValue) : 0;
+                        AwaFloat newValueAsFloat = newValueLength == sizeof(AwaFloat) ? *((AwaFloat *)newValue) : 0;
+
+                        if ((greaterThanAttributes != NULL) &&
+                                ((oldValueAsFloat > greaterThanAttributes->GreaterThan) == (newValueAsFloat > greaterThanAttributes->GreaterThan)))
+                        {
+                            Lwm2m_Error("/%d/%d/%d changed but did not cross over threshold high value; not notifying observer for server %d", objectID, objectInstanceID, resourceID, shortServerID);
+                        }
+                        else if ((lessThanAttributes != NULL) &&
+                                ((oldValueAsFloat > lessThanAttributes->LessThan) == (newValueAsFloat > lessThanAttributes->LessThan)))
+                        {
+                            Lwm2m_Error("/%d/%d/%d changed but did not cross over threshold low value; not notifying observer for server %d", objectID, objectInstanceID, resourceID, shortServerID);
+                        }
+                        else if ((stepAttributes != NULL) && stepAttributes->Step > fabs(oldValueAsFloat - newValueAsFloat))
+                        {
+                            Lwm2m_Error("/%d/%d/%d changed but not by the step amount (Old value = %f, new value = %f); not notifying observer for server %d", objectID, objectInstanceID, resourceID, oldValueAsFloat, newValueAsFloat, shortServerID);
+                        }
+                        else
+                        {
+                            passedAttributeChecks = true;
+                        }
                         break;
                     }
-            }
-            else
-            {
-                if (observer->OldValue != NULL && resourceID != -1)
-                {
-                    Lwm2m_Error("No resource definition for /%d/%d/%d\n", objectID, objectInstanceID, resourceID);
-                }
-                else
-                {
-                    passedAttributeChecks = true;
+                    default:
+                        Lwm2m_Error("Unsupported resource type for checking gt/lt/stp attributes: %d\n", definition->Type);
+                        break;
                 }
+                break;
             }
-
-            if (passedAttributeChecks)
-            {
-                Lwm2m_Debug("All attributes checked out for server %d, Will notify change to /%d/%d/%d when possible.\n", shortServerID, objectID, objectInstanceID, resourceID);
-                observer->Changed = true;
-
-                if (observer->OldValue != NULL)
-                {
-                    free(observer->OldValue);
-                    observer->OldValue = NULL;
-                }
-
-                if (newValue != NULL)
-                {
-                    observer->OldValue = malloc(newValueLength);
-                    observer->OldValueLength = newValueLength;
-                    memcpy(observer->OldValue, newValue, newValueLength);
-                }
+            default:
+                // Other resource types do not support stp/gt/lt attributes
+                passedAttributeChecks = true;
+                break;
             }
+    }
+    else
+    {
+        if (observer->OldValue != NULL && resourceID != -1)
+        {
+            Lwm2m_Error("No resource definition for /%d/%d/%d\n", objectID, objectInstanceID, resourceID);
+        }
+        else
+        {
+            passedAttributeChecks = true;
         }
     }
+
+    if (passedAttributeChecks)
+    {
+        Lwm2m_Debug("All attributes checked out for server %d, Will notify change to /%d/%d/%d when possible.\n", shortServerID, objectID, objectInstanceID, resourceID);
+        if (!observer->Changed)
+        {
+            observer->Changed = true;
+            ScheduleObserver(context, observer);
+        }
+
+        SetOldValue(observer, newValue, newValueLength);
+    }
 }
 
-int Lwm2m_RemoveAllObserversForOIR(void * ctxt, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
+void Lwm2m_MarkObserversChanged(void * ctxt, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
+                                ResourceIDType resourceID, const void * newValue, size_t newValueLength)
 {
     Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
-    struct ListHead * observerItem, *next;
-    ListForEachSafe(observerItem, next, Lwm2mCore_GetObserverList(context))
-    {
-        Lwm2mObserverType * observer = ListEntry(observerItem, Lwm2mObserverType, list);
 
-        if (observer->ObjectID == objectID &&
-            observer->ObjectInstanceID == objectInstanceID &&
-            observer->ResourceID == resourceID)
+    // a change is seen by observers of the path itself, and of its object instance and object
+    ObjectInstanceIDType objectInstanceIDs[] = { objectInstanceID, -1 };
+    ResourceIDType resourceIDs[] = { resourceID, -1 };
+    int numberOfObjectInstanceIDs = (objectInstanceID == -1) ? 1 : 2;
+    int numberOfResourceIDs = (resourceID == -1) ? 1 : 2;
+
+    int i, j;
+    for (i = 0; i < numberOfObjectInstanceIDs; i++)
+    {
+        for (j = 0; j < numberOfResourceIDs; j++)
         {
+            ObserverKey key = { objectID, objectInstanceIDs[i], resourceIDs[j] };
+            Lwm2mObserverType * observer;
+            for (observer = FindFirstObserver(context, &key); observer != NULL; observer = FindNextObserver(observer, &key))
+            {
+                MarkObserverChanged(context, observer, objectID, objectInstanceID, resourceID, newValue, newValueLength);
+            }
+        }
+    }
 
-           ListRemove(&observer->list);
+    // a server's default periods apply to all of its observers
+    if ((objectID == LWM2M_SERVER_OBJECT) &&
+        ((resourceID == -1) || (resourceID == LWM2M_SERVER_OBJECT_MINIMUM_PERIOD) || (resourceID == LWM2M_SERVER_OBJECT_MAXIMUM_PERIOD)))
+    {
+        Lwm2m_RescheduleObservers(context);
+    }
+}
 
-           free(observer->OldValue);
-           free(observer->ContextData);
-           free(observer);
-           return 0;
-        }
+int Lwm2m_RemoveAllObserversForOIR(void * ctxt, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
+{
+    ObserverKey key = { objectID, objectInstanceID, resourceID };
+    Lwm2mObserverType * observer = FindFirstObserver(ctxt, &key);
+    if (observer != NULL)
+    {
+        FreeObserver(ctxt, observer);
+        return 0;
     }
     return -1;
 }
@@ -257,134 +479,241 @@ void Lwm2m_FreeObservers(void * ctxt)
     ListForEachSafe(observerItem, n, Lwm2mCore_GetObserverList(context))
     {
         Lwm2mObserverType * observer = ListEntry(observerItem, Lwm2mObserverType, list);
-
-        ListRemove(observerItem);
-        free(observer->OldValue);
-        free(observer->ContextData);
-        free(observer);
+        FreeObserver(context, observer);
     }
 }
 
-int Lwm2m_Observe(void * ctxt, AddressType * addr, const char * token, int tokenLength, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
-                  ResourceIDType resourceID, AwaContentType contentType, Lwm2mNotificationCallback callback, void * ContextData)
+static Lwm2mObserverType * NewObserver(Lwm2mContextType * context, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
 {
-    Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
-    int result = 0;
-
-    Lwm2mObserverType * observer;
-
-    // If the client is already on the list of observers, the server must
-    // not add it a second time but replace or update the existing entry.
-    observer = LookupObserver(context, addr, objectID, objectInstanceID, resourceID);
+    Lwm2mObserverType * observer = (Lwm2mObserverType *) malloc(sizeof(Lwm2mObserverType));
     if (observer == NULL)
     {
-        observer = (Lwm2mObserverType *) malloc(sizeof(Lwm2mObserverType));
-        if (observer == NULL)
-        {
-            Lwm2m_Error("Error allocating memory\n");
-            result = -1;
-            goto error;
-        }
-
-        memset(observer, 0, sizeof(*observer));
-        ListAdd(&observer->list, Lwm2mCore_GetObserverList(context));
-    }
-    else
-    {
-        free(observer->OldValue);
-        free(observer->ContextData);
+        Lwm2m_Error("Error allocating memory\n");
+        return NULL;
     }
 
-    observer->OldValue = NULL;
-    observer->OldValueLength = 0;
+    memset(observer, 0, sizeof(*observer));
     observer->ObjectID = objectID;
     observer->ObjectInstanceID = objectInstanceID;
     observer->ResourceID = resourceID;
+    ListInit(&observer->CompositeMember);
+
+    ObserverKey key = { objectID, objectInstanceID, resourceID };
+    ListAdd(&observer->list, Lwm2mCore_GetObserverList(context));
+    HashTable_Add(Lwm2mCore_GetObserverIndex(context), &observer->IndexNode, HashObserverKey(&key));
+    Metrics_Increment(Metric_Observations);
+    return observer;
+}
+
+static void StartObserver(Lwm2mContextType * context, Lwm2mObserverType * observer, AddressType * addr, const char * token, int tokenLength,
+                          AwaContentType contentType)
+{
+    SetOldValue(observer, NULL, 0);
     observer->ContentType = contentType;
     observer->LastUpdate = 0;
-    observer->Callback = callback;
-    observer->ContextData = ContextData;
     observer->Changed = false;
     observer->TokenLength = tokenLength;
     observer->Sequence = 1;
     memcpy(&observer->Token, token, tokenLength);
     memcpy(&observer->Address, addr, sizeof(AddressType));
 
+    UpdateObserverAttributes(context, observer);
+    ScheduleObserver(context, observer);
+
     // The old value buffer must be created when the observation begins,
     // otherwise attributes can't be checked on the first modification of a resource value.
-    if (resourceID != -1)
+    if (observer->ResourceID != -1)
     {
-        ResourceDefinition * resourceDefinition = Definition_LookupResourceDefinition(Lwm2mCore_GetDefinitions(context), objectID, resourceID);
+        ResourceDefinition * resourceDefinition = Definition_LookupResourceDefinition(Lwm2mCore_GetDefinitions(context), observer->ObjectID, observer->ResourceID);
 
         if ((resourceDefinition != NULL) && (!IS_MULTIPLE_INSTANCE(resourceDefinition)))
         {
             const void * oldValue = NULL;
             size_t oldValueLength = 0;
 
-            Lwm2mCore_GetResourceInstanceValue(context, objectID, objectInstanceID, resourceID, 0, &oldValue, &oldValueLength);
+            Lwm2mCore_GetResourceInstanceValue(context, observer->ObjectID, observer->ObjectInstanceID, observer->ResourceID, 0, &oldValue, &oldValueLength);
 
             if ((oldValueLength > 0) && (oldValue != NULL))
             {
-                observer->OldValueLength = oldValueLength;
-                observer->OldValue = malloc(observer->OldValueLength);
-                memcpy(observer->OldValue, oldValue, observer->OldValueLength);
+                SetOldValue(observer, oldValue, oldValueLength);
             }
         }
     }
-
-error:
-    return result;
 }
 
-int Lwm2m_CancelObserve(void * ctxt, AddressType * addr, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
+int Lwm2m_Observe(void * ctxt, AddressType * addr, const char * token, int tokenLength, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
+                  ResourceIDType resourceID, AwaContentType contentType, Lwm2mNotificationCallback callback, void * ContextData)
 {
     Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
+
+    // If the client is already on the list of observers, the server must
+    // not add it a second time but replace or update the existing entry.
     Lwm2mObserverType * observer = LookupObserver(context, addr, objectID, objectInstanceID, resourceID);
-    if (observer != NULL)
+    if (observer == NULL)
+    {
+        if ((observer = NewObserver(context, objectID, objectInstanceID, resourceID)) == NULL)
+        {
+            return -1;
+        }
+    }
+    else
     {
-        ListRemove(&observer->list);
-        free(observer->OldValue);
         free(observer->ContextData);
-        free(observer);
-        return 0;
     }
-    return -1;
+
+    observer->Callback = callback;
+    observer->ContextData = ContextData;
+    StartObserver(context, observer, addr, token, tokenLength, contentType);
+    return 0;
 }
 
-void Lwm2m_UpdateObservers(void * ctxt)
+int Lwm2m_ObserveComposite(void * ctxt, AddressType * addr, const char * token, int tokenLength, const ObjectInstanceResourceKey * paths, int numberOfPaths,
+                           AwaContentType contentType, Lwm2mCompositeNotificationCallback callback, void * ContextData)
 {
     Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
-    uint32_t now = Lwm2mCore_GetTickCountMs();
 
-    struct ListHead * observerItem, *n;
-    ListForEachSafe(observerItem, n, Lwm2mCore_GetObserverList(context))
+    if (numberOfPaths <= 0)
     {
-        Lwm2mObserverType * observer = ListEntry(observerItem, Lwm2mObserverType, list);
+        return -1;
+    }
+
+    Lwm2m_CancelObserveComposite(context, addr, token, tokenLength);
+
+    Lwm2mCompositeObserverType * composite = (Lwm2mCompositeObserverType *) malloc(sizeof(Lwm2mCompositeObserverType));
+    ObjectInstanceResourceKey * duePaths = (ObjectInstanceResourceKey *) malloc(numberOfPaths * sizeof(ObjectInstanceResourceKey));
+    if ((composite == NULL) || (duePaths == NULL))
+    {
+        Lwm2m_Error("Error allocating memory\n");
+        free(composite);
+        free(duePaths);
+        return -1;
+    }
+
+    memset(composite, 0, sizeof(*composite));
+    ListInit(&composite->Members);
+    ListInit(&composite->Due);
+    memcpy(&composite->Address, addr, sizeof(AddressType));
+    composite->Callback = callback;
+    composite->ContentType = contentType;
+    memcpy(composite->Token, token, tokenLength);
+    composite->TokenLength = tokenLength;
+    composite->Sequence = 1;
+    composite->DuePaths = duePaths;
+
+    int i;
+    for (i = 0; i < numberOfPaths; i++)
+    {
+        Lwm2mObserverType * observer = NewObserver(context, paths[i].ObjectID, paths[i].InstanceID, paths[i].ResourceID);
+        if (observer == NULL)
+        {
+            FreeCompositeObserver(context, composite);
+            return -1;
+        }
+        observer->Composite = composite;
+        ListAdd(&observer->CompositeMember, &composite->Members);
+        StartObserver(context, observer, addr, token, tokenLength, contentType);
+    }
+
+    composite->ContextData = ContextData;
+    return 0;
+}
 
-        int shortServerID = Lwm2mSecurity_GetShortServerID(context, &observer->Address);
+int Lwm2m_CancelObserve(void * ctxt, AddressType * addr, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
+{
+    Lwm2mObserverType * observer = LookupObserver(ctxt, addr, objectID, objectInstanceID, resourceID);
+    if (observer != NULL)
+    {
+        FreeObserver(ctxt, observer);
+        return 0;
+    }
+    return -1;
+}
 
-        NotificationAttributes * resourceAttributes = observer->ResourceID == -1? NULL : AttributeStore_LookupNotificationAttributes(Lwm2mCore_GetAttributes(context), shortServerID, observer->ObjectID, observer->ObjectInstanceID, observer->ResourceID);
-        NotificationAttributes * objectInstanceAttributes = observer->ObjectInstanceID == -1? NULL : AttributeStore_LookupNotificationAttributes(Lwm2mCore_GetAttributes(context), shortServerID, observer->ObjectID, observer->ObjectInstanceID, -1);
-        NotificationAttributes * objectAttributes = AttributeStore_LookupNotificationAttributes(Lwm2mCore_GetAttributes(context), shortServerID, observer->ObjectID, -1, -1);
+int Lwm2m_CancelObserveComposite(void * ctxt, AddressType * addr, const char * token, int tokenLength)
+{
+    Lwm2mCompositeObserverType * composite = LookupCompositeObserver(ctxt, addr, token, tokenLength);
+    if (composite != NULL)
+    {
+        FreeCompositeObserver(ctxt, composite);
+        return 0;
+    }
+    return -1;
+}
 
-        NotificationAttributes * minimumPeriodAttributes = GetHighestValidAttributesForType(AttributeTypeEnum_MinimumPeriod, resourceAttributes, objectInstanceAttributes, objectAttributes);
-        int minimumPeriod = minimumPeriodAttributes != NULL? minimumPeriodAttributes->MinimumPeriod : Lwm2mServerObject_GetDefaultMinimumPeriod(context, shortServerID);
+int Lwm2m_UpdateObservers(void * ctxt)
+{
+    Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
+    Heap * deadlines = Lwm2mCore_GetObserverDeadlines(context);
+    uint64_t now = Lwm2mCore_GetTickCountMs();
 
-        NotificationAttributes * maximumPeriodAttributes = GetHighestValidAttributesForType(AttributeTypeEnum_MaximumPeriod, resourceAttributes, objectInstanceAttributes, objectAttributes);
-        int maximumPeriod = maximumPeriodAttributes != NULL? maximumPeriodAttributes->MaximumPeriod : Lwm2mServerObject_GetDefaultMaximumPeriod(context, shortServerID);
+    struct ListHead dueComposites;
+    ListInit(&dueComposites);
 
-        uint32_t elapsed = now - observer->LastUpdate;
+    // only visit the observers that are due
+    HeapNode * node;
+    while (((node = Heap_Peek(deadlines)) != NULL) && (node->Key <= now))
+    {
+        Lwm2mObserverType * observer = HeapEntry(Heap_Pop(deadlines), Lwm2mObserverType, Deadline);
+        Lwm2mCompositeObserverType * composite = observer->Composite;
 
-        if ((observer->Changed && (elapsed > ((uint32_t)minimumPeriod * 1000))) ||
-            ((maximumPeriod != -1) && (elapsed > ((uint32_t)maximumPeriod * 1000))))
+        if (composite != NULL)
+        {
+            // the paths of a composite observation that are due together are sent in one notification
+            if (!composite->IsDue)
+            {
+                composite->IsDue = true;
+                composite->NumberOfDuePaths = 0;
+                ListAdd(&composite->Due, &dueComposites);
+            }
+            ObjectInstanceResourceKey * path = &composite->DuePaths[composite->NumberOfDuePaths++];
+            path->ObjectID = observer->ObjectID;
+            path->InstanceID = observer->ObjectInstanceID;
+            path->ResourceID = observer->ResourceID;
+        }
+        else
         {
             observer->Sequence ++;
+            Metrics_Increment(Metric_ObserveNotifications);
             observer->Callback(context, &observer->Address, observer->Sequence,
                                (const char *)&observer->Token,
                                observer->TokenLength,
                                observer->ObjectID, observer->ObjectInstanceID, observer->ResourceID, observer->ContentType, observer->ContextData);
-            observer->Changed = false;
-            observer->LastUpdate = now;
         }
+        observer->Changed = false;
+        observer->LastUpdate = now;
+        ScheduleObserver(context, observer);
+    }
+
+    struct ListHead * compositeItem, * n;
+    ListForEachSafe(compositeItem, n, &dueComposites)
+    {
+        Lwm2mCompositeObserverType * composite = ListEntry(compositeItem, Lwm2mCompositeObserverType, Due);
+        ListRemove(&composite->Due);
+        composite->IsDue = false;
+
+        composite->Sequence ++;
+        Metrics_Increment(Metric_ObserveNotifications);
+        composite->Callback(context, &composite->Address, composite->Sequence, composite->Token, composite->TokenLength,
+                            composite->DuePaths, composite->NumberOfDuePaths, composite->ContentType, composite->ContextData);
+    }
+
+    int timeout = -1;
+    if ((node = Heap_Peek(deadlines)) != NULL)
+    {
+        uint64_t remaining = node->Key - now;
+        timeout = (remaining < INT_MAX) ? (int)remaining : INT_MAX;
+    }
+    return timeout;
+}
+
+void Lwm2m_RescheduleObservers(void * ctxt)
+{
+    Lwm2mContextType * context = (Lwm2mContextType *) ctxt;
+    struct ListHead * observerItem;
+    ListForEach(observerItem, Lwm2mCore_GetObserverList(context))
+    {
+        Lwm2mObserverType * observer = ListEntry(observerItem, Lwm2mObserverType, list);
+        UpdateObserverAttributes(context, observer);
+        ScheduleObserver(context, observer);
     }
 }
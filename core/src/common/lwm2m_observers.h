@@ -31,13 +31,39 @@ extern "C" {
 #include "lwm2m_types.h"
 #include "lwm2m_attributes.h"
 #include "lwm2m_list.h"
+#include "lwm2m_hash.h"
+#include "lwm2m_heap.h"
+#include "lwm2m_util.h"
 
 typedef int (*Lwm2mNotificationCallback)(void * context, AddressType *, int, const char *, int, ObjectIDType, ObjectInstanceIDType, ResourceIDType, AwaContentType, void * ContextData);
+typedef int (*Lwm2mCompositeNotificationCallback)(void * context, AddressType *, int, const char *, int, const ObjectInstanceResourceKey * paths, int numberOfPaths,
+                                                  AwaContentType, void * ContextData);
+
+// An Observe-Composite observation of several paths, which share one token. Each path has its own observer, so that changes and
+// notification attributes are tracked as for any other observation, but paths that are due at the same time are notified together.
+typedef struct
+{
+    struct ListHead Members;               // observers of each path
+    struct ListHead Due;                   // in the list of composite observations to notify, while Lwm2m_UpdateObservers runs
+    bool IsDue;
+    AddressType Address;
+    Lwm2mCompositeNotificationCallback Callback;
+    void * ContextData;
+    AwaContentType ContentType;
+    char Token[8];
+    int TokenLength;
+    int Sequence;
+    ObjectInstanceResourceKey * DuePaths;  // paths of the members due in the current update, with room for every member
+    int NumberOfDuePaths;
+} Lwm2mCompositeObserverType;
 
 typedef struct
 {
     struct ListHead list;
-    uint32_t LastUpdate;
+    HashTableNode IndexNode;               // in the observer index, keyed by object / instance / resource
+    HeapNode Deadline;                     // when the observer is next due, while it has a pmin gate or pmax deadline pending
+    uint64_t LastUpdate;
+    NotificationAttributes Attributes;     // resolved attributes, with the server's default pmin and pmax if they are not set
     ObjectIDType ObjectID;
     ObjectInstanceIDType ObjectInstanceID;
     ResourceIDType ResourceID;
@@ -49,12 +75,26 @@ typedef struct
     char Token[8];                         // CoAP message token for notification
     int TokenLength;                       // Length of CoAP message token
     int Sequence;
-    void * OldValue;                       // For Integer and Float datatypes only, used for notification attributes.
-    size_t OldValueLength;
+    void * OldValue;                       // Last notified value, used for notification attributes - points to InlineValue, or
+    size_t OldValueLength;                 // to OldValueBuffer for values too long for it, or NULL if there is none.
+    void * OldValueBuffer;                 // Reused for long string and opaque values, grown as needed
+    size_t OldValueBufferSize;
+    union
+    {
+        AwaInteger Integer;
+        AwaFloat Float;
+        uint8_t Bytes[16];
+    } InlineValue;                         // Holds fixed size values without allocating
+    Lwm2mCompositeObserverType * Composite; // composite observation this path belongs to, or NULL
+    struct ListHead CompositeMember;
 } Lwm2mObserverType;
 
 // Send out pending notifications to any observers of objects, object instances and resources.
-void Lwm2m_UpdateObservers(void * ctxt);
+// Returns the time in ms until the next observer is due, or -1 if none are.
+int Lwm2m_UpdateObservers(void * ctxt);
+
+// Recalculate when each observer is next due, after notification attributes or default periods have changed.
+void Lwm2m_RescheduleObservers(void * ctxt);
 
 void Lwm2m_FreeObservers(void * ctxt);
 
@@ -65,6 +105,12 @@ int Lwm2m_Observe(void * ctxt, AddressType * addr, const char * token, int token
                   ResourceIDType resourceID, AwaContentType contentType, Lwm2mNotificationCallback callback, void * ContextData);
 int Lwm2m_CancelObserve(void * ctxt, AddressType * addr, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID);
 
+// Observe several paths as one observation, identified by its token. An existing composite observation with the same token is replaced.
+// Each notification is given the paths that are due, which are those that changed or reached their maximum period.
+int Lwm2m_ObserveComposite(void * ctxt, AddressType * addr, const char * token, int tokenLength, const ObjectInstanceResourceKey * paths, int numberOfPaths,
+                           AwaContentType contentType, Lwm2mCompositeNotificationCallback callback, void * ContextData);
+int Lwm2m_CancelObserveComposite(void * ctxt, AddressType * addr, const char * token, int tokenLength);
+
 /* Free any observers in the observer list. this is called when a DELETE operation occurs for a specified object instance/resource.
  * Note that this will happen silently and will not notify the watcher that this has happened.
  */
@@ -0,0 +1,442 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+
+#include "lwm2m_senml_json.h"
+#include "lwm2m_definition.h"
+#include "lwm2m_debug.h"
+
+#define MAX_NAME_LENGTH 64
+
+typedef struct
+{
+    char * Buffer;
+    int Length;
+    int Position;
+    bool FirstRecord;
+    ObjectIDType BaseObjectID;                 // records are named relative to the object instance of the last base name
+    ObjectInstanceIDType BaseObjectInstanceID;
+} SenMLJsonWriter;
+
+typedef struct
+{
+    const char * Buffer;
+    int Length;
+    int Position;
+} SenMLJsonReader;
+
+static bool Append(SenMLJsonWriter * writer, const char * format, ...)
+{
+    int space = writer->Length - writer->Position;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(&writer->Buffer[writer->Position], (space > 0) ? space : 0, format, args);
+    va_end(args);
+
+    if ((written < 0) || (written >= space))
+    {
+        return false;
+    }
+    writer->Position += written;
+    return true;
+}
+
+static bool AppendChar(SenMLJsonWriter * writer, char c)
+{
+    if (writer->Position + 1 >= writer->Length)
+    {
+        return false;
+    }
+    writer->Buffer[writer->Position++] = c;
+    return true;
+}
+
+static bool AppendString(SenMLJsonWriter * writer, const char * value, size_t length)
+{
+    bool result = AppendChar(writer, '"');
+    size_t i;
+    for (i = 0; result && (i < length) && (value[i] != '\0'); i++)
+    {
+        unsigned char c = (unsigned char)value[i];
+        if ((c == '"') || (c == '\\'))
+        {
+            result = AppendChar(writer, '\\') && AppendChar(writer, c);
+        }
+        else if (c < 0x20)
+        {
+            result = Append(writer, "\\u%04x", c);
+        }
+        else
+        {
+            result = AppendChar(writer, c);
+        }
+    }
+    return result && AppendChar(writer, '"');
+}
+
+// Opaque values are base64url encoded, without padding (RFC 8428 section 5)
+static bool AppendBase64Url(SenMLJsonWriter * writer, const uint8_t * value, size_t length)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    bool result = AppendChar(writer, '"');
+    size_t i;
+    for (i = 0; result && (i < length); i += 3)
+    {
+        uint32_t bits = (uint32_t)value[i] << 16;
+        bits |= (i + 1 < length) ? (uint32_t)value[i + 1] << 8 : 0;
+        bits |= (i + 2 < length) ? (uint32_t)value[i + 2] : 0;
+
+        int characters = (length - i >= 3) ? 4 : (int)(length - i) + 1;
+        int j;
+        for (j = 0; result && (j < characters); j++)
+        {
+            result = AppendChar(writer, alphabet[(bits >> (18 - 6 * j)) & 0x3F]);
+        }
+    }
+    return result && AppendChar(writer, '"');
+}
+
+static bool AppendValue(SenMLJsonWriter * writer, const ResourceDefinition * definition, const uint8_t * value, uint16_t size)
+{
+    switch (definition->Type)
+    {
+        case AwaResourceType_String:
+            return Append(writer, ",\"vs\":") && AppendString(writer, (const char *)value, size);
+
+        case AwaResourceType_Boolean:
+            return Append(writer, ",\"vb\":%s", ((size > 0) && *(bool *)value) ? "true" : "false");
+
+        case AwaResourceType_Time:  // no break
+        case AwaResourceType_Integer:
+        {
+            int64_t integer;
+            switch (size)
+            {
+                case sizeof(int8_t):
+                    integer = ptrToInt8((void *)value);
+                    break;
+                case sizeof(int16_t):
+                    integer = ptrToInt16((void *)value);
+                    break;
+                case sizeof(int32_t):
+                    integer = ptrToInt32((void *)value);
+                    break;
+                case sizeof(int64_t):
+                    integer = ptrToInt64((void *)value);
+                    break;
+                default:
+                    Lwm2m_Error("SenML JSON - invalid length for integer\n");
+                    return false;
+            }
+            return Append(writer, ",\"v\":%" PRId64, integer);
+        }
+
+        case AwaResourceType_Float:
+            switch (size)
+            {
+                case sizeof(float):
+                    return Append(writer, ",\"v\":%.9g", *(float *)value);
+                case sizeof(double):
+                    return Append(writer, ",\"v\":%.17g", *(double *)value);
+                default:
+                    Lwm2m_Error("SenML JSON - invalid length for float\n");
+                    return false;
+            }
+
+        case AwaResourceType_Opaque:
+            return Append(writer, ",\"vd\":") && AppendBase64Url(writer, value, size);
+
+        case AwaResourceType_ObjectLink:
+        {
+            const AwaObjectLink * objectLink = (const AwaObjectLink *)value;
+            return Append(writer, ",\"vlo\":\"%d:%d\"", objectLink->ObjectID, objectLink->ObjectInstanceID);
+        }
+
+        default:
+            Lwm2m_Error("SenML JSON - unsupported resource type %d\n", definition->Type);
+            return false;
+    }
+}
+
+static bool SerialiseResource(SenMLJsonWriter * writer, Lwm2mTreeNode * node, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID,
+                              ResourceIDType resourceID)
+{
+    const ResourceDefinition * definition = (const ResourceDefinition *)Lwm2mTreeNode_GetDefinition(node);
+    if (definition == NULL)
+    {
+        return false;
+    }
+
+    bool result = true;
+    Lwm2mTreeNode * child;
+    for (child = Lwm2mTreeNode_GetFirstChild(node); result && (child != NULL); child = Lwm2mTreeNode_GetNextChild(node, child))
+    {
+        int resourceInstanceID;
+        uint16_t size;
+        Lwm2mTreeNode_GetID(child, &resourceInstanceID);
+        const uint8_t * value = Lwm2mTreeNode_GetValue(child, &size);
+
+        result = Append(writer, writer->FirstRecord ? "{" : ",{");
+        writer->FirstRecord = false;
+
+        // a base name is only given when the object instance changes
+        if (result && ((objectID != writer->BaseObjectID) || (objectInstanceID != writer->BaseObjectInstanceID)))
+        {
+            result = Append(writer, "\"bn\":\"/%d/%d/\",", objectID, objectInstanceID);
+            writer->BaseObjectID = objectID;
+            writer->BaseObjectInstanceID = objectInstanceID;
+        }
+
+        if (result)
+        {
+            result = IS_MULTIPLE_INSTANCE(definition) ? Append(writer, "\"n\":\"%d/%d\"", resourceID, resourceInstanceID) :
+                                                        Append(writer, "\"n\":\"%d\"", resourceID);
+        }
+        result = result && (value != NULL) && AppendValue(writer, definition, value, size) && AppendChar(writer, '}');
+    }
+    return result;
+}
+
+static bool SerialiseObjectInstance(SenMLJsonWriter * writer, Lwm2mTreeNode * node, ObjectIDType objectID, ObjectInstanceIDType objectInstanceID)
+{
+    bool result = true;
+    Lwm2mTreeNode * child;
+    for (child = Lwm2mTreeNode_GetFirstChild(node); result && (child != NULL); child = Lwm2mTreeNode_GetNextChild(node, child))
+    {
+        int resourceID;
+        Lwm2mTreeNode_GetID(child, &resourceID);
+        result = SerialiseResource(writer, child, objectID, objectInstanceID, resourceID);
+    }
+    return result;
+}
+
+static bool SerialiseObject(SenMLJsonWriter * writer, Lwm2mTreeNode * node, ObjectIDType objectID)
+{
+    bool result = true;
+    Lwm2mTreeNode * child;
+    for (child = Lwm2mTreeNode_GetFirstChild(node); result && (child != NULL); child = Lwm2mTreeNode_GetNextChild(node, child))
+    {
+        int objectInstanceID;
+        Lwm2mTreeNode_GetID(child, &objectInstanceID);
+        result = SerialiseObjectInstance(writer, child, objectID, objectInstanceID);
+    }
+    return result;
+}
+
+int SenMLJson_SerialisePaths(Lwm2mTreeNode * const * nodes, const ObjectInstanceResourceKey * paths, int numberOfPaths, char * buffer, int len)
+{
+    SenMLJsonWriter writer = { .Buffer = buffer, .Length = len, .Position = 0, .FirstRecord = true, .BaseObjectID = -1, .BaseObjectInstanceID = -1 };
+    bool result = AppendChar(&writer, '[');
+
+    int i;
+    for (i = 0; result && (i < numberOfPaths); i++)
+    {
+        if (nodes[i] == NULL)
+        {
+            result = false;
+        }
+        else if (Lwm2mTreeNode_GetType(nodes[i]) == Lwm2mTreeNodeType_Object)
+        {
+            result = SerialiseObject(&writer, nodes[i], paths[i].ObjectID);
+        }
+        else if (Lwm2mTreeNode_GetType(nodes[i]) == Lwm2mTreeNodeType_ObjectInstance)
+        {
+            result = SerialiseObjectInstance(&writer, nodes[i], paths[i].ObjectID, paths[i].InstanceID);
+        }
+        else if (Lwm2mTreeNode_GetType(nodes[i]) == Lwm2mTreeNodeType_Resource)
+        {
+            result = SerialiseResource(&writer, nodes[i], paths[i].ObjectID, paths[i].InstanceID, paths[i].ResourceID);
+        }
+        else
+        {
+            Lwm2m_Error("SenML JSON - unexpected node type %d\n", Lwm2mTreeNode_GetType(nodes[i]));
+            result = false;
+        }
+    }
+
+    if (!(result && Append(&writer, "]")))
+    {
+        Lwm2m_Error("Failed to serialise SenML JSON pack of %d paths in %d bytes\n", numberOfPaths, len);
+        return -1;
+    }
+    return writer.Position;
+}
+
+static void SkipWhitespace(SenMLJsonReader * reader)
+{
+    while ((reader->Position < reader->Length) && isspace((unsigned char)reader->Buffer[reader->Position]))
+    {
+        reader->Position++;
+    }
+}
+
+static bool Expect(SenMLJsonReader * reader, char c)
+{
+    SkipWhitespace(reader);
+    if ((reader->Position < reader->Length) && (reader->Buffer[reader->Position] == c))
+    {
+        reader->Position++;
+        return true;
+    }
+    return false;
+}
+
+static bool ReadString(SenMLJsonReader * reader, char * value, size_t size)
+{
+    if (!Expect(reader, '"'))
+    {
+        return false;
+    }
+
+    size_t length = 0;
+    while (reader->Position < reader->Length)
+    {
+        char c = reader->Buffer[reader->Position++];
+        if (c == '"')
+        {
+            value[length] = '\0';
+            return true;
+        }
+        // names are paths, which have nothing to escape
+        if ((c == '\\') || (length + 1 >= size))
+        {
+            return false;
+        }
+        value[length++] = c;
+    }
+    return false;
+}
+
+// Parse "/O", "/O/I" or "/O/I/R", with an optional trailing '/'
+static bool ParsePath(const char * name, ObjectInstanceResourceKey * path)
+{
+    int ids[3] = { -1, -1, -1 };
+    int count = 0;
+    const char * position = name;
+
+    while ((position[0] == '/') && isdigit((unsigned char)position[1]))
+    {
+        char * end;
+        long id = strtol(&position[1], &end, 10);
+        if ((count == 3) || (id > UINT16_MAX))
+        {
+            return false;
+        }
+        ids[count++] = (int)id;
+        position = end;
+    }
+
+    if (position[0] == '/')
+    {
+        position++;
+    }
+    if ((count == 0) || (position[0] != '\0'))
+    {
+        return false;
+    }
+
+    path->ObjectID = ids[0];
+    path->InstanceID = ids[1];
+    path->ResourceID = ids[2];
+    return true;
+}
+
+int SenMLJson_DeserialisePaths(const char * buffer, int len, ObjectInstanceResourceKey * paths, int maxPaths)
+{
+    SenMLJsonReader reader = { .Buffer = buffer, .Length = len, .Position = 0 };
+    char baseName[MAX_NAME_LENGTH] = "";
+    int numberOfPaths = 0;
+
+    if (!Expect(&reader, '['))
+    {
+        return -1;
+    }
+
+    do
+    {
+        char name[MAX_NAME_LENGTH] = "";
+        if (!Expect(&reader, '{'))
+        {
+            return -1;
+        }
+
+        if (!Expect(&reader, '}'))
+        {
+            do
+            {
+                char key[8];
+                char value[MAX_NAME_LENGTH];
+                if (!ReadString(&reader, key, sizeof(key)) || !Expect(&reader, ':') || !ReadString(&reader, value, sizeof(value)))
+                {
+                    return -1;
+                }
+
+                // the base name applies to this and later records
+                if (strcmp(key, "bn") == 0)
+                {
+                    strcpy(baseName, value);
+                }
+                else if (strcmp(key, "n") == 0)
+                {
+                    strcpy(name, value);
+                }
+                else
+                {
+                    Lwm2m_Error("SenML JSON - unsupported field \"%s\"\n", key);
+                    return -1;
+                }
+            }
+            while (Expect(&reader, ','));
+
+            if (!Expect(&reader, '}'))
+            {
+                return -1;
+            }
+        }
+
+        char path[2 * MAX_NAME_LENGTH];
+        snprintf(path, sizeof(path), "%s%s", baseName, name);
+        if ((numberOfPaths >= maxPaths) || !ParsePath(path, &paths[numberOfPaths]))
+        {
+            Lwm2m_Error("SenML JSON - invalid or too many paths at \"%s\"\n", path);
+            return -1;
+        }
+        numberOfPaths++;
+    }
+    while (Expect(&reader, ','));
+
+    if (!Expect(&reader, ']'))
+    {
+        return -1;
+    }
+    SkipWhitespace(&reader);
+    return (reader.Position == reader.Length) ? numberOfPaths : -1;
+}
@@ -0,0 +1,48 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef LWM2M_SENML_JSON_H
+#define LWM2M_SENML_JSON_H
+
+#include "lwm2m_tree_node.h"
+#include "lwm2m_util.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// SenML JSON (RFC 8428) is the content format of LwM2M 1.1 composite operations, which name their paths in the payload.
+
+// Serialise the tree read from each of the paths into one SenML JSON pack. Return the length of the pack, or -1 on error or if it does not fit.
+int SenMLJson_SerialisePaths(Lwm2mTreeNode * const * nodes, const ObjectInstanceResourceKey * paths, int numberOfPaths, char * buffer, int len);
+
+// Decode the names of the records in a SenML JSON pack, such as the body of an Observe-Composite request, as object, object instance
+// or resource paths. Other fields are not supported. Return the number of paths, or -1 if the pack is malformed or has more than maxPaths.
+int SenMLJson_DeserialisePaths(const char * buffer, int len, ObjectInstanceResourceKey * paths, int maxPaths);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LWM2M_SENML_JSON_H
@@ -507,6 +507,20 @@ static int TlvDecodeHeader(int * type, uint16_t * identifier, int * length, cons
     return valueIndex;
 }
 
+int TlvDecodeResourceHeader(ResourceIDType * resourceID, int * length, const uint8_t * buffer, int bufferLen)
+{
+    int type;
+    uint16_t identifier;
+    int valueIndex = TlvDecodeHeader(&type, &identifier, length, buffer, bufferLen);
+
+    if ((valueIndex < 0) || (type != TLV_TYPE_IDENT_RESOURCE_VALUE) || (valueIndex > bufferLen))
+    {
+        return -1;
+    }
+    *resourceID = identifier;
+    return valueIndex;
+}
+
 /**
  * @brief decode a TLV encoded float value (excluding the header)
  *
@@ -32,6 +32,10 @@ extern "C" {
 
 extern const SerialiserDeserialiser tlvSerDes;
 
+// Decode the header of a single resource TLV, so that the value of a resource too large to be deserialised at once can be
+// written as it arrives. Return the position of the value, or -1 on error.
+int TlvDecodeResourceHeader(ResourceIDType * resourceID, int * length, const uint8_t * buffer, int bufferLen);
+
 #ifdef __cplusplus
 }
 #endif
@@ -73,6 +73,7 @@ typedef struct
         struct sockaddr_in6 Sin6;
     } Addr;
     bool Secure;
+    bool Reliable;
 } AddressType;
 #endif
 #endif
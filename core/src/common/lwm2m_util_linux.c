@@ -72,6 +72,13 @@ void Lwm2mCore_AddressTypeToPath(char * path, size_t pathSize, AddressType * add
         pathSize--;
     }
 
+    if (addr->Reliable)
+    {
+        memcpy(path, "+tcp", 4);
+        path += 4;
+        pathSize -= 4;
+    }
+
     switch (addr->Addr.Sa.sa_family)
     {
         case AF_INET:
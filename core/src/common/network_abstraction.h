@@ -60,12 +60,18 @@ NetworkAddress * NetworkAddress_New(const char * uri, int uriLength);
 
 int NetworkAddress_Compare(NetworkAddress * addressX, NetworkAddress * addressY);
 
+// Hash of the address and port, consistent with NetworkAddress_Compare (equal addresses have equal hashes)
+uint32_t NetworkAddress_Hash(const NetworkAddress * address);
+
 void NetworkAddress_SetAddressType(NetworkAddress * address, AddressType * addressType);
 
 void NetworkAddress_Free(NetworkAddress ** address);
 
 bool NetworkAddress_IsSecure(const NetworkAddress * address);
 
+// True for addresses reached over a connection-oriented transport (CoAP over TCP, RFC 8323), given by the coap+tcp scheme
+bool NetworkAddress_IsReliable(const NetworkAddress * address);
+
 NetworkSocket * NetworkSocket_New(const char * ipAddress, NetworkSocketType socketType, uint16_t port);
 
 NetworkSocketError NetworkSocket_GetError(NetworkSocket * networkSocket);
@@ -78,6 +84,16 @@ void NetworkSocket_SetPSK(NetworkSocket * networkSocket, const char * identity,
 
 bool NetworkSocket_StartListening(NetworkSocket * networkSocket);
 
+// Largest message accepted over a connection, announced to the peer when the connection is opened (RFC 8323 section 5.3)
+void NetworkSocket_SetMaxMessageSize(NetworkSocket * networkSocket, int maxMessageSize);
+
+// Largest message the peer at destAddress accepts over its connection, and whether it takes BERT blocks (RFC 8323 section 6)
+int NetworkSocket_GetMaxMessageSize(NetworkSocket * networkSocket, NetworkAddress * destAddress);
+bool NetworkSocket_IsBlockwiseSupported(NetworkSocket * networkSocket, NetworkAddress * destAddress);
+
+// True while messages received over connections are waiting to be read - they do not make the file descriptor readable
+bool NetworkSocket_HasPendingMessages(NetworkSocket * networkSocket);
+
 //bool NetworkSocket_Connect(NetworkSocket networkSocket, NetworkAddress * destAddress);
 
 bool NetworkSocket_Read(NetworkSocket * networkSocket, uint8_t * buffer, int bufferLength, NetworkAddress ** sourceAddress, int *readLength);
@@ -33,6 +33,7 @@
 #endif
 
 #include "lwm2m_debug.h"
+#include "lwm2m_hash.h"
 #include "lwm2m_util.h"
 #include "network_abstraction.h"
 #include "dtls_abstraction.h"
@@ -84,7 +85,7 @@ static NetworkAddress * addCachedAddress(const uip_ipaddr_t * addr, uint16_t por
 static NetworkAddress * getCachedAddress(const uip_ipaddr_t * addr, uint16_t port);
 
 #ifndef ENCRYPT_BUFFER_LENGTH
-#define ENCRYPT_BUFFER_LENGTH 1024
+#define ENCRYPT_BUFFER_LENGTH 1536
 #endif
 
 uint8_t encryptBuffer[ENCRYPT_BUFFER_LENGTH];
@@ -274,6 +275,17 @@ int NetworkAddress_Compare(NetworkAddress * address1, NetworkAddress * address2)
     return result;
 }
 
+uint32_t NetworkAddress_Hash(const NetworkAddress * address)
+{
+    uint32_t hash = HASH_SEED;
+    if (address)
+    {
+        hash = Hash_Bytes(&address->Address, sizeof(uip_ipaddr_t), hash);
+        hash = Hash_Bytes(&address->Port, sizeof(address->Port), hash);
+    }
+    return hash;
+}
+
 void NetworkAddress_SetAddressType(NetworkAddress * address, AddressType * addressType)
 {
     if (address && addressType)
@@ -317,6 +329,12 @@ bool NetworkAddress_IsSecure(const NetworkAddress * address)
     return result;
 }
 
+bool NetworkAddress_IsReliable(const NetworkAddress * address)
+{
+    // CoAP over TCP is not supported on Contiki
+    return false;
+}
+
 static NetworkAddress * addCachedAddress(const uip_ipaddr_t * addr, uint16_t port, bool secure)
 {
     NetworkAddress * result = NULL;
@@ -394,6 +412,25 @@ int NetworkSocket_GetFileDescriptor(NetworkSocket * networkSocket)
     return result;
 }
 
+void NetworkSocket_SetMaxMessageSize(NetworkSocket * networkSocket, int maxMessageSize)
+{
+}
+
+int NetworkSocket_GetMaxMessageSize(NetworkSocket * networkSocket, NetworkAddress * destAddress)
+{
+    return 1152;
+}
+
+bool NetworkSocket_IsBlockwiseSupported(NetworkSocket * networkSocket, NetworkAddress * destAddress)
+{
+    return false;
+}
+
+bool NetworkSocket_HasPendingMessages(NetworkSocket * networkSocket)
+{
+    return false;
+}
+
 void NetworkSocket_SetCertificate(NetworkSocket * networkSocket, const uint8_t * cert, int certLength, AwaCertificateFormat format)
 {
     DTLS_SetCertificate(cert, certLength, format);
@@ -28,6 +28,8 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
 #include <netdb.h>
 typedef int SOCKET;
 #define SOCKET_ERROR            (-1)
@@ -38,6 +40,8 @@ typedef int SOCKET;
 #include <linux/version.h>
 
 #include "lwm2m_debug.h"
+#include "lwm2m_hash.h"
+#include "lwm2m_list.h"
 #include "lwm2m_util.h"
 #include "network_abstraction.h"
 #include "dtls_abstraction.h"
@@ -53,24 +57,80 @@ struct _NetworkAddress
         struct sockaddr_in6 Sin6;
     } Address;
     bool Secure;
+    bool Reliable;
     int useCount;
+    HashTableNode Node;                 // in the address cache, by address
+    HashTableNode UriNode;              // by the scheme and authority of the URI it was resolved from, if any
+    char * Uri;
 };
 
 struct _NetworkSocket
 {
     int Socket;
     int SocketIPv6;
+    int StreamSocket;                   // listening for CoAP over TCP connections
+    int StreamSocketIPv6;
+    int Poll;                           // epoll set of all of the above and the connections
     NetworkAddress * BindAddress;
     NetworkSocketType SocketType;
     uint16_t Port;
     NetworkSocketError LastError;
+    int MaxMessageSize;
+    HashTable Connections;              // by peer address
+    struct ListHead PendingConnections; // connections with a whole message received, waiting to be read
 };
 
+// A CoAP over TCP connection (RFC 8323), accepted from or opened to a peer. Messages are framed by their length, so bytes
+// are gathered until a whole message has arrived. Bytes the socket cannot take yet are kept until it is writable.
 typedef struct
 {
-    char * uri;
-    NetworkAddress * address;
-} NetworkAddressCache;
+    HashTableNode Node;
+    struct ListHead Pending;
+    bool IsPending;
+    NetworkAddress * Address;
+    int Socket;
+    bool Connected;
+    bool Writing;                       // waiting for the socket to become writable
+    int PeerMaxMessageSize;
+    bool PeerBlockwise;
+    uint8_t * Input;
+    size_t InputStart;
+    size_t InputLength;
+    size_t InputSize;
+    uint8_t * Output;
+    size_t OutputLength;
+    size_t OutputSize;
+} NetworkConnection;
+
+// Signalling messages (RFC 8323 section 5) have codes of class 7
+#define SIGNAL_CODE_CLASS               (7 << 5)
+#define SIGNAL_CODE_CSM                 (SIGNAL_CODE_CLASS | 1)
+#define SIGNAL_CODE_PING                (SIGNAL_CODE_CLASS | 2)
+#define SIGNAL_CODE_PONG                (SIGNAL_CODE_CLASS | 3)
+#define SIGNAL_CODE_RELEASE             (SIGNAL_CODE_CLASS | 4)
+#define SIGNAL_CODE_ABORT               (SIGNAL_CODE_CLASS | 5)
+#define CSM_OPTION_MAX_MESSAGE_SIZE     (2)
+#define CSM_OPTION_BLOCKWISE_TRANSFER   (4)
+
+// Until its CSM says otherwise, a peer is assumed to take messages of up to 1152 bytes (RFC 8323 section 5.3.1)
+#define DEFAULT_MAX_MESSAGE_SIZE        (1152)
+
+// A datagram has a 4 byte header (version, type, token length, code and message ID) before the token
+#define DATAGRAM_HEADER_LENGTH          (4)
+#define MAX_STREAM_HEADER_LENGTH        (6)
+
+#ifndef STREAM_READ_SIZE
+#define STREAM_READ_SIZE                (16 * 1024)
+#endif
+
+// Sends are refused while this much is waiting to be written to a connection
+#ifndef MAX_STREAM_OUTPUT
+#define MAX_STREAM_OUTPUT               (1024 * 1024)
+#endif
+
+#ifndef MAX_NETWORK_EVENTS
+#define MAX_NETWORK_EVENTS              (64)
+#endif
 
 typedef enum
 {
@@ -81,11 +141,10 @@ typedef enum
 
 #define MAX_URI_LENGTH  (256)
 
-#ifndef MAX_NETWORK_ADDRESS_CACHE
-    #define MAX_NETWORK_ADDRESS_CACHE  (5)
-#endif
-
-static NetworkAddressCache networkAddressCache[MAX_NETWORK_ADDRESS_CACHE] = {{0}};
+// Addresses in use are cached, so that a peer always has the same address and a URI is only resolved once - requests
+// to a registered client find its address by the scheme and authority of the URI, without parsing or a name lookup
+static HashTable addressCache;
+static HashTable addressCacheByUri;
 
 static void addCachedAddress(NetworkAddress * address, const char * uri, int uriLength);
 static NetworkAddress * getCachedAddress(NetworkAddress * matchAddress, const char * uri, int uriLength);
@@ -93,7 +152,7 @@ static NetworkAddress * getCachedAddressByUri(const char * uri, int uriLength);
 static int getUriHostLength(const char * uri, int uriLength);
 
 #ifndef ENCRYPT_BUFFER_LENGTH
-#define ENCRYPT_BUFFER_LENGTH 1024
+#define ENCRYPT_BUFFER_LENGTH 1536
 #endif
 
 uint8_t encryptBuffer[ENCRYPT_BUFFER_LENGTH];
@@ -137,6 +196,7 @@ NetworkAddress * NetworkAddress_New(const char * uri, int uriLength)
         {
             bool ip6Address = false;
             bool secure = false;
+            bool reliable = false;
             int index = 0;
             int startIndex = 0;
             int port = 5683;
@@ -159,6 +219,16 @@ NetworkAddress * NetworkAddress_New(const char * uri, int uriLength)
                             port = 5684;
                             secure = true;
                         }
+                        else if ((length == 8) && (strncmp(&uri[startIndex],"coap+tcp", length) == 0))
+                        {
+                            reliable = true;
+                        }
+                        else if ((length == 9) && (strncmp(&uri[startIndex],"coaps+tcp", length) == 0))
+                        {
+                            port = 5684;
+                            secure = true;
+                            reliable = true;
+                        }
                         else
                         {
                             break;
@@ -260,6 +330,7 @@ NetworkAddress * NetworkAddress_New(const char * uri, int uriLength)
                 if (networkAddress)
                 {
                     networkAddress->Secure = secure;
+                    networkAddress->Reliable = reliable;
                     result = getCachedAddress(networkAddress, uri, uriHostLength);
                     if (result)
                     {
@@ -303,8 +374,8 @@ int NetworkAddress_Compare(NetworkAddress * address1, NetworkAddress * address2)
 {
     int result = -1;
 
-    // Compare address and port (ignore uri)
-    if (address1 && address2 && address1->Address.Sa.sa_family == address2->Address.Sa.sa_family)
+    // Compare address and port (ignore uri) - a peer reached over TCP is not the one at the same address and port over UDP
+    if (address1 && address2 && address1->Address.Sa.sa_family == address2->Address.Sa.sa_family && address1->Reliable == address2->Reliable)
     {
         if (address1->Address.Sa.sa_family == AF_INET)
         {
@@ -326,6 +397,29 @@ int NetworkAddress_Compare(NetworkAddress * address1, NetworkAddress * address2)
     return result;
 }
 
+uint32_t NetworkAddress_Hash(const NetworkAddress * address)
+{
+    uint32_t hash = HASH_SEED;
+    if (address)
+    {
+        if (address->Address.Sa.sa_family == AF_INET)
+        {
+            hash = Hash_Bytes(&address->Address.Sin.sin_addr.s_addr, sizeof(address->Address.Sin.sin_addr.s_addr), hash);
+            hash = Hash_Bytes(&address->Address.Sin.sin_port, sizeof(address->Address.Sin.sin_port), hash);
+        }
+        else if (address->Address.Sa.sa_family == AF_INET6)
+        {
+            hash = Hash_Bytes(&address->Address.Sin6.sin6_addr, sizeof(address->Address.Sin6.sin6_addr), hash);
+            hash = Hash_Bytes(&address->Address.Sin6.sin6_port, sizeof(address->Address.Sin6.sin6_port), hash);
+        }
+        if (address->Reliable)
+        {
+            hash = Hash_Bytes(&address->Reliable, sizeof(address->Reliable), hash);
+        }
+    }
+    return hash;
+}
+
 void NetworkAddress_SetAddressType(NetworkAddress * address, AddressType * addressType)
 {
     if (address && addressType)
@@ -333,6 +427,7 @@ void NetworkAddress_SetAddressType(NetworkAddress * address, AddressType * addre
         addressType->Size = sizeof(addressType->Addr);
         memcpy(&addressType->Addr, &address->Address, addressType->Size);
         addressType->Secure = address->Secure;
+        addressType->Reliable = address->Reliable;
 //        if (addressType->Addr.Sa.sa_family == AF_INET6)
 //            addressType->Addr.Sin6.sin6_port = ntohs(address->Address.Sin6.sin6_port);
 //        else
@@ -348,24 +443,16 @@ void NetworkAddress_Free(NetworkAddress ** address)
         (*address)->useCount--;
         if ((*address)->useCount == 0)
         {
-            int index;
-            for (index = 0; index < MAX_NETWORK_ADDRESS_CACHE; index++)
+            HashTable_Remove(&addressCache, &(*address)->Node);
+            if ((*address)->Uri)
             {
-                if (networkAddressCache[index].address == *address)
-                {
-                    if (networkAddressCache[index].uri)
-                    {
-                        Lwm2m_Debug("Address free: %s\n", networkAddressCache[index].uri);
-                        free(networkAddressCache[index].uri);
-                        networkAddressCache[index].uri = NULL;
-                    }
-                    else
-                    {
-                        Lwm2m_Debug("Address free\n");
-                    }
-                    networkAddressCache[index].address = NULL;
-                    break;
-                }
+                Lwm2m_Debug("Address free: %s\n", (*address)->Uri);
+                HashTable_Remove(&addressCacheByUri, &(*address)->UriNode);
+                free((*address)->Uri);
+            }
+            else
+            {
+                Lwm2m_Debug("Address free\n");
             }
             free(*address);
         }
@@ -383,52 +470,71 @@ bool NetworkAddress_IsSecure(const NetworkAddress * address)
     return result;
 }
 
+bool NetworkAddress_IsReliable(const NetworkAddress * address)
+{
+    bool result = false;
+    if (address)
+    {
+        result = address->Reliable;
+    }
+    return result;
+}
+
+static bool matchCachedAddress(const HashTableNode * node, const void * key)
+{
+    return NetworkAddress_Compare(HashTableEntry(node, NetworkAddress, Node), (NetworkAddress *)key) == 0;
+}
+
+typedef struct
+{
+    const char * Uri;
+    int UriLength;
+} UriKey;
+
+// The whole of the scheme and authority must match - "coap://host:5683" is not "coap://host:56830"
+static bool matchCachedUri(const HashTableNode * node, const void * key)
+{
+    const NetworkAddress * address = HashTableEntry(node, NetworkAddress, UriNode);
+    const UriKey * uriKey = (const UriKey *)key;
+    return (strncmp(address->Uri, uriKey->Uri, uriKey->UriLength) == 0) && (address->Uri[uriKey->UriLength] == '\0');
+}
+
+static void setCachedUri(NetworkAddress * address, const char * uri, int uriLength)
+{
+    address->Uri = (char *)malloc(uriLength + 1);
+    if (address->Uri)
+    {
+        memcpy(address->Uri, uri, uriLength);
+        address->Uri[uriLength] = 0;
+        HashTable_Add(&addressCacheByUri, &address->UriNode, Hash_Bytes(uri, uriLength, HASH_SEED));
+        Lwm2m_Debug("Address add: %s\n", address->Uri);
+    }
+}
+
 static void addCachedAddress(NetworkAddress * address, const char * uri, int uriLength)
 {
     if (address)
     {
-        int index;
-        for (index = 0; index < MAX_NETWORK_ADDRESS_CACHE; index++)
+        HashTable_Add(&addressCache, &address->Node, NetworkAddress_Hash(address));
+        if (uri && uriLength > 0)
         {
-            if (networkAddressCache[index].address == NULL)
-            {
-                if (uri && uriLength > 0)
-                {
-                    networkAddressCache[index].uri = (char *)malloc(uriLength + 1);
-                    if (networkAddressCache[index].uri)
-                    {
-                        memcpy(networkAddressCache[index].uri, uri, uriLength);
-                        networkAddressCache[index].uri[uriLength] = 0;
-                        networkAddressCache[index].address = address;
-                        Lwm2m_Debug("Address add: %s\n", networkAddressCache[index].uri);
-                    }
-                }
-                else
-                {
-                    networkAddressCache[index].address = address;
-                    networkAddressCache[index].uri = NULL;
-                    Lwm2m_Debug("Address add (received)\n");    // TODO - print remote address
-                }
-                break;
-            }
+            setCachedUri(address, uri, uriLength);
+        }
+        else
+        {
+            Lwm2m_Debug("Address add (received)\n");    // TODO - print remote address
         }
     }
 }
 
-
-
 static NetworkAddress * getCachedAddressByUri(const char * uri, int uriLength)
 {
     NetworkAddress * result = NULL;
-    int index;
-    for (index = 0; index < MAX_NETWORK_ADDRESS_CACHE; index++)
+    UriKey key = { .Uri = uri, .UriLength = uriLength };
+    HashTableNode * node = HashTable_Find(&addressCacheByUri, Hash_Bytes(uri, uriLength, HASH_SEED), matchCachedUri, &key);
+    if (node != NULL)
     {
-        if (networkAddressCache[index].uri && (memcmp(networkAddressCache[index].uri, uri, uriLength) == 0))
-        {
-            //Lwm2m_Debug("Address uri matched: %s\n", networkAddressCache[index].uri);
-            result = networkAddressCache[index].address;
-            break;
-        }
+        result = HashTableEntry(node, NetworkAddress, UriNode);
     }
     return result;
 }
@@ -436,29 +542,15 @@ static NetworkAddress * getCachedAddressByUri(const char * uri, int uriLength)
 static NetworkAddress * getCachedAddress(NetworkAddress * matchAddress, const char * uri, int uriLength)
 {
     NetworkAddress * result = NULL;
-    int index;
-    for (index = 0; index < MAX_NETWORK_ADDRESS_CACHE; index++)
+    HashTableNode * node = HashTable_Find(&addressCache, NetworkAddress_Hash(matchAddress), matchCachedAddress, matchAddress);
+    if (node != NULL)
     {
-        NetworkAddress * address = networkAddressCache[index].address;
-        if (address)
+        result = HashTableEntry(node, NetworkAddress, Node);
+        if (uri && uriLength > 0 && result->Uri == NULL)
         {
-            if (NetworkAddress_Compare(matchAddress, address) == 0)
-            {
-                if (uri && uriLength > 0 && networkAddressCache[index].uri == NULL)
-                {
-                    // Add info to cached address
-                    address->Secure = matchAddress->Secure;
-                    networkAddressCache[index].uri = (char *)malloc(uriLength + 1);
-                    if (networkAddressCache[index].uri)
-                    {
-                        memcpy(networkAddressCache[index].uri, uri, uriLength);
-                        networkAddressCache[index].uri[uriLength] = 0;
-                        Lwm2m_Debug("Address add uri: %s\n", networkAddressCache[index].uri);
-                    }
-                }
-                result = address;
-                break;
-            }
+            // Add info to cached address
+            result->Secure = matchAddress->Secure;
+            setCachedUri(result, uri, uriLength);
         }
     }
     return result;
@@ -493,8 +585,16 @@ NetworkSocket * NetworkSocket_New(const char * ipAddress, NetworkSocketType sock
     if (result)
     {
         memset(result, 0, size);
+        result->Socket = SOCKET_ERROR;
+        result->SocketIPv6 = SOCKET_ERROR;
+        result->StreamSocket = SOCKET_ERROR;
+        result->StreamSocketIPv6 = SOCKET_ERROR;
+        result->Poll = SOCKET_ERROR;
         result->SocketType = socketType;
         result->Port = port;
+        result->MaxMessageSize = DEFAULT_MAX_MESSAGE_SIZE;
+        HashTable_Init(&result->Connections, 0);
+        ListInit(&result->PendingConnections);
         DTLS_SetNetworkSendCallback(SendDTLS);
         if (ipAddress && (*ipAddress != '\0'))
         {
@@ -521,7 +621,9 @@ int NetworkSocket_GetFileDescriptor(NetworkSocket * networkSocket)
     int result = -1;
     if (networkSocket)
     {
-        result = networkSocket->Socket;
+        result = networkSocket->Poll;
+        if (result == SOCKET_ERROR)
+            result = networkSocket->Socket;
         if (result == SOCKET_ERROR)
             result = networkSocket->SocketIPv6;
     }
@@ -539,6 +641,47 @@ void NetworkSocket_SetPSK(NetworkSocket * networkSocket, const char * identity,
     DTLS_SetPSK(identity, key, keyLength);
 }
 
+void NetworkSocket_SetMaxMessageSize(NetworkSocket * networkSocket, int maxMessageSize)
+{
+    if (networkSocket && (maxMessageSize >= DEFAULT_MAX_MESSAGE_SIZE))
+    {
+        networkSocket->MaxMessageSize = maxMessageSize;
+    }
+}
+
+static int openStreamSocket(int family, const struct sockaddr * address, socklen_t addressLength)
+{
+    int result = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (result != SOCKET_ERROR)
+    {
+        int yes = 1;
+        setsockopt(result, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (family == AF_INET6)
+        {
+            setsockopt(result, IPPROTO_IPV6, IPV6_V6ONLY, &yes, sizeof(yes));
+        }
+        if ((bind(result, address, addressLength) == SOCKET_ERROR) || (listen(result, SOMAXCONN) == SOCKET_ERROR))
+        {
+            Lwm2m_Debug("Failed to listen on %s stream socket\n", (family == AF_INET6) ? "ip6" : "ip4");
+            close(result);
+            result = SOCKET_ERROR;
+        }
+    }
+    return result;
+}
+
+static void watchSocket(NetworkSocket * networkSocket, int socketHandle, void * owner)
+{
+    if ((networkSocket->Poll != SOCKET_ERROR) && (socketHandle != SOCKET_ERROR))
+    {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = owner;
+        epoll_ctl(networkSocket->Poll, EPOLL_CTL_ADD, socketHandle, &event);
+    }
+}
+
 
 bool NetworkSocket_StartListening(NetworkSocket * networkSocket)
 {
@@ -547,11 +690,6 @@ bool NetworkSocket_StartListening(NetworkSocket * networkSocket)
     {
         int protocol = IPPROTO_UDP;
         int socketMode = SOCK_DGRAM;
-        if ((networkSocket->SocketType & NetworkSocketType_TCP) == NetworkSocketType_TCP)
-        {
-            protocol = IPPROTO_TCP;
-            socketMode = SOCK_STREAM;
-        }
         struct sockaddr_in ip4AnyAddress;
         struct sockaddr_in6 ip6AnyAddress;
 
@@ -639,10 +777,666 @@ bool NetworkSocket_StartListening(NetworkSocket * networkSocket)
                 }
             }
         }
+
+        // CoAP over TCP connections are accepted on the same port
+        if ((networkSocket->SocketType & NetworkSocketType_TCP) == NetworkSocketType_TCP)
+        {
+            if ((networkSocket->SocketType & NetworkSocketType_Secure) == NetworkSocketType_Secure)
+            {
+                Lwm2m_Error("CoAP over TLS is not supported - not accepting connections\n");
+            }
+            else
+            {
+                if (ip4Address)
+                    networkSocket->StreamSocket = openStreamSocket(AF_INET, (struct sockaddr *)ip4Address, sizeof(struct sockaddr_in));
+                if (ip6Address)
+                    networkSocket->StreamSocketIPv6 = openStreamSocket(AF_INET6, (struct sockaddr *)ip6Address, sizeof(struct sockaddr_in6));
+                if ((networkSocket->StreamSocket == SOCKET_ERROR) && (networkSocket->StreamSocketIPv6 == SOCKET_ERROR))
+                {
+                    Lwm2m_Error("Failed to listen for connections on port %d\n", networkSocket->Port);
+                    result = false;
+                }
+            }
+        }
+
+        // The sockets and connections are all watched through one file descriptor
+        networkSocket->Poll = epoll_create1(EPOLL_CLOEXEC);
+        watchSocket(networkSocket, networkSocket->Socket, &networkSocket->Socket);
+        watchSocket(networkSocket, networkSocket->SocketIPv6, &networkSocket->SocketIPv6);
+        watchSocket(networkSocket, networkSocket->StreamSocket, &networkSocket->StreamSocket);
+        watchSocket(networkSocket, networkSocket->StreamSocketIPv6, &networkSocket->StreamSocketIPv6);
+    }
+    return result;
+}
+
+// Addresses of peers are kept in the address cache, so that each message from a peer has the same address
+static NetworkAddress * getReceivedAddress(NetworkAddress * matchAddress)
+{
+    NetworkAddress * networkAddress = getCachedAddress(matchAddress, NULL, 0);
+    if (networkAddress == NULL)
+    {
+        size_t size = sizeof(struct _NetworkAddress);
+        networkAddress = (NetworkAddress *)malloc(size);
+        if (networkAddress)
+        {
+            // Add new address to cache (note: uri and secure is unknown)
+            memcpy(networkAddress, matchAddress, size);
+            networkAddress->Uri = NULL;
+            addCachedAddress(networkAddress, NULL, 0);
+            networkAddress->useCount++;         // TODO - ensure addresses are freed? (after t/o or transaction or DTLS session closed)
+        }
+    }
+    return networkAddress;
+}
+
+static bool matchConnection(const HashTableNode * node, const void * key)
+{
+    return NetworkAddress_Compare(HashTableEntry(node, NetworkConnection, Node)->Address, (NetworkAddress *)key) == 0;
+}
+
+static NetworkConnection * findConnection(NetworkSocket * networkSocket, NetworkAddress * address)
+{
+    NetworkConnection * result = NULL;
+    HashTableNode * node = HashTable_Find(&networkSocket->Connections, NetworkAddress_Hash(address), matchConnection, address);
+    if (node != NULL)
+    {
+        result = HashTableEntry(node, NetworkConnection, Node);
+    }
+    return result;
+}
+
+static void closeConnection(NetworkSocket * networkSocket, NetworkConnection * connection)
+{
+    Lwm2m_Debug("Connection closed\n");
+    if (networkSocket->Poll != SOCKET_ERROR)
+    {
+        epoll_ctl(networkSocket->Poll, EPOLL_CTL_DEL, connection->Socket, NULL);
+    }
+    close(connection->Socket);
+    HashTable_Remove(&networkSocket->Connections, &connection->Node);
+    if (connection->IsPending)
+    {
+        ListRemove(&connection->Pending);
+    }
+    NetworkAddress_Free(&connection->Address);
+    free(connection->Input);
+    free(connection->Output);
+    free(connection);
+}
+
+static void watchConnection(NetworkSocket * networkSocket, NetworkConnection * connection, bool writing)
+{
+    if (connection->Writing != writing)
+    {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | (writing ? EPOLLOUT : 0);
+        event.data.ptr = connection;
+        epoll_ctl(networkSocket->Poll, EPOLL_CTL_MOD, connection->Socket, &event);
+        connection->Writing = writing;
+    }
+}
+
+static bool appendOutput(NetworkConnection * connection, const uint8_t * data, size_t length)
+{
+    bool result = true;
+    if (connection->OutputLength + length > connection->OutputSize)
+    {
+        size_t size = connection->OutputLength + length + STREAM_READ_SIZE;
+        uint8_t * output = (size <= MAX_STREAM_OUTPUT) ? (uint8_t *)realloc(connection->Output, size) : NULL;
+        if (output != NULL)
+        {
+            connection->Output = output;
+            connection->OutputSize = size;
+        }
+        else
+        {
+            result = false;
+        }
+    }
+    if (result)
+    {
+        memcpy(&connection->Output[connection->OutputLength], data, length);
+        connection->OutputLength += length;
+    }
+    return result;
+}
+
+// Write as much of the kept output as the socket takes. Returns false if the connection failed (and has been closed).
+static bool flushOutput(NetworkSocket * networkSocket, NetworkConnection * connection)
+{
+    bool result = true;
+    if (connection->Connected && (connection->OutputLength > 0))
+    {
+        int sentBytes = send(connection->Socket, connection->Output, connection->OutputLength, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sentBytes > 0)
+        {
+            connection->OutputLength -= sentBytes;
+            memmove(connection->Output, &connection->Output[sentBytes], connection->OutputLength);
+        }
+        else if ((sentBytes == SOCKET_ERROR) && (errno != EWOULDBLOCK) && (errno != EAGAIN))
+        {
+            closeConnection(networkSocket, connection);
+            result = false;
+        }
+    }
+    if (result)
+    {
+        watchConnection(networkSocket, connection, !connection->Connected || (connection->OutputLength > 0));
+    }
+    return result;
+}
+
+// CoAP over TCP frames a message with its length, in place of the version, type and message ID of a datagram (RFC 8323
+// section 3.2). Writes the frame header (up to the token) for a message with length bytes of options and payload.
+static int writeStreamHeader(uint8_t * header, uint8_t tokenLength, uint8_t code, size_t length)
+{
+    int headerLength = 1;
+    if (length < 13)
+    {
+        header[0] = (length << 4) | tokenLength;
+    }
+    else if (length < 269)
+    {
+        header[0] = (13 << 4) | tokenLength;
+        header[headerLength++] = length - 13;
+    }
+    else if (length < 65805)
+    {
+        header[0] = (14 << 4) | tokenLength;
+        header[headerLength++] = (length - 269) >> 8;
+        header[headerLength++] = (length - 269);
+    }
+    else
+    {
+        header[0] = (15 << 4) | tokenLength;
+        header[headerLength++] = (length - 65805) >> 24;
+        header[headerLength++] = (length - 65805) >> 16;
+        header[headerLength++] = (length - 65805) >> 8;
+        header[headerLength++] = (length - 65805);
+    }
+    header[headerLength++] = code;
+    return headerLength;
+}
+
+// Length of the message framed at the start of data, or 0 if not all of its frame header has arrived yet
+static size_t getStreamMessageLength(const uint8_t * data, size_t available, size_t * headerLength)
+{
+    size_t result = 0;
+    if (available > 0)
+    {
+        uint8_t length = data[0] >> 4;
+        size_t extendedLength = (length == 13) ? 1 : (length == 14) ? 2 : (length == 15) ? 4 : 0;
+        if (available >= extendedLength + 2)
+        {
+            size_t optionsLength = length;
+            if (length == 13)
+                optionsLength = 13 + data[1];
+            else if (length == 14)
+                optionsLength = 269 + ((data[1] << 8) | data[2]);
+            else if (length == 15)
+                optionsLength = 65805 + (((uint32_t)data[1] << 24) | ((uint32_t)data[2] << 16) | (data[3] << 8) | data[4]);
+            *headerLength = extendedLength + 2;
+            result = *headerLength + (data[0] & 0x0F) + optionsLength;
+        }
     }
     return result;
 }
 
+// Returns false if the connection failed, including if the signal could not be kept to send, and has been closed
+static bool sendSignal(NetworkSocket * networkSocket, NetworkConnection * connection, uint8_t code, const uint8_t * token,
+                       uint8_t tokenLength, const uint8_t * options, size_t optionsLength)
+{
+    uint8_t header[MAX_STREAM_HEADER_LENGTH];
+    int headerLength = writeStreamHeader(header, tokenLength, code, optionsLength);
+    if (!(appendOutput(connection, header, headerLength) && appendOutput(connection, token, tokenLength) &&
+          appendOutput(connection, options, optionsLength)))
+    {
+        Lwm2m_Error("Failed to send signal %d.%02d - closing connection\n", code >> 5, code & 0x1F);
+        closeConnection(networkSocket, connection);
+        return false;
+    }
+    return flushOutput(networkSocket, connection);
+}
+
+// Each side starts with a Capabilities and Settings Message, giving the largest message it takes and that it takes BERT blocks
+static bool sendCSM(NetworkSocket * networkSocket, NetworkConnection * connection)
+{
+    uint8_t options[8];
+    size_t length = 0;
+    uint32_t maxMessageSize = networkSocket->MaxMessageSize;
+    int valueLength = (maxMessageSize > 0xFFFFFF) ? 4 : (maxMessageSize > 0xFFFF) ? 3 : 2;
+    int index;
+
+    options[length++] = (CSM_OPTION_MAX_MESSAGE_SIZE << 4) | valueLength;
+    for (index = valueLength - 1; index >= 0; index--)
+    {
+        options[length++] = maxMessageSize >> (index * 8);
+    }
+    options[length++] = (CSM_OPTION_BLOCKWISE_TRANSFER - CSM_OPTION_MAX_MESSAGE_SIZE) << 4;
+    return sendSignal(networkSocket, connection, SIGNAL_CODE_CSM, NULL, 0, options, length);
+}
+
+static void handleCSM(NetworkConnection * connection, const uint8_t * option, const uint8_t * end)
+{
+    unsigned int number = 0;
+    while ((option < end) && (*option != 0xFF))
+    {
+        unsigned int delta = option[0] >> 4;
+        size_t length = option[0] & 0x0F;
+        option++;
+        if ((delta > 13) || (length > 13) || (option + (delta == 13) + (length == 13) > end))
+        {
+            // No option of a CSM needs a longer delta or value
+            break;
+        }
+        if (delta == 13)
+            delta += *option++;
+        if (length == 13)
+            length += *option++;
+        if (option + length > end)
+            break;
+
+        number += delta;
+        if (number == CSM_OPTION_MAX_MESSAGE_SIZE)
+        {
+            uint32_t value = 0;
+            size_t index;
+            for (index = 0; index < length; index++)
+            {
+                value = (value << 8) | option[index];
+            }
+            connection->PeerMaxMessageSize = (value > INT32_MAX) ? INT32_MAX : (int)value;
+        }
+        else if (number == CSM_OPTION_BLOCKWISE_TRANSFER)
+        {
+            connection->PeerBlockwise = true;
+        }
+        option += length;
+    }
+}
+
+// Signalling messages are handled here, and never passed on. Returns false if the connection is closed.
+static bool handleSignal(NetworkSocket * networkSocket, NetworkConnection * connection, const uint8_t * message, size_t headerLength, size_t length)
+{
+    bool result = true;
+    uint8_t code = message[headerLength - 1];
+    uint8_t tokenLength = message[0] & 0x0F;
+    const uint8_t * token = &message[headerLength];
+
+    switch (code)
+    {
+    case SIGNAL_CODE_CSM:
+        handleCSM(connection, token + tokenLength, message + length);
+        break;
+    case SIGNAL_CODE_PING:
+        result = sendSignal(networkSocket, connection, SIGNAL_CODE_PONG, token, tokenLength, NULL, 0);
+        break;
+    case SIGNAL_CODE_RELEASE:
+    case SIGNAL_CODE_ABORT:
+        closeConnection(networkSocket, connection);
+        result = false;
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+
+// Handle the signalling messages at the start of the input, and note whether a whole message follows them. Returns false
+// if the connection is closed.
+static bool processInput(NetworkSocket * networkSocket, NetworkConnection * connection)
+{
+    bool result = true;
+    bool pending = false;
+    while (result)
+    {
+        size_t headerLength = 0;
+        const uint8_t * message = &connection->Input[connection->InputStart];
+        size_t available = connection->InputLength - connection->InputStart;
+        size_t length = getStreamMessageLength(message, available, &headerLength);
+        if ((length > (size_t)networkSocket->MaxMessageSize))
+        {
+            Lwm2m_Error("Message of %zu bytes is too large - closing connection\n", length);
+            if (sendSignal(networkSocket, connection, SIGNAL_CODE_ABORT, NULL, 0, NULL, 0))
+            {
+                closeConnection(networkSocket, connection);
+            }
+            result = false;
+        }
+        else if ((length == 0) || (length > available))
+        {
+            break;
+        }
+        else if ((message[headerLength - 1] & SIGNAL_CODE_CLASS) == SIGNAL_CODE_CLASS)
+        {
+            connection->InputStart += length;
+            result = handleSignal(networkSocket, connection, message, headerLength, length);
+        }
+        else
+        {
+            pending = true;
+            break;
+        }
+    }
+
+    if (result && (pending != connection->IsPending))
+    {
+        if (pending)
+            ListAdd(&connection->Pending, &networkSocket->PendingConnections);
+        else
+            ListRemove(&connection->Pending);
+        connection->IsPending = pending;
+    }
+    return result;
+}
+
+static void receiveStream(NetworkSocket * networkSocket, NetworkConnection * connection)
+{
+    // Keep the start of the input at the start of the buffer, so that a whole message always fits
+    if (connection->InputStart > 0)
+    {
+        connection->InputLength -= connection->InputStart;
+        memmove(connection->Input, &connection->Input[connection->InputStart], connection->InputLength);
+        connection->InputStart = 0;
+    }
+    if (connection->InputSize - connection->InputLength < STREAM_READ_SIZE)
+    {
+        size_t size = connection->InputLength + STREAM_READ_SIZE;
+        uint8_t * input = (uint8_t *)realloc(connection->Input, size);
+        if (input == NULL)
+        {
+            closeConnection(networkSocket, connection);
+            return;
+        }
+        connection->Input = input;
+        connection->InputSize = size;
+    }
+
+    errno = 0;
+    int readLength = recv(connection->Socket, &connection->Input[connection->InputLength], connection->InputSize - connection->InputLength, MSG_DONTWAIT);
+    if (readLength > 0)
+    {
+        connection->InputLength += readLength;
+        processInput(networkSocket, connection);
+    }
+    else if ((readLength == 0) || ((errno != EWOULDBLOCK) && (errno != EAGAIN)))
+    {
+        closeConnection(networkSocket, connection);
+    }
+}
+
+static NetworkConnection * newConnection(NetworkSocket * networkSocket, int socketHandle, NetworkAddress * address, bool connected)
+{
+    NetworkConnection * connection = (NetworkConnection *)malloc(sizeof(NetworkConnection));
+    if (connection)
+    {
+        int yes = 1;
+        struct epoll_event event;
+        memset(connection, 0, sizeof(NetworkConnection));
+        connection->Socket = socketHandle;
+        connection->Address = address;
+        connection->Connected = connected;
+        connection->Writing = !connected;
+        connection->PeerMaxMessageSize = DEFAULT_MAX_MESSAGE_SIZE;
+        address->useCount++;
+        setsockopt(socketHandle, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | (connected ? 0 : EPOLLOUT);
+        event.data.ptr = connection;
+        epoll_ctl(networkSocket->Poll, EPOLL_CTL_ADD, socketHandle, &event);
+        HashTable_Add(&networkSocket->Connections, &connection->Node, NetworkAddress_Hash(address));
+
+        if (!sendCSM(networkSocket, connection))
+        {
+            // the connection has been closed
+            connection = NULL;
+        }
+    }
+    else
+    {
+        close(socketHandle);
+    }
+    return connection;
+}
+
+static void acceptConnections(NetworkSocket * networkSocket, int listenSocket)
+{
+    struct sockaddr_storage peerSocket;
+    socklen_t peerSocketLength = sizeof(peerSocket);
+    int socketHandle;
+    while ((socketHandle = accept4(listenSocket, (struct sockaddr *)&peerSocket, &peerSocketLength, SOCK_NONBLOCK | SOCK_CLOEXEC)) != SOCKET_ERROR)
+    {
+        NetworkAddress matchAddress;
+        NetworkAddress * address;
+        memset(&matchAddress, 0, sizeof(matchAddress));
+        memcpy(&matchAddress.Address.Sa, &peerSocket, peerSocketLength);
+        matchAddress.Reliable = true;
+        address = getReceivedAddress(&matchAddress);
+        if (address)
+        {
+            NetworkConnection * previous = findConnection(networkSocket, address);
+            if (previous)
+            {
+                closeConnection(networkSocket, previous);
+            }
+            Lwm2m_Debug("Connection accepted\n");
+            newConnection(networkSocket, socketHandle, address, true);
+        }
+        else
+        {
+            close(socketHandle);
+        }
+        peerSocketLength = sizeof(peerSocket);
+    }
+}
+
+static NetworkConnection * openConnection(NetworkSocket * networkSocket, NetworkAddress * address)
+{
+    NetworkConnection * connection = NULL;
+    if (address->Secure)
+    {
+        Lwm2m_Error("CoAP over TLS is not supported\n");
+    }
+    else if (networkSocket->Poll != SOCKET_ERROR)
+    {
+        int socketHandle = socket(address->Address.Sa.sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (socketHandle != SOCKET_ERROR)
+        {
+            socklen_t addressLength = (address->Address.Sa.sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+            if (connect(socketHandle, &address->Address.Sa, addressLength) == 0)
+            {
+                connection = newConnection(networkSocket, socketHandle, address, true);
+            }
+            else if (errno == EINPROGRESS)
+            {
+                connection = newConnection(networkSocket, socketHandle, address, false);
+            }
+            else
+            {
+                Lwm2m_Error("Failed to connect: %s\n", strerror(errno));
+                close(socketHandle);
+            }
+        }
+    }
+    return connection;
+}
+
+static void handleConnectionEvent(NetworkSocket * networkSocket, NetworkConnection * connection, uint32_t events)
+{
+    if (!connection->Connected && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+    {
+        int error = 0;
+        socklen_t errorLength = sizeof(error);
+        if ((getsockopt(connection->Socket, SOL_SOCKET, SO_ERROR, &error, &errorLength) == SOCKET_ERROR) || (error != 0))
+        {
+            Lwm2m_Error("Failed to connect: %s\n", strerror(error));
+            closeConnection(networkSocket, connection);
+            return;
+        }
+        connection->Connected = true;
+    }
+    if ((events & EPOLLOUT) && !flushOutput(networkSocket, connection))
+    {
+        return;
+    }
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+    {
+        receiveStream(networkSocket, connection);
+    }
+}
+
+// Read a message received over a connection. It is passed on in the form of a non-confirmable datagram, with no message
+// ID, so that it is handled as one that came over UDP.
+static bool readStream(NetworkSocket * networkSocket, uint8_t * buffer, int bufferLength, NetworkAddress ** sourceAddress, int *readLength)
+{
+    if (ListEmpty(&networkSocket->PendingConnections))
+    {
+        struct epoll_event events[MAX_NETWORK_EVENTS];
+        int count = epoll_wait(networkSocket->Poll, events, MAX_NETWORK_EVENTS, 0);
+        int index;
+        for (index = 0; index < count; index++)
+        {
+            void * owner = events[index].data.ptr;
+            if (owner == &networkSocket->StreamSocket)
+            {
+                acceptConnections(networkSocket, networkSocket->StreamSocket);
+            }
+            else if (owner == &networkSocket->StreamSocketIPv6)
+            {
+                acceptConnections(networkSocket, networkSocket->StreamSocketIPv6);
+            }
+            else if ((owner != &networkSocket->Socket) && (owner != &networkSocket->SocketIPv6))
+            {
+                // A connection closed by an earlier event is no longer in the epoll set, and has no events after it
+                handleConnectionEvent(networkSocket, (NetworkConnection *)owner, events[index].events);
+            }
+        }
+    }
+
+    if (!ListEmpty(&networkSocket->PendingConnections))
+    {
+        NetworkConnection * connection = ListEntry(networkSocket->PendingConnections.Next, NetworkConnection, Pending);
+        const uint8_t * message = &connection->Input[connection->InputStart];
+        size_t headerLength = 0;
+        size_t length = getStreamMessageLength(message, connection->InputLength - connection->InputStart, &headerLength);
+        uint8_t tokenLength = message[0] & 0x0F;
+
+        if (length - headerLength + DATAGRAM_HEADER_LENGTH > (size_t)bufferLength)
+        {
+            Lwm2m_Error("Message of %zu bytes is too large - closing connection\n", length);
+            closeConnection(networkSocket, connection);
+        }
+        else
+        {
+            buffer[0] = (1 << 6) | (1 << 4) | tokenLength;      // version 1, non-confirmable
+            buffer[1] = message[headerLength - 1];
+            buffer[2] = 0;
+            buffer[3] = 0;
+            memcpy(&buffer[DATAGRAM_HEADER_LENGTH], &message[headerLength], length - headerLength);
+            *readLength = length - headerLength + DATAGRAM_HEADER_LENGTH;
+            *sourceAddress = connection->Address;
+            connection->InputStart += length;
+            processInput(networkSocket, connection);
+        }
+    }
+    return true;
+}
+
+// Send a message, given as a datagram, over the connection to destAddress - opening the connection if there is none
+static bool sendStream(NetworkSocket * networkSocket, NetworkAddress * destAddress, const uint8_t * buffer, int bufferLength)
+{
+    bool result = false;
+    uint8_t tokenLength = buffer[0] & 0x0F;
+    if ((bufferLength < DATAGRAM_HEADER_LENGTH) || (bufferLength < DATAGRAM_HEADER_LENGTH + tokenLength))
+    {
+        networkSocket->LastError = NetworkSocketError_InvalidArguments;
+    }
+    else if (buffer[1] == 0)
+    {
+        // Empty messages (acknowledgements and resets) have no use on a reliable transport
+        result = true;
+    }
+    else
+    {
+        NetworkConnection * connection = findConnection(networkSocket, destAddress);
+        if (connection == NULL)
+        {
+            connection = openConnection(networkSocket, destAddress);
+        }
+        if (connection != NULL)
+        {
+            uint8_t header[MAX_STREAM_HEADER_LENGTH];
+            size_t headerLength = writeStreamHeader(header, tokenLength, buffer[1], bufferLength - DATAGRAM_HEADER_LENGTH - tokenLength);
+            const uint8_t * body = &buffer[DATAGRAM_HEADER_LENGTH];
+            size_t bodyLength = bufferLength - DATAGRAM_HEADER_LENGTH;
+            size_t sentBytes = 0;
+
+            if (connection->Connected && (connection->OutputLength == 0))
+            {
+                // Nothing is waiting to be written, so try to send the message straight away
+                struct iovec parts[2] = { { header, headerLength }, { (void *)body, bodyLength } };
+                struct msghdr message;
+                memset(&message, 0, sizeof(message));
+                message.msg_iov = parts;
+                message.msg_iovlen = 2;
+                int sent = sendmsg(connection->Socket, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (sent > 0)
+                {
+                    sentBytes = sent;
+                }
+                else if ((sent == SOCKET_ERROR) && (errno != EWOULDBLOCK) && (errno != EAGAIN))
+                {
+                    closeConnection(networkSocket, connection);
+                    connection = NULL;
+                }
+            }
+
+            if (connection != NULL)
+            {
+                // Keep the rest until the socket is writable
+                if (sentBytes < headerLength)
+                {
+                    result = appendOutput(connection, &header[sentBytes], headerLength - sentBytes) && appendOutput(connection, body, bodyLength);
+                }
+                else
+                {
+                    result = appendOutput(connection, &body[sentBytes - headerLength], bodyLength - (sentBytes - headerLength));
+                }
+                watchConnection(networkSocket, connection, !connection->Connected || (connection->OutputLength > 0));
+            }
+        }
+        if (!result)
+        {
+            networkSocket->LastError = NetworkSocketError_SendError;
+        }
+    }
+    return result;
+}
+
+int NetworkSocket_GetMaxMessageSize(NetworkSocket * networkSocket, NetworkAddress * destAddress)
+{
+    int result = DEFAULT_MAX_MESSAGE_SIZE;
+    NetworkConnection * connection = (networkSocket && destAddress) ? findConnection(networkSocket, destAddress) : NULL;
+    if (connection)
+    {
+        result = connection->PeerMaxMessageSize;
+    }
+    return result;
+}
+
+bool NetworkSocket_IsBlockwiseSupported(NetworkSocket * networkSocket, NetworkAddress * destAddress)
+{
+    NetworkConnection * connection = (networkSocket && destAddress) ? findConnection(networkSocket, destAddress) : NULL;
+    return connection && connection->PeerBlockwise;
+}
+
+bool NetworkSocket_HasPendingMessages(NetworkSocket * networkSocket)
+{
+    return networkSocket && !ListEmpty(&networkSocket->PendingConnections);
+}
+
 bool readUDP(NetworkSocket * networkSocket, int socketHandle, uint8_t * buffer, int bufferLength, NetworkAddress ** sourceAddress, int *readLength)
 {
     bool result = false;
@@ -669,23 +1463,10 @@ bool readUDP(NetworkSocket * networkSocket, int socketHandle, uint8_t * buffer,
     {
         NetworkAddress * networkAddress = NULL;
         NetworkAddress matchAddress;
-        size_t size = sizeof(struct _NetworkAddress);
-        memset(&matchAddress, 0, size);
+        memset(&matchAddress, 0, sizeof(matchAddress));
         memcpy(&matchAddress.Address.Sa, &sourceSocket, sourceSocketLength);
         matchAddress.Secure = (networkSocket->SocketType & NetworkSocketType_Secure) == NetworkSocketType_Secure;
-        networkAddress = getCachedAddress(&matchAddress, NULL, 0);
-
-        if (networkAddress == NULL)
-        {
-            networkAddress = (NetworkAddress *)malloc(size);
-            if (networkAddress)
-            {
-                // Add new address to cache (note: uri and secure is unknown)
-                memcpy(networkAddress, &matchAddress, size);
-                addCachedAddress(networkAddress, NULL, 0);
-                networkAddress->useCount++;         // TODO - ensure addresses are freed? (after t/o or transaction or DTLS session closed)
-            }
-        }
+        networkAddress = getReceivedAddress(&matchAddress);
         if (networkAddress)
         {
             *sourceAddress = networkAddress;
@@ -736,24 +1517,11 @@ bool NetworkSocket_Read(NetworkSocket * networkSocket, uint8_t * buffer, int buf
                     networkSocket->LastError = NetworkSocketError_InvalidArguments;
                 }
             }
-            else
+            if ((*readLength == 0) && sourceAddress && (networkSocket->Poll != SOCKET_ERROR))
             {
-                errno = 0;
-                *readLength = recv(networkSocket->Socket, buffer, bufferLength, 0);
-                int lastError = errno;
-                if (*readLength == 0)
-                {
-                    networkSocket->LastError = NetworkSocketError_ConnectionLost;
-                }
-                else if (*readLength == SOCKET_ERROR)
+                if (readStream(networkSocket, buffer, bufferLength, sourceAddress, readLength))
                 {
-                    *readLength = 0;
-                    if (lastError == EWOULDBLOCK)
-                        *readLength = 0;
-                    else if (lastError == ENOTCONN)
-                        networkSocket->LastError = NetworkSocketError_ConnectionLost;
-                    else if (lastError == EBADF)
-                        networkSocket->LastError = NetworkSocketError_ConnectionLost;
+                    result = true;
                 }
             }
         }
@@ -815,7 +1583,11 @@ bool NetworkSocket_Send(NetworkSocket * networkSocket, NetworkAddress * destAddr
         networkSocket->LastError = NetworkSocketError_NoError;
         if (buffer && bufferLength > 0)
         {
-            if ((networkSocket->SocketType & NetworkSocketType_UDP) == NetworkSocketType_UDP)
+            if (destAddress && destAddress->Reliable)
+            {
+                result = sendStream(networkSocket, destAddress, buffer, bufferLength);
+            }
+            else if ((networkSocket->SocketType & NetworkSocketType_UDP) == NetworkSocketType_UDP)
             {
                 if (destAddress)
                 {
@@ -855,10 +1627,24 @@ void NetworkSocket_Free(NetworkSocket ** networkSocket)
 {
     if (networkSocket && *networkSocket)
     {
+        HashTableNode * node;
+        HashTableNode * next;
+        size_t bucket;
+        HashTableForEachSafe(node, next, bucket, &(*networkSocket)->Connections)
+        {
+            closeConnection(*networkSocket, HashTableEntry(node, NetworkConnection, Node));
+        }
+        HashTable_Destroy(&(*networkSocket)->Connections);
         if ((*networkSocket)->Socket != SOCKET_ERROR)
             close((*networkSocket)->Socket);
         if ((*networkSocket)->SocketIPv6 != SOCKET_ERROR)
             close((*networkSocket)->SocketIPv6);
+        if ((*networkSocket)->StreamSocket != SOCKET_ERROR)
+            close((*networkSocket)->StreamSocket);
+        if ((*networkSocket)->StreamSocketIPv6 != SOCKET_ERROR)
+            close((*networkSocket)->StreamSocketIPv6);
+        if ((*networkSocket)->Poll != SOCKET_ERROR)
+            close((*networkSocket)->Poll);
         if ((*networkSocket)->BindAddress)
             NetworkAddress_Free(&(*networkSocket)->BindAddress);
         free(*networkSocket);
@@ -0,0 +1,173 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "er-coap-block2.h"
+#include "../common/lwm2m_metrics.h"
+#include "../common/lwm2m_util.h"
+
+typedef struct
+{
+    NetworkAddress * remoteAddress;
+    const char * uri;
+} coap_block2_key_t;
+
+static HashTable responses = {0};
+static Heap expiries = {0};
+static uint32_t next_etag = 0;
+static uint32_t served_etag = 0;
+
+static uint32_t coap_block2_hash(NetworkAddress * remoteAddress, const char * uri)
+{
+    return Hash_Bytes(uri, strlen(uri), NetworkAddress_Hash(remoteAddress));
+}
+
+static bool coap_block2_match(const HashTableNode * node, const void * key)
+{
+    const coap_block2_entry_t * entry = HashTableEntry(node, coap_block2_entry_t, node);
+    const coap_block2_key_t * k = (const coap_block2_key_t *)key;
+    return (strcmp(entry->uri, k->uri) == 0) &&
+            ((entry->remoteAddress == k->remoteAddress) || (NetworkAddress_Compare(entry->remoteAddress, k->remoteAddress) == 0));
+}
+
+static void coap_block2_remove(coap_block2_entry_t * entry)
+{
+    HashTable_Remove(&responses, &entry->node);
+    Heap_Remove(&expiries, &entry->expiry);
+    free(entry);
+    Metrics_Decrement(Metric_CoapBlockCacheEntries);
+}
+
+static void coap_block2_expire(uint64_t now)
+{
+    HeapNode * node;
+    while (((node = Heap_Peek(&expiries)) != NULL) && (node->Key <= now))
+    {
+        coap_block2_remove(HeapEntry(node, coap_block2_entry_t, expiry));
+    }
+}
+
+void coap_init_block2(void)
+{
+    coap_destroy_block2();
+    HashTable_Init(&responses, 0);
+    Heap_Init(&expiries, 0);
+    next_etag = (uint32_t)random_rand();
+}
+
+void coap_destroy_block2(void)
+{
+    HeapNode * node;
+    while ((node = Heap_Peek(&expiries)) != NULL)
+    {
+        coap_block2_remove(HeapEntry(node, coap_block2_entry_t, expiry));
+    }
+    HashTable_Destroy(&responses);
+    Heap_Destroy(&expiries);
+}
+
+coap_block2_entry_t * coap_block2_find(NetworkAddress * remoteAddress, const char * uri)
+{
+    coap_block2_expire(Lwm2mCore_GetTickCountMs());
+
+    coap_block2_key_t key = { .remoteAddress = remoteAddress, .uri = uri };
+    HashTableNode * node = HashTable_Find(&responses, coap_block2_hash(remoteAddress, uri), coap_block2_match, &key);
+    return (node != NULL) ? HashTableEntry(node, coap_block2_entry_t, node) : NULL;
+}
+
+coap_block2_entry_t * coap_block2_add(NetworkAddress * remoteAddress, const char * uri, int content_format, const uint8_t * payload, size_t length)
+{
+    size_t uri_len = strlen(uri);
+    coap_block2_entry_t * entry = coap_block2_find(remoteAddress, uri);
+    if (entry != NULL)
+    {
+        coap_block2_remove(entry);
+    }
+
+    if (HashTable_Count(&responses) >= COAP_MAX_BLOCK2_ENTRIES)
+    {
+        coap_block2_remove(HeapEntry(Heap_Peek(&expiries), coap_block2_entry_t, expiry));
+    }
+
+    /* the URI is kept after the payload */
+    entry = (coap_block2_entry_t *)malloc(sizeof(*entry) + length + uri_len + 1);
+    if (entry != NULL)
+    {
+        memset(entry, 0, sizeof(*entry));
+        entry->remoteAddress = remoteAddress;
+        entry->uri = (char *)&entry->payload[length];
+        memcpy(entry->uri, uri, uri_len + 1);
+        entry->content_format = content_format;
+        entry->etag = ++next_etag;
+        entry->length = length;
+        memcpy(entry->payload, payload, length);
+
+        if (Heap_Push(&expiries, &entry->expiry, Lwm2mCore_GetTickCountMs() + COAP_BLOCK2_LIFETIME_MS))
+        {
+            HashTable_Add(&responses, &entry->node, coap_block2_hash(remoteAddress, uri));
+            Metrics_Increment(Metric_CoapBlockCacheEntries);
+        }
+        else
+        {
+            free(entry);
+            entry = NULL;
+        }
+    }
+    return entry;
+}
+
+int32_t coap_block2_serve(coap_block2_entry_t * entry, void * response, uint32_t offset, uint16_t size, uint8_t * buffer)
+{
+    int32_t next_offset = -2;
+    if (offset < entry->length)
+    {
+        size_t length = MIN(entry->length - offset, size);
+        memcpy(buffer, &entry->payload[offset], length);
+        coap_set_bert_payload(response, buffer, length);
+        /* the entry is gone once its last block is served, so the ETag is kept until the response is serialised */
+        served_etag = entry->etag;
+        coap_set_header_etag(response, (const uint8_t *)&served_etag, sizeof(served_etag));
+        Metrics_Increment(Metric_CoapBlocksSent);
+
+        if (offset + length < entry->length)
+        {
+            next_offset = offset + length;
+            Heap_Update(&expiries, &entry->expiry, Lwm2mCore_GetTickCountMs() + COAP_BLOCK2_LIFETIME_MS);
+        }
+        else
+        {
+            next_offset = -1;
+            coap_block2_remove(entry);
+        }
+    }
+    return next_offset;
+}
+
+size_t coap_block2_count(void)
+{
+    return HashTable_Count(&responses);
+}
@@ -0,0 +1,70 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+
+#ifndef COAP_BLOCK2_H_
+#define COAP_BLOCK2_H_
+
+#include "er-coap.h"
+#include "er-coap-transactions.h"
+#include "network_abstraction.h"
+
+/*
+ * Blockwise responses (RFC 7959 Block2). A response too large for one block is serialised once and kept here,
+ * by remote address and request URI, so that the following blocks are served from the copy instead of handling
+ * the request again. An entry is forgotten once its last block has been sent, when no block has been requested
+ * for COAP_BLOCK2_LIFETIME_MS, or oldest first when the cache is full. Each entry carries an ETag so that the
+ * requester can tell when the representation changed between blocks.
+ */
+#define COAP_BLOCK2_LIFETIME_MS             COAP_MAX_TRANSMIT_WAIT_MS
+
+typedef struct
+{
+    HashTableNode node;
+    HeapNode expiry;
+    NetworkAddress * remoteAddress;
+    char * uri;
+    int content_format;
+    uint32_t etag;
+    size_t length;
+    uint8_t payload[];
+} coap_block2_entry_t;
+
+void coap_init_block2(void);
+void coap_destroy_block2(void);
+
+/* Keep a serialised response to the request for uri from remoteAddress, replacing any kept before */
+coap_block2_entry_t * coap_block2_add(NetworkAddress * remoteAddress, const char * uri, int content_format, const uint8_t * payload, size_t length);
+
+coap_block2_entry_t * coap_block2_find(NetworkAddress * remoteAddress, const char * uri);
+
+/* Copy the block of the response at offset into buffer and set it as the payload of response, along with the
+ * ETag of the entry. Returns the offset of the next block, or -1 if this was the last block (the entry is then
+ * forgotten). Returns -2 if offset is beyond the end of the response.
+ */
+int32_t coap_block2_serve(coap_block2_entry_t * entry, void * response, uint32_t offset, uint16_t size, uint8_t * buffer);
+
+size_t coap_block2_count(void);
+
+#endif /* COAP_BLOCK2_H_ */
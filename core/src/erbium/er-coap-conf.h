@@ -53,6 +53,51 @@
 #define COAP_MAX_OPEN_TRANSACTIONS     4
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
+/* The number of unacknowledged confirmable messages allowed to each peer (NSTART) - further messages are queued. */
+#ifndef COAP_NSTART
+#ifdef CONTIKI
+#define COAP_NSTART                    1
+#else
+#define COAP_NSTART                    4
+#endif
+#endif /* COAP_NSTART */
+
+/* The number of recently received requests remembered for duplicate detection. */
+#ifndef COAP_MAX_DEDUP_ENTRIES
+#ifdef CONTIKI
+#define COAP_MAX_DEDUP_ENTRIES         8
+#else
+#define COAP_MAX_DEDUP_ENTRIES         4096
+#endif
+#endif /* COAP_MAX_DEDUP_ENTRIES */
+
+/* The number of large responses kept for serving block by block (Block2), and the largest response or blockwise
+ * request payload that can be transferred. */
+#ifndef COAP_MAX_BLOCK2_ENTRIES
+#ifdef CONTIKI
+#define COAP_MAX_BLOCK2_ENTRIES        1
+#else
+#define COAP_MAX_BLOCK2_ENTRIES        64
+#endif
+#endif /* COAP_MAX_BLOCK2_ENTRIES */
+
+#ifndef COAP_MAX_BLOCKWISE_SIZE
+#ifdef CONTIKI
+#define COAP_MAX_BLOCKWISE_SIZE        2048
+#else
+#define COAP_MAX_BLOCKWISE_SIZE        (64 * 1024)
+#endif
+#endif /* COAP_MAX_BLOCKWISE_SIZE */
+
+/* The largest message accepted over a connection (CoAP over TCP), which bounds the size of a BERT block */
+#ifndef COAP_MAX_MESSAGE_SIZE_TCP
+#ifdef CONTIKI
+#define COAP_MAX_MESSAGE_SIZE_TCP      (COAP_MAX_HEADER_SIZE + 1024)
+#else
+#define COAP_MAX_MESSAGE_SIZE_TCP      (COAP_MAX_HEADER_SIZE + 16 * 1024)
+#endif
+#endif /* COAP_MAX_MESSAGE_SIZE_TCP */
+
 /* Maximum number of failed request attempts before action */
 #ifndef COAP_MAX_ATTEMPTS
 #define COAP_MAX_ATTEMPTS              4
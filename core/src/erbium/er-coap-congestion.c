@@ -0,0 +1,186 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "er-coap-congestion.h"
+#include "er-coap-transactions.h"
+#include "../common/lwm2m_util.h"
+
+#define STRONG_RTO_K        4
+#define WEAK_RTO_K          1
+
+static HashTable peers = {0};
+static Heap idlePeers = {0};
+
+static bool coap_congestion_match(const HashTableNode * node, const void * key)
+{
+    coap_peer_t * peer = HashTableEntry(node, coap_peer_t, node);
+    NetworkAddress * remoteAddress = (NetworkAddress *)key;
+    return (peer->remoteAddress == remoteAddress) || (NetworkAddress_Compare(peer->remoteAddress, remoteAddress) == 0);
+}
+
+static void coap_congestion_free_peer(coap_peer_t * peer)
+{
+    HashTable_Remove(&peers, &peer->node);
+    Heap_Remove(&idlePeers, &peer->idle_timer);
+    free(peer);
+}
+
+void coap_init_congestion(void)
+{
+    HeapNode * node;
+    while ((node = Heap_Pop(&idlePeers)) != NULL)
+    {
+        coap_congestion_free_peer(HeapEntry(node, coap_peer_t, idle_timer));
+    }
+    HashTable_Destroy(&peers);
+    HashTable_Init(&peers, 0);
+    Heap_Destroy(&idlePeers);
+    Heap_Init(&idlePeers, 0);
+}
+
+coap_peer_t * coap_congestion_find_peer(NetworkAddress * remoteAddress)
+{
+    HashTableNode * node = HashTable_Find(&peers, NetworkAddress_Hash(remoteAddress), coap_congestion_match, remoteAddress);
+    return (node != NULL) ? HashTableEntry(node, coap_peer_t, node) : NULL;
+}
+
+coap_peer_t * coap_congestion_peer(NetworkAddress * remoteAddress)
+{
+    coap_peer_t * peer = coap_congestion_find_peer(remoteAddress);
+    if (peer != NULL)
+    {
+        Heap_Remove(&idlePeers, &peer->idle_timer);
+    }
+    else
+    {
+        peer = (coap_peer_t *)malloc(sizeof(*peer));
+        if (peer != NULL)
+        {
+            memset(peer, 0, sizeof(*peer));
+            peer->remoteAddress = remoteAddress;
+            peer->rto = COAP_RESPONSE_TIMEOUT_MS;
+            peer->rto_updated = Lwm2mCore_GetTickCountMs();
+            HashTable_Add(&peers, &peer->node, NetworkAddress_Hash(remoteAddress));
+        }
+    }
+    return peer;
+}
+
+void coap_congestion_peer_idle(coap_peer_t * peer)
+{
+    if ((peer->in_flight == 0) && (peer->queue_head == NULL))
+    {
+        Heap_Update(&idlePeers, &peer->idle_timer, Lwm2mCore_GetTickCountMs() + COAP_PEER_STATE_LIFETIME_MS);
+    }
+}
+
+void coap_congestion_expire_peers(uint64_t now)
+{
+    HeapNode * node;
+    while (((node = Heap_Peek(&idlePeers)) != NULL) && (node->Key <= now))
+    {
+        coap_congestion_free_peer(HeapEntry(node, coap_peer_t, idle_timer));
+    }
+}
+
+uint32_t coap_congestion_initial_timeout(coap_peer_t * peer, uint8_t * backoff)
+{
+    uint32_t rto = COAP_RESPONSE_TIMEOUT_MS;
+    if (peer != NULL)
+    {
+        /* RTO aging - move estimates that have not been updated for a while back towards the default */
+        uint64_t now = Lwm2mCore_GetTickCountMs();
+        if ((peer->rto < 1000) && (now - peer->rto_updated > 16 * (uint64_t)peer->rto))
+        {
+            peer->rto *= 2;
+            peer->rto_updated = now;
+        }
+        else if ((peer->rto > 3000) && (now - peer->rto_updated > 4 * (uint64_t)peer->rto))
+        {
+            peer->rto = (peer->rto + COAP_RESPONSE_TIMEOUT_MS) / 2;
+            peer->rto_updated = now;
+        }
+        rto = peer->rto;
+    }
+
+    /* variable backoff factor - back off faster from a small RTO, and slower from a large one */
+    *backoff = (rto < 1000) ? 6 : ((rto > 3000) ? 3 : 4);
+
+    return rto + (rand() % ((uint32_t)(rto * ((float)COAP_RESPONSE_RANDOM_FACTOR - 1.0)) + 1));
+}
+
+uint32_t coap_congestion_backoff(uint32_t interval, uint8_t backoff)
+{
+    return (backoff > 0) ? (interval * backoff) / 2 : interval * 2;
+}
+
+static uint32_t coap_congestion_estimate(bool * valid, uint32_t * srtt, uint32_t * rttvar, uint32_t rtt, int k)
+{
+    if (!*valid)
+    {
+        *srtt = rtt;
+        *rttvar = rtt / 2;
+        *valid = true;
+    }
+    else
+    {
+        uint32_t delta = (*srtt > rtt) ? *srtt - rtt : rtt - *srtt;
+        *rttvar = ((3 * *rttvar) + delta) / 4;
+        *srtt = ((7 * *srtt) + rtt) / 8;
+    }
+    return *srtt + (k * *rttvar);
+}
+
+void coap_congestion_update_rto(coap_peer_t * peer, uint32_t rtt, uint8_t retransmissions)
+{
+    /* exchanges that needed more than two retransmissions are not used, as the RTT is too ambiguous */
+    if (retransmissions <= 2)
+    {
+        if (retransmissions == 0)
+        {
+            /* strong estimate - the RTT is unambiguous */
+            uint32_t rto = coap_congestion_estimate(&peer->strong_valid, &peer->strong_srtt, &peer->strong_rttvar, rtt, STRONG_RTO_K);
+            peer->rto = (peer->rto + rto) / 2;
+        }
+        else
+        {
+            /* weak estimate - the RTT is measured from the first transmission */
+            uint32_t rto = coap_congestion_estimate(&peer->weak_valid, &peer->weak_srtt, &peer->weak_rttvar, rtt, WEAK_RTO_K);
+            peer->rto = ((3 * peer->rto) + rto) / 4;
+        }
+
+        if (peer->rto < COAP_MIN_RTO_MS)
+        {
+            peer->rto = COAP_MIN_RTO_MS;
+        }
+        else if (peer->rto > COAP_MAX_RTO_MS)
+        {
+            peer->rto = COAP_MAX_RTO_MS;
+        }
+        peer->rto_updated = Lwm2mCore_GetTickCountMs();
+    }
+}
@@ -0,0 +1,88 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef COAP_CONGESTION_H_
+#define COAP_CONGESTION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/lwm2m_hash.h"
+#include "../common/lwm2m_heap.h"
+#include "network_abstraction.h"
+
+/*
+ * CoCoA congestion control (draft-ietf-core-cocoa). For each peer the transaction layer keeps an estimate of the
+ * retransmission timeout (RTO), updated from round-trip times measured on confirmable exchanges, and limits the
+ * number of unacknowledged confirmable messages to COAP_NSTART - further messages are queued until one is
+ * acknowledged or times out.
+ */
+#define COAP_MIN_RTO_MS                     200
+#define COAP_MAX_RTO_MS                     60000
+
+/* How long the RTO estimate for a peer is kept after its last exchange */
+#define COAP_PEER_STATE_LIFETIME_MS         (10 * 60 * 1000)
+
+struct coap_transaction;
+
+typedef struct coap_peer
+{
+    HashTableNode node;
+    HeapNode idle_timer;                    /* scheduled while there are no exchanges with the peer */
+    NetworkAddress * remoteAddress;
+
+    uint32_t rto;                           /* overall RTO estimate in milliseconds */
+    uint64_t rto_updated;
+    bool strong_valid;
+    uint32_t strong_srtt;
+    uint32_t strong_rttvar;
+    bool weak_valid;
+    uint32_t weak_srtt;
+    uint32_t weak_rttvar;
+
+    uint16_t in_flight;                     /* unacknowledged confirmable messages */
+    struct coap_transaction * queue_head;   /* confirmable messages waiting for the window to open */
+    struct coap_transaction * queue_tail;
+} coap_peer_t;
+
+void coap_init_congestion(void);
+
+/* Find the state for a peer, creating it if there is none. Returns NULL if out of memory. */
+coap_peer_t * coap_congestion_peer(NetworkAddress * remoteAddress);
+coap_peer_t * coap_congestion_find_peer(NetworkAddress * remoteAddress);
+
+/* Called when the last exchange with a peer completes - its state is forgotten after COAP_PEER_STATE_LIFETIME_MS */
+void coap_congestion_peer_idle(coap_peer_t * peer);
+void coap_congestion_expire_peers(uint64_t now);
+
+/* Initial retransmission timeout for a new exchange, randomised between RTO and RTO * COAP_RESPONSE_RANDOM_FACTOR.
+ * backoff is set to the variable backoff factor to apply on each retransmission, in halves.
+ */
+uint32_t coap_congestion_initial_timeout(coap_peer_t * peer, uint8_t * backoff);
+uint32_t coap_congestion_backoff(uint32_t interval, uint8_t backoff);
+
+/* Update the RTO estimate from an exchange that needed the specified number of retransmissions */
+void coap_congestion_update_rto(coap_peer_t * peer, uint32_t rtt, uint8_t retransmissions);
+
+#endif /* COAP_CONGESTION_H_ */
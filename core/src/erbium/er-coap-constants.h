@@ -42,7 +42,7 @@
 #define COAP_DEFAULT_PORT                    5683
 
 #define COAP_DEFAULT_MAX_AGE                 60
-#define COAP_RESPONSE_TIMEOUT                3
+#define COAP_RESPONSE_TIMEOUT                2
 #define COAP_RESPONSE_RANDOM_FACTOR          1.5
 #define COAP_MAX_RETRANSMIT                  4
 
@@ -50,6 +50,9 @@
 #define COAP_TOKEN_LEN                       8  /* The maximum number of bytes for the Token */
 #define COAP_ETAG_LEN                        8  /* The maximum number of bytes for the ETag */
 
+#define COAP_BERT_BLOCK_SIZE                 1024  /* BERT blocks carry multiples of this size (RFC 8323 section 6) */
+#define COAP_BLOCK_SZX_BERT                  7
+
 #define COAP_HEADER_VERSION_MASK             0xC0
 #define COAP_HEADER_VERSION_POSITION         6
 #define COAP_HEADER_TYPE_MASK                0x30
@@ -73,7 +76,8 @@ typedef enum {
   COAP_GET = 1,
   COAP_POST,
   COAP_PUT,
-  COAP_DELETE
+  COAP_DELETE,
+  COAP_FETCH                    /* RFC 8132 */
 } coap_method_t;
 
 /* CoAP response codes */
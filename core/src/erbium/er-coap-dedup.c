@@ -0,0 +1,197 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "er-coap-dedup.h"
+#include "../common/lwm2m_hash.h"
+#include "../common/lwm2m_heap.h"
+#include "../common/lwm2m_metrics.h"
+#include "../common/lwm2m_util.h"
+
+typedef struct
+{
+    HashTableNode node;
+    HeapNode expiry;                 /* entries are forgotten at expiry, or oldest first when the cache is full */
+    NetworkAddress * remoteAddress;
+    uint16_t mid;
+    uint16_t response_len;           /* zero if no response has been sent yet */
+    uint8_t response[];
+} coap_dedup_entry_t;
+
+typedef struct
+{
+    NetworkAddress * remoteAddress;
+    uint16_t mid;
+} coap_dedup_key_t;
+
+static HashTable requests = {0};
+static Heap expiries = {0};
+
+static uint32_t coap_dedup_hash(NetworkAddress * remoteAddress, uint16_t mid)
+{
+    return Hash_Bytes(&mid, sizeof(mid), NetworkAddress_Hash(remoteAddress));
+}
+
+static bool coap_dedup_match(const HashTableNode * node, const void * key)
+{
+    const coap_dedup_entry_t * entry = HashTableEntry(node, coap_dedup_entry_t, node);
+    const coap_dedup_key_t * k = (const coap_dedup_key_t *)key;
+    return (entry->mid == k->mid) &&
+            ((entry->remoteAddress == k->remoteAddress) || (NetworkAddress_Compare(entry->remoteAddress, k->remoteAddress) == 0));
+}
+
+static void coap_dedup_remove(coap_dedup_entry_t * entry)
+{
+    HashTable_Remove(&requests, &entry->node);
+    Heap_Remove(&expiries, &entry->expiry);
+    free(entry);
+    Metrics_Decrement(Metric_CoapDuplicateCacheEntries);
+}
+
+static void coap_dedup_expire(uint64_t now)
+{
+    HeapNode * node;
+    while (((node = Heap_Peek(&expiries)) != NULL) && (node->Key <= now))
+    {
+        coap_dedup_remove(HeapEntry(node, coap_dedup_entry_t, expiry));
+    }
+}
+
+static coap_dedup_entry_t * coap_dedup_find(NetworkAddress * remoteAddress, uint16_t mid)
+{
+    coap_dedup_key_t key = { .remoteAddress = remoteAddress, .mid = mid };
+    HashTableNode * node = HashTable_Find(&requests, coap_dedup_hash(remoteAddress, mid), coap_dedup_match, &key);
+    return (node != NULL) ? HashTableEntry(node, coap_dedup_entry_t, node) : NULL;
+}
+
+void coap_init_dedup(void)
+{
+    coap_destroy_dedup();
+    HashTable_Init(&requests, 0);
+    Heap_Init(&expiries, 0);
+}
+
+void coap_destroy_dedup(void)
+{
+    HeapNode * node;
+    while ((node = Heap_Peek(&expiries)) != NULL)
+    {
+        coap_dedup_remove(HeapEntry(node, coap_dedup_entry_t, expiry));
+    }
+    HashTable_Destroy(&requests);
+    Heap_Destroy(&expiries);
+}
+
+bool coap_dedup_check(NetworkSocket * networkSocket, NetworkAddress * remoteAddress, const coap_packet_t * request)
+{
+    bool duplicate = false;
+    coap_dedup_expire(Lwm2mCore_GetTickCountMs());
+    if (NetworkAddress_IsReliable(remoteAddress))
+    {
+        /* requests over a connection are never retransmitted */
+        return false;
+    }
+
+    coap_dedup_entry_t * entry = coap_dedup_find(remoteAddress, request->mid);
+    if (entry != NULL)
+    {
+        PRINTF("Duplicate request %u\n", request->mid);
+        duplicate = true;
+        Metrics_Increment(Metric_CoapDuplicatesReceived);
+
+        if (request->type == COAP_TYPE_CON)
+        {
+            if (entry->response_len > 0)
+            {
+                NetworkSocket_Send(networkSocket, remoteAddress, entry->response, entry->response_len);
+            }
+            else
+            {
+                /* the response will follow separately - acknowledge the request again */
+                coap_packet_t ack[1];
+                uint8_t buffer[COAP_MAX_HEADER_SIZE];
+                coap_init_message(ack, COAP_TYPE_ACK, 0, request->mid);
+                size_t length = coap_serialize_message(ack, buffer);
+                NetworkSocket_Send(networkSocket, remoteAddress, buffer, length);
+            }
+        }
+    }
+    return duplicate;
+}
+
+void coap_dedup_add(NetworkAddress * remoteAddress, coap_message_type_t type, uint16_t mid, const uint8_t * response, uint16_t response_len)
+{
+    uint64_t now = Lwm2mCore_GetTickCountMs();
+    if (NetworkAddress_IsReliable(remoteAddress))
+    {
+        return;
+    }
+    coap_dedup_entry_t * entry = coap_dedup_find(remoteAddress, mid);
+    if (entry != NULL)
+    {
+        coap_dedup_remove(entry);
+    }
+
+    /* only the response to a confirmable request is sent again */
+    if ((type != COAP_TYPE_CON) || (response == NULL))
+    {
+        response_len = 0;
+    }
+
+    if (HashTable_Count(&requests) >= COAP_MAX_DEDUP_ENTRIES)
+    {
+        coap_dedup_remove(HeapEntry(Heap_Peek(&expiries), coap_dedup_entry_t, expiry));
+    }
+
+    entry = (coap_dedup_entry_t *)malloc(sizeof(*entry) + response_len);
+    if (entry != NULL)
+    {
+        memset(entry, 0, sizeof(*entry));
+        entry->remoteAddress = remoteAddress;
+        entry->mid = mid;
+        entry->response_len = response_len;
+        if (response_len > 0)
+        {
+            memcpy(entry->response, response, response_len);
+        }
+
+        uint64_t lifetime = (type == COAP_TYPE_CON) ? COAP_EXCHANGE_LIFETIME_MS : COAP_NON_LIFETIME_MS;
+        if (Heap_Push(&expiries, &entry->expiry, now + lifetime))
+        {
+            HashTable_Add(&requests, &entry->node, coap_dedup_hash(remoteAddress, mid));
+            Metrics_Increment(Metric_CoapDuplicateCacheEntries);
+        }
+        else
+        {
+            free(entry);
+        }
+    }
+}
+
+size_t coap_dedup_count(void)
+{
+    return HashTable_Count(&requests);
+}
@@ -0,0 +1,55 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef COAP_DEDUP_H_
+#define COAP_DEDUP_H_
+
+#include "er-coap.h"
+#include "er-coap-transactions.h"
+#include "network_abstraction.h"
+
+/*
+ * Duplicate detection (RFC 7252 section 4.5). Requests are remembered by remote address and MID for
+ * EXCHANGE_LIFETIME (CON) or NON_LIFETIME (NON), along with the response sent to them. A retransmitted
+ * confirmable request is answered with the same response instead of being handled again.
+ */
+#define COAP_MAX_TRANSMIT_SPAN_MS           (long)(COAP_RESPONSE_TIMEOUT_MS * ((1 << COAP_MAX_RETRANSMIT) - 1) * (float)COAP_RESPONSE_RANDOM_FACTOR)
+#define COAP_MAX_LATENCY_MS                 (100 * 1000)
+#define COAP_EXCHANGE_LIFETIME_MS           (COAP_MAX_TRANSMIT_SPAN_MS + (2 * COAP_MAX_LATENCY_MS) + COAP_RESPONSE_TIMEOUT_MS)
+#define COAP_NON_LIFETIME_MS                (COAP_MAX_TRANSMIT_SPAN_MS + COAP_MAX_LATENCY_MS)
+
+void coap_init_dedup(void);
+void coap_destroy_dedup(void);
+
+/* Returns true if the request is a duplicate of one already received from remoteAddress. The response
+ * to a duplicate confirmable request is sent again; duplicate non-confirmable requests are ignored.
+ */
+bool coap_dedup_check(NetworkSocket * networkSocket, NetworkAddress * remoteAddress, const coap_packet_t * request);
+
+/* Remember a request, and the response sent to it (NULL if the response will be sent separately) */
+void coap_dedup_add(NetworkAddress * remoteAddress, coap_message_type_t type, uint16_t mid, const uint8_t * response, uint16_t response_len);
+
+size_t coap_dedup_count(void);
+
+#endif /* COAP_DEDUP_H_ */
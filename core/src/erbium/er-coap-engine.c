@@ -41,6 +41,7 @@
 #include <string.h>
 
 #include "er-coap-engine.h"
+#include "er-coap-dedup.h"
 #include "er-resource.h"
 #include "network_abstraction.h"
 
@@ -55,8 +56,27 @@ static service_callback_t service_cbk = NULL;
 
 uint8_t CoapBuffer[COAP_BUFFER_LENGTH];
 
+/* responses to requests received over a connection are not kept in a transaction, as they are never retransmitted */
+static uint8_t ReliableResponseBuffer[COAP_MAX_MESSAGE_SIZE_TCP + 1];
+
 NetworkAddress * sourceAddress = NULL;
 
+uint16_t coap_get_max_block_size(NetworkSocket * networkSocket, NetworkAddress * address)
+{
+    uint16_t result = COAP_MAX_BLOCK_SIZE;
+    if (NetworkAddress_IsReliable(address) && NetworkSocket_IsBlockwiseSupported(networkSocket, address))
+    {
+        /* a BERT block as large as fits in a message the peer accepts, with room for the options */
+        int size = MIN(NetworkSocket_GetMaxMessageSize(networkSocket, address), COAP_MAX_MESSAGE_SIZE_TCP) - COAP_MAX_HEADER_SIZE - 2;
+        size -= size % COAP_BERT_BLOCK_SIZE;
+        if (size > COAP_MAX_BLOCK_SIZE)
+        {
+            result = size;
+        }
+    }
+    return result;
+}
+
 int coap_receive(NetworkSocket * networkSocket)
 {
     erbium_status_code = NO_ERROR;
@@ -69,34 +89,52 @@ int coap_receive(NetworkSocket * networkSocket)
     static coap_packet_t response[1];
     static coap_transaction_t *transaction;
     transaction = NULL;
+    bool is_request = false;
+    bool reliable = false;
+    size_t response_length = 0;
     int readLength;
-    if (NetworkSocket_Read(networkSocket, CoapBuffer, COAP_BUFFER_LENGTH, &sourceAddress, &readLength) && (readLength > 0))
+    /* leave room for the terminating '\0' added to the payload */
+    if (NetworkSocket_Read(networkSocket, CoapBuffer, COAP_BUFFER_LENGTH - 1, &sourceAddress, &readLength) && (readLength > 0))
     {
 
         PRINTF("receiving UDP datagram from: ");
         PRINTF(" Length: %u\n", readLength);
 
-        erbium_status_code = coap_parse_message(message, CoapBuffer, readLength);
+        reliable = NetworkAddress_IsReliable(sourceAddress);
+        if (reliable)
+        {
+            erbium_status_code = coap_parse_reliable_message(message, CoapBuffer, readLength);
+        }
+        else
+        {
+            erbium_status_code = coap_parse_message(message, CoapBuffer, readLength);
+        }
 
         if (erbium_status_code == NO_ERROR)
         {
 
-            /*TODO duplicates suppression, if required by application */
-
             PRINTF("  Parsed: v %u, t %u, tkl %u, c %u, mid %u\n", message->version, message->type, message->token_len, message->code,
                     message->mid);
             PRINTF("  URL: %.*s\n", (int)message->uri_path_len, message->uri_path);
             PRINTF("  Payload: %.*s\n", message->payload_len, message->payload);
 
             /* handle requests */
-            if (message->code >= COAP_GET && message->code <= COAP_DELETE)
+            if (message->code >= COAP_GET && message->code <= COAP_FETCH)
             {
+                is_request = true;
 
+                /* duplicates suppression - a retransmitted request gets the response that was sent before */
+                if (coap_dedup_check(networkSocket, sourceAddress, message))
+                {
+                    is_request = false;
+                }
                 /* use transaction buffer for response to confirmable request */
-                if ((transaction = coap_new_transaction(networkSocket, message->mid, sourceAddress)))
+                else if (reliable || (transaction = coap_new_transaction(networkSocket, message->mid, sourceAddress)))
                 {
+                    uint8_t * response_buffer = transaction ? transaction->packet : ReliableResponseBuffer;
+                    uint16_t max_block_size = coap_get_max_block_size(networkSocket, sourceAddress);
                     uint32_t block_num = 0;
-                    uint16_t block_size = COAP_MAX_BLOCK_SIZE;
+                    uint16_t block_size = max_block_size;
                     uint32_t block_offset = 0;
                     int32_t new_offset = 0;
 
@@ -121,7 +159,8 @@ int coap_receive(NetworkSocket * networkSocket)
                     {
                         PRINTF("Blockwise: block request %lu (%u/%u) @ %lu bytes\n", (long unsigned int)block_num, block_size, COAP_MAX_BLOCK_SIZE,
                                 (long unsigned int)block_offset);
-                        block_size = MIN(block_size, COAP_MAX_BLOCK_SIZE);
+                        /* a peer asking for 1024 byte blocks over a connection gets BERT blocks, if it takes them */
+                        block_size = (block_size >= COAP_MAX_BLOCK_SIZE) ? max_block_size : MIN(block_size, max_block_size);
                         new_offset = block_offset;
                     }
 
@@ -130,7 +169,7 @@ int coap_receive(NetworkSocket * networkSocket)
                     {
 
                         /* call REST framework and check if found and allowed */
-                        if (service_cbk(message, response, transaction->packet + COAP_MAX_HEADER_SIZE, block_size, &new_offset))
+                        if (service_cbk(message, response, response_buffer + COAP_MAX_HEADER_SIZE, block_size, &new_offset))
                         {
 
                             if (erbium_status_code == NO_ERROR)
@@ -167,7 +206,7 @@ int coap_receive(NetworkSocket * networkSocket)
                                         {
                                             coap_set_header_block2(response, block_num, response->payload_len - block_offset > block_size,
                                                     block_size);
-                                            coap_set_payload(response, response->payload + block_offset,
+                                            coap_set_bert_payload(response, response->payload + block_offset,
                                                     MIN(response->payload_len - block_offset, block_size));
                                         } /* if(valid offset) */
 
@@ -181,7 +220,7 @@ int coap_receive(NetworkSocket * networkSocket)
 
                                         if (response->payload_len > block_size)
                                         {
-                                            coap_set_payload(response, response->payload, block_size);
+                                            coap_set_bert_payload(response, response->payload, block_size);
                                         }
                                     } /* if(resource aware of blockwise) */
 
@@ -189,10 +228,10 @@ int coap_receive(NetworkSocket * networkSocket)
                                 }
                                 else if (new_offset != 0)
                                 {
-                                    PRINTF("Blockwise: no block option for blockwise resource, using block size %u\n", COAP_MAX_BLOCK_SIZE);
+                                    PRINTF("Blockwise: no block option for blockwise resource, using block size %u\n", block_size);
 
-                                    coap_set_header_block2(response, 0, new_offset != -1, COAP_MAX_BLOCK_SIZE);
-                                    coap_set_payload(response, response->payload, MIN(response->payload_len, COAP_MAX_BLOCK_SIZE));
+                                    coap_set_header_block2(response, 0, new_offset != -1, block_size);
+                                    coap_set_bert_payload(response, response->payload, MIN(response->payload_len, block_size));
                                 } /* blockwise transfer handling */
                             } /* no errors/hooks */
                             /* successful service callback */
@@ -200,10 +239,14 @@ int coap_receive(NetworkSocket * networkSocket)
                         }
                         if (erbium_status_code == NO_ERROR)
                         {
-                            if ((transaction->packet_len = coap_serialize_message(response, transaction->packet)) == 0)
+                            if ((response_length = coap_serialize_message(response, response_buffer)) == 0)
                             {
                                 erbium_status_code = PACKET_SERIALIZATION_ERROR;
                             }
+                            else if (transaction)
+                            {
+                                transaction->packet_len = response_length;
+                            }
                         }
                     }
                     else
@@ -240,12 +283,17 @@ int coap_receive(NetworkSocket * networkSocket)
                     //coap_remove_observer_by_mid(sourceAddress, message->mid); //TODO add
                 }
 
-                if ((transaction = coap_get_transaction_by_mid(message->mid)))
+                if ((((message->type == COAP_TYPE_ACK) || (message->type == COAP_TYPE_RST)) &&
+                        (transaction = coap_get_transaction_by_mid(sourceAddress, message->mid))) ||
+                        /* a separate response can overtake the empty ACK for its request */
+                        (((message->type == COAP_TYPE_CON) || (message->type == COAP_TYPE_NON)) && (message->code >= CREATED_2_01) &&
+                                (transaction = coap_get_transaction_by_token(sourceAddress, message->token, message->token_len))))
                 {
                     /* free transaction memory before callback, as it may create a new transaction */
                     restful_response_handler callback = transaction->callback;
                     void *callback_data = transaction->callback_data;
 
+                    coap_measure_transaction_rtt(transaction);
                     coap_clear_transaction(&transaction);
                     transaction = NULL;
 
@@ -254,14 +302,28 @@ int coap_receive(NetworkSocket * networkSocket)
                     {
                         callback(callback_data, message);
                     }
+
+                    if (message->type == COAP_TYPE_CON)
+                    {
+                        coap_init_message(response, COAP_TYPE_ACK, 0, message->mid);
+                        int sendLength = coap_serialize_message(response, CoapBuffer);
+                        NetworkSocket_Send(networkSocket, sourceAddress, CoapBuffer, sendLength);
+                    }
                 }
 //#if COAP_OBSERVE_CLIENT
-                /* if observe notification */
+                /* if observe notification, or separate response to an acknowledged request */
                 else if((message->type == COAP_TYPE_CON || message->type == COAP_TYPE_NON)
-                        && IS_OPTION(message, COAP_OPTION_OBSERVE))
+                        && message->code >= CREATED_2_01)
                 {
                     PRINTF("Observe [%u]\n", message->observe);
                     coap_handle_notification(sourceAddress, message);
+
+                    if (message->type == COAP_TYPE_CON)
+                    {
+                        coap_init_message(response, COAP_TYPE_ACK, 0, message->mid);
+                        int sendLength = coap_serialize_message(response, CoapBuffer);
+                        NetworkSocket_Send(networkSocket, sourceAddress, CoapBuffer, sendLength);
+                    }
                 }
 //#endif /* COAP_OBSERVE_CLIENT */
             } /* request or response */
@@ -272,13 +334,25 @@ int coap_receive(NetworkSocket * networkSocket)
         {
             if (transaction)
             {
+                if (is_request)
+                {
+                    coap_dedup_add(sourceAddress, message->type, message->mid, transaction->packet, transaction->packet_len);
+                }
                 coap_send_transaction(transaction);
             }
+            else if (reliable && is_request && (response_length > 0))
+            {
+                NetworkSocket_Send(networkSocket, sourceAddress, ReliableResponseBuffer, response_length);
+            }
         }
         else if (erbium_status_code == MANUAL_RESPONSE)
         {
             PRINTF("Clearing transaction for manual response");
             coap_clear_transaction(&transaction);
+            if (is_request)
+            {
+                coap_dedup_add(sourceAddress, message->type, message->mid, NULL, 0);
+            }
         }
         else
         {
@@ -298,10 +372,16 @@ int coap_receive(NetworkSocket * networkSocket)
                 erbium_status_code = INTERNAL_SERVER_ERROR_5_00;
                 /* reuse input buffer for error message */
             }
+            coap_message_type_t request_type = message->type;
+            uint16_t request_mid = message->mid;
             coap_init_message(message, reply_type, erbium_status_code, message->mid);
             coap_set_payload(message, coap_error_message, strlen(coap_error_message));
             int sendLength = coap_serialize_message(message, CoapBuffer);
             NetworkSocket_Send(networkSocket, sourceAddress, CoapBuffer, sendLength);
+            if (is_request)
+            {
+                coap_dedup_add(sourceAddress, request_type, request_mid, CoapBuffer, sendLength);
+            }
         }
     }
 
@@ -98,4 +98,7 @@ void coap_set_service_callback(service_callback_t callback);
 
 void coap_handle_notification(NetworkAddress * sourceAddress, coap_packet_t * message);
 
+/* The largest block to transfer with the peer - a BERT block if it is connected over TCP and takes them */
+uint16_t coap_get_max_block_size(NetworkSocket * networkSocket, NetworkAddress * address);
+
 #endif /* ER_COAP_ENGINE_H_ */
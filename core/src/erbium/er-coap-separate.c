@@ -41,6 +41,8 @@
 #include "er-coap-separate.h"
 #include "er-coap-transactions.h"
 
+/* source of the request being handled, set by coap_receive() */
+extern NetworkAddress * sourceAddress;
 
 /*---------------------------------------------------------------------------*/
 /*- Separate Response API ---------------------------------------------------*/
@@ -76,7 +78,7 @@ void
 coap_separate_accept(void *request, coap_separate_t *separate_store)
 {
   coap_packet_t *const coap_req = (coap_packet_t *)request;
-  coap_transaction_t *const t = coap_get_transaction_by_mid(coap_req->mid);
+  coap_transaction_t *const t = coap_get_transaction_by_mid(sourceAddress, coap_req->mid);
 
   PRINTF("Separate ACCEPT: /%.*s MID %u\n", (int)coap_req->uri_path_len,
          coap_req->uri_path, coap_req->mid);
@@ -37,15 +37,22 @@
  */
 
 #include "string.h"
-#include "../common/lwm2m_list.h"
+#include <stdlib.h>
 #include "er-coap-transactions.h"
+#include "../common/lwm2m_metrics.h"
+#include "../common/lwm2m_util.h"
 
 /*---------------------------------------------------------------------------*/
 //MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
 //LIST(transactions_list);
 
 
-struct ListHead transactions_list = {0};
+/* outstanding transactions, indexed by (remote address, MID) and by (remote address, token) */
+static HashTable transactionsByMid = {0};
+static HashTable transactionsByToken = {0};
+
+/* retransmission deadlines of transactions, soonest first */
+static Heap retransmissions = {0};
 
 //static struct process *transaction_handler_process = NULL;
 
@@ -58,9 +65,48 @@ struct ListHead transactions_list = {0};
 //  transaction_handler_process = PROCESS_CURRENT();
 //}
 
+typedef struct
+{
+    NetworkAddress * remoteAddress;
+    uint16_t mid;
+    const uint8_t * token;
+    uint8_t token_len;
+} transaction_key_t;
+
+static uint32_t coap_hash_mid(NetworkAddress * remoteAddress, uint16_t mid)
+{
+    return Hash_Bytes(&mid, sizeof(mid), NetworkAddress_Hash(remoteAddress));
+}
+
+static uint32_t coap_hash_token(NetworkAddress * remoteAddress, const uint8_t * token, uint8_t token_len)
+{
+    return Hash_Bytes(token, token_len, NetworkAddress_Hash(remoteAddress));
+}
+
+static bool coap_match_mid(const HashTableNode * node, const void * key)
+{
+    const coap_transaction_t * t = HashTableEntry(node, coap_transaction_t, mid_node);
+    const transaction_key_t * k = (const transaction_key_t *)key;
+    return (t->mid == k->mid) && ((t->remoteAddress == k->remoteAddress) || (NetworkAddress_Compare(t->remoteAddress, k->remoteAddress) == 0));
+}
+
+static bool coap_match_token(const HashTableNode * node, const void * key)
+{
+    const coap_transaction_t * t = HashTableEntry(node, coap_transaction_t, token_node);
+    const transaction_key_t * k = (const transaction_key_t *)key;
+    return (t->token_len == k->token_len) && (memcmp(t->token, k->token, k->token_len) == 0) &&
+            ((t->remoteAddress == k->remoteAddress) || (NetworkAddress_Compare(t->remoteAddress, k->remoteAddress) == 0));
+}
+
 void coap_init_transactions(void)
 {
-	ListInit(&transactions_list);
+    HashTable_Destroy(&transactionsByMid);
+    HashTable_Init(&transactionsByMid, 0);
+    HashTable_Destroy(&transactionsByToken);
+    HashTable_Init(&transactionsByToken, 0);
+    Heap_Destroy(&retransmissions);
+    Heap_Init(&retransmissions, 0);
+    coap_init_congestion();
 }
 
 coap_transaction_t * coap_new_transaction(NetworkSocket * networkSocket, uint16_t mid, NetworkAddress * remoteAddress)
@@ -74,77 +120,167 @@ coap_transaction_t * coap_new_transaction(NetworkSocket * networkSocket, uint16_
         t->networkSocket = networkSocket;
         t->remoteAddress = remoteAddress;
 
-        ListAdd(&t->list, &transactions_list); /* list itself makes sure same element is not added twice */
+        HashTable_Add(&transactionsByMid, &t->mid_node, coap_hash_mid(remoteAddress, mid));
     }
 
     return t;
 }
 /*---------------------------------------------------------------------------*/
-void coap_send_transaction(coap_transaction_t *t)
+static void coap_timeout_transaction(coap_transaction_t *t)
 {
-    PRINTF("Sending transaction %u\n", t->mid);
+    PRINTF("Timeout\n");
+    restful_response_handler callback = t->callback;
+    void *callback_data = t->callback_data;
 
+    /* handle observers */
+    //coap_remove_observer_by_client(t->session);	// TODO - restore when observe supported
 
-    //coap_send_message(&t->addr, t->port, t->packet, t->packet_len);
-    if (NetworkSocket_Send(t->networkSocket, t->remoteAddress, t->packet, t->packet_len))
+    coap_clear_transaction(&t);
+
+    if(callback)
     {
-        t->sent = true;
-        if(COAP_TYPE_CON ==
-                ((COAP_HEADER_TYPE_MASK & t->packet[0]) >> COAP_HEADER_TYPE_POSITION))
+        callback(callback_data, NULL);
+    }
+}
+
+static bool coap_is_confirmable(const coap_transaction_t *t)
+{
+    return COAP_TYPE_CON == ((COAP_HEADER_TYPE_MASK & t->packet[0]) >> COAP_HEADER_TYPE_POSITION);
+}
+
+/* Confirmable messages are sent only while fewer than COAP_NSTART are unacknowledged - returns false if queued */
+static bool coap_open_window(coap_transaction_t *t)
+{
+    bool open = true;
+    if(coap_is_confirmable(t) && (t->peer == NULL))
+    {
+        t->peer = coap_congestion_peer(t->remoteAddress);
+        if(t->peer != NULL)
         {
-            if(t->retrans_counter < COAP_MAX_RETRANSMIT)
+            if(t->peer->in_flight < COAP_NSTART)
             {
-                /* not timed out yet */
-                PRINTF("Keeping transaction %u\n", t->mid);
-
-                if(t->retrans_counter == 0)
+                t->peer->in_flight++;
+            }
+            else
+            {
+                PRINTF("Queueing transaction %u\n", t->mid);
+                t->queued = true;
+                if(t->peer->queue_tail != NULL)
                 {
-    //                t->retrans_timer.timer.interval =
-    //                        COAP_RESPONSE_TIMEOUT_TICKS + (random_rand()
-    //                                %
-    //                                (clock_time_t)
-    //                                COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
-    //                PRINTF("Initial interval %f\n",
-    //                        (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
+                    t->peer->queue_tail->queue_next = t;
                 }
                 else
                 {
-    //                t->retrans_timer.timer.interval <<= 1;  /* double */
-    //                PRINTF("Doubled (%u) interval %f\n", t->retrans_counter,
-    //                        (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
+                    t->peer->queue_head = t;
                 }
+                t->peer->queue_tail = t;
+                Metrics_Increment(Metric_CoapMessagesQueued);
+                open = false;
+            }
+        }
+    }
+    return open;
+}
 
-    //            PROCESS_CONTEXT_BEGIN(transaction_handler_process);
-    //            etimer_restart(&t->retrans_timer);        /* interval updated above */
-    //            PROCESS_CONTEXT_END(transaction_handler_process);
+static void coap_close_window(coap_transaction_t *t)
+{
+    coap_peer_t * peer = t->peer;
+    if(t->queued)
+    {
+        coap_transaction_t ** link = &peer->queue_head;
+        coap_transaction_t * previous = NULL;
+        while(*link != t)
+        {
+            previous = *link;
+            link = &(*link)->queue_next;
+        }
+        *link = t->queue_next;
+        if(peer->queue_tail == t)
+        {
+            peer->queue_tail = previous;
+        }
+        Metrics_Decrement(Metric_CoapMessagesQueued);
+    }
+    else if(peer->queue_head != NULL)
+    {
+        /* hand the window slot to the next queued message, which is sent by coap_check_transactions() */
+        coap_transaction_t * next = peer->queue_head;
+        peer->queue_head = next->queue_next;
+        if(peer->queue_head == NULL)
+        {
+            peer->queue_tail = NULL;
+        }
+        next->queued = false;
+        next->queue_next = NULL;
+        Metrics_Decrement(Metric_CoapMessagesQueued);
+        Heap_Update(&retransmissions, &next->retrans_timer, Lwm2mCore_GetTickCountMs());
+    }
+    else
+    {
+        peer->in_flight--;
+        coap_congestion_peer_idle(peer);
+    }
+    t->peer = NULL;
+}
 
-                t = NULL;
-            }
-            else
-            {
-                /* timed out */
-                PRINTF("Timeout\n");
-                restful_response_handler callback = t->callback;
-                void *callback_data = t->callback_data;
+void coap_send_transaction(coap_transaction_t *t)
+{
+    PRINTF("Sending transaction %u\n", t->mid);
 
-                /* handle observers */
-                //coap_remove_observer_by_client(t->session);	// TODO - restore when observe supported
+    if(!coap_open_window(t))
+    {
+        return;
+    }
 
-                coap_clear_transaction(&t);
+    uint64_t now = Lwm2mCore_GetTickCountMs();
+    if(t->first_send_time == 0)
+    {
+        t->first_send_time = now;
 
-                if(callback)
-                {
-                    callback(callback_data, NULL);
-                }
+        /* index confirmable requests by token, to match a separate response that arrives before its empty ACK */
+        uint8_t token_len = (t->packet[0] & COAP_HEADER_TOKEN_LEN_MASK) >> COAP_HEADER_TOKEN_LEN_POSITION;
+        if((COAP_TYPE_CON == ((COAP_HEADER_TYPE_MASK & t->packet[0]) >> COAP_HEADER_TYPE_POSITION)) &&
+                (t->packet[1] >= COAP_GET) && (t->packet[1] <= COAP_FETCH) &&
+                (token_len > 0) && (token_len <= COAP_TOKEN_LEN) && (t->packet_len >= COAP_HEADER_LEN + token_len))
+        {
+            t->token_len = token_len;
+            memcpy(t->token, &t->packet[COAP_HEADER_LEN], token_len);
+            HashTable_Add(&transactionsByToken, &t->token_node, coap_hash_token(t->remoteAddress, t->token, t->token_len));
+        }
+    }
+
+    if (NetworkSocket_Send(t->networkSocket, t->remoteAddress, t->packet, t->packet_len))
+    {
+        t->sent = true;
+        if(coap_is_confirmable(t))
+        {
+            /* keep the transaction until it is acknowledged or retransmission times out */
+            if(t->retrans_interval == 0)
+            {
+                t->transmit_time = now;
+                t->retrans_interval = coap_congestion_initial_timeout(t->peer, &t->retrans_backoff);
+                PRINTF("Initial interval %u ms\n", t->retrans_interval);
             }
-        } else {
+            Heap_Update(&retransmissions, &t->retrans_timer, now + t->retrans_interval);
+        }
+        else
+        {
             coap_clear_transaction(&t);
         }
     }
     else
     {
-        PRINTF("Failed to sened transaciton %u\n", t->mid);
+        PRINTF("Failed to send transaction %u\n", t->mid);
         t->sent = false;
+        if(now - t->first_send_time >= COAP_MAX_TRANSMIT_WAIT_MS)
+        {
+            coap_timeout_transaction(t);
+        }
+        else
+        {
+            /* retry shortly - a failed send does not count as a retransmission */
+            Heap_Update(&retransmissions, &t->retrans_timer, now + COAP_SEND_RETRY_INTERVAL_MS);
+        }
     }
 }
 /*---------------------------------------------------------------------------*/
@@ -154,47 +290,92 @@ void coap_clear_transaction(coap_transaction_t **t)
     {
         PRINTF("Freeing transaction %u: %p\n", (*t)->mid, (*t));
 
-        //etimer_stop(&t->retrans_timer);
-        ListRemove(&(*t)->list);
+        Heap_Remove(&retransmissions, &(*t)->retrans_timer);
+        if((*t)->peer != NULL)
+        {
+            coap_close_window(*t);
+        }
+        HashTable_Remove(&transactionsByMid, &(*t)->mid_node);
+        if((*t)->token_len > 0)
+        {
+            HashTable_Remove(&transactionsByToken, &(*t)->token_node);
+        }
         free(*t);
         *t = NULL;
     }
 }
 
-coap_transaction_t * coap_get_transaction_by_mid(uint16_t mid)
+void coap_measure_transaction_rtt(coap_transaction_t *t)
 {
-    struct ListHead * i = NULL;
+    if((t->peer != NULL) && t->sent && (t->transmit_time != 0))
+    {
+        coap_congestion_update_rto(t->peer, (uint32_t)(Lwm2mCore_GetTickCountMs() - t->transmit_time), t->retrans_counter);
+    }
+}
 
-    ListForEach(i, &transactions_list)
+coap_transaction_t * coap_get_transaction_by_mid(NetworkAddress * remoteAddress, uint16_t mid)
+{
+    transaction_key_t key = { .remoteAddress = remoteAddress, .mid = mid };
+    coap_transaction_t * t = NULL;
+
+    HashTableNode * node = HashTable_Find(&transactionsByMid, coap_hash_mid(remoteAddress, mid), coap_match_mid, &key);
+    if(node != NULL)
     {
-        struct coap_transaction * t = ListEntry(i, struct coap_transaction, list);
+        t = HashTableEntry(node, coap_transaction_t, mid_node);
+        PRINTF("Found transaction for MID %u: %p\n", t->mid, t);
+    }
+    return t;
+}
 
-        if(t->mid == mid) {
-            PRINTF("Found transaction for MID %u: %p\n", t->mid, t);
-            return t;
-        }
+coap_transaction_t * coap_get_transaction_by_token(NetworkAddress * remoteAddress, const uint8_t * token, uint8_t token_len)
+{
+    transaction_key_t key = { .remoteAddress = remoteAddress, .token = token, .token_len = token_len };
+    coap_transaction_t * t = NULL;
+
+    HashTableNode * node = HashTable_Find(&transactionsByToken, coap_hash_token(remoteAddress, token, token_len), coap_match_token, &key);
+    if(node != NULL)
+    {
+        t = HashTableEntry(node, coap_transaction_t, token_node);
+        PRINTF("Found transaction for token: %p\n", t);
     }
-    return NULL;
+    return t;
 }
 /*---------------------------------------------------------------------------*/
-void coap_check_transactions()
+int coap_check_transactions()
 {
-    struct ListHead * current = NULL;
-    struct ListHead * next = NULL;
+    int timeout = -1;
+    uint64_t now = Lwm2mCore_GetTickCountMs();
+    HeapNode * node;
 
-    ListForEachSafe(current ,next, &transactions_list)
+    while (((node = Heap_Peek(&retransmissions)) != NULL) && (node->Key <= now))
     {
+        coap_transaction_t *t = HeapEntry(Heap_Pop(&retransmissions), struct coap_transaction, retrans_timer);
 
-        coap_transaction_t *t = ListEntry(current, struct coap_transaction, list);
-
-        //if(t->retrans_timer == 0)
         if (!t->sent)
         {
-            //++(t->retrans_counter);
-            //PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
             coap_send_transaction(t);
         }
+        else if (t->retrans_counter < COAP_MAX_RETRANSMIT)
+        {
+            ++(t->retrans_counter);
+            t->retrans_interval = coap_congestion_backoff(t->retrans_interval, t->retrans_backoff);
+            PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
+            Metrics_Increment(Metric_CoapRetransmissions);
+            coap_send_transaction(t);
+        }
+        else
+        {
+            /* the last retransmission was not acknowledged either */
+            coap_timeout_transaction(t);
+        }
+    }
+
+    if (node != NULL)
+    {
+        timeout = (int)(node->Key - now);
     }
 
+    coap_congestion_expire_peers(now);
+    return timeout;
 }
 /*---------------------------------------------------------------------------*/
@@ -39,27 +39,41 @@
 #ifndef COAP_TRANSACTIONS_H_
 #define COAP_TRANSACTIONS_H_
 
-#include "../common/lwm2m_list.h"
+#include "../common/lwm2m_heap.h"
+#include "../common/lwm2m_hash.h"
 #include "er-coap.h"
+#include "er-coap-congestion.h"
 #include "er-resource.h"
 #include "network_abstraction.h"
 
-/*
- * Modulo mask (thus +1) for a random number to get the tick number for the random
- * retransmission time between COAP_RESPONSE_TIMEOUT and COAP_RESPONSE_TIMEOUT*COAP_RESPONSE_RANDOM_FACTOR.
- */
-#define COAP_RESPONSE_TIMEOUT_TICKS         (CLOCK_SECOND * COAP_RESPONSE_TIMEOUT)
-#define COAP_RESPONSE_TIMEOUT_BACKOFF_MASK  (long)((CLOCK_SECOND * COAP_RESPONSE_TIMEOUT * ((float)COAP_RESPONSE_RANDOM_FACTOR - 1.0)) + 0.5) + 1
+/* Default retransmission timeout, used until a round-trip time has been measured for a peer */
+#define COAP_RESPONSE_TIMEOUT_MS            (1000 * COAP_RESPONSE_TIMEOUT)
+
+/* Longest time from the first transmission of a message to giving up on it (RFC 7252 MAX_TRANSMIT_WAIT) */
+#define COAP_MAX_TRANSMIT_WAIT_MS           (long)(COAP_RESPONSE_TIMEOUT_MS * ((2 << COAP_MAX_RETRANSMIT) - 1) * (float)COAP_RESPONSE_RANDOM_FACTOR)
+
+/* Interval between attempts to send a message that could not be sent, e.g. while a DTLS handshake is in progress */
+#define COAP_SEND_RETRY_INTERVAL_MS         100
 
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction
 {
-    struct ListHead list;
+    HashTableNode mid_node;          /* indexed by remote address and MID */
+    HashTableNode token_node;        /* confirmable requests are also indexed by remote address and token */
 
     uint16_t mid;
-    //struct etimer retrans_timer;
-    uint32_t retrans_timer;
+    uint8_t token_len;
+    uint8_t token[COAP_TOKEN_LEN];
+    HeapNode retrans_timer;
+    uint32_t retrans_interval;
     uint8_t retrans_counter;
+    uint8_t retrans_backoff;         /* multiplier for the retransmission interval, in halves */
+    uint64_t first_send_time;
+    uint64_t transmit_time;          /* first successful transmission, for measuring round-trip time */
+
+    coap_peer_t * peer;              /* confirmable messages count towards the peer's NSTART window */
+    bool queued;
+    struct coap_transaction * queue_next;
 
     NetworkSocket * networkSocket;
     NetworkAddress * remoteAddress;
@@ -79,8 +93,15 @@ void coap_init_transactions(void);
 coap_transaction_t * coap_new_transaction(NetworkSocket * networkSocket, uint16_t mid, NetworkAddress * remoteAddress);
 void coap_send_transaction(coap_transaction_t *t);
 void coap_clear_transaction(coap_transaction_t **t);
-coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
 
-void coap_check_transactions(void);
+/* Update the peer's RTO estimate when the ACK or response to a confirmable message is received */
+void coap_measure_transaction_rtt(coap_transaction_t *t);
+coap_transaction_t *coap_get_transaction_by_mid(NetworkAddress * remoteAddress, uint16_t mid);
+coap_transaction_t *coap_get_transaction_by_token(NetworkAddress * remoteAddress, const uint8_t * token, uint8_t token_len);
+
+/* Send due retransmissions and time out unacknowledged transactions. Returns the time in milliseconds until
+ * it should next be called, or -1 if there are no outstanding transactions.
+ */
+int coap_check_transactions(void);
 
 #endif /* COAP_TRANSACTIONS_H_ */
@@ -196,7 +196,7 @@ coap_serialize_int_option(unsigned int number, unsigned int current_number,
 /*---------------------------------------------------------------------------*/
 static size_t
 coap_serialize_array_option(unsigned int number, unsigned int current_number,
-        uint8_t *buffer, uint8_t *array, size_t length,
+        uint8_t *buffer, const uint8_t *array, size_t length,
         char split_char)
 {
     size_t i = 0;
@@ -207,8 +207,8 @@ coap_serialize_array_option(unsigned int number, unsigned int current_number,
     if(split_char != '\0')
     {
         int j;
-        uint8_t *part_start = array;
-        uint8_t *part_end = NULL;
+        const uint8_t *part_start = array;
+        const uint8_t *part_end = NULL;
         size_t temp_length;
 
         for(j = 0; j <= length + 1; ++j) {
@@ -459,8 +459,8 @@ coap_serialize_message(void *packet, uint8_t *buffer)
     return (option - buffer) + coap_pkt->payload_len; /* packet length */
 }
 /*---------------------------------------------------------------------------*/
-coap_status_t
-coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
+static coap_status_t
+coap_parse(void *packet, uint8_t *data, uint16_t data_len, uint16_t max_payload_len)
 {
     coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
 
@@ -494,7 +494,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
 
     uint8_t *current_option = data + COAP_HEADER_LEN;
 
-    memcpy(coap_pkt->token, current_option, coap_pkt->token_len);
+    coap_pkt->token = current_option;
     PRINTF("Token (len %u) [0x%02X%02X%02X%02X%02X%02X%02X%02X]\n",
             coap_pkt->token_len, coap_pkt->token[0], coap_pkt->token[1],
             coap_pkt->token[2], coap_pkt->token[3], coap_pkt->token[4],
@@ -506,6 +506,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
     current_option += coap_pkt->token_len;
 
     unsigned int option_number = 0;
+    unsigned int szx = 0;
 
     while(current_option < data + data_len)
     {
@@ -518,9 +519,9 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
             coap_pkt->payload_len = data_len - (coap_pkt->payload - data);
 
             /* also for receiving, the Erbium upper bound is REST_MAX_CHUNK_SIZE */
-            if(coap_pkt->payload_len > REST_MAX_CHUNK_SIZE)
+            if(coap_pkt->payload_len > max_payload_len)
             {
-                coap_pkt->payload_len = REST_MAX_CHUNK_SIZE;
+                coap_pkt->payload_len = max_payload_len;
                 /* null-terminate payload */
             }
             coap_pkt->payload[coap_pkt->payload_len] = '\0';
@@ -578,7 +579,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
             break;
         case COAP_OPTION_ETAG:
             coap_pkt->etag_len = MIN(COAP_ETAG_LEN, option_length);
-            memcpy(coap_pkt->etag, current_option, coap_pkt->etag_len);
+            coap_pkt->etag = current_option;
             PRINTF("ETag %u [0x%02X%02X%02X%02X%02X%02X%02X%02X]\n",
                     coap_pkt->etag_len, coap_pkt->etag[0], coap_pkt->etag[1],
                     coap_pkt->etag[2], coap_pkt->etag[3], coap_pkt->etag[4],
@@ -592,7 +593,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
         case COAP_OPTION_IF_MATCH:
             /* TODO support multiple ETags */
             coap_pkt->if_match_len = MIN(COAP_ETAG_LEN, option_length);
-            memcpy(coap_pkt->if_match, current_option, coap_pkt->if_match_len);
+            coap_pkt->if_match = current_option;
             PRINTF("If-Match %u [0x%02X%02X%02X%02X%02X%02X%02X%02X]\n",
                     coap_pkt->if_match_len, coap_pkt->if_match[0],
                     coap_pkt->if_match[1], coap_pkt->if_match[2],
@@ -683,9 +684,14 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
             coap_pkt->block2_num = coap_parse_int_option(current_option,
                     option_length);
             coap_pkt->block2_more = (coap_pkt->block2_num & 0x08) >> 3;
-            coap_pkt->block2_size = 16 << (coap_pkt->block2_num & 0x07);
-            coap_pkt->block2_offset = (coap_pkt->block2_num & ~0x0000000F)
-                << (coap_pkt->block2_num & 0x07);
+            /* a BERT block is numbered, and sized, in 1024 byte blocks */
+            szx = coap_pkt->block2_num & 0x07;
+            if(szx == COAP_BLOCK_SZX_BERT)
+            {
+                szx = COAP_BLOCK_SZX_BERT - 1;
+            }
+            coap_pkt->block2_size = 16 << szx;
+            coap_pkt->block2_offset = (coap_pkt->block2_num & ~0x0000000F) << szx;
             coap_pkt->block2_num >>= 4;
             PRINTF("Block2 [%lu%s (%u B/blk)]\n",
                     (unsigned long)coap_pkt->block2_num,
@@ -695,9 +701,14 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
             coap_pkt->block1_num = coap_parse_int_option(current_option,
                     option_length);
             coap_pkt->block1_more = (coap_pkt->block1_num & 0x08) >> 3;
-            coap_pkt->block1_size = 16 << (coap_pkt->block1_num & 0x07);
-            coap_pkt->block1_offset = (coap_pkt->block1_num & ~0x0000000F)
-                << (coap_pkt->block1_num & 0x07);
+            /* a BERT block is numbered, and sized, in 1024 byte blocks */
+            szx = coap_pkt->block1_num & 0x07;
+            if(szx == COAP_BLOCK_SZX_BERT)
+            {
+                szx = COAP_BLOCK_SZX_BERT - 1;
+            }
+            coap_pkt->block1_size = 16 << szx;
+            coap_pkt->block1_offset = (coap_pkt->block1_num & ~0x0000000F) << szx;
             coap_pkt->block1_num >>= 4;
             PRINTF("Block1 [%lu%s (%u B/blk)]\n",
                     (unsigned long)coap_pkt->block1_num,
@@ -726,6 +737,16 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
 
     return NO_ERROR;
 }
+coap_status_t
+coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
+{
+    return coap_parse(packet, data, data_len, REST_MAX_CHUNK_SIZE);
+}
+coap_status_t
+coap_parse_reliable_message(void *packet, uint8_t *data, uint16_t data_len)
+{
+    return coap_parse(packet, data, data_len, data_len);
+}
 /*---------------------------------------------------------------------------*/
 /*- REST Engine API ---------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -771,7 +792,7 @@ coap_set_token(void *packet, const uint8_t *token, size_t token_len)
     coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
 
     coap_pkt->token_len = MIN(COAP_TOKEN_LEN, token_len);
-    memcpy(coap_pkt->token, token, coap_pkt->token_len);
+    coap_pkt->token = token;
 
     return coap_pkt->token_len;
 }
@@ -862,7 +883,7 @@ coap_set_header_etag(void *packet, const uint8_t *etag, size_t etag_len)
     coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
 
     coap_pkt->etag_len = MIN(COAP_ETAG_LEN, etag_len);
-    memcpy(coap_pkt->etag, etag, coap_pkt->etag_len);
+    coap_pkt->etag = etag;
 
     SET_OPTION(coap_pkt, COAP_OPTION_ETAG);
     return coap_pkt->etag_len;
@@ -887,7 +908,7 @@ coap_set_header_if_match(void *packet, const uint8_t *etag, size_t etag_len)
     coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
 
     coap_pkt->if_match_len = MIN(COAP_ETAG_LEN, etag_len);
-    memcpy(coap_pkt->if_match, etag, coap_pkt->if_match_len);
+    coap_pkt->if_match = etag;
 
     SET_OPTION(coap_pkt, COAP_OPTION_IF_MATCH);
     return coap_pkt->if_match_len;
@@ -1136,7 +1157,7 @@ coap_set_header_block2(void *packet, uint32_t num, uint8_t more,
     {
         return 0;
     }
-    if(size > 2048)
+    if((size > 2048) && (size % COAP_BERT_BLOCK_SIZE))
     {
         return 0;
     }
@@ -1191,7 +1212,7 @@ coap_set_header_block1(void *packet, uint32_t num, uint8_t more,
     {
         return 0;
     }
-    if(size > 2048)
+    if((size > 2048) && (size % COAP_BERT_BLOCK_SIZE))
     {
         return 0;
     }
@@ -1276,4 +1297,14 @@ coap_set_payload(void *packet, const void *payload, size_t length)
 
     return coap_pkt->payload_len;
 }
+int
+coap_set_bert_payload(void *packet, const void *payload, size_t length)
+{
+    coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+
+    coap_pkt->payload = (uint8_t *)payload;
+    coap_pkt->payload_len = MIN(COAP_MAX_MESSAGE_SIZE_TCP - COAP_MAX_HEADER_SIZE, length);
+
+    return coap_pkt->payload_len;
+}
 /*---------------------------------------------------------------------------*/
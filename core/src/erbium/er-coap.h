@@ -88,7 +88,7 @@ typedef uip_ipaddr_t ipaddr_t;
 
 
 #ifndef REST_MAX_CHUNK_SIZE
-#define REST_MAX_CHUNK_SIZE (512)
+#define REST_MAX_CHUNK_SIZE (1024)
 #endif /* REST_MAX_CHUNK_SIZE */
 
 /* REST_MAX_CHUNK_SIZE can be different from 2^x so we need to get next lower 2^x for COAP_MAX_BLOCK_SIZE */
@@ -129,15 +129,16 @@ typedef struct {
     uint8_t code;
     uint16_t mid;
 
+    /* like the string options, token and ETags refer to the parsed buffer, or to the values set until serialised */
     uint8_t token_len;
-    uint8_t token[COAP_TOKEN_LEN];
+    const uint8_t *token;
 
     uint8_t options[COAP_OPTION_SIZE1 / OPTION_MAP_SIZE + 1]; /* bitmap to check if option is set */
 
     uint16_t content_format; /* parse options once and store; allows setting options in random order  */
     uint32_t max_age;
     uint8_t etag_len;
-    uint8_t etag[COAP_ETAG_LEN];
+    const uint8_t *etag;
     size_t proxy_uri_len;
     const char *proxy_uri;
     size_t proxy_scheme_len;
@@ -154,7 +155,7 @@ typedef struct {
     int32_t observe;
     uint16_t accept;
     uint8_t if_match_len;
-    uint8_t if_match[COAP_ETAG_LEN];
+    const uint8_t *if_match;
     uint32_t block2_num;
     uint8_t block2_more;
     uint16_t block2_size;
@@ -198,7 +199,7 @@ typedef struct {
 #define COAP_SERIALIZE_STRING_OPTION(number, field, splitter, text) \
         if(IS_OPTION(coap_pkt, number)) { \
             PRINTF(text " [%.*s]\n", (int)coap_pkt->field##_len, coap_pkt->field); \
-            option += coap_serialize_array_option(number, current_number, option, (uint8_t *)coap_pkt->field, coap_pkt->field##_len, splitter); \
+            option += coap_serialize_array_option(number, current_number, option, (const uint8_t *)coap_pkt->field, coap_pkt->field##_len, splitter); \
             current_number = number; \
         }
 #define COAP_SERIALIZE_BLOCK_OPTION(number, field, text) \
@@ -207,7 +208,7 @@ typedef struct {
             PRINTF(text " [%lu%s (%u B/blk)]\n", (unsigned long)coap_pkt->field##_num, coap_pkt->field##_more ? "+" : "", coap_pkt->field##_size); \
             uint32_t block = coap_pkt->field##_num << 4; \
             if(coap_pkt->field##_more) { block |= 0x8; } \
-            block |= 0xF & coap_log_2(coap_pkt->field##_size / 16); \
+            block |= 0xF & ((coap_pkt->field##_size > COAP_BERT_BLOCK_SIZE) ? COAP_BLOCK_SZX_BERT : coap_log_2(coap_pkt->field##_size / 16)); \
             PRINTF(text " encoded: 0x%lX\n", (unsigned long)block);		\
             option += coap_serialize_int_option(number, current_number, option, block); \
             current_number = number; \
@@ -223,6 +224,8 @@ uint16_t coap_get_mid(void);
 void coap_init_message(void *packet, coap_message_type_t type, uint8_t code,
         uint16_t mid);
 size_t coap_serialize_message(void *packet, uint8_t *buffer);
+/* messages received over a connection may carry more than REST_MAX_CHUNK_SIZE (a BERT block) */
+coap_status_t coap_parse_reliable_message(void *request, uint8_t *data, uint16_t data_len);
 coap_status_t coap_parse_message(void *request, uint8_t *data,
         uint16_t data_len);
 
@@ -298,8 +301,15 @@ int coap_set_header_size1(void *packet, uint32_t size);
 
 int coap_get_payload(void *packet, const uint8_t **payload);
 int coap_set_payload(void *packet, const void *payload, size_t length);
+/* a payload up to a BERT block - the length must be bounded by the block size agreed with the peer */
+int coap_set_bert_payload(void *packet, const void *payload, size_t length);
 
-#define COAP_BUFFER_LENGTH   1024
+/* room for a message carrying a full block, and the DTLS record around it */
+#if COAP_MAX_MESSAGE_SIZE_TCP > COAP_MAX_PACKET_SIZE
+#define COAP_BUFFER_LENGTH   (COAP_MAX_MESSAGE_SIZE_TCP + 256)
+#else
+#define COAP_BUFFER_LENGTH   (COAP_MAX_PACKET_SIZE + 256)
+#endif
 extern uint8_t CoapBuffer[COAP_BUFFER_LENGTH];
 
 
@@ -16,12 +16,13 @@ typedef enum {
   METHOD_POST = (1 << 1),
   METHOD_PUT = (1 << 2),
   METHOD_DELETE = (1 << 3),
+  METHOD_FETCH = (1 << 4),
 
   /* special flags */
-  HAS_SUB_RESOURCES = (1 << 4),
-  IS_SEPARATE = (1 << 5),
-  IS_OBSERVABLE = (1 << 6),
-  IS_PERIODIC = (1 << 7)
+  HAS_SUB_RESOURCES = (1 << 5),
+  IS_SEPARATE = (1 << 6),
+  IS_OBSERVABLE = (1 << 7),
+  IS_PERIODIC = (1 << 8)
 } rest_resource_flags_t;
 
 struct resource_s;
@@ -0,0 +1,251 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lwm2m_debug.h"
+#include "lwm2m_list.h"
+#include "lwm2m_hash.h"
+#include "lwm2m_admission_control.h"
+
+// How long a pending slot is held for a client that does not retry on time
+#define PENDING_SLOT_GRACE_MS (30000)
+
+// random() returns values in [0, 2^31 - 1]; the daemons seed it at start-up
+#define RANDOM_MAX (0x7FFFFFFF)
+
+typedef struct
+{
+    HashTableNode Node;
+    struct ListHead list;   // pending queue, in slot order
+    uint64_t SlotTime;      // time at which the client's reserved token becomes available
+    char Key[];
+
+} PendingEntry;
+
+struct _AdmissionControl
+{
+    double Tokens;          // negative while tokens are reserved for pending clients
+    double Rate;            // tokens per millisecond
+    double Burst;
+    uint64_t LastRefill;
+    int MaxPending;
+    HashTable PendingTable;
+    struct ListHead PendingQueue;
+    AdmissionStatistics Statistics;
+};
+
+static bool MatchPendingEntry(const HashTableNode * node, const void * key)
+{
+    return strcmp(HashTableEntry(node, PendingEntry, Node)->Key, (const char *)key) == 0;
+}
+
+static uint32_t MillisecondsToSeconds(double ms)
+{
+    uint32_t seconds = (uint32_t)((ms + 999) / 1000);
+    return (seconds > 0) ? seconds : 1;
+}
+
+static void RemovePendingEntry(AdmissionControl * admission, PendingEntry * entry)
+{
+    HashTable_Remove(&admission->PendingTable, &entry->Node);
+    ListRemove(&entry->list);
+    admission->Statistics.Pending--;
+    free(entry);
+}
+
+static void Refill(AdmissionControl * admission, uint64_t now)
+{
+    if (now > admission->LastRefill)
+    {
+        admission->Tokens += (now - admission->LastRefill) * admission->Rate;
+        if (admission->Tokens > admission->Burst)
+        {
+            admission->Tokens = admission->Burst;
+        }
+    }
+    admission->LastRefill = now;
+}
+
+/* Drop slots held by clients that did not come back in time, returning the tokens reserved for them to the bucket.
+ * Slots are handed out in time order.
+ */
+static void ExpirePendingEntries(AdmissionControl * admission, uint64_t now)
+{
+    while (admission->PendingQueue.Next != &admission->PendingQueue)
+    {
+        PendingEntry * entry = ListEntry(admission->PendingQueue.Next, PendingEntry, list);
+        if (entry->SlotTime + PENDING_SLOT_GRACE_MS > now)
+        {
+            break;
+        }
+        Lwm2m_Debug("Pending slot for %s expired\n", entry->Key);
+        RemovePendingEntry(admission, entry);
+
+        admission->Tokens += 1.0;
+        if (admission->Tokens > admission->Burst)
+        {
+            admission->Tokens = admission->Burst;
+        }
+    }
+}
+
+AdmissionControl * AdmissionControl_New(int rate, int burst, int maxPending)
+{
+    AdmissionControl * admission = NULL;
+    if ((rate > 0) && (burst > 0) && (maxPending >= 0))
+    {
+        admission = malloc(sizeof(*admission));
+        if (admission != NULL)
+        {
+            memset(admission, 0, sizeof(*admission));
+            admission->Rate = rate / 1000.0;
+            admission->Burst = burst;
+            admission->Tokens = burst;
+            admission->MaxPending = maxPending;
+            ListInit(&admission->PendingQueue);
+            if (HashTable_Init(&admission->PendingTable, maxPending) != 0)
+            {
+                free(admission);
+                admission = NULL;
+            }
+        }
+        if (admission == NULL)
+        {
+            Lwm2m_Error("Out of memory\n");
+        }
+    }
+    else
+    {
+        Lwm2m_Error("Invalid admission control parameters: rate %d, burst %d, maxPending %d\n", rate, burst, maxPending);
+    }
+    return admission;
+}
+
+void AdmissionControl_Free(AdmissionControl ** admission)
+{
+    if ((admission != NULL) && (*admission != NULL))
+    {
+        struct ListHead * i, * n;
+        ListForEachSafe(i, n, &(*admission)->PendingQueue)
+        {
+            free(ListEntry(i, PendingEntry, list));
+        }
+        HashTable_Destroy(&(*admission)->PendingTable);
+        free(*admission);
+        *admission = NULL;
+    }
+}
+
+AdmissionResult AdmissionControl_Admit(AdmissionControl * admission, const char * key, uint64_t now, uint32_t * retryAfter)
+{
+    AdmissionResult result = AdmissionResult_Accepted;
+
+    if (admission == NULL)
+    {
+        return AdmissionResult_Accepted;
+    }
+
+    Refill(admission, now);
+    ExpirePendingEntries(admission, now);
+
+    uint32_t hash = Hash_String(key, HASH_SEED);
+    HashTableNode * node = HashTable_Find(&admission->PendingTable, hash, MatchPendingEntry, key);
+    if (node != NULL)
+    {
+        // A deferred client retrying - its token was reserved when it was deferred
+        PendingEntry * entry = HashTableEntry(node, PendingEntry, Node);
+        if (now >= entry->SlotTime)
+        {
+            RemovePendingEntry(admission, entry);
+            result = AdmissionResult_Accepted;
+        }
+        else
+        {
+            *retryAfter = MillisecondsToSeconds(entry->SlotTime - now);
+            result = AdmissionResult_Deferred;
+        }
+    }
+    else if (admission->Tokens >= 1.0)
+    {
+        admission->Tokens -= 1.0;
+        result = AdmissionResult_Accepted;
+    }
+    else if (admission->Statistics.Pending < admission->MaxPending)
+    {
+        PendingEntry * entry = malloc(sizeof(PendingEntry) + strlen(key) + 1);
+        if (entry != NULL)
+        {
+            // Reserve a token - the slot comes up when the bucket has refilled enough to cover it
+            admission->Tokens -= 1.0;
+            entry->SlotTime = now + (uint64_t)(-admission->Tokens / admission->Rate);
+            strcpy(entry->Key, key);
+            HashTable_Add(&admission->PendingTable, &entry->Node, hash);
+            ListAdd(&entry->list, &admission->PendingQueue);
+            admission->Statistics.Pending++;
+
+            *retryAfter = MillisecondsToSeconds(entry->SlotTime - now);
+            result = AdmissionResult_Deferred;
+        }
+        else
+        {
+            *retryAfter = MillisecondsToSeconds(admission->MaxPending / admission->Rate);
+            result = AdmissionResult_Rejected;
+        }
+    }
+    else
+    {
+        // Back off long enough for the pending queue to drain, spread out so that rejected clients do not all return together
+        double drainTime = (admission->MaxPending + 1) / admission->Rate;
+        *retryAfter = MillisecondsToSeconds(drainTime + drainTime * (random() / (double)RANDOM_MAX));
+        result = AdmissionResult_Rejected;
+    }
+
+    switch (result)
+    {
+        case AdmissionResult_Accepted:
+            admission->Statistics.Accepted++;
+            break;
+        case AdmissionResult_Deferred:
+            admission->Statistics.Deferred++;
+            break;
+        case AdmissionResult_Rejected:
+            admission->Statistics.Rejected++;
+            break;
+    }
+    return result;
+}
+
+void AdmissionControl_GetStatistics(const AdmissionControl * admission, AdmissionStatistics * statistics)
+{
+    if (admission != NULL)
+    {
+        *statistics = admission->Statistics;
+    }
+    else
+    {
+        memset(statistics, 0, sizeof(*statistics));
+    }
+}
@@ -0,0 +1,82 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef LWM2M_ADMISSION_CONTROL_H
+#define LWM2M_ADMISSION_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Admission control for registration and update requests, to stop a fleet of clients re-registering at once
+ * (e.g. after a network outage) from overloading the server.
+ *
+ * Requests are admitted at a sustained rate by a token bucket. When the bucket is empty a request is deferred:
+ * the client is given a slot in a bounded pending queue and told to retry when its slot comes up, and the token
+ * it will need is reserved so that new arrivals cannot take it. A client that retries at or after its slot is
+ * admitted. When the pending queue is full, requests are rejected and the client is told to back off for long
+ * enough for the queue to drain.
+ */
+
+typedef enum
+{
+    AdmissionResult_Accepted,
+    AdmissionResult_Deferred,
+    AdmissionResult_Rejected,
+
+} AdmissionResult;
+
+typedef struct
+{
+    uint32_t Accepted;
+    uint32_t Deferred;
+    uint32_t Rejected;
+    uint32_t Pending;     // clients currently holding a slot in the pending queue
+
+} AdmissionStatistics;
+
+typedef struct _AdmissionControl AdmissionControl;
+
+/* rate is the sustained number of requests admitted per second, burst the number that may be admitted at once,
+ * and maxPending the capacity of the pending queue.
+ */
+AdmissionControl * AdmissionControl_New(int rate, int burst, int maxPending);
+void AdmissionControl_Free(AdmissionControl ** admission);
+
+/* Decide whether to admit a request from the client identified by key, at time now (in milliseconds).
+ * If the request is deferred or rejected, retryAfter is set to the number of seconds the client should wait
+ * before trying again.
+ */
+AdmissionResult AdmissionControl_Admit(AdmissionControl * admission, const char * key, uint64_t now, uint32_t * retryAfter);
+
+void AdmissionControl_GetStatistics(const AdmissionControl * admission, AdmissionStatistics * statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LWM2M_ADMISSION_CONTROL_H
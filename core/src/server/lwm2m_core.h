@@ -39,6 +39,8 @@
 #include "lwm2m_endpoints.h"
 #include "lwm2m_request_origin.h"
 #include "lwm2m_observers.h"
+#include "lwm2m_registration_store.h"
+#include "lwm2m_admission_control.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -95,6 +97,13 @@ AwaContentType Lwm2mCore_GetContentType(Lwm2mContextType * context);
 int Lwm2mCore_GetLastLocation(Lwm2mContextType * context);
 struct ListHead * Lwm2mCore_GetEventRecordList(Lwm2mContextType * context);
 void Lwm2mCore_SetLastLocation(Lwm2mContextType * context, int location);
+RegistrationStore * Lwm2mCore_GetRegistrationStore(Lwm2mContextType * context);
+void Lwm2mCore_SetRegistrationStore(Lwm2mContextType * context, RegistrationStore * store);
+AdmissionControl * Lwm2mCore_GetAdmissionControl(Lwm2mContextType * context);
+void Lwm2mCore_SetAdmissionControl(Lwm2mContextType * context, AdmissionControl * admission);
+
+// Set the Max-Age option on the response to the request currently being handled
+void Lwm2mCore_SetResponseMaxAge(Lwm2mContextType * context, uint32_t maxAge);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,226 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lwm2m_debug.h"
+#include "lwm2m_hash.h"
+#include "lwm2m_object_list.h"
+
+/* Each entry is packed into 32 bits - the object ID in the upper half and the instance ID plus one in the lower
+ * half - so that an object announced without instances (instance -1) sorts before all of its instances.
+ */
+#define MAX_OBJECT_LIST_ID (0xFFFF)
+
+#define MAKE_KEY(objectID, instanceID) (((uint32_t)(objectID) << 16) | (uint16_t)((instanceID) + 1))
+#define KEY_OBJECT_ID(key)             ((ObjectIDType)((key) >> 16))
+#define KEY_INSTANCE_ID(key)           ((ObjectInstanceIDType)((key) & 0xFFFF) - 1)
+
+struct _ObjectList
+{
+    HashTableNode Node;
+    int RefCount;
+    size_t Count;
+    uint32_t Keys[];   // sorted, no duplicates
+};
+
+typedef struct
+{
+    const uint32_t * Keys;
+    size_t Count;
+
+} ObjectListKey;
+
+// All object lists in use, indexed by content
+static HashTable internedLists;
+
+static int CompareKeys(const void * a, const void * b)
+{
+    uint32_t keyA = *(const uint32_t *)a;
+    uint32_t keyB = *(const uint32_t *)b;
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+static bool MatchObjectList(const HashTableNode * node, const void * key)
+{
+    const ObjectListType * list = HashTableEntry(node, ObjectListType, Node);
+    const ObjectListKey * listKey = (const ObjectListKey *)key;
+    return (list->Count == listKey->Count) && (memcmp(list->Keys, listKey->Keys, list->Count * sizeof(uint32_t)) == 0);
+}
+
+// Index of the first key not less than key
+static size_t LowerBound(const ObjectListType * list, uint32_t key)
+{
+    size_t low = 0;
+    size_t high = list->Count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (list->Keys[middle] < key)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+ObjectListType * ObjectList_Acquire(ObjectListEntry * entries, size_t numberOfEntries)
+{
+    ObjectListType * list = NULL;
+    uint32_t * keys = malloc((numberOfEntries > 0 ? numberOfEntries : 1) * sizeof(uint32_t));
+    size_t count = 0;
+    size_t i;
+
+    if (keys == NULL)
+    {
+        Lwm2m_Error("Out of memory\n");
+        goto done;
+    }
+
+    for (i = 0; i < numberOfEntries; i++)
+    {
+        if ((entries[i].ObjectID < 0) || (entries[i].ObjectID > MAX_OBJECT_LIST_ID) ||
+            (entries[i].InstanceID < -1) || (entries[i].InstanceID >= MAX_OBJECT_LIST_ID))
+        {
+            Lwm2m_Error("Invalid object list entry /%d/%d\n", entries[i].ObjectID, entries[i].InstanceID);
+            continue;
+        }
+        keys[count++] = MAKE_KEY(entries[i].ObjectID, entries[i].InstanceID);
+    }
+
+    qsort(keys, count, sizeof(uint32_t), CompareKeys);
+
+    // remove duplicates
+    if (count > 1)
+    {
+        size_t unique = 1;
+        for (i = 1; i < count; i++)
+        {
+            if (keys[i] != keys[unique - 1])
+            {
+                keys[unique++] = keys[i];
+            }
+        }
+        count = unique;
+    }
+
+    if ((internedLists.Buckets == NULL) && (HashTable_Init(&internedLists, 0) != 0))
+    {
+        Lwm2m_Error("Out of memory\n");
+        goto done;
+    }
+
+    ObjectListKey key = { .Keys = keys, .Count = count };
+    uint32_t hash = Hash_Bytes(keys, count * sizeof(uint32_t), HASH_SEED);
+    HashTableNode * node = HashTable_Find(&internedLists, hash, MatchObjectList, &key);
+    if (node != NULL)
+    {
+        list = HashTableEntry(node, ObjectListType, Node);
+        list->RefCount++;
+    }
+    else
+    {
+        list = malloc(sizeof(ObjectListType) + count * sizeof(uint32_t));
+        if (list != NULL)
+        {
+            list->RefCount = 1;
+            list->Count = count;
+            memcpy(list->Keys, keys, count * sizeof(uint32_t));
+            HashTable_Add(&internedLists, &list->Node, hash);
+        }
+        else
+        {
+            Lwm2m_Error("Out of memory\n");
+        }
+    }
+
+done:
+    free(keys);
+    return list;
+}
+
+void ObjectList_Release(ObjectListType ** list)
+{
+    if ((list != NULL) && (*list != NULL))
+    {
+        if (--(*list)->RefCount == 0)
+        {
+            HashTable_Remove(&internedLists, &(*list)->Node);
+            free(*list);
+
+            if (HashTable_Count(&internedLists) == 0)
+            {
+                HashTable_Destroy(&internedLists);
+            }
+        }
+        *list = NULL;
+    }
+}
+
+bool ObjectList_Contains(const ObjectListType * list, ObjectIDType objectID, ObjectInstanceIDType instanceID)
+{
+    bool result = false;
+    if ((list != NULL) && (objectID >= 0) && (objectID <= MAX_OBJECT_LIST_ID) && (instanceID >= -1) && (instanceID < MAX_OBJECT_LIST_ID))
+    {
+        if (instanceID == -1)
+        {
+            // any entry for the object - the object without instances sorts first
+            size_t index = LowerBound(list, MAKE_KEY(objectID, -1));
+            result = (index < list->Count) && (KEY_OBJECT_ID(list->Keys[index]) == objectID);
+        }
+        else
+        {
+            uint32_t key = MAKE_KEY(objectID, instanceID);
+            size_t index = LowerBound(list, key);
+            result = (index < list->Count) && (list->Keys[index] == key);
+        }
+    }
+    return result;
+}
+
+size_t ObjectList_GetCount(const ObjectListType * list)
+{
+    return (list != NULL) ? list->Count : 0;
+}
+
+ObjectListEntry ObjectList_GetEntry(const ObjectListType * list, size_t index)
+{
+    ObjectListEntry entry = { .ObjectID = -1, .InstanceID = -1 };
+    if ((list != NULL) && (index < list->Count))
+    {
+        entry.ObjectID = KEY_OBJECT_ID(list->Keys[index]);
+        entry.InstanceID = KEY_INSTANCE_ID(list->Keys[index]);
+    }
+    return entry;
+}
+
+size_t ObjectList_GetNumberOfUniqueLists(void)
+{
+    return HashTable_Count(&internedLists);
+}
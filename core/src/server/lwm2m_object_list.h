@@ -0,0 +1,71 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef LWM2M_OBJECT_LIST_H
+#define LWM2M_OBJECT_LIST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "lwm2m_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The set of objects and object instances a client announces when it registers, stored as a sorted array so
+ * that membership can be tested with a binary search. Object lists are immutable and interned - clients that
+ * register identical lists share a single reference-counted copy.
+ */
+typedef struct _ObjectList ObjectListType;
+
+typedef struct
+{
+    ObjectIDType ObjectID;
+    ObjectInstanceIDType InstanceID;   // -1 if the object was announced without any instances
+
+} ObjectListEntry;
+
+/* Return a reference to the object list holding the specified entries, creating it if no client has registered
+ * the same list. The entries may be in any order and may contain duplicates; they are sorted in place.
+ * Release the reference with ObjectList_Release.
+ */
+ObjectListType * ObjectList_Acquire(ObjectListEntry * entries, size_t numberOfEntries);
+void ObjectList_Release(ObjectListType ** list);
+
+// Returns true if the list contains the object instance, or any instance of the object if instanceID is -1
+bool ObjectList_Contains(const ObjectListType * list, ObjectIDType objectID, ObjectInstanceIDType instanceID);
+
+size_t ObjectList_GetCount(const ObjectListType * list);
+ObjectListEntry ObjectList_GetEntry(const ObjectListType * list, size_t index);
+
+// Number of distinct object lists currently held by registered clients
+size_t ObjectList_GetNumberOfUniqueLists(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LWM2M_OBJECT_LIST_H
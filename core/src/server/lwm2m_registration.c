@@ -25,11 +25,14 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "lwm2m_core.h"
 #include "lwm2m_result.h"
 #include "lwm2m_endpoints.h"
+#include "lwm2m_metrics.h"
 #include "server/lwm2m_registration.h"
+#include "server/lwm2m_registration_store.h"
 
 #define QUERY_EP_NAME  "ep="
 #define QUERY_LIFETIME "lt="
@@ -52,8 +55,6 @@ typedef struct
 
 } EventRecord;
 
-static void DestroyObjectList(struct ListHead * objectList);
-
 static int RegistrationEndpointHandler(int type, void * ctxt, AddressType * addr, const char * path, const char * query, const char * token,
                                        int tokenLength, AwaContentType contentType, const char * requestContent, size_t requestContentLen,
                                        AwaContentType * responseContentType, char * responseContent, size_t * responseContentLen, int * responseCode);
@@ -107,39 +108,27 @@ static void Lwm2m_SplitUpQuery(const char * query, RegistrationQueryString * res
 
 bool Lwm2m_ClientSupportsObject(Lwm2mClientType * client, ObjectIDType objectID, ObjectInstanceIDType instanceID)
 {
-    bool clientSupportsObject = false;
-    struct ListHead * i;
-    ListForEach(i, &client->ObjectList)
-    {
-        ObjectListEntry * entry = ListEntry(i, ObjectListEntry, list);
-        if ((entry->ObjectID == objectID) &&
-            ((entry->InstanceID == instanceID) || (instanceID == -1)))
-        {
-            clientSupportsObject = true;
-            break;
-        }
-    }
-    return clientSupportsObject;
+    return ObjectList_Contains(client->ObjectList, objectID, instanceID);
 }
 
-// parse object list in "CoRE" format
-static void Lwm2m_ParseObjectList(Lwm2mClientType * client, const char * objectList, int objectListLength)
+// parse object list in "CoRE" format. Returns 0 on success, or -1 if out of memory, in which case the client's object list is unchanged
+static int Lwm2m_ParseObjectList(Lwm2mClientType * client, const char * objectList, int objectListLength)
 {
-    // clear all entries out of object list
-    struct ListHead * i, * n;
-    ListForEachSafe(i, n, &client->ObjectList)
-    {
-        ObjectListEntry * entry = ListEntry(i, ObjectListEntry, list);
-        ListRemove(i);
-        free(entry);
-    }
+    ObjectListEntry * entries = NULL;
+    size_t numberOfEntries = 0;
+    size_t capacity = 0;
+    bool outOfMemory = false;
+    char altPath[128];
+    strcpy(altPath, "/"); // Assume root path is "/" until proven otherwise
 
     if ((objectListLength > 0) && (objectList != NULL))
     {
-        char altPath[128];
-        strcpy(altPath, "/"); // Assume root path is "/" until proven otherwise
-
         char * str = strndup(objectList, objectListLength);
+        if (str == NULL)
+        {
+            Lwm2m_Error("Out of memory\n");
+            return -1;
+        }
         const char delim[] = ", ";
         char * savePointer;
 
@@ -192,17 +181,22 @@ static void Lwm2m_ParseObjectList(Lwm2mClientType * client, const char * objectL
                     continue;
                 }
 
-                // Create new entry, perhaps check for duplicates?
-                ObjectListEntry * entry = malloc(sizeof(ObjectListEntry));
-                if (entry == NULL)
+                if (numberOfEntries == capacity)
                 {
-                    break;
+                    size_t newCapacity = (capacity == 0) ? 16 : capacity * 2;
+                    ObjectListEntry * newEntries = realloc(entries, newCapacity * sizeof(ObjectListEntry));
+                    if (newEntries == NULL)
+                    {
+                        outOfMemory = true;
+                        break;
+                    }
+                    entries = newEntries;
+                    capacity = newCapacity;
                 }
 
-                entry->ObjectID = object;
-                entry->InstanceID = instance;
-
-                ListAdd(&entry->list, &client->ObjectList);
+                entries[numberOfEntries].ObjectID = object;
+                entries[numberOfEntries].InstanceID = instance;
+                numberOfEntries++;
             }
 
         skip:
@@ -210,21 +204,34 @@ static void Lwm2m_ParseObjectList(Lwm2mClientType * client, const char * objectL
         }
 
         free(str);
+    }
 
-        // Debug, printout list
-        ListForEach(i, &client->ObjectList)
+    // Replace the client's object list with the shared copy of the new one
+    ObjectListType * newObjectList = outOfMemory ? NULL : ObjectList_Acquire(entries, numberOfEntries);
+    free(entries);
+    if (newObjectList == NULL)
+    {
+        Lwm2m_Error("Failed to store object list\n");
+        return -1;
+    }
+    ObjectList_Release(&client->ObjectList);
+    client->ObjectList = newObjectList;
+
+    // Debug, printout list
+    size_t i;
+    for (i = 0; i < ObjectList_GetCount(client->ObjectList); i++)
+    {
+        ObjectListEntry entry = ObjectList_GetEntry(client->ObjectList, i);
+        if (entry.InstanceID != -1)
         {
-            ObjectListEntry * entry = ListEntry(i, ObjectListEntry, list);
-            if (entry->InstanceID != -1)
-            {
-                Lwm2m_Info("Path %s Object %d, Instance %d\n", altPath, entry->ObjectID, entry->InstanceID);
-            }
-            else
-            {
-                Lwm2m_Info("Path %s Object %d\n", altPath, entry->ObjectID);
-            }
+            Lwm2m_Info("Path %s Object %d, Instance %d\n", altPath, entry.ObjectID, entry.InstanceID);
+        }
+        else
+        {
+            Lwm2m_Info("Path %s Object %d\n", altPath, entry.ObjectID);
         }
     }
+    return 0;
 }
 
 static void Lwm2m_ReleaseQueryString(RegistrationQueryString * queryString)
@@ -305,6 +312,92 @@ static void DispatchRegistrationEventCallbacks(Lwm2mContextType * lwm2mContext,
     }
 }
 
+// Build the client's object list in CoRE link format, i.e </1/0>,</3/0>. The caller must free the result.
+static char * Lwm2m_ObjectListToLinkFormat(Lwm2mClientType * client)
+{
+    size_t count = ObjectList_GetCount(client->ObjectList);
+    char * objectList = malloc(count * sizeof("</65535/65535>,") + 1);
+    if (objectList != NULL)
+    {
+        size_t len = 0;
+        size_t i;
+        objectList[0] = '\0';
+        for (i = 0; i < count; i++)
+        {
+            ObjectListEntry entry = ObjectList_GetEntry(client->ObjectList, i);
+            const char * separator = (len > 0) ? "," : "";
+            if (entry.InstanceID != -1)
+            {
+                len += sprintf(&objectList[len], "%s</%d/%d>", separator, entry.ObjectID, entry.InstanceID);
+            }
+            else
+            {
+                len += sprintf(&objectList[len], "%s</%d>", separator, entry.ObjectID);
+            }
+        }
+    }
+    return objectList;
+}
+
+static bool Lwm2m_ClientToRegistrationRecord(Lwm2mClientType * client, RegistrationRecord * record)
+{
+    uint32_t now = Lwm2mCore_GetTickCountMs();
+    int64_t remainingMs = (int64_t)client->LifeTime * 1000 - (uint32_t)(now - client->LastUpdateTime);
+
+    memset(record, 0, sizeof(*record));
+    record->Location = client->Location;
+    record->EndPointName = client->EndPointName;
+    record->Address = client->Address;
+    record->LifeTime = client->LifeTime;
+    record->BindingMode = client->BindingMode;
+    record->SupportsJson = client->SupportsJson;
+    record->Expiry = time(NULL) + (time_t)(remainingMs / 1000);
+    record->ObjectList = Lwm2m_ObjectListToLinkFormat(client);
+
+    return record->ObjectList != NULL;
+}
+
+static void Lwm2m_StoreClient(Lwm2mContextType * context, Lwm2mClientType * client)
+{
+    RegistrationStore * store = Lwm2mCore_GetRegistrationStore(context);
+    if (store != NULL)
+    {
+        RegistrationRecord record;
+        if (Lwm2m_ClientToRegistrationRecord(client, &record))
+        {
+            RegistrationStore_Save(store, &record);
+            free((char *)record.ObjectList);
+        }
+        else
+        {
+            Lwm2m_Error("Failed to store registration for \'%s\'\n", client->EndPointName);
+        }
+    }
+}
+
+// Replace the registration journal with a snapshot of the currently registered clients
+static int Lwm2m_CompactRegistrationStore(Lwm2mContextType * context)
+{
+    int result = -1;
+    RegistrationStore * store = Lwm2mCore_GetRegistrationStore(context);
+    if ((store != NULL) && (RegistrationStore_StartCompaction(store) == 0))
+    {
+        struct ListHead * i;
+        ListForEach(i, Lwm2mCore_GetClientList(context))
+        {
+            Lwm2mClientType * client = ListEntry(i, Lwm2mClientType, list);
+            RegistrationRecord record;
+            if (Lwm2m_ClientToRegistrationRecord(client, &record))
+            {
+                RegistrationStore_AddSnapshotRecord(store, &record);
+                free((char *)record.ObjectList);
+            }
+        }
+        result = RegistrationStore_FinishCompaction(store);
+    }
+    return result;
+}
+
 static int Lwm2m_UpdateClient(Lwm2mContextType * context, int location, int lifeTime, BindingMode bindingMode,
                               AddressType * addr, AwaContentType contentType, const char * objectList, int objectListLength,
                               RegistrationEventType registrationEventType)
@@ -333,6 +426,8 @@ static int Lwm2m_UpdateClient(Lwm2mContextType * context, int location, int life
 
         client->LastUpdateTime = now;
 
+        Lwm2m_StoreClient(context, client);
+
         DispatchRegistrationEventCallbacks(context, registrationEventType, client);
 
         result = 0;
@@ -363,15 +458,17 @@ static int Lwm2m_RegisterClient(Lwm2mContextType * context, const char * endPoin
             client->Location = Lwm2mCore_GetLastLocation(context) + 1;
             Lwm2mCore_SetLastLocation(context, client->Location);
 
-            ListInit(&client->ObjectList);
+            client->ObjectList = NULL;
 
             ListAdd(&client->list, Lwm2mCore_GetClientList(context));
+            Metrics_Increment(Metric_RegisteredClients);
 
             sprintf(RegisterLocation, "/rd/%d", client->Location);
             Lwm2mCore_AddResourceEndPoint(context, RegisterLocation, UpdateEndpointHandler);
 
             result = Lwm2m_UpdateClient(context, client->Location, lifeTime, bindingMode, addr, contentType, objectList, objectListLength, RegistrationEventType_Register);
 
+            Metrics_Increment(Metric_Registrations);
             Lwm2m_Info("Client registered: \'%s\'\n", endPointName);
         }
         else
@@ -391,19 +488,58 @@ static void Lwm2m_DeregisterClient(Lwm2mContextType * context, Lwm2mClientType *
     char RegisterLocation[128] = {0};
 
     ListRemove(&client->list);
-    DestroyObjectList(&client->ObjectList);
+    Metrics_Decrement(Metric_RegisteredClients);
 
     sprintf(RegisterLocation, "/rd/%d", client->Location);
     Lwm2mCore_RemoveResourceEndPoint(context, RegisterLocation);
 
+    if (Lwm2mCore_GetRegistrationStore(context) != NULL)
+    {
+        RegistrationStore_Remove(Lwm2mCore_GetRegistrationStore(context), client->Location);
+    }
+
     Lwm2m_Info("Client deregistered: \'%s\'\n", client->EndPointName);
 
     DispatchRegistrationEventCallbacks(context, RegistrationEventType_Deregister, client);
 
+    ObjectList_Release(&client->ObjectList);
     free(client->EndPointName);
     free(client);
 }
 
+/* Apply admission control to a registration or update request. Returns false if the request must not be handled now,
+ * in which case the response asks the client to retry after a back-off period.
+ */
+static bool Lwm2m_AdmitRequest(Lwm2mContextType * context, const char * key, int * responseCode)
+{
+    uint32_t retryAfter = 0;
+    bool admitted = true;
+
+    switch (AdmissionControl_Admit(Lwm2mCore_GetAdmissionControl(context), key, Lwm2mCore_GetTickCountMs(), &retryAfter))
+    {
+        case AdmissionResult_Accepted:
+            Metrics_Increment(Metric_AdmissionAccepted);
+            break;
+        case AdmissionResult_Deferred:
+            Metrics_Increment(Metric_AdmissionDeferred);
+            Lwm2m_Debug("Request from %s deferred, retry after %us\n", key, retryAfter);
+            admitted = false;
+            break;
+        case AdmissionResult_Rejected:
+            Metrics_Increment(Metric_AdmissionRejected);
+            Lwm2m_Debug("Request from %s rejected, retry after %us\n", key, retryAfter);
+            admitted = false;
+            break;
+    }
+
+    if (!admitted)
+    {
+        *responseCode = AwaResult_ServiceUnavailable;
+        Lwm2mCore_SetResponseMaxAge(context, retryAfter);
+    }
+    return admitted;
+}
+
 // handler called when a client posts to /rd
 static int Lwm2m_RegisterPost(void * ctxt, AddressType * addr, const char * path,
                               const char * query, AwaContentType contentType,
@@ -434,6 +570,13 @@ static int Lwm2m_RegisterPost(void * ctxt, AddressType * addr, const char * path
         goto done;
     }
 
+    if (!Lwm2m_AdmitRequest(context, q.EndPointName, responseCode))
+    {
+        *responseContentLen = 0;
+        Lwm2m_ReleaseQueryString(&q);
+        goto done;
+    }
+
     /* If the LWM2M Client sends a "Register" operation to the LWM2M Server even though the LWM2M Server has registration
      * information of the LWM2M Client, the LWM2M Server removes the existing registration information and performs the
      * new "Register" operation. This situation happens when the LWM2M Client forgets the state of the LWM2M Server (e.g., factory reset).
@@ -491,10 +634,16 @@ static int RegisterPut(void * ctxt, AddressType * addr, const char * path,
         goto done;
     }
 
+    if (!Lwm2m_AdmitRequest(context, path, responseCode))
+    {
+        goto done;
+    }
+
     Lwm2m_SplitUpQuery(query, &q);
 
     if (Lwm2m_UpdateClient(context, location, q.LifeTime, q.BindingModeValue, addr, contentType, requestContent, requestContentLen, RegistrationEventType_Update) == 0)
     {
+        Metrics_Increment(Metric_RegistrationUpdates);
         *responseCode = AwaResult_SuccessChanged;
     }
     else
@@ -533,6 +682,7 @@ static int RegisterDelete(void * ctxt, AddressType * addr, const char * path, co
     else
     {
         Lwm2m_DeregisterClient(context, client);
+        Metrics_Increment(Metric_Deregistrations);
         *responseCode = AwaResult_SuccessDeleted;
     }
 done:
@@ -589,6 +739,21 @@ static int RegistrationEndpointHandler(int type, void * ctxt, AddressType * addr
     return 0;
 }
 
+// Log a summary of admission control activity, if any requests have been turned away since the last report
+static void Lwm2m_ReportAdmissionStatistics(Lwm2mContextType * context)
+{
+    static AdmissionStatistics lastReported;
+    AdmissionStatistics statistics;
+
+    AdmissionControl_GetStatistics(Lwm2mCore_GetAdmissionControl(context), &statistics);
+    if ((statistics.Deferred != lastReported.Deferred) || (statistics.Rejected != lastReported.Rejected))
+    {
+        Lwm2m_Info("Admission control: %u accepted, %u deferred, %u rejected, %u pending\n",
+                   statistics.Accepted, statistics.Deferred, statistics.Rejected, statistics.Pending);
+    }
+    lastReported = statistics;
+}
+
 int32_t Lwm2m_AgeRegistrations(Lwm2mContextType * context)
 {
     uint32_t now = Lwm2mCore_GetTickCountMs();
@@ -601,37 +766,128 @@ int32_t Lwm2m_AgeRegistrations(Lwm2mContextType * context)
         if ((now - client->LastUpdateTime) > (client->LifeTime * 1000))
         {
             Lwm2m_Error("Client \'%s\' Lifetime Expired\n", client->EndPointName);
+            Metrics_Increment(Metric_RegistrationExpiries);
 
             Lwm2m_DeregisterClient(context, client);
         }
     }
+
+    Lwm2m_ReportAdmissionStatistics(context);
+
+    RegistrationStore * store = Lwm2mCore_GetRegistrationStore(context);
+    if ((store != NULL) && RegistrationStore_NeedsCompaction(store, ListCount(Lwm2mCore_GetClientList(context))))
+    {
+        Lwm2m_CompactRegistrationStore(context);
+    }
     return 0;
 }
 
-int Lwm2m_RegistrationInit(Lwm2mContextType * context)
+// Recreate a client registration from the registration store
+static void Lwm2m_RestoreClient(void * context, const RegistrationRecord * record)
 {
-    // Initialise client list
-    ListInit(Lwm2mCore_GetClientList(context));
-    Lwm2mCore_SetLastLocation(context, 0);
+    Lwm2mContextType * lwm2mContext = (Lwm2mContextType *)context;
+    char registerLocation[128] = {0};
 
-    Lwm2mCore_AddResourceEndPoint(context, "/rd", RegistrationEndpointHandler);
+    if ((Lwm2m_LookupClientByName(lwm2mContext, record->EndPointName) != NULL) ||
+        (Lwm2m_LookupClientByLocation(lwm2mContext, record->Location) != NULL))
+    {
+        Lwm2m_Error("Stored registration for \'%s\' is a duplicate, skipping\n", record->EndPointName);
+        return;
+    }
 
-    ListInit(Lwm2mCore_GetEventRecordList(context));
+    Lwm2mClientType * client = malloc(sizeof(Lwm2mClientType));
+    if (client == NULL)
+    {
+        Lwm2m_Error("Failed to allocate memory for Client entry\n");
+        return;
+    }
 
-    return 0;
+    client->EndPointName = strdup(record->EndPointName);
+    client->Address = record->Address;
+    client->LifeTime = record->LifeTime;
+    client->BindingMode = record->BindingMode;
+    client->ResourceType = NULL;
+    client->Location = record->Location;
+    client->ObjectList = NULL;
+    if ((client->EndPointName == NULL) || (Lwm2m_ParseObjectList(client, record->ObjectList, strlen(record->ObjectList)) != 0))
+    {
+        Lwm2m_Error("Failed to restore stored registration for \'%s\', skipping\n", record->EndPointName);
+        free(client->EndPointName);
+        free(client);
+        return;
+    }
+    client->SupportsJson = record->SupportsJson;
+
+    // Back-date the last update so the client expires when its original lifetime runs out. The remaining time is
+    // bounded by the lifetime, in case the clock has been set back since the record was stored.
+    time_t remaining = record->Expiry - time(NULL);
+    if (remaining < 0)
+    {
+        remaining = 0;
+    }
+    else if (remaining > client->LifeTime)
+    {
+        remaining = client->LifeTime;
+    }
+    client->LastUpdateTime = Lwm2mCore_GetTickCountMs() - (uint32_t)((client->LifeTime - remaining) * 1000);
+
+    ListAdd(&client->list, Lwm2mCore_GetClientList(lwm2mContext));
+    Metrics_Increment(Metric_RegisteredClients);
+
+    sprintf(registerLocation, "/rd/%d", client->Location);
+    Lwm2mCore_AddResourceEndPoint(lwm2mContext, registerLocation, UpdateEndpointHandler);
+
+    if (client->Location > Lwm2mCore_GetLastLocation(lwm2mContext))
+    {
+        Lwm2mCore_SetLastLocation(lwm2mContext, client->Location);
+    }
+
+    Lwm2m_Info("Client restored: \'%s\' at /rd/%d\n", client->EndPointName, client->Location);
 }
 
-static void DestroyObjectList(struct ListHead * objectList)
+int Lwm2m_RegistrationOpenStore(Lwm2mContextType * context, const char * fileName)
 {
-    if (objectList != NULL)
+    int result = -1;
+    RegistrationStore * store = RegistrationStore_Open(fileName);
+    if (store != NULL)
     {
-        struct ListHead * i, * n;
-        ListForEachSafe(i, n, objectList)
+        result = RegistrationStore_Load(store, Lwm2m_RestoreClient, context);
+        if (result >= 0)
         {
-            ObjectListEntry * object = ListEntry(i, ObjectListEntry, list);
-            free(object);
+            Lwm2mCore_SetRegistrationStore(context, store);
+
+            // Start with a journal that only holds the restored registrations
+            if (Lwm2m_CompactRegistrationStore(context) != 0)
+            {
+                Lwm2m_Error("Failed to initialise registration store %s\n", fileName);
+                Lwm2mCore_SetRegistrationStore(context, NULL);
+                RegistrationStore_Close(&store);
+                result = -1;
+            }
+            else
+            {
+                Lwm2m_Info("Restored %d client registrations from %s\n", result, fileName);
+            }
+        }
+        else
+        {
+            RegistrationStore_Close(&store);
         }
     }
+    return result;
+}
+
+int Lwm2m_RegistrationInit(Lwm2mContextType * context)
+{
+    // Initialise client list
+    ListInit(Lwm2mCore_GetClientList(context));
+    Lwm2mCore_SetLastLocation(context, 0);
+
+    Lwm2mCore_AddResourceEndPoint(context, "/rd", RegistrationEndpointHandler);
+
+    ListInit(Lwm2mCore_GetEventRecordList(context));
+
+    return 0;
 }
 
 static void DestroyClientList(struct ListHead * clientList)
@@ -644,9 +900,10 @@ static void DestroyClientList(struct ListHead * clientList)
             Lwm2mClientType * client = ListEntry(i, Lwm2mClientType, list);
             if (client != NULL)
             {
-                DestroyObjectList(&client->ObjectList);
+                ObjectList_Release(&client->ObjectList);
                 free(client->EndPointName);
                 free(client);
+                Metrics_Decrement(Metric_RegisteredClients);
             }
         }
     }
@@ -671,8 +928,35 @@ static void DestroyEventList(struct ListHead * eventRecordList)
     }
 }
 
+int Lwm2m_RegistrationSetAdmissionControl(Lwm2mContextType * context, int rate, int burst, int maxPending)
+{
+    AdmissionControl * admission = Lwm2mCore_GetAdmissionControl(context);
+    AdmissionControl_Free(&admission);
+    Lwm2mCore_SetAdmissionControl(context, NULL);
+
+    if (rate > 0)
+    {
+        admission = AdmissionControl_New(rate, (burst > 0) ? burst : rate, maxPending);
+        if (admission == NULL)
+        {
+            return -1;
+        }
+        Lwm2mCore_SetAdmissionControl(context, admission);
+        Lwm2m_Info("Admission control: %d requests/s, burst %d, %d pending\n", rate, (burst > 0) ? burst : rate, maxPending);
+    }
+    return 0;
+}
+
 void Lwm2m_RegistrationDestroy(Lwm2mContextType * context)
 {
+    AdmissionControl * admission = Lwm2mCore_GetAdmissionControl(context);
+    AdmissionControl_Free(&admission);
+    Lwm2mCore_SetAdmissionControl(context, NULL);
+
+    RegistrationStore * store = Lwm2mCore_GetRegistrationStore(context);
+    RegistrationStore_Close(&store);
+    Lwm2mCore_SetRegistrationStore(context, NULL);
+
     DestroyClientList(Lwm2mCore_GetClientList(context));
     DestroyEventList(Lwm2mCore_GetEventRecordList(context));
 }
@@ -30,6 +30,7 @@
 
 #include "lwm2m_core.h"
 #include "coap_abstraction.h"
+#include "lwm2m_object_list.h"
 #include "../../api/src/ipc_defs.h"
 
 #ifdef __cplusplus
@@ -61,14 +62,6 @@ typedef enum
     RegistrationEventType_Deregister,
 } RegistrationEventType;
 
-typedef struct
-{
-    struct ListHead list;
-    ObjectIDType ObjectID;
-    ObjectInstanceIDType InstanceID;
-
-} ObjectListEntry;
-
 // Information about Registered Clients
 typedef struct
 {
@@ -78,7 +71,7 @@ typedef struct
     int LifeTime;                      // Lifetime in seconds, 86400 is the default.
     BindingMode BindingMode;           // Binding mode, currently only "U" is supported.
     uint32_t LastUpdateTime;           // Time the client last sent an update or registration request to the server
-    struct ListHead ObjectList;        // List of supported objects, object instances
+    ObjectListType * ObjectList;       // Supported objects, object instances - shared by clients that register the same list
     char * ResourceType;               // RFC6690 Resource Type parameter
     bool SupportsJson;                 // The Client supports JSON for all objects
     int Location;                      // /rd/location, this should probably be a string
@@ -88,6 +81,18 @@ typedef struct
 int Lwm2m_RegistrationInit(Lwm2mContextType * context);
 void Lwm2m_RegistrationDestroy(Lwm2mContextType * context);
 
+/* Persist client registrations to the specified file, so that they survive a server restart. Any registrations
+ * already in the file that have not expired are restored. Returns the number of restored registrations, or -1 on error.
+ */
+int Lwm2m_RegistrationOpenStore(Lwm2mContextType * context, const char * fileName);
+
+/* Limit the rate at which registration and update requests are handled to rate per second, allowing bursts of up to
+ * burst requests (rate if zero). Requests over the limit are answered with 5.03 Service Unavailable and a Max-Age telling
+ * the client when to retry - up to maxPending clients are given reserved retry slots, the rest are told to back off until
+ * the pending clients have been handled. A rate of zero disables admission control.
+ */
+int Lwm2m_RegistrationSetAdmissionControl(Lwm2mContextType * context, int rate, int burst, int maxPending);
+
 /* Age the client registrations. The registration will be removed by the server if a registration or update
  * has not been received with the client lifetime.
  */
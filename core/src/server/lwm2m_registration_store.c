@@ -0,0 +1,492 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "lwm2m_debug.h"
+#include "lwm2m_registration_store.h"
+
+#define RECORD_REGISTRATION 'R'
+#define RECORD_REMOVAL      'D'
+#define FIELD_SEPARATOR     "\t"
+
+struct _RegistrationStore
+{
+    char * FileName;
+    char * SnapshotFileName;     // compaction writes here, then renames it over FileName
+    FILE * Journal;
+    FILE * Snapshot;
+    int NumberOfRecords;         // records currently in the journal
+    int NumberOfSnapshotRecords;
+};
+
+// A journal record read back during load, ordered by location then position within the journal
+typedef struct
+{
+    int Sequence;
+    char Type;
+    char * Line;                 // owns the storage that the record's strings point into
+    RegistrationRecord Record;
+
+} LoadedRecord;
+
+// Escape characters that would break the line-based journal format
+static void WriteEscaped(FILE * f, const char * str)
+{
+    for (; (str != NULL) && (*str != '\0'); str++)
+    {
+        if ((*str == '%') || ((unsigned char)*str < 0x20))
+        {
+            fprintf(f, "%%%02X", (unsigned char)*str);
+        }
+        else
+        {
+            fputc(*str, f);
+        }
+    }
+}
+
+// Unescape in-place
+static char * Unescape(char * str)
+{
+    char * in = str;
+    char * out = str;
+    while (*in != '\0')
+    {
+        unsigned int value;
+        if ((*in == '%') && (sscanf(in + 1, "%2X", &value) == 1))
+        {
+            *out++ = (char)value;
+            in += 3;
+        }
+        else
+        {
+            *out++ = *in++;
+        }
+    }
+    *out = '\0';
+    return str;
+}
+
+static int WriteRegistrationRecord(FILE * f, const RegistrationRecord * record)
+{
+    char ip[INET6_ADDRSTRLEN] = {0};
+    int port = 0;
+
+    switch (record->Address.Addr.Sa.sa_family)
+    {
+        case AF_INET:
+            inet_ntop(AF_INET, &record->Address.Addr.Sin.sin_addr, ip, sizeof(ip));
+            port = ntohs(record->Address.Addr.Sin.sin_port);
+            break;
+        case AF_INET6:
+            inet_ntop(AF_INET6, &record->Address.Addr.Sin6.sin6_addr, ip, sizeof(ip));
+            port = ntohs(record->Address.Addr.Sin6.sin6_port);
+            break;
+        default:
+            Lwm2m_Error("Unsupported address family %d for client %s\n", record->Address.Addr.Sa.sa_family, record->EndPointName);
+            return -1;
+    }
+
+    fprintf(f, "%c\t%d\t%ld\t%d\t%d\t%d\t%d\t%s\t%d\t", RECORD_REGISTRATION, record->Location, (long)record->Expiry, record->LifeTime,
+            record->BindingMode, record->SupportsJson ? 1 : 0, record->Address.Secure ? 1 : 0, ip, port);
+    WriteEscaped(f, record->EndPointName);
+    fputc('\t', f);
+    WriteEscaped(f, record->ObjectList);
+    fputc('\n', f);
+
+    return ferror(f) ? -1 : 0;
+}
+
+static bool ParseAddress(const char * ip, int port, bool secure, AddressType * address)
+{
+    memset(address, 0, sizeof(*address));
+    address->Secure = secure;
+
+    if (inet_pton(AF_INET, ip, &address->Addr.Sin.sin_addr) == 1)
+    {
+        address->Addr.Sin.sin_family = AF_INET;
+        address->Addr.Sin.sin_port = htons(port);
+        address->Size = sizeof(address->Addr.Sin);
+    }
+    else if (inet_pton(AF_INET6, ip, &address->Addr.Sin6.sin6_addr) == 1)
+    {
+        address->Addr.Sin6.sin6_family = AF_INET6;
+        address->Addr.Sin6.sin6_port = htons(port);
+        address->Size = sizeof(address->Addr.Sin6);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// Parse a journal line in-place. Returns false if the line is malformed, e.g. truncated by a crash mid-write.
+static bool ParseRecord(char * line, LoadedRecord * loaded)
+{
+    char * fields[11] = {0};
+    int numberOfFields = 0;
+    char * field;
+
+    line[strcspn(line, "\r\n")] = '\0';
+
+    while ((numberOfFields < 11) && ((field = strsep(&line, FIELD_SEPARATOR)) != NULL))
+    {
+        fields[numberOfFields++] = field;
+    }
+
+    if ((numberOfFields < 2) || (strlen(fields[0]) != 1))
+    {
+        return false;
+    }
+
+    loaded->Type = fields[0][0];
+    loaded->Record.Location = atoi(fields[1]);
+
+    if (loaded->Type == RECORD_REMOVAL)
+    {
+        return numberOfFields == 2;
+    }
+
+    if ((loaded->Type != RECORD_REGISTRATION) || (numberOfFields != 11) || (line != NULL))
+    {
+        return false;
+    }
+
+    loaded->Record.Expiry = (time_t)strtol(fields[2], NULL, 10);
+    loaded->Record.LifeTime = atoi(fields[3]);
+    loaded->Record.BindingMode = atoi(fields[4]);
+    loaded->Record.SupportsJson = atoi(fields[5]) != 0;
+    loaded->Record.EndPointName = Unescape(fields[9]);
+    loaded->Record.ObjectList = Unescape(fields[10]);
+
+    return ParseAddress(fields[7], atoi(fields[8]), atoi(fields[6]) != 0, &loaded->Record.Address) &&
+           (strlen(loaded->Record.EndPointName) > 0);
+}
+
+static int CompareLoadedRecords(const void * a, const void * b)
+{
+    const LoadedRecord * recordA = (const LoadedRecord *)a;
+    const LoadedRecord * recordB = (const LoadedRecord *)b;
+
+    if (recordA->Record.Location != recordB->Record.Location)
+    {
+        return (recordA->Record.Location < recordB->Record.Location) ? -1 : 1;
+    }
+    return (recordA->Sequence < recordB->Sequence) ? -1 : (recordA->Sequence > recordB->Sequence);
+}
+
+static int OpenJournal(RegistrationStore * store)
+{
+    if (store->Journal == NULL)
+    {
+        store->Journal = fopen(store->FileName, "a");
+        if (store->Journal == NULL)
+        {
+            Lwm2m_Error("Failed to open registration store %s: %s\n", store->FileName, strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int SyncAndClose(FILE * f)
+{
+    int result = 0;
+    if ((fflush(f) != 0) || (fsync(fileno(f)) != 0))
+    {
+        result = -1;
+    }
+    if (fclose(f) != 0)
+    {
+        result = -1;
+    }
+    return result;
+}
+
+RegistrationStore * RegistrationStore_Open(const char * fileName)
+{
+    RegistrationStore * store = NULL;
+
+    if (fileName == NULL)
+    {
+        Lwm2m_Error("fileName is NULL\n");
+        goto error;
+    }
+
+    store = malloc(sizeof(*store));
+    if (store == NULL)
+    {
+        Lwm2m_Error("Out of memory\n");
+        goto error;
+    }
+    memset(store, 0, sizeof(*store));
+
+    store->FileName = strdup(fileName);
+    store->SnapshotFileName = malloc(strlen(fileName) + strlen(".tmp") + 1);
+    if ((store->FileName == NULL) || (store->SnapshotFileName == NULL))
+    {
+        Lwm2m_Error("Out of memory\n");
+        RegistrationStore_Close(&store);
+        goto error;
+    }
+    sprintf(store->SnapshotFileName, "%s.tmp", fileName);
+
+    return store;
+
+error:
+    return NULL;
+}
+
+void RegistrationStore_Close(RegistrationStore ** store)
+{
+    if ((store != NULL) && (*store != NULL))
+    {
+        if ((*store)->Snapshot != NULL)
+        {
+            fclose((*store)->Snapshot);
+            remove((*store)->SnapshotFileName);
+        }
+        if ((*store)->Journal != NULL)
+        {
+            SyncAndClose((*store)->Journal);
+        }
+        free((*store)->FileName);
+        free((*store)->SnapshotFileName);
+        free(*store);
+        *store = NULL;
+    }
+}
+
+int RegistrationStore_Load(RegistrationStore * store, RegistrationStoreLoadCallback callback, void * context)
+{
+    int result = -1;
+    LoadedRecord * records = NULL;
+    int numberOfRecords = 0;
+    int capacity = 0;
+    char * line = NULL;
+    size_t len = 0;
+    int i;
+
+    if ((store == NULL) || (callback == NULL))
+    {
+        Lwm2m_Error("Invalid arguments\n");
+        goto done;
+    }
+
+    FILE * f = fopen(store->FileName, "r");
+    if (f == NULL)
+    {
+        if (errno == ENOENT)
+        {
+            // Nothing persisted yet
+            result = 0;
+        }
+        else
+        {
+            Lwm2m_Error("Failed to open registration store %s: %s\n", store->FileName, strerror(errno));
+        }
+        goto done;
+    }
+
+    while (getline(&line, &len, f) != -1)
+    {
+        if (numberOfRecords == capacity)
+        {
+            int newCapacity = (capacity == 0) ? 64 : capacity * 2;
+            LoadedRecord * newRecords = realloc(records, newCapacity * sizeof(LoadedRecord));
+            if (newRecords == NULL)
+            {
+                Lwm2m_Error("Out of memory\n");
+                free(line);
+                fclose(f);
+                goto done;
+            }
+            records = newRecords;
+            capacity = newCapacity;
+        }
+
+        LoadedRecord * loaded = &records[numberOfRecords];
+        memset(loaded, 0, sizeof(*loaded));
+        loaded->Sequence = numberOfRecords;
+        loaded->Line = line;
+
+        if (ParseRecord(line, loaded))
+        {
+            numberOfRecords++;
+        }
+        else
+        {
+            Lwm2m_Error("Skipping malformed record %d in registration store %s\n", numberOfRecords + 1, store->FileName);
+            free(line);
+        }
+        line = NULL;  // must be NULL for getline() to allocate memory for the next line
+        len = 0;
+    }
+    free(line);  // getline may allocate memory for characters before EOF
+    fclose(f);
+
+    store->NumberOfRecords = numberOfRecords;
+
+    // Only the last record for each location counts - a later update supersedes a registration, a removal deletes it.
+    qsort(records, numberOfRecords, sizeof(LoadedRecord), CompareLoadedRecords);
+
+    time_t now = time(NULL);
+    result = 0;
+    for (i = 0; i < numberOfRecords; i++)
+    {
+        bool last = (i == numberOfRecords - 1) || (records[i + 1].Record.Location != records[i].Record.Location);
+        if (last && (records[i].Type == RECORD_REGISTRATION))
+        {
+            if (records[i].Record.Expiry > now)
+            {
+                callback(context, &records[i].Record);
+                result++;
+            }
+            else
+            {
+                Lwm2m_Info("Stored registration for \'%s\' has expired\n", records[i].Record.EndPointName);
+            }
+        }
+    }
+
+done:
+    for (i = 0; i < numberOfRecords; i++)
+    {
+        free(records[i].Line);
+    }
+    free(records);
+    return result;
+}
+
+int RegistrationStore_Save(RegistrationStore * store, const RegistrationRecord * record)
+{
+    int result = -1;
+    if ((store != NULL) && (record != NULL) && (OpenJournal(store) == 0))
+    {
+        if ((WriteRegistrationRecord(store->Journal, record) == 0) && (fflush(store->Journal) == 0))
+        {
+            store->NumberOfRecords++;
+            result = 0;
+        }
+        else
+        {
+            Lwm2m_Error("Failed to write registration store %s\n", store->FileName);
+        }
+    }
+    return result;
+}
+
+int RegistrationStore_Remove(RegistrationStore * store, int location)
+{
+    int result = -1;
+    if ((store != NULL) && (OpenJournal(store) == 0))
+    {
+        if ((fprintf(store->Journal, "%c\t%d\n", RECORD_REMOVAL, location) > 0) && (fflush(store->Journal) == 0))
+        {
+            store->NumberOfRecords++;
+            result = 0;
+        }
+        else
+        {
+            Lwm2m_Error("Failed to write registration store %s\n", store->FileName);
+        }
+    }
+    return result;
+}
+
+bool RegistrationStore_NeedsCompaction(RegistrationStore * store, int numberOfClients)
+{
+    return (store != NULL) && (store->NumberOfRecords > REGISTRATION_STORE_COMPACT_MIN_RECORDS) &&
+           (store->NumberOfRecords > 2 * numberOfClients);
+}
+
+int RegistrationStore_StartCompaction(RegistrationStore * store)
+{
+    int result = -1;
+    if ((store != NULL) && (store->Snapshot == NULL))
+    {
+        store->Snapshot = fopen(store->SnapshotFileName, "w");
+        if (store->Snapshot != NULL)
+        {
+            store->NumberOfSnapshotRecords = 0;
+            result = 0;
+        }
+        else
+        {
+            Lwm2m_Error("Failed to create %s: %s\n", store->SnapshotFileName, strerror(errno));
+        }
+    }
+    return result;
+}
+
+int RegistrationStore_AddSnapshotRecord(RegistrationStore * store, const RegistrationRecord * record)
+{
+    int result = -1;
+    if ((store != NULL) && (store->Snapshot != NULL) && (record != NULL))
+    {
+        if (WriteRegistrationRecord(store->Snapshot, record) == 0)
+        {
+            store->NumberOfSnapshotRecords++;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+int RegistrationStore_FinishCompaction(RegistrationStore * store)
+{
+    int result = -1;
+    if ((store != NULL) && (store->Snapshot != NULL))
+    {
+        // Make sure the snapshot is on disk before it replaces the journal
+        bool written = (ferror(store->Snapshot) == 0) && (SyncAndClose(store->Snapshot) == 0);
+        store->Snapshot = NULL;
+
+        if (written && (rename(store->SnapshotFileName, store->FileName) == 0))
+        {
+            if (store->Journal != NULL)
+            {
+                fclose(store->Journal);
+                store->Journal = NULL;
+            }
+            store->NumberOfRecords = store->NumberOfSnapshotRecords;
+            Lwm2m_Debug("Compacted registration store %s to %d records\n", store->FileName, store->NumberOfRecords);
+            result = OpenJournal(store);
+        }
+        else
+        {
+            // The existing journal is left intact
+            Lwm2m_Error("Failed to compact registration store %s: %s\n", store->FileName, strerror(errno));
+            remove(store->SnapshotFileName);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,93 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef LWM2M_REGISTRATION_STORE_H
+#define LWM2M_REGISTRATION_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "lwm2m_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The registration store persists the server's table of registered clients, so that a restarted server can continue
+ * to accept updates at the /rd/<location> the clients were originally given, rather than forcing every client to
+ * register again.
+ *
+ * The store is an append-only journal: a record is written for each registration or update, and a removal record
+ * for each deregistration or expiry. When the journal grows too large relative to the number of registered clients
+ * it is compacted, by writing a snapshot of the current registrations to a temporary file and renaming it over the
+ * journal.
+ */
+
+#define REGISTRATION_STORE_COMPACT_MIN_RECORDS (1024)   // never compact a journal with fewer records than this
+
+typedef struct _RegistrationStore RegistrationStore;
+
+typedef struct
+{
+    int Location;                  // /rd/<location>
+    const char * EndPointName;
+    AddressType Address;
+    int LifeTime;                  // in seconds
+    int BindingMode;
+    bool SupportsJson;
+    time_t Expiry;                 // wall-clock time at which the registration expires
+    const char * ObjectList;       // object list in CoRE link format, i.e </1/0>,</3/0>
+
+} RegistrationRecord;
+
+// Called once for each registration that is still live when the store is loaded
+typedef void (*RegistrationStoreLoadCallback)(void * context, const RegistrationRecord * record);
+
+RegistrationStore * RegistrationStore_Open(const char * fileName);
+void RegistrationStore_Close(RegistrationStore ** store);
+
+/* Replay the journal, calling the callback for each registration that has not been removed or expired.
+ * Returns the number of registrations restored, or -1 on error.
+ */
+int RegistrationStore_Load(RegistrationStore * store, RegistrationStoreLoadCallback callback, void * context);
+
+int RegistrationStore_Save(RegistrationStore * store, const RegistrationRecord * record);
+int RegistrationStore_Remove(RegistrationStore * store, int location);
+
+// Returns true if the journal holds enough stale records that it should be compacted
+bool RegistrationStore_NeedsCompaction(RegistrationStore * store, int numberOfClients);
+
+/* Compaction - call RegistrationStore_StartCompaction, then RegistrationStore_AddSnapshotRecord for every
+ * registered client, then RegistrationStore_FinishCompaction to replace the journal with the snapshot.
+ */
+int RegistrationStore_StartCompaction(RegistrationStore * store);
+int RegistrationStore_AddSnapshotRecord(RegistrationStore * store, const RegistrationRecord * record);
+int RegistrationStore_FinishCompaction(RegistrationStore * store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LWM2M_REGISTRATION_STORE_H
@@ -47,6 +47,9 @@ struct _Lwm2mContextType
     int LastLocation;                         // Used for registration, creates /rd/0, /rd/1 etc
     AwaContentType ContentType;                  // Used to set CoAP content type
     struct ListHead EventRecordList;          // Used to dispatch event callbacks
+    RegistrationStore * RegistrationStore;    // Optional persistent store of client registrations
+    AdmissionControl * AdmissionControl;      // Optional rate limit on registration and update requests
+    CoapResponse * CurrentResponse;           // Response to the request currently being handled
 };
 
 static Lwm2mContextType Lwm2mContext;
@@ -103,10 +106,12 @@ static int Lwm2mCore_HandleRequest(CoapRequest * request, CoapResponse * respons
     ResourceEndPoint * endPoint = Lwm2mEndPoint_FindResourceEndPoint(&context->EndPointList, request->path);
     if (endPoint != NULL)
     {
+        context->CurrentResponse = response;
         result = endPoint->Handler(request->type, request->ctxt, &request->addr, request->path, request->query,
                  request->token, request->tokenLength, request->contentType, request->requestContent,
                  request->requestContentLen, &response->responseContentType, response->responseContent,
                  &response->responseContentLen, &response->responseCode);
+        context->CurrentResponse = NULL;
     }
     else
     {
@@ -158,6 +163,34 @@ void Lwm2mCore_SetLastLocation(Lwm2mContextType * context, int location)
     context->LastLocation = location;
 }
 
+RegistrationStore * Lwm2mCore_GetRegistrationStore(Lwm2mContextType * context)
+{
+    return context->RegistrationStore;
+}
+
+void Lwm2mCore_SetRegistrationStore(Lwm2mContextType * context, RegistrationStore * store)
+{
+    context->RegistrationStore = store;
+}
+
+AdmissionControl * Lwm2mCore_GetAdmissionControl(Lwm2mContextType * context)
+{
+    return context->AdmissionControl;
+}
+
+void Lwm2mCore_SetAdmissionControl(Lwm2mContextType * context, AdmissionControl * admission)
+{
+    context->AdmissionControl = admission;
+}
+
+void Lwm2mCore_SetResponseMaxAge(Lwm2mContextType * context, uint32_t maxAge)
+{
+    if (context->CurrentResponse != NULL)
+    {
+        context->CurrentResponse->responseMaxAge = maxAge;
+    }
+}
+
 Lwm2mContextType * Lwm2mCore_Init(CoapInfo * coap, AwaContentType contentType)
 {
     Lwm2m_Debug("Create object store\n");
@@ -0,0 +1,123 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <string>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "lwm2m_core.h"
+#include "lwm2m_registration.h"
+#include "lwm2m_registration_store.h"
+
+// Registrations restored from the registration store when the server starts
+class Lwm2mRegistrationTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        Lwm2m_SetLogLevel(DebugLevel_Emerg);
+        char fileName[] = "/tmp/awa_registration_test_XXXXXX";
+        int fd = mkstemp(fileName);
+        ASSERT_NE(-1, fd);
+        close(fd);
+        fileName_ = fileName;
+        context_ = NULL;
+    }
+
+    void TearDown()
+    {
+        if (context_ != NULL)
+        {
+            Lwm2mCore_Destroy(context_);
+        }
+        unlink(fileName_.c_str());
+        Lwm2m_SetLogLevel(DebugLevel_Info);
+    }
+
+    // Store a client registered before the server restarted, with its registration expiring after remaining seconds
+    void Store(int location, const char * endPointName, int lifeTime, time_t remaining)
+    {
+        RegistrationStore * store = RegistrationStore_Open(fileName_.c_str());
+        ASSERT_TRUE(store != NULL);
+        RegistrationRecord record;
+        memset(&record, 0, sizeof(record));
+        record.Location = location;
+        record.EndPointName = endPointName;
+        record.Address.Addr.Sin.sin_family = AF_INET;
+        record.Address.Addr.Sin.sin_port = htons(30000 + location);
+        inet_pton(AF_INET, "127.0.0.1", &record.Address.Addr.Sin.sin_addr);
+        record.Address.Size = sizeof(record.Address.Addr.Sin);
+        record.LifeTime = lifeTime;
+        record.Expiry = time(NULL) + remaining;
+        record.ObjectList = "</3/0>,</1000/1>";
+        ASSERT_EQ(0, RegistrationStore_Save(store, &record));
+        RegistrationStore_Close(&store);
+    }
+
+    int Restore()
+    {
+        context_ = Lwm2mCore_Init(NULL, AwaContentType_ApplicationOmaLwm2mTLV);
+        return Lwm2m_RegistrationOpenStore(context_, fileName_.c_str());
+    }
+
+    // Milliseconds since the restored client last updated its registration, as far as the server can tell
+    uint32_t SinceLastUpdate(const char * endPointName)
+    {
+        Lwm2mClientType * client = Lwm2m_LookupClientByName(context_, endPointName);
+        EXPECT_TRUE(client != NULL);
+        return (client != NULL) ? (uint32_t)Lwm2mCore_GetTickCountMs() - client->LastUpdateTime : 0;
+    }
+
+    std::string fileName_;
+    Lwm2mContextType * context_;
+};
+
+TEST_F(Lwm2mRegistrationTestSuite, restored_client_keeps_its_registration)
+{
+    Store(1, "client1", 86400, 86400);
+    ASSERT_EQ(1, Restore());
+
+    Lwm2mClientType * client = Lwm2m_LookupClientByName(context_, "client1");
+    ASSERT_TRUE(client != NULL);
+    EXPECT_EQ(86400, client->LifeTime);
+    EXPECT_TRUE(Lwm2m_ClientSupportsObject(client, 3, 0));
+    EXPECT_TRUE(Lwm2m_ClientSupportsObject(client, 1000, 1));
+    EXPECT_FALSE(Lwm2m_ClientSupportsObject(client, 1000, 2));
+}
+
+TEST_F(Lwm2mRegistrationTestSuite, restored_client_expires_when_its_lifetime_runs_out)
+{
+    Store(1, "client1", 100, 40);
+    ASSERT_EQ(1, Restore());
+    uint32_t elapsed = SinceLastUpdate("client1");
+    EXPECT_GE(elapsed, 59000u);
+    EXPECT_LE(elapsed, 62000u);
+}
+
+TEST_F(Lwm2mRegistrationTestSuite, restored_client_is_not_updated_in_the_future_if_the_clock_was_set_back)
+{
+    // the registration expires ten lifetimes from now, as if the clock went back after it was stored
+    Store(1, "client1", 100, 1000);
+    ASSERT_EQ(1, Restore());
+    EXPECT_LE(SinceLastUpdate("client1"), 2000u);
+}
@@ -0,0 +1,286 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+
+extern "C" {
+#include "er-coap-engine.h"
+#include "er-coap-transactions.h"
+#include "er-coap-dedup.h"
+#include "er-coap-block2.h"
+
+extern NetworkAddress * sourceAddress;
+}
+
+namespace {
+
+const int SERVER_PORT = 60685;
+const int PEER_PORT = 60686;
+const size_t LARGE_RESPONSE_LENGTH = 60000;
+
+int requestsHandled = 0;
+
+int HandleRequest(void * request, void * response, uint8_t * buffer, uint16_t preferredSize, int32_t * offset)
+{
+    requestsHandled++;
+    coap_set_status_code(response, CONTENT_2_05);
+    coap_set_payload(response, "hello", 5);
+    return 1;
+}
+
+// Respond with as large a payload as fits in one message
+int HandleFullRequest(void * request, void * response, uint8_t * buffer, uint16_t preferredSize, int32_t * offset)
+{
+    for (uint16_t i = 0; i < preferredSize; i++)
+    {
+        buffer[i] = i % 251;
+    }
+    coap_set_status_code(response, CONTENT_2_05);
+    coap_set_bert_payload(response, buffer, preferredSize);
+    return 1;
+}
+
+// Serve a large response block by block
+int HandleLargeRequest(void * request, void * response, uint8_t * buffer, uint16_t preferredSize, int32_t * offset)
+{
+    coap_block2_entry_t * block = coap_block2_find(sourceAddress, "large");
+    if ((*offset == 0) || (block == NULL))
+    {
+        std::vector<uint8_t> payload(LARGE_RESPONSE_LENGTH);
+        for (size_t i = 0; i < payload.size(); i++)
+        {
+            payload[i] = i % 251;
+        }
+        block = coap_block2_add(sourceAddress, "large", APPLICATION_OCTET_STREAM, payload.data(), payload.size());
+    }
+    coap_set_status_code(response, CONTENT_2_05);
+    *offset = coap_block2_serve(block, response, *offset, preferredSize, buffer);
+    return 1;
+}
+
+} // namespace
+
+class CoapTcpTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        coap_init_transactions();
+        coap_init_dedup();
+        coap_init_block2();
+        coap_set_service_callback(HandleRequest);
+        requestsHandled = 0;
+        server_ = NetworkSocket_New("127.0.0.1", (NetworkSocketType)(NetworkSocketType_UDP | NetworkSocketType_TCP), SERVER_PORT);
+        peer_ = NetworkSocket_New("127.0.0.1", NetworkSocketType_UDP, PEER_PORT);
+        ASSERT_TRUE(server_ != NULL);
+        ASSERT_TRUE(peer_ != NULL);
+        NetworkSocket_SetMaxMessageSize(server_, COAP_MAX_MESSAGE_SIZE_TCP);
+        NetworkSocket_SetMaxMessageSize(peer_, COAP_MAX_MESSAGE_SIZE_TCP);
+        ASSERT_TRUE(NetworkSocket_StartListening(server_));
+        ASSERT_TRUE(NetworkSocket_StartListening(peer_));
+
+        const char * serverUri = "coap+tcp://127.0.0.1:60685";
+        const char * serverUdpUri = "coap://127.0.0.1:60685";
+        serverAddress_ = NetworkAddress_New(serverUri, strlen(serverUri));
+        serverUdpAddress_ = NetworkAddress_New(serverUdpUri, strlen(serverUdpUri));
+        ASSERT_TRUE(serverAddress_ != NULL);
+        ASSERT_TRUE(serverUdpAddress_ != NULL);
+    }
+
+    void TearDown()
+    {
+        coap_set_service_callback(NULL);
+        coap_destroy_dedup();
+        coap_destroy_block2();
+        NetworkSocket_Free(&server_);
+        NetworkSocket_Free(&peer_);
+    }
+
+    // Send a GET for "large" from the peer, and wait for the response. Over TCP the server has to accept the connection and
+    // read the peer's settings first, and the peer may have to finish connecting, so both sides are polled until it arrives.
+    std::vector<uint8_t> Exchange(NetworkAddress * address, int32_t blockNum, uint16_t blockSize)
+    {
+        coap_packet_t request[1];
+        uint8_t buffer[COAP_BUFFER_LENGTH];
+        uint32_t token = 0x1234;
+        coap_init_message(request, COAP_TYPE_CON, COAP_GET, coap_get_mid());
+        coap_set_token(request, reinterpret_cast<uint8_t *>(&token), sizeof(token));
+        coap_set_header_uri_path(request, "large");
+        if (blockNum >= 0)
+        {
+            coap_set_header_block2(request, blockNum, 0, blockSize);
+        }
+        size_t length = coap_serialize_message(request, buffer);
+        EXPECT_TRUE(NetworkSocket_Send(peer_, address, buffer, length));
+
+        std::vector<uint8_t> message;
+        for (int attempt = 0; (attempt < 10000) && message.empty(); attempt++)
+        {
+            coap_receive(server_);
+
+            NetworkAddress * source = NULL;
+            int readLength = 0;
+            NetworkSocket_Read(peer_, buffer, sizeof(buffer), &source, &readLength);
+            if (readLength > 0)
+            {
+                message.assign(buffer, buffer + readLength);
+            }
+            else if (!NetworkSocket_HasPendingMessages(server_))
+            {
+                usleep(50);
+            }
+        }
+        return message;
+    }
+
+    // Read a large response block by block, returning the number of messages it took
+    int ReadBlockwise(NetworkAddress * address, uint16_t blockSize, std::vector<uint8_t> & received)
+    {
+        int messages = 0;
+        uint8_t more = 1;
+        received.clear();
+        while (more)
+        {
+            // BERT blocks are numbered in 1024 byte blocks
+            std::vector<uint8_t> message = Exchange(address, received.size() / std::min<uint16_t>(blockSize, COAP_BERT_BLOCK_SIZE), blockSize);
+            coap_packet_t response[1];
+            EXPECT_EQ(NO_ERROR, coap_parse_reliable_message(response, message.data(), message.size()));
+            uint32_t offset = 0;
+            if (!coap_get_header_block2(response, NULL, &more, NULL, &offset) || (offset != received.size()))
+            {
+                ADD_FAILURE() << "unexpected block at offset " << offset;
+                break;
+            }
+            const uint8_t * payload = NULL;
+            int payloadLength = coap_get_payload(response, &payload);
+            received.insert(received.end(), payload, payload + payloadLength);
+            messages++;
+        }
+        return messages;
+    }
+
+    NetworkSocket * server_;
+    NetworkSocket * peer_;
+    NetworkAddress * serverAddress_;
+    NetworkAddress * serverUdpAddress_;
+};
+
+TEST_F(CoapTcpTestSuite, request_over_connection_is_answered_over_connection)
+{
+    std::vector<uint8_t> message = Exchange(serverAddress_, -1, 0);
+    ASSERT_FALSE(message.empty());
+    EXPECT_EQ(1, requestsHandled);
+    EXPECT_TRUE(NetworkAddress_IsReliable(sourceAddress));
+
+    coap_packet_t response[1];
+    ASSERT_EQ(NO_ERROR, coap_parse_reliable_message(response, message.data(), message.size()));
+    EXPECT_EQ(CONTENT_2_05, response->code);
+    uint32_t token = 0x1234;
+    ASSERT_EQ(sizeof(token), response->token_len);
+    EXPECT_EQ(0, memcmp(&token, response->token, sizeof(token)));
+
+    const uint8_t * payload = NULL;
+    ASSERT_EQ(5, coap_get_payload(response, &payload));
+    EXPECT_EQ(0, memcmp("hello", payload, 5));
+}
+
+TEST_F(CoapTcpTestSuite, repeated_request_over_connection_is_not_suppressed)
+{
+    // Messages over a connection have no message ID, so every request is handled
+    EXPECT_FALSE(Exchange(serverAddress_, -1, 0).empty());
+    EXPECT_FALSE(Exchange(serverAddress_, -1, 0).empty());
+    EXPECT_EQ(2, requestsHandled);
+}
+
+TEST_F(CoapTcpTestSuite, response_larger_than_a_datagram_is_sent_in_one_message)
+{
+    coap_set_service_callback(HandleFullRequest);
+    std::vector<uint8_t> message = Exchange(serverAddress_, -1, 0);
+
+    coap_packet_t response[1];
+    ASSERT_EQ(NO_ERROR, coap_parse_reliable_message(response, message.data(), message.size()));
+    const uint8_t * payload = NULL;
+    int payloadLength = coap_get_payload(response, &payload);
+    EXPECT_EQ(coap_get_max_block_size(server_, sourceAddress), payloadLength);
+    EXPECT_GT(payloadLength, COAP_MAX_BLOCK_SIZE);
+    for (int i = 0; i < payloadLength; i++)
+    {
+        ASSERT_EQ(i % 251, payload[i]);
+    }
+}
+
+TEST_F(CoapTcpTestSuite, large_response_is_served_in_bert_blocks)
+{
+    coap_set_service_callback(HandleLargeRequest);
+
+    // the peer asks for 1024 byte blocks, and takes BERT blocks
+    std::vector<uint8_t> received;
+    int messages = ReadBlockwise(serverAddress_, COAP_MAX_BLOCK_SIZE, received);
+
+    ASSERT_EQ(LARGE_RESPONSE_LENGTH, received.size());
+    for (size_t i = 0; i < received.size(); i++)
+    {
+        ASSERT_EQ(i % 251, received[i]);
+    }
+    EXPECT_LT(messages, static_cast<int>(LARGE_RESPONSE_LENGTH / COAP_MAX_BLOCK_SIZE));
+    EXPECT_EQ(0u, coap_block2_count());
+}
+
+TEST_F(CoapTcpTestSuite, benchmark_bulk_read_udp_blocks_against_tcp_bert)
+{
+    coap_set_service_callback(HandleLargeRequest);
+    const int numberOfReads = 20;
+    std::vector<uint8_t> received;
+
+    // warm up the connection, so that connecting is not measured
+    ReadBlockwise(serverAddress_, COAP_MAX_BLOCK_SIZE, received);
+
+    int udpMessages = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numberOfReads; i++)
+    {
+        udpMessages += ReadBlockwise(serverUdpAddress_, COAP_MAX_BLOCK_SIZE, received);
+        ASSERT_EQ(LARGE_RESPONSE_LENGTH, received.size());
+    }
+    std::chrono::duration<double> udpElapsed = std::chrono::steady_clock::now() - start;
+
+    int tcpMessages = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numberOfReads; i++)
+    {
+        tcpMessages += ReadBlockwise(serverAddress_, COAP_MAX_BLOCK_SIZE, received);
+        ASSERT_EQ(LARGE_RESPONSE_LENGTH, received.size());
+    }
+    std::chrono::duration<double> tcpElapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_LT(tcpMessages, udpMessages);
+    double megabytes = numberOfReads * LARGE_RESPONSE_LENGTH / (1024.0 * 1024.0);
+    std::cout << "[ BENCHMARK] bulk read of " << LARGE_RESPONSE_LENGTH << " bytes: UDP " << udpMessages / numberOfReads
+              << " blocks, " << megabytes / udpElapsed.count() << " MB/s; TCP " << tcpMessages / numberOfReads
+              << " BERT blocks, " << megabytes / tcpElapsed.count() << " MB/s" << std::endl;
+}
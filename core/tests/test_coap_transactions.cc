@@ -0,0 +1,633 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "unit_support.h"
+
+extern "C" {
+#include "er-coap-engine.h"
+#include "er-coap-transactions.h"
+#include "er-coap-dedup.h"
+#include "er-coap-block2.h"
+
+extern NetworkAddress * sourceAddress;
+}
+
+namespace {
+
+const int SERVER_PORT = 60683;
+const int PEER_PORT = 60684;
+
+struct Responses
+{
+    int Received;
+    int TimedOut;
+};
+
+void CountResponse(void * callbackData, void * response)
+{
+    Responses * responses = static_cast<Responses *>(callbackData);
+    if (response != NULL)
+    {
+        responses->Received++;
+    }
+    else
+    {
+        responses->TimedOut++;
+    }
+}
+
+int requestsHandled = 0;
+
+int HandleRequest(void * request, void * response, uint8_t * buffer, uint16_t preferredSize, int32_t * offset)
+{
+    requestsHandled++;
+    coap_set_status_code(response, CONTENT_2_05);
+    coap_set_payload(response, "hello", 5);
+    return 1;
+}
+
+// Serve a large response block by block, rendering it only for the first block
+int largeResponsesRendered = 0;
+
+int HandleLargeRequest(void * request, void * response, uint8_t * buffer, uint16_t preferredSize, int32_t * offset)
+{
+    coap_block2_entry_t * block = coap_block2_find(sourceAddress, "large");
+    if ((*offset == 0) || (block == NULL))
+    {
+        std::vector<uint8_t> payload(3000);
+        for (size_t i = 0; i < payload.size(); i++)
+        {
+            payload[i] = i % 251;
+        }
+        largeResponsesRendered++;
+        block = coap_block2_add(sourceAddress, "large", APPLICATION_OCTET_STREAM, payload.data(), payload.size());
+    }
+    coap_set_status_code(response, CONTENT_2_05);
+    *offset = coap_block2_serve(block, response, *offset, preferredSize, buffer);
+    return 1;
+}
+
+} // namespace
+
+class CoapTransactionsTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        coap_init_transactions();
+        coap_init_dedup();
+        coap_init_block2();
+        coap_set_service_callback(HandleRequest);
+        requestsHandled = 0;
+        server_ = NetworkSocket_New("127.0.0.1", NetworkSocketType_UDP, SERVER_PORT);
+        peer_ = NetworkSocket_New("127.0.0.1", NetworkSocketType_UDP, PEER_PORT);
+        ASSERT_TRUE(server_ != NULL);
+        ASSERT_TRUE(peer_ != NULL);
+        ASSERT_TRUE(NetworkSocket_StartListening(server_));
+        ASSERT_TRUE(NetworkSocket_StartListening(peer_));
+
+        const char * serverUri = "coap://127.0.0.1:60683";
+        const char * peerUri = "coap://127.0.0.1:60684";
+        serverAddress_ = NetworkAddress_New(serverUri, strlen(serverUri));
+        peerAddress_ = NetworkAddress_New(peerUri, strlen(peerUri));
+        ASSERT_TRUE(serverAddress_ != NULL);
+        ASSERT_TRUE(peerAddress_ != NULL);
+        memset(&responses_, 0, sizeof(responses_));
+    }
+
+    void TearDown()
+    {
+        for (size_t i = 0; i < transactions_.size(); i++)
+        {
+            coap_clear_transaction(&transactions_[i]);
+        }
+        coap_set_service_callback(NULL);
+        coap_destroy_dedup();
+        coap_destroy_block2();
+        NetworkSocket_Free(&server_);
+        NetworkSocket_Free(&peer_);
+    }
+
+    // Create a confirmable GET to the peer, without sending it
+    coap_transaction_t * NewRequest(uint16_t mid, uint32_t token, NetworkSocket * networkSocket = NULL, NetworkAddress * remoteAddress = NULL)
+    {
+        coap_transaction_t * transaction = coap_new_transaction((networkSocket != NULL) ? networkSocket : server_, mid,
+                                                                (remoteAddress != NULL) ? remoteAddress : peerAddress_);
+        if (transaction != NULL)
+        {
+            coap_packet_t request[1];
+            coap_init_message(request, COAP_TYPE_CON, COAP_GET, mid);
+            coap_set_token(request, reinterpret_cast<uint8_t *>(&token), sizeof(token));
+            transaction->packet_len = coap_serialize_message(request, transaction->packet);
+            transaction->callback = CountResponse;
+            transaction->callback_data = &responses_;
+        }
+        return transaction;
+    }
+
+    // Send a message from the peer to the server, and have the server handle it
+    int ReceiveFromPeer(coap_message_type_t type, uint8_t code, uint16_t mid, const uint32_t * token)
+    {
+        coap_packet_t message[1];
+        uint8_t buffer[COAP_MAX_HEADER_SIZE];
+        coap_init_message(message, type, code, mid);
+        if (token != NULL)
+        {
+            coap_set_token(message, reinterpret_cast<const uint8_t *>(token), sizeof(*token));
+        }
+        size_t length = coap_serialize_message(message, buffer);
+        EXPECT_TRUE(NetworkSocket_Send(peer_, serverAddress_, buffer, length));
+        return coap_receive(server_);
+    }
+
+    std::vector<uint8_t> DrainPeer()
+    {
+        uint8_t buffer[COAP_MAX_PACKET_SIZE];
+        NetworkAddress * sourceAddress = NULL;
+        int readLength = 0;
+        NetworkSocket_Read(peer_, buffer, sizeof(buffer), &sourceAddress, &readLength);
+        return std::vector<uint8_t>(buffer, buffer + readLength);
+    }
+
+    NetworkSocket * server_;
+    NetworkSocket * peer_;
+    NetworkAddress * serverAddress_;
+    NetworkAddress * peerAddress_;
+    Responses responses_;
+    std::vector<coap_transaction_t *> transactions_;
+};
+
+TEST_F(CoapTransactionsTestSuite, get_transaction_by_mid_matches_remote_address)
+{
+    coap_transaction_t * transaction = NewRequest(1234, 1);
+    ASSERT_TRUE(transaction != NULL);
+    transactions_.push_back(transaction);
+
+    EXPECT_EQ(transaction, coap_get_transaction_by_mid(peerAddress_, 1234));
+    EXPECT_EQ(NULL, coap_get_transaction_by_mid(peerAddress_, 1235));
+    EXPECT_EQ(NULL, coap_get_transaction_by_mid(serverAddress_, 1234));
+}
+
+TEST_F(CoapTransactionsTestSuite, separate_response_before_ack_completes_transaction)
+{
+    uint32_t token = 0x12345678;
+    coap_transaction_t * transaction = NewRequest(42, token);
+    ASSERT_TRUE(transaction != NULL);
+    coap_send_transaction(transaction);
+    DrainPeer();
+    EXPECT_EQ(transaction, coap_get_transaction_by_token(peerAddress_, reinterpret_cast<uint8_t *>(&token), sizeof(token)));
+
+    // Separate CON response with a new MID - the empty ACK for the request was lost
+    ReceiveFromPeer(COAP_TYPE_CON, CONTENT_2_05, 9999, &token);
+
+    EXPECT_EQ(1, responses_.Received);
+    EXPECT_EQ(NULL, coap_get_transaction_by_mid(peerAddress_, 42));
+    EXPECT_EQ(NULL, coap_get_transaction_by_token(peerAddress_, reinterpret_cast<uint8_t *>(&token), sizeof(token)));
+    DrainPeer();   // ACK for the separate response
+}
+
+TEST_F(CoapTransactionsTestSuite, benchmark_acknowledge_10k_outstanding_transactions)
+{
+    const int numberOfTransactions = 10000;
+    for (int i = 0; i < numberOfTransactions; i++)
+    {
+        coap_transaction_t * transaction = NewRequest(i, i);
+        ASSERT_TRUE(transaction != NULL);
+        transactions_.push_back(transaction);
+    }
+
+    // Acknowledge in reverse order, the worst case for a list scan
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = numberOfTransactions - 1; i >= 0; i--)
+    {
+        ReceiveFromPeer(COAP_TYPE_ACK, CONTENT_2_05, i, NULL);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    transactions_.clear();   // freed as they were acknowledged
+
+    EXPECT_EQ(numberOfTransactions, responses_.Received);
+    EXPECT_EQ(0, responses_.TimedOut);
+    std::cout << "[ BENCHMARK] " << numberOfTransactions << " ACKs through coap_receive: "
+              << elapsed.count() / numberOfTransactions << " us per message" << std::endl;
+}
+
+TEST_F(CoapTransactionsTestSuite, duplicate_confirmable_request_is_answered_from_cache)
+{
+    uint32_t token = 7;
+    ReceiveFromPeer(COAP_TYPE_CON, COAP_GET, 100, &token);
+    std::vector<uint8_t> response = DrainPeer();
+    ASSERT_LT(0u, response.size());
+    EXPECT_EQ(1, requestsHandled);
+    EXPECT_EQ(1u, coap_dedup_count());
+
+    ReceiveFromPeer(COAP_TYPE_CON, COAP_GET, 100, &token);
+    EXPECT_EQ(response, DrainPeer());
+    EXPECT_EQ(1, requestsHandled);
+
+    // a new MID is a new request
+    ReceiveFromPeer(COAP_TYPE_CON, COAP_GET, 101, &token);
+    DrainPeer();
+    EXPECT_EQ(2, requestsHandled);
+    EXPECT_EQ(2u, coap_dedup_count());
+}
+
+TEST_F(CoapTransactionsTestSuite, duplicate_non_confirmable_request_is_ignored)
+{
+    uint32_t token = 8;
+    ReceiveFromPeer(COAP_TYPE_NON, COAP_GET, 200, &token);
+    DrainPeer();
+    ReceiveFromPeer(COAP_TYPE_NON, COAP_GET, 200, &token);
+    EXPECT_EQ(1, requestsHandled);
+}
+
+TEST_F(CoapTransactionsTestSuite, confirmable_messages_beyond_nstart_are_queued)
+{
+    const int numberOfTransactions = COAP_NSTART + 2;
+    for (int i = 0; i < numberOfTransactions; i++)
+    {
+        coap_transaction_t * transaction = NewRequest(300 + i, 300 + i);
+        ASSERT_TRUE(transaction != NULL);
+        coap_send_transaction(transaction);
+    }
+
+    coap_peer_t * peer = coap_congestion_find_peer(peerAddress_);
+    ASSERT_TRUE(peer != NULL);
+    EXPECT_EQ(COAP_NSTART, peer->in_flight);
+    EXPECT_TRUE(peer->queue_head != NULL);
+
+    // each ACK lets one queued message through
+    for (int i = 0; i < numberOfTransactions; i++)
+    {
+        DrainPeer();
+        ReceiveFromPeer(COAP_TYPE_ACK, CONTENT_2_05, 300 + i, NULL);
+        coap_check_transactions();
+    }
+    EXPECT_EQ(numberOfTransactions, responses_.Received);
+    EXPECT_EQ(0, peer->in_flight);
+    EXPECT_EQ(NULL, peer->queue_head);
+}
+
+TEST_F(CoapTransactionsTestSuite, acknowledgement_updates_peer_rto)
+{
+    coap_transaction_t * transaction = NewRequest(400, 400);
+    ASSERT_TRUE(transaction != NULL);
+    coap_send_transaction(transaction);
+    DrainPeer();
+
+    coap_peer_t * peer = coap_congestion_find_peer(peerAddress_);
+    ASSERT_TRUE(peer != NULL);
+    EXPECT_EQ(static_cast<uint32_t>(COAP_RESPONSE_TIMEOUT_MS), peer->rto);
+
+    ReceiveFromPeer(COAP_TYPE_ACK, CONTENT_2_05, 400, NULL);
+    EXPECT_EQ(1, responses_.Received);
+    EXPECT_LT(peer->rto, static_cast<uint32_t>(COAP_RESPONSE_TIMEOUT_MS));
+    EXPECT_GE(peer->rto, static_cast<uint32_t>(COAP_MIN_RTO_MS));
+}
+
+TEST_F(CoapTransactionsTestSuite, large_response_is_served_block_by_block_from_cache)
+{
+    coap_set_service_callback(HandleLargeRequest);
+    largeResponsesRendered = 0;
+
+    // the peer asks for 256 byte blocks
+    std::vector<uint8_t> received;
+    uint32_t etag = 0;
+    uint8_t more = 1;
+    for (uint32_t num = 0; more; num++)
+    {
+        coap_packet_t request[1];
+        uint8_t buffer[COAP_MAX_HEADER_SIZE];
+        coap_init_message(request, COAP_TYPE_CON, COAP_GET, 500 + num);
+        coap_set_header_uri_path(request, "large");
+        coap_set_header_block2(request, num, 0, 256);
+        size_t length = coap_serialize_message(request, buffer);
+        ASSERT_TRUE(NetworkSocket_Send(peer_, serverAddress_, buffer, length));
+        coap_receive(server_);
+
+        std::vector<uint8_t> message = DrainPeer();
+        coap_packet_t response[1];
+        ASSERT_EQ(NO_ERROR, coap_parse_message(response, message.data(), message.size()));
+
+        uint32_t responseNum = 0;
+        uint16_t size = 0;
+        ASSERT_TRUE(coap_get_header_block2(response, &responseNum, &more, &size, NULL));
+        EXPECT_EQ(num, responseNum);
+        EXPECT_EQ(256, size);
+
+        const uint8_t * tag = NULL;
+        ASSERT_EQ(static_cast<int>(sizeof(etag)), coap_get_header_etag(response, &tag));
+        if (num == 0)
+        {
+            memcpy(&etag, tag, sizeof(etag));
+        }
+        EXPECT_EQ(0, memcmp(&etag, tag, sizeof(etag)));
+
+        const uint8_t * payload = NULL;
+        int payloadLength = coap_get_payload(response, &payload);
+        received.insert(received.end(), payload, payload + payloadLength);
+    }
+
+    ASSERT_EQ(3000u, received.size());
+    for (size_t i = 0; i < received.size(); i++)
+    {
+        ASSERT_EQ(i % 251, received[i]);
+    }
+    EXPECT_EQ(1, largeResponsesRendered);
+    EXPECT_EQ(0u, coap_block2_count());   // forgotten once the last block was sent
+}
+
+TEST_F(CoapTransactionsTestSuite, block2_serve_handles_offset_beyond_response)
+{
+    uint8_t payload[100] = { 0 };
+    uint8_t buffer[64];
+    coap_packet_t response[1];
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, 1);
+
+    coap_block2_entry_t * block = coap_block2_add(peerAddress_, "small", TEXT_PLAIN, payload, sizeof(payload));
+    ASSERT_TRUE(block != NULL);
+    EXPECT_EQ(block, coap_block2_find(peerAddress_, "small"));
+    EXPECT_EQ(NULL, coap_block2_find(serverAddress_, "small"));
+
+    EXPECT_EQ(-2, coap_block2_serve(block, response, 128, sizeof(buffer), buffer));
+    EXPECT_EQ(64, coap_block2_serve(block, response, 0, sizeof(buffer), buffer));
+    EXPECT_EQ(-1, coap_block2_serve(block, response, 64, sizeof(buffer), buffer));
+    EXPECT_EQ(0u, coap_block2_count());
+}
+
+TEST_F(CoapTransactionsTestSuite, addresses_are_cached_by_whole_uri_authority)
+{
+    const char * resourceUri = "coap://127.0.0.1:60684/3/0/0?pmin=1";
+    const char * otherPortUri = "coap://127.0.0.1:6068/3/0/0";
+    const char * tcpUri = "coap+tcp://127.0.0.1:60684/3/0/0";
+
+    NetworkAddress * resource = NetworkAddress_New(resourceUri, strlen(resourceUri));
+    NetworkAddress * otherPort = NetworkAddress_New(otherPortUri, strlen(otherPortUri));
+    NetworkAddress * tcp = NetworkAddress_New(tcpUri, strlen(tcpUri));
+
+    EXPECT_EQ(peerAddress_, resource);
+    EXPECT_TRUE(otherPort != NULL);
+    EXPECT_NE(peerAddress_, otherPort);
+    EXPECT_TRUE(tcp != NULL);
+    EXPECT_NE(peerAddress_, tcp);
+    EXPECT_TRUE(NetworkAddress_IsReliable(tcp));
+
+    NetworkAddress_Free(&resource);
+    NetworkAddress_Free(&otherPort);
+    NetworkAddress_Free(&tcp);
+}
+
+TEST_F(CoapTransactionsTestSuite, parsed_token_and_etag_refer_to_receive_buffer)
+{
+    uint8_t buffer[COAP_MAX_HEADER_SIZE];
+    uint32_t token = 0x12345678;
+    uint32_t etag = 0xcafe;
+    coap_packet_t message[1];
+    coap_init_message(message, COAP_TYPE_CON, CONTENT_2_05, 7);
+    coap_set_token(message, reinterpret_cast<uint8_t *>(&token), sizeof(token));
+    coap_set_header_etag(message, reinterpret_cast<uint8_t *>(&etag), sizeof(etag));
+    size_t length = coap_serialize_message(message, buffer);
+
+    coap_packet_t parsed[1];
+    ASSERT_EQ(NO_ERROR, coap_parse_message(parsed, buffer, length));
+    const uint8_t * parsedEtag = NULL;
+    ASSERT_EQ(static_cast<int>(sizeof(etag)), coap_get_header_etag(parsed, &parsedEtag));
+    EXPECT_TRUE(parsed->token == &buffer[4]);
+    EXPECT_TRUE((parsedEtag > buffer) && (parsedEtag < buffer + length));
+    EXPECT_EQ(0, memcmp(&token, parsed->token, sizeof(token)));
+    EXPECT_EQ(0, memcmp(&etag, parsedEtag, sizeof(etag)));
+}
+
+TEST_F(CoapTransactionsTestSuite, benchmark_resolve_10k_client_uris)
+{
+    const int numberOfClients = 10000;
+    const int requestsPerClient = 10;
+    std::vector<NetworkAddress *> addresses;
+    char uri[64];
+
+    for (int i = 0; i < numberOfClients; i++)
+    {
+        snprintf(uri, sizeof(uri), "coap://127.0.0.1:%d/rd", 10000 + i);
+        addresses.push_back(NetworkAddress_New(uri, strlen(uri)));
+        ASSERT_TRUE(addresses.back() != NULL);
+    }
+
+    // Requests to registered clients find the address resolved at registration
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int n = 0; n < requestsPerClient; n++)
+    {
+        for (int i = 0; i < numberOfClients; i++)
+        {
+            snprintf(uri, sizeof(uri), "coap://127.0.0.1:%d/3/0/%d", 10000 + i, n);
+            NetworkAddress * address = NetworkAddress_New(uri, strlen(uri));
+            ASSERT_EQ(addresses[i], address);
+            NetworkAddress_Free(&address);
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (size_t i = 0; i < addresses.size(); i++)
+    {
+        NetworkAddress_Free(&addresses[i]);
+    }
+    std::cout << "[ BENCHMARK] NetworkAddress_New for " << numberOfClients << " cached clients: "
+              << elapsed.count() / (numberOfClients * requestsPerClient) << " us per request" << std::endl;
+}
+
+// Retransmission tests run on a stopped clock, which they move on themselves
+class CoapRetransmissionTestSuite : public CoapTransactionsTestSuite
+{
+protected:
+    void SetUp()
+    {
+        UnitSupport_SetTickCountMs(1000000);
+        CoapTransactionsTestSuite::SetUp();
+    }
+
+    void TearDown()
+    {
+        CoapTransactionsTestSuite::TearDown();
+        UnitSupport_UseRealTickCount();
+    }
+
+    // Move the clock on and process transactions, returning the next timeout
+    int Advance(int milliseconds)
+    {
+        UnitSupport_AdvanceTickCountMs(milliseconds);
+        return coap_check_transactions();
+    }
+};
+
+TEST_F(CoapRetransmissionTestSuite, first_retransmission_is_between_ack_timeout_and_random_factor)
+{
+    const int minimumTimeout = COAP_RESPONSE_TIMEOUT_MS;
+    const int maximumTimeout = COAP_RESPONSE_TIMEOUT_MS * COAP_RESPONSE_RANDOM_FACTOR;
+
+    for (int i = 0; i < 20; i++)
+    {
+        coap_transaction_t * transaction = NewRequest(600 + i, 600 + i);
+        ASSERT_TRUE(transaction != NULL);
+        coap_send_transaction(transaction);
+        std::vector<uint8_t> request = DrainPeer();
+        ASSERT_LT(0u, request.size());
+
+        int timeout = coap_check_transactions();
+        EXPECT_GE(timeout, minimumTimeout);
+        EXPECT_LE(timeout, maximumTimeout);
+
+        // nothing is resent until the timeout has passed
+        EXPECT_EQ(1, Advance(timeout - 1));
+        EXPECT_EQ(0u, DrainPeer().size());
+        Advance(1);
+        EXPECT_EQ(request, DrainPeer());
+        EXPECT_EQ(1, transaction->retrans_counter);
+
+        coap_clear_transaction(&transaction);
+    }
+    EXPECT_EQ(0, responses_.TimedOut);
+}
+
+TEST_F(CoapRetransmissionTestSuite, retransmission_interval_doubles_until_transaction_times_out)
+{
+    coap_transaction_t * transaction = NewRequest(700, 700);
+    ASSERT_TRUE(transaction != NULL);
+    coap_send_transaction(transaction);
+    std::vector<uint8_t> request = DrainPeer();
+
+    int timeout = coap_check_transactions();
+    for (int i = 1; i <= COAP_MAX_RETRANSMIT; i++)
+    {
+        int nextTimeout = Advance(timeout);
+        EXPECT_EQ(request, DrainPeer());
+        EXPECT_EQ(i, transaction->retrans_counter);
+        EXPECT_EQ(2 * timeout, nextTimeout);
+        timeout = nextTimeout;
+    }
+    EXPECT_EQ(0, responses_.TimedOut);
+
+    // the callback is told there is no response once the last retransmission has gone unacknowledged
+    EXPECT_EQ(-1, Advance(timeout));
+    EXPECT_EQ(0u, DrainPeer().size());
+    EXPECT_EQ(1, responses_.TimedOut);
+    EXPECT_EQ(0, responses_.Received);
+    EXPECT_EQ(NULL, coap_get_transaction_by_mid(peerAddress_, 700));
+}
+
+TEST_F(CoapRetransmissionTestSuite, acknowledged_transaction_is_not_retransmitted)
+{
+    coap_transaction_t * transaction = NewRequest(750, 750);
+    ASSERT_TRUE(transaction != NULL);
+    coap_send_transaction(transaction);
+    DrainPeer();
+
+    int timeout = Advance(100);
+    ReceiveFromPeer(COAP_TYPE_ACK, CONTENT_2_05, 750, NULL);
+    EXPECT_EQ(1, responses_.Received);
+    EXPECT_EQ(-1, Advance(timeout));
+    EXPECT_EQ(0u, DrainPeer().size());
+}
+
+TEST_F(CoapRetransmissionTestSuite, failed_send_is_retried_without_counting_as_retransmission)
+{
+    // a socket that is not listening cannot send
+    NetworkSocket * closed = NetworkSocket_New("127.0.0.1", NetworkSocketType_UDP, PEER_PORT + 1);
+    ASSERT_TRUE(closed != NULL);
+    coap_transaction_t * transaction = NewRequest(800, 800, closed);
+    ASSERT_TRUE(transaction != NULL);
+
+    coap_send_transaction(transaction);
+    EXPECT_FALSE(transaction->sent);
+    EXPECT_EQ(COAP_SEND_RETRY_INTERVAL_MS, coap_check_transactions());
+    for (int i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(COAP_SEND_RETRY_INTERVAL_MS, Advance(COAP_SEND_RETRY_INTERVAL_MS));
+        EXPECT_FALSE(transaction->sent);
+    }
+    EXPECT_EQ(0, transaction->retrans_counter);
+
+    // once the message can be sent, retransmission starts from the initial timeout
+    transaction->networkSocket = server_;
+    int timeout = Advance(COAP_SEND_RETRY_INTERVAL_MS);
+    EXPECT_TRUE(transaction->sent);
+    EXPECT_LT(0u, DrainPeer().size());
+    EXPECT_EQ(0, transaction->retrans_counter);
+    EXPECT_GE(timeout, COAP_RESPONSE_TIMEOUT_MS);
+    EXPECT_LE(timeout, COAP_RESPONSE_TIMEOUT_MS * COAP_RESPONSE_RANDOM_FACTOR);
+
+    coap_clear_transaction(&transaction);
+    NetworkSocket_Free(&closed);
+}
+
+TEST_F(CoapRetransmissionTestSuite, message_that_cannot_be_sent_times_out_after_max_transmit_wait)
+{
+    NetworkSocket * closed = NetworkSocket_New("127.0.0.1", NetworkSocketType_UDP, PEER_PORT + 1);
+    ASSERT_TRUE(closed != NULL);
+    coap_transaction_t * transaction = NewRequest(900, 900, closed);
+    ASSERT_TRUE(transaction != NULL);
+    coap_send_transaction(transaction);
+
+    long elapsed = 0;
+    while ((responses_.TimedOut == 0) && (elapsed <= COAP_MAX_TRANSMIT_WAIT_MS))
+    {
+        Advance(COAP_SEND_RETRY_INTERVAL_MS);
+        elapsed += COAP_SEND_RETRY_INTERVAL_MS;
+    }
+    EXPECT_EQ(1, responses_.TimedOut);
+    EXPECT_GE(elapsed, COAP_MAX_TRANSMIT_WAIT_MS);
+    EXPECT_LT(elapsed, COAP_MAX_TRANSMIT_WAIT_MS + COAP_SEND_RETRY_INTERVAL_MS);
+    EXPECT_EQ(-1, coap_check_transactions());
+
+    NetworkSocket_Free(&closed);
+}
+
+TEST_F(CoapRetransmissionTestSuite, check_transactions_returns_time_until_soonest_retransmission)
+{
+    EXPECT_EQ(-1, coap_check_transactions());
+
+    coap_transaction_t * first = NewRequest(1000, 1000);
+    ASSERT_TRUE(first != NULL);
+    coap_send_transaction(first);
+    DrainPeer();
+    int firstTimeout = coap_check_transactions();
+    EXPECT_EQ(firstTimeout - 500, Advance(500));
+
+    // a message to another peer is not held back by NSTART, and its retransmission may come first
+    const char * otherUri = "coap://127.0.0.1:60685";
+    NetworkAddress * other = NetworkAddress_New(otherUri, strlen(otherUri));
+    ASSERT_TRUE(other != NULL);
+    coap_transaction_t * second = NewRequest(1001, 1001, server_, other);
+    ASSERT_TRUE(second != NULL);
+    coap_send_transaction(second);
+    int secondTimeout = second->retrans_interval;
+    EXPECT_EQ(std::min(firstTimeout - 500, secondTimeout), coap_check_transactions());
+
+    coap_clear_transaction(&first);
+    EXPECT_EQ(secondTimeout, coap_check_transactions());
+    coap_clear_transaction(&second);
+    EXPECT_EQ(-1, coap_check_transactions());
+    NetworkAddress_Free(&other);
+}
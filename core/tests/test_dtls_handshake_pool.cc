@@ -0,0 +1,214 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <poll.h>
+
+#include "dtls_handshake_pool.h"
+#include "dtls_abstraction.h"
+#include "lwm2m_metrics.h"
+
+namespace {
+
+// Held by a gated job's Run until the test opens it
+std::atomic<bool> gateOpen(true);
+
+struct TestJob
+{
+    DTLS_HandshakeJob Job;
+    bool Gated;
+    std::thread::id RunThread;
+    std::thread::id CompleteThread;
+    int Runs;
+    int Completions;
+};
+
+void RunJob(DTLS_HandshakeJob * job)
+{
+    TestJob * testJob = reinterpret_cast<TestJob *>(job);
+    while (testJob->Gated && !gateOpen)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    testJob->RunThread = std::this_thread::get_id();
+    testJob->Runs++;
+}
+
+void CompleteJob(DTLS_HandshakeJob * job)
+{
+    TestJob * testJob = reinterpret_cast<TestJob *>(job);
+    testJob->CompleteThread = std::this_thread::get_id();
+    testJob->Completions++;
+}
+
+bool IsReadable(int fd, int timeoutMs)
+{
+    struct pollfd pollFd = { fd, POLLIN, 0 };
+    return (poll(&pollFd, 1, timeoutMs) == 1) && (pollFd.revents & POLLIN);
+}
+
+} // namespace
+
+class DTLSHandshakePoolTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        gateOpen = true;
+        jobsBefore_ = Metrics_Get(Metric_DtlsHandshakeJobs);
+    }
+
+    void TearDown()
+    {
+        gateOpen = true;
+        DTLS_SetHandshakeWorkers(0);
+    }
+
+    TestJob * Submit(bool gated = false)
+    {
+        TestJob job = { };
+        job.Job.Run = RunJob;
+        job.Job.Complete = CompleteJob;
+        job.Gated = gated;
+        jobs_.push_back(job);
+        return DTLSHandshakePool_Submit(&jobs_.back().Job) ? &jobs_.back() : NULL;
+    }
+
+    int Completions()
+    {
+        int completions = 0;
+        for (size_t i = 0; i < jobs_.size(); i++)
+        {
+            completions += jobs_[i].Completions;
+        }
+        return completions;
+    }
+
+    int64_t jobsBefore_;
+    std::deque<TestJob> jobs_;     // a deque, so that submitted jobs do not move
+};
+
+TEST_F(DTLSHandshakePoolTestSuite, jobs_are_not_accepted_without_workers)
+{
+    DTLS_SetHandshakeWorkers(0);
+    EXPECT_EQ(-1, DTLS_GetHandshakeFileDescriptor());
+    EXPECT_EQ(NULL, Submit());
+    EXPECT_EQ(jobsBefore_, Metrics_Get(Metric_DtlsHandshakeJobs));
+
+    // nothing to complete, and stopping without workers is harmless
+    DTLS_CompleteHandshakes();
+    DTLSHandshakePool_Stop();
+    EXPECT_EQ(0, Completions());
+}
+
+TEST_F(DTLSHandshakePoolTestSuite, jobs_run_on_workers_and_complete_on_main_loop)
+{
+    const int numberOfJobs = 200;
+    DTLS_SetHandshakeWorkers(4);
+    int fd = DTLS_GetHandshakeFileDescriptor();
+    ASSERT_NE(-1, fd);
+
+    for (int i = 0; i < numberOfJobs; i++)
+    {
+        ASSERT_TRUE(Submit() != NULL);
+    }
+
+    for (int i = 0; (i < 1000) && (Completions() < numberOfJobs); i++)
+    {
+        if (IsReadable(fd, 10))
+        {
+            DTLS_CompleteHandshakes();
+        }
+    }
+    ASSERT_EQ(numberOfJobs, Completions());
+
+    for (size_t i = 0; i < jobs_.size(); i++)
+    {
+        EXPECT_EQ(1, jobs_[i].Runs);
+        EXPECT_EQ(1, jobs_[i].Completions);
+        EXPECT_NE(std::this_thread::get_id(), jobs_[i].RunThread);
+        EXPECT_EQ(std::this_thread::get_id(), jobs_[i].CompleteThread);
+    }
+    EXPECT_EQ(jobsBefore_, Metrics_Get(Metric_DtlsHandshakeJobs));
+}
+
+TEST_F(DTLSHandshakePoolTestSuite, wake_pipe_is_readable_only_once_a_job_is_done)
+{
+    DTLS_SetHandshakeWorkers(1);
+    int fd = DTLS_GetHandshakeFileDescriptor();
+    ASSERT_NE(-1, fd);
+
+    gateOpen = false;
+    TestJob * job = Submit(true);
+    ASSERT_TRUE(job != NULL);
+    EXPECT_EQ(jobsBefore_ + 1, Metrics_Get(Metric_DtlsHandshakeJobs));
+    EXPECT_FALSE(IsReadable(fd, 50));
+
+    // completing early does nothing while the worker has the job
+    DTLS_CompleteHandshakes();
+    EXPECT_EQ(0, job->Completions);
+
+    gateOpen = true;
+    EXPECT_TRUE(IsReadable(fd, 5000));
+    EXPECT_EQ(0, job->Completions);
+    DTLS_CompleteHandshakes();
+    EXPECT_EQ(1, job->Completions);
+    EXPECT_EQ(jobsBefore_, Metrics_Get(Metric_DtlsHandshakeJobs));
+
+    // the pipe is drained
+    EXPECT_FALSE(IsReadable(fd, 0));
+}
+
+TEST_F(DTLSHandshakePoolTestSuite, stop_runs_and_completes_queued_jobs)
+{
+    const int numberOfQueuedJobs = 20;
+    DTLS_SetHandshakeWorkers(1);
+
+    // the worker is held by the first job, so the rest are still queued when the pool is stopped
+    gateOpen = false;
+    ASSERT_TRUE(Submit(true) != NULL);
+    for (int i = 0; i < numberOfQueuedJobs; i++)
+    {
+        ASSERT_TRUE(Submit() != NULL);
+    }
+    std::thread opener([]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        gateOpen = true;
+    });
+
+    DTLSHandshakePool_Stop();
+    opener.join();
+
+    EXPECT_EQ(numberOfQueuedJobs + 1, Completions());
+    for (size_t i = 0; i < jobs_.size(); i++)
+    {
+        EXPECT_EQ(1, jobs_[i].Runs);
+        EXPECT_EQ(1, jobs_[i].Completions);
+    }
+    EXPECT_EQ(-1, DTLS_GetHandshakeFileDescriptor());
+    EXPECT_EQ(NULL, Submit());
+    EXPECT_EQ(jobsBefore_, Metrics_Get(Metric_DtlsHandshakeJobs));
+}
@@ -0,0 +1,275 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+extern "C" {
+#include "dtls_abstraction.h"
+#include "dtls_keystore.h"
+#include "lwm2m_debug.h"
+#include "lwm2m_metrics.h"
+}
+
+class DTLSKeyStoreTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        logLevel_ = Lwm2m_GetLogLevel();
+        Lwm2m_SetLogLevel(DebugLevel_Emerg);
+        store_ = DTLSKeyStore_New();
+        char fileName[] = "/tmp/awa_keystore_XXXXXX";
+        int fd = mkstemp(fileName);
+        close(fd);
+        fileName_ = fileName;
+    }
+
+    void TearDown()
+    {
+        DTLSKeyStore_Free(&store_);
+        DTLS_LoadKeyStore(NULL);
+        remove(fileName_.c_str());
+        Lwm2m_SetLogLevel(logLevel_);
+    }
+
+    void WriteFile(const std::string & contents)
+    {
+        std::ofstream file(fileName_.c_str(), std::ios::trunc);
+        file << contents;
+    }
+
+    std::string Key(const char * identity)
+    {
+        size_t keyLength = 0;
+        const uint8_t * key = DTLSKeyStore_Find(store_, identity, strlen(identity), &keyLength);
+        return key ? std::string(reinterpret_cast<const char *>(key), keyLength) : std::string("none");
+    }
+
+    DebugLevel logLevel_;
+    DTLS_KeyStore * store_;
+    std::string fileName_;
+};
+
+TEST_F(DTLSKeyStoreTestSuite, keys_are_found_by_identity)
+{
+    ASSERT_TRUE(NULL != store_);
+    EXPECT_TRUE(DTLSKeyStore_Add(store_, "device1", 7, reinterpret_cast<const uint8_t *>("key1"), 4));
+    EXPECT_TRUE(DTLSKeyStore_Add(store_, "device2", 7, reinterpret_cast<const uint8_t *>("key2"), 4));
+    EXPECT_EQ(2u, DTLSKeyStore_Count(store_));
+    EXPECT_EQ("key1", Key("device1"));
+    EXPECT_EQ("key2", Key("device2"));
+    EXPECT_EQ("none", Key("device3"));
+    EXPECT_EQ("none", Key("device"));
+    EXPECT_EQ(NULL, DTLSKeyStore_Find(NULL, "device1", 7, NULL));
+}
+
+TEST_F(DTLSKeyStoreTestSuite, adding_an_identity_again_replaces_its_key)
+{
+    EXPECT_TRUE(DTLSKeyStore_Add(store_, "device1", 7, reinterpret_cast<const uint8_t *>("key1"), 4));
+    EXPECT_TRUE(DTLSKeyStore_Add(store_, "device1", 7, reinterpret_cast<const uint8_t *>("KEY1"), 4));
+    EXPECT_EQ("KEY1", Key("device1"));
+    EXPECT_TRUE(DTLSKeyStore_Add(store_, "device1", 7, reinterpret_cast<const uint8_t *>("longer key"), 10));
+    EXPECT_EQ("longer key", Key("device1"));
+    EXPECT_EQ(1u, DTLSKeyStore_Count(store_));
+}
+
+TEST_F(DTLSKeyStoreTestSuite, invalid_entries_are_rejected)
+{
+    uint8_t key[DTLS_MAX_PSK_LENGTH + 1] = { 0 };
+    EXPECT_FALSE(DTLSKeyStore_Add(store_, "device1", 7, key, 0));
+    EXPECT_FALSE(DTLSKeyStore_Add(store_, "device1", 7, key, sizeof(key)));
+    EXPECT_FALSE(DTLSKeyStore_Add(store_, "", 0, key, 1));
+    EXPECT_FALSE(DTLSKeyStore_Add(NULL, "device1", 7, key, 1));
+    EXPECT_EQ(0u, DTLSKeyStore_Count(store_));
+}
+
+TEST_F(DTLSKeyStoreTestSuite, load_parses_identities_and_hex_keys)
+{
+    WriteFile("# identity:key\n"
+              "\n"
+              "device1:6B657931\n"
+              "urn:imei:123456789012345:6b657932\r\n"
+              "device3:6B65793\n"          // odd number of digits
+              "device4:6B65797X\n"         // not hex
+              ":6B657935\n"                // no identity
+              "device6\n"                  // no key
+              "device7:6B657937   \n");
+    DTLS_KeyStore * loaded = DTLSKeyStore_Load(fileName_.c_str());
+    ASSERT_TRUE(NULL != loaded);
+    DTLSKeyStore_Free(&store_);
+    store_ = loaded;
+    EXPECT_EQ(3u, DTLSKeyStore_Count(store_));
+    EXPECT_EQ("key1", Key("device1"));
+    EXPECT_EQ("key2", Key("urn:imei:123456789012345"));
+    EXPECT_EQ("key7", Key("device7"));
+    EXPECT_EQ("none", Key("device3"));
+    EXPECT_EQ("none", Key("device4"));
+    EXPECT_EQ(NULL, DTLSKeyStore_Load("/nonexistent/keys.psk"));
+}
+
+TEST_F(DTLSKeyStoreTestSuite, reload_replaces_keys_and_keeps_them_if_the_file_is_missing)
+{
+    uint8_t key[DTLS_MAX_PSK_LENGTH];
+    EXPECT_EQ(-1, DTLS_FindPSK("device1", 7, key, sizeof(key)));
+
+    WriteFile("device1:6B657931\ndevice2:6B657932\n");
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName_.c_str()));
+    EXPECT_EQ(2, Metrics_Get(Metric_DtlsPskIdentities));
+    EXPECT_EQ(4, DTLS_FindPSK("device1", 7, key, sizeof(key)));
+    EXPECT_EQ(0, memcmp(key, "key1", 4));
+    EXPECT_EQ(0, DTLS_FindPSK("device3", 7, key, sizeof(key)));
+
+    // device2 is removed and device3 added
+    WriteFile("device1:4B455931\ndevice3:6B657933\n");
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName_.c_str()));
+    EXPECT_EQ(4, DTLS_FindPSK("device1", 7, key, sizeof(key)));
+    EXPECT_EQ(0, memcmp(key, "KEY1", 4));
+    EXPECT_EQ(0, DTLS_FindPSK("device2", 7, key, sizeof(key)));
+    EXPECT_EQ(4, DTLS_FindPSK("device3", 7, key, sizeof(key)));
+
+    remove(fileName_.c_str());
+    EXPECT_FALSE(DTLS_LoadKeyStore(fileName_.c_str()));
+    EXPECT_EQ(4, DTLS_FindPSK("device3", 7, key, sizeof(key)));
+
+    EXPECT_TRUE(DTLS_LoadKeyStore(NULL));
+    EXPECT_EQ(-1, DTLS_FindPSK("device3", 7, key, sizeof(key)));
+    EXPECT_EQ(0, Metrics_Get(Metric_DtlsPskIdentities));
+}
+
+TEST_F(DTLSKeyStoreTestSuite, keys_are_revoked_only_if_changed_or_removed)
+{
+    DTLS_KeyStore * store = DTLSKeyStore_New();
+    ASSERT_TRUE(NULL != store);
+    EXPECT_TRUE(DTLSKeyStore_Add(store_, "device1", 7, reinterpret_cast<const uint8_t *>("key1"), 4));
+    EXPECT_TRUE(DTLSKeyStore_Add(store_, "device2", 7, reinterpret_cast<const uint8_t *>("key2"), 4));
+    EXPECT_TRUE(DTLSKeyStore_Add(store, "device2", 7, reinterpret_cast<const uint8_t *>("key2"), 4));
+    EXPECT_TRUE(DTLSKeyStore_Add(store, "device1", 7, reinterpret_cast<const uint8_t *>("key1"), 4));
+    EXPECT_FALSE(DTLSKeyStore_KeysRevoked(store_, store));
+
+    // adding an identity revokes nothing
+    EXPECT_TRUE(DTLSKeyStore_Add(store, "device3", 7, reinterpret_cast<const uint8_t *>("key3"), 4));
+    EXPECT_FALSE(DTLSKeyStore_KeysRevoked(store_, store));
+    EXPECT_TRUE(DTLSKeyStore_KeysRevoked(store, store_));
+
+    EXPECT_TRUE(DTLSKeyStore_Add(store, "device1", 7, reinterpret_cast<const uint8_t *>("KEY1"), 4));
+    EXPECT_TRUE(DTLSKeyStore_KeysRevoked(store_, store));
+    EXPECT_TRUE(DTLSKeyStore_Add(store, "device1", 7, reinterpret_cast<const uint8_t *>("key1 "), 5));
+    EXPECT_TRUE(DTLSKeyStore_KeysRevoked(store_, store));
+
+    EXPECT_FALSE(DTLSKeyStore_KeysRevoked(NULL, NULL));
+    EXPECT_TRUE(DTLSKeyStore_KeysRevoked(store_, NULL));
+    EXPECT_TRUE(DTLSKeyStore_KeysRevoked(NULL, store));
+    DTLSKeyStore_Free(&store);
+}
+
+namespace {
+
+int keysRevoked = 0;
+
+void CountKeysRevoked(void)
+{
+    keysRevoked++;
+}
+
+} // namespace
+
+TEST_F(DTLSKeyStoreTestSuite, reload_calls_back_when_keys_are_revoked)
+{
+    keysRevoked = 0;
+    DTLSKeyStore_SetKeysRevokedCallback(CountKeysRevoked);
+
+    WriteFile("device1:6B657931\n");
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName_.c_str()));
+    EXPECT_EQ(1, keysRevoked);
+
+    WriteFile("device1:6B657931\ndevice2:6B657932\n");
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName_.c_str()));
+    EXPECT_EQ(1, keysRevoked);
+
+    WriteFile("device1:4B455931\ndevice2:6B657932\n");
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName_.c_str()));
+    EXPECT_EQ(2, keysRevoked);
+
+    // a file that fails to load keeps the keys in use
+    remove(fileName_.c_str());
+    EXPECT_FALSE(DTLS_LoadKeyStore(fileName_.c_str()));
+    EXPECT_EQ(2, keysRevoked);
+
+    EXPECT_TRUE(DTLS_LoadKeyStore(NULL));
+    EXPECT_EQ(3, keysRevoked);
+    DTLSKeyStore_SetKeysRevokedCallback(NULL);
+}
+
+TEST_F(DTLSKeyStoreTestSuite, benchmark_1m_identities)
+{
+    const int numberOfIdentities = 1000000;
+    const size_t keyLength = 16;
+    std::vector<std::string> identities(numberOfIdentities);
+    size_t identityBytes = 0;
+    {
+        std::ofstream file(fileName_.c_str(), std::ios::trunc);
+        for (int i = 0; i < numberOfIdentities; i++)
+        {
+            char identity[32];
+            snprintf(identity, sizeof(identity), "device-%08d", i);
+            identities[i] = identity;
+            identityBytes += identities[i].length();
+            file << identity << ":264618867" << (i % 10) << "F6CCD4AAEA476C645F2565\n";
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    DTLSKeyStore_Free(&store_);
+    store_ = DTLSKeyStore_Load(fileName_.c_str());
+    auto loadElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_TRUE(NULL != store_);
+    ASSERT_EQ(static_cast<size_t>(numberOfIdentities), DTLSKeyStore_Count(store_));
+
+    start = std::chrono::steady_clock::now();
+    int found = 0;
+    for (int i = 0; i < numberOfIdentities; i++)
+    {
+        size_t length;
+        const uint8_t * key = DTLSKeyStore_Find(store_, identities[i].c_str(), identities[i].length(), &length);
+        found += (key != NULL) && (length == keyLength) && (key[4] == 0x70 + (i % 10));
+    }
+    auto findElapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(numberOfIdentities, found);
+
+    // memory beyond the identities and keys themselves
+    double overhead = static_cast<double>(DTLSKeyStore_Size(store_) - identityBytes - numberOfIdentities * keyLength) / numberOfIdentities;
+    EXPECT_LT(overhead, 32.0);
+
+    std::cout << "[ BENCHMARK] " << numberOfIdentities << " PSK identities: loaded in " << loadElapsed << " ms, "
+              << static_cast<double>(findElapsed) / numberOfIdentities << " ns per lookup, "
+              << DTLSKeyStore_Size(store_) / (1024 * 1024) << " MB (" << overhead << " bytes per entry beyond the identity and key)" << std::endl;
+}
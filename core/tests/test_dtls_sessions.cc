@@ -0,0 +1,620 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+
+extern "C" {
+#include "dtls_abstraction.h"
+#include "dtls_sessions.h"
+#include "lwm2m_metrics.h"
+#include "lwm2m_debug.h"
+}
+
+namespace {
+
+struct TestSession
+{
+    DTLS_SessionEntry Entry;
+    int ID;
+};
+
+std::vector<int> freedSessions;
+
+void FreeTestSession(DTLS_SessionEntry * entry)
+{
+    freedSessions.push_back(DTLSSessionEntry(entry, TestSession, Entry)->ID);
+}
+
+NetworkAddress * NewAddress(const char * host, int port)
+{
+    std::string uri = std::string("coaps://") + host + ":" + std::to_string(port);
+    return NetworkAddress_New(uri.c_str(), uri.length());
+}
+
+} // namespace
+
+class DTLSSessionsTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        freedSessions.clear();
+        DTLSSessions_Init(FreeTestSession);
+    }
+
+    void TearDown()
+    {
+        DTLSSessions_Destroy();
+        DTLS_SetSessionLimits(0, 0);
+        for (size_t i = 0; i < addresses_.size(); i++)
+        {
+            NetworkAddress_Free(&addresses_[i]);
+        }
+    }
+
+    // Sessions stay allocated until the table is destroyed in TearDown
+    TestSession * AddSession(int port)
+    {
+        TestSession session;
+        session.ID = sessions_.size();
+        sessions_.push_back(session);
+        addresses_.push_back(NewAddress("127.0.0.1", port));
+        DTLSSessions_Add(&sessions_.back().Entry, addresses_.back());
+        return &sessions_.back();
+    }
+
+    std::deque<TestSession> sessions_;
+    std::vector<NetworkAddress *> addresses_;
+};
+
+TEST_F(DTLSSessionsTestSuite, sessions_are_found_by_peer_address)
+{
+    const int numberOfSessions = 1000;
+    for (int i = 0; i < numberOfSessions; i++)
+    {
+        AddSession(20000 + i);
+    }
+    EXPECT_EQ(static_cast<size_t>(numberOfSessions), DTLSSessions_Count());
+
+    for (int i = 0; i < numberOfSessions; i++)
+    {
+        NetworkAddress * address = NewAddress("127.0.0.1", 20000 + i);
+        EXPECT_EQ(&sessions_[i].Entry, DTLSSessions_Find(address));
+        NetworkAddress_Free(&address);
+    }
+    NetworkAddress * unknown = NewAddress("127.0.0.1", 19999);
+    EXPECT_EQ(NULL, DTLSSessions_Find(unknown));
+    NetworkAddress_Free(&unknown);
+
+    DTLSSessions_Remove(&sessions_[7].Entry);
+    DTLSSessions_Remove(&sessions_[7].Entry);
+    EXPECT_EQ(NULL, DTLSSessions_Find(addresses_[7]));
+    EXPECT_EQ(static_cast<size_t>(numberOfSessions - 1), DTLSSessions_Count());
+    EXPECT_EQ(static_cast<int64_t>(numberOfSessions - 1), Metrics_Get(Metric_DtlsSessions));
+    EXPECT_TRUE(freedSessions.empty());
+}
+
+TEST_F(DTLSSessionsTestSuite, least_recently_used_session_is_evicted_when_full)
+{
+    const int maxSessions = 4;
+    DTLS_SetSessionLimits(maxSessions, 0);
+    int64_t evicted = Metrics_Get(Metric_DtlsSessionsEvicted);
+
+    for (int i = 0; i < maxSessions; i++)
+    {
+        AddSession(20000 + i);
+    }
+    // session 0 is used again, so session 1 is now the least recently used
+    EXPECT_EQ(&sessions_[0].Entry, DTLSSessions_Find(addresses_[0]));
+
+    AddSession(20000 + maxSessions);
+    ASSERT_EQ(1u, freedSessions.size());
+    EXPECT_EQ(1, freedSessions[0]);
+    EXPECT_EQ(NULL, DTLSSessions_Find(addresses_[1]));
+    EXPECT_EQ(&sessions_[0].Entry, DTLSSessions_Find(addresses_[0]));
+
+    AddSession(20000 + maxSessions + 1);
+    ASSERT_EQ(2u, freedSessions.size());
+    EXPECT_EQ(2, freedSessions[1]);
+
+    EXPECT_EQ(static_cast<size_t>(maxSessions), DTLSSessions_Count());
+    EXPECT_EQ(evicted + 2, Metrics_Get(Metric_DtlsSessionsEvicted));
+}
+
+TEST_F(DTLSSessionsTestSuite, idle_sessions_are_evicted)
+{
+    DTLS_SetSessionLimits(0, 1);
+    AddSession(20000);
+    TestSession * active = AddSession(20001);
+
+    DTLSSessions_EvictIdle();
+    EXPECT_TRUE(freedSessions.empty());
+
+    usleep(600 * 1000);
+    DTLSSessions_Find(addresses_[1]);
+    usleep(600 * 1000);
+    DTLSSessions_EvictIdle();
+    ASSERT_EQ(1u, freedSessions.size());
+    EXPECT_EQ(0, freedSessions[0]);
+    EXPECT_EQ(1u, DTLSSessions_Count());
+    EXPECT_EQ(&active->Entry, DTLSSessions_Find(addresses_[1]));
+}
+
+TEST_F(DTLSSessionsTestSuite, destroy_frees_every_session)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        AddSession(20000 + i);
+    }
+    DTLSSessions_Destroy();
+    EXPECT_EQ(3u, freedSessions.size());
+    EXPECT_EQ(0u, DTLSSessions_Count());
+    EXPECT_EQ(0, Metrics_Get(Metric_DtlsSessions));
+}
+
+TEST_F(DTLSSessionsTestSuite, session_cache_keeps_state_by_key)
+{
+    const char sessionID[] = "session-1";
+    const char state[] = "state";
+    const char newState[] = "new state";
+    int64_t hits = Metrics_Get(Metric_DtlsSessionCacheHits);
+    int64_t misses = Metrics_Get(Metric_DtlsSessionCacheMisses);
+
+    size_t length = 0;
+    EXPECT_EQ(NULL, DTLSSessionCache_Find(sessionID, sizeof(sessionID), &length));
+    EXPECT_TRUE(DTLSSessionCache_Store(sessionID, sizeof(sessionID), state, sizeof(state)));
+    const void * found = DTLSSessionCache_Find(sessionID, sizeof(sessionID), &length);
+    ASSERT_TRUE(NULL != found);
+    EXPECT_EQ(sizeof(state), length);
+    EXPECT_EQ(0, memcmp(state, found, length));
+
+    // a key that is a prefix of another is a different key
+    EXPECT_EQ(NULL, DTLSSessionCache_Find(sessionID, sizeof(sessionID) - 2, &length));
+
+    EXPECT_TRUE(DTLSSessionCache_Store(sessionID, sizeof(sessionID), newState, sizeof(newState)));
+    EXPECT_EQ(1u, DTLSSessionCache_Count());
+    found = DTLSSessionCache_Find(sessionID, sizeof(sessionID), &length);
+    ASSERT_TRUE(NULL != found);
+    EXPECT_EQ(0, memcmp(newState, found, sizeof(newState)));
+
+    DTLSSessionCache_Remove(sessionID, sizeof(sessionID));
+    EXPECT_EQ(NULL, DTLSSessionCache_Find(sessionID, sizeof(sessionID), &length));
+    EXPECT_EQ(0u, DTLSSessionCache_Count());
+    EXPECT_EQ(hits + 2, Metrics_Get(Metric_DtlsSessionCacheHits));
+    EXPECT_EQ(misses + 3, Metrics_Get(Metric_DtlsSessionCacheMisses));
+}
+
+TEST_F(DTLSSessionsTestSuite, session_cache_keeps_state_by_peer_address)
+{
+    AddSession(20001);
+    AddSession(20002);
+    EXPECT_TRUE(DTLSSessionCache_StoreForPeer(addresses_[0], "first", 6));
+    EXPECT_TRUE(DTLSSessionCache_StoreForPeer(addresses_[1], "second", 7));
+
+    NetworkAddress * address = NewAddress("127.0.0.1", 20002);
+    size_t length = 0;
+    const void * found = DTLSSessionCache_FindForPeer(address, &length);
+    NetworkAddress_Free(&address);
+    ASSERT_TRUE(NULL != found);
+    EXPECT_STREQ("second", static_cast<const char *>(found));
+
+    // destroying the session table drops the cached state too
+    DTLSSessions_Destroy();
+    EXPECT_EQ(0u, DTLSSessionCache_Count());
+}
+
+TEST_F(DTLSSessionsTestSuite, session_cache_drops_least_recently_used_state_when_full)
+{
+    for (int i = 0; i < MAX_DTLS_SESSION_CACHE; i++)
+    {
+        DTLSSessionCache_Store(&i, sizeof(i), &i, sizeof(i));
+    }
+    size_t length = 0;
+    int first = 0;
+    int second = 1;
+    EXPECT_TRUE(NULL != DTLSSessionCache_Find(&first, sizeof(first), &length));
+
+    int extra = MAX_DTLS_SESSION_CACHE;
+    DTLSSessionCache_Store(&extra, sizeof(extra), &extra, sizeof(extra));
+    EXPECT_EQ(static_cast<size_t>(MAX_DTLS_SESSION_CACHE), DTLSSessionCache_Count());
+    EXPECT_TRUE(NULL != DTLSSessionCache_Find(&first, sizeof(first), &length));
+    EXPECT_EQ(NULL, DTLSSessionCache_Find(&second, sizeof(second), &length));
+    EXPECT_EQ(static_cast<int64_t>(MAX_DTLS_SESSION_CACHE), Metrics_Get(Metric_DtlsSessionCacheEntries));
+}
+
+namespace {
+
+// Handshake flights are queued rather than delivered from inside the DTLS library's send callback
+struct Datagram
+{
+    bool ToServer;
+    NetworkAddress * Source;
+    std::vector<uint8_t> Data;
+};
+
+std::deque<Datagram> datagrams;
+std::map<NetworkAddress *, NetworkAddress *> peers;     // server address -> client address, and back
+std::map<NetworkAddress *, bool> serverAddresses;
+int datagramsSent = 0;
+int64_t bytesSent = 0;
+std::vector<int64_t> decryptTimes;     // nanoseconds the main loop was held by each record
+
+NetworkTransmissionError QueueDatagram(NetworkAddress * destAddress, const uint8_t * buffer, int bufferLength, void * context)
+{
+    Datagram datagram;
+    datagram.ToServer = serverAddresses.count(destAddress) > 0;
+    datagram.Source = peers[destAddress];
+    datagram.Data.assign(buffer, buffer + bufferLength);
+    datagrams.push_back(datagram);
+    datagramsSent++;
+    bytesSent += bufferLength;
+    return NetworkTransmissionError_None;
+}
+
+// Deliver datagrams until every handshake is done, including those on handshake workers
+void DeliverDatagrams()
+{
+    uint8_t decrypted[1024];
+    while (!datagrams.empty() || (Metrics_Get(Metric_DtlsHandshakeJobs) > 0))
+    {
+        if (datagrams.empty())
+        {
+            struct pollfd fd = { DTLS_GetHandshakeFileDescriptor(), POLLIN, 0 };
+            poll(&fd, 1, 1000);
+            DTLS_CompleteHandshakes();
+            continue;
+        }
+        Datagram datagram = datagrams.front();
+        datagrams.pop_front();
+        int decryptedLength = 0;
+        auto start = std::chrono::steady_clock::now();
+        DTLS_Decrypt(datagram.Source, datagram.Data.data(), datagram.Data.size(), decrypted, sizeof(decrypted), &decryptedLength, NULL);
+        decryptTimes.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+const uint8_t pskKey[] = { 0x26, 0x46, 0x18, 0x86, 0x72, 0xF6, 0xCC, 0xD4, 0xAA, 0xEA, 0x47, 0x6C, 0x64, 0x5F, 0x25, 0x65 };
+
+} // namespace
+
+// Clients and servers in one process - each client talks to its own server address, so both ends of every session
+// share the one session table
+class DTLSLoopbackTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        logLevel_ = Lwm2m_GetLogLevel();
+        Lwm2m_SetLogLevel(DebugLevel_Warning);
+        DTLS_Init();
+        DTLS_SetNetworkSendCallback(QueueDatagram);
+        DTLS_SetPSK("benchmark", pskKey, sizeof(pskKey));
+    }
+
+    void TearDown()
+    {
+        DTLS_Shutdown();
+        EXPECT_EQ(-1, DTLS_GetHandshakeFileDescriptor());
+        Lwm2m_SetLogLevel(logLevel_);
+        DTLS_SetSessionLimits(0, 0);
+        DTLS_SetNetworkSendCallback(NULL);
+        for (size_t i = 0; i < serverAddress_.size(); i++)
+        {
+            NetworkAddress_Free(&serverAddress_[i]);
+            NetworkAddress_Free(&clientAddress_[i]);
+        }
+        peers.clear();
+        serverAddresses.clear();
+        EXPECT_EQ(0u, DTLSSessions_Count());
+    }
+
+    static bool Supported()
+    {
+        return strcmp(DTLS_LibraryName, "None") != 0;
+    }
+
+    void AddClients(int numberOfClients)
+    {
+        DTLS_SetSessionLimits(2 * numberOfClients, 0);
+        serverAddress_.resize(numberOfClients);
+        clientAddress_.resize(numberOfClients);
+        for (int i = 0; i < numberOfClients; i++)
+        {
+            serverAddress_[i] = NewAddress("127.0.0.2", 20000 + i);
+            clientAddress_[i] = NewAddress("127.0.0.3", 20000 + i);
+            peers[serverAddress_[i]] = clientAddress_[i];
+            peers[clientAddress_[i]] = serverAddress_[i];
+            serverAddresses[serverAddress_[i]] = true;
+        }
+    }
+
+    // Handshake every client with its server, returning the time taken in microseconds
+    int64_t Handshake()
+    {
+        uint8_t encrypted[1024];
+        int encryptedLength = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < serverAddress_.size(); i++)
+        {
+            DTLS_Encrypt(serverAddress_[i], plainText_, sizeof(plainText_), encrypted, sizeof(encrypted), &encryptedLength, NULL);
+            DeliverDatagrams();
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Time the main loop was held by a record, in microseconds, at the given percentile of the records delivered
+    static double DecryptPercentile(double percentile)
+    {
+        std::vector<int64_t> sorted(decryptTimes);
+        std::sort(sorted.begin(), sorted.end());
+        return sorted.empty() ? 0 : sorted[static_cast<size_t>(percentile / 100 * (sorted.size() - 1))] / 1000.0;
+    }
+
+    // Start every handshake before delivering any flight, as when many clients reconnect at once, returning the time
+    // taken in microseconds
+    int64_t HandshakeStorm()
+    {
+        uint8_t encrypted[1024];
+        int encryptedLength = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < serverAddress_.size(); i++)
+        {
+            DTLS_Encrypt(serverAddress_[i], plainText_, sizeof(plainText_), encrypted, sizeof(encrypted), &encryptedLength, NULL);
+        }
+        DeliverDatagrams();
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Send from every client to its server, returning the number of messages delivered
+    int RoundTrip()
+    {
+        int delivered = 0;
+        for (size_t i = 0; i < serverAddress_.size(); i++)
+        {
+            uint8_t encrypted[1024];
+            uint8_t decrypted[1024];
+            int encryptedLength = 0;
+            int decryptedLength = 0;
+            if (DTLS_Encrypt(serverAddress_[i], plainText_, sizeof(plainText_), encrypted, sizeof(encrypted), &encryptedLength, NULL) &&
+                DTLS_Decrypt(clientAddress_[i], encrypted, encryptedLength, decrypted, sizeof(decrypted), &decryptedLength, NULL) &&
+                (decryptedLength == sizeof(plainText_)) && (memcmp(decrypted, plainText_, sizeof(plainText_)) == 0))
+            {
+                delivered++;
+            }
+        }
+        return delivered;
+    }
+
+    DebugLevel logLevel_;
+    uint8_t plainText_[5] = "ping";
+    std::vector<NetworkAddress *> serverAddress_;
+    std::vector<NetworkAddress *> clientAddress_;
+};
+
+TEST_F(DTLSLoopbackTestSuite, server_authenticates_clients_by_key_store)
+{
+    if (!Supported())
+    {
+        GTEST_SKIP() << "not built with DTLS support";
+    }
+
+    char fileName[] = "/tmp/awa_keystore_XXXXXX";
+    int fd = mkstemp(fileName);
+    ASSERT_NE(-1, fd);
+    const char keys[] = "other:00112233445566778899AABBCCDDEEFF\nbenchmark:2646188672F6CCD4AAEA476C645F2565\n";
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(keys) - 1), write(fd, keys, sizeof(keys) - 1));
+    close(fd);
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName));
+
+    AddClients(2);
+    Handshake();
+    EXPECT_EQ(2, RoundTrip());
+    for (int i = 0; i < 2; i++)
+    {
+        DTLS_Reset(serverAddress_[i]);
+        DTLS_Reset(clientAddress_[i]);
+    }
+
+    // the client's identity is removed, so it can no longer resume its session
+    const char changed[] = "other:00112233445566778899AABBCCDDEEFF\n";
+    FILE * file = fopen(fileName, "w");
+    ASSERT_TRUE(NULL != file);
+    fputs(changed, file);
+    fclose(file);
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName));
+    Handshake();
+    EXPECT_EQ(0, RoundTrip());
+
+    DTLS_LoadKeyStore(NULL);
+    remove(fileName);
+}
+
+TEST_F(DTLSLoopbackTestSuite, sessions_are_not_resumed_once_their_key_is_changed)
+{
+    if (!Supported())
+    {
+        GTEST_SKIP() << "not built with DTLS support";
+    }
+
+    char fileName[] = "/tmp/awa_keystore_XXXXXX";
+    int fd = mkstemp(fileName);
+    ASSERT_NE(-1, fd);
+    const char keys[] = "benchmark:2646188672F6CCD4AAEA476C645F2565\n";
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(keys) - 1), write(fd, keys, sizeof(keys) - 1));
+    close(fd);
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName));
+
+    AddClients(2);
+    Handshake();
+    EXPECT_EQ(2, RoundTrip());
+
+    // reloading the same keys leaves the sessions resumable
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName));
+    int64_t resumed = Metrics_Get(Metric_DtlsHandshakesResumed);
+    DTLS_Reset(serverAddress_[0]);
+    DTLS_Reset(clientAddress_[0]);
+    Handshake();
+    EXPECT_EQ(2, RoundTrip());
+    EXPECT_EQ(resumed + 2, Metrics_Get(Metric_DtlsHandshakesResumed));
+
+    // the client's key is rotated, so it must not resume a session established with its old key - neither from the
+    // session cache nor from a ticket
+    const char changed[] = "benchmark:00112233445566778899AABBCCDDEEFF\n";
+    FILE * file = fopen(fileName, "w");
+    ASSERT_TRUE(NULL != file);
+    fputs(changed, file);
+    fclose(file);
+    ASSERT_TRUE(DTLS_LoadKeyStore(fileName));
+    EXPECT_EQ(0u, DTLSSessionCache_Count());
+    resumed = Metrics_Get(Metric_DtlsHandshakesResumed);
+    for (int i = 0; i < 2; i++)
+    {
+        DTLS_Reset(serverAddress_[i]);
+        DTLS_Reset(clientAddress_[i]);
+    }
+    Handshake();
+    EXPECT_EQ(0, RoundTrip());
+    EXPECT_EQ(resumed, Metrics_Get(Metric_DtlsHandshakesResumed));
+
+    DTLS_LoadKeyStore(NULL);
+    remove(fileName);
+}
+
+TEST_F(DTLSLoopbackTestSuite, benchmark_10k_psk_sessions)
+{
+    if (!Supported())
+    {
+        GTEST_SKIP() << "not built with DTLS support";
+    }
+
+    const int numberOfClients = 10000;
+    AddClients(numberOfClients);
+    int64_t elapsed = Handshake();
+    EXPECT_EQ(static_cast<size_t>(2 * numberOfClients), DTLSSessions_Count());
+
+    // every client can now send to its server, and the server finds the session by the client's address
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(numberOfClients, RoundTrip());
+    auto lookupElapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "[ BENCHMARK] " << numberOfClients << " " << DTLS_LibraryName << " PSK handshakes: "
+              << elapsed / 1000 << " ms (" << static_cast<double>(elapsed) / numberOfClients << " us each), "
+              << DTLSSessions_Count() << " sessions, round trip over an established session "
+              << static_cast<double>(lookupElapsed) / numberOfClients << " us" << std::endl;
+}
+
+TEST_F(DTLSLoopbackTestSuite, benchmark_full_and_resumed_handshakes)
+{
+    if (!Supported())
+    {
+        GTEST_SKIP() << "not built with DTLS support";
+    }
+
+    const int numberOfClients = 1000;
+    AddClients(numberOfClients);
+    int64_t fullHandshakes = Metrics_Get(Metric_DtlsHandshakesFull);
+    datagramsSent = 0;
+    bytesSent = 0;
+    int64_t fullElapsed = Handshake();
+    int fullDatagrams = datagramsSent;
+    int64_t fullBytes = bytesSent;
+    ASSERT_EQ(numberOfClients, RoundTrip());
+    EXPECT_EQ(fullHandshakes + 2 * numberOfClients, Metrics_Get(Metric_DtlsHandshakesFull));
+
+    // the clients wake from sleep without their sessions, and the server has dropped them too
+    for (int i = 0; i < numberOfClients; i++)
+    {
+        DTLS_Reset(serverAddress_[i]);
+        DTLS_Reset(clientAddress_[i]);
+    }
+    EXPECT_EQ(0u, DTLSSessions_Count());
+
+    fullHandshakes = Metrics_Get(Metric_DtlsHandshakesFull);
+    int64_t resumedHandshakes = Metrics_Get(Metric_DtlsHandshakesResumed);
+    datagramsSent = 0;
+    bytesSent = 0;
+    int64_t resumedElapsed = Handshake();
+    int resumedDatagrams = datagramsSent;
+    int64_t resumedBytes = bytesSent;
+    EXPECT_EQ(numberOfClients, RoundTrip());
+    EXPECT_EQ(fullHandshakes, Metrics_Get(Metric_DtlsHandshakesFull));
+    EXPECT_EQ(resumedHandshakes + 2 * numberOfClients, Metrics_Get(Metric_DtlsHandshakesResumed));
+
+    EXPECT_LT(resumedDatagrams, fullDatagrams);
+    EXPECT_LT(resumedBytes, fullBytes);
+
+    std::cout << "[ BENCHMARK] " << numberOfClients << " " << DTLS_LibraryName << " PSK handshakes: full "
+              << static_cast<double>(fullElapsed) / numberOfClients << " us, "
+              << static_cast<double>(fullDatagrams) / numberOfClients << " datagrams, "
+              << fullBytes / numberOfClients << " bytes each; resumed "
+              << static_cast<double>(resumedElapsed) / numberOfClients << " us, "
+              << static_cast<double>(resumedDatagrams) / numberOfClients << " datagrams, "
+              << resumedBytes / numberOfClients << " bytes each" << std::endl;
+}
+
+TEST_F(DTLSLoopbackTestSuite, benchmark_handshakes_on_workers)
+{
+    if (!Supported())
+    {
+        GTEST_SKIP() << "not built with DTLS support";
+    }
+
+    const int numberOfClients = 1000;
+    AddClients(numberOfClients);
+    int64_t handshakes = Metrics_Get(Metric_DtlsHandshakesFull) + Metrics_Get(Metric_DtlsHandshakesResumed);
+    decryptTimes.clear();
+    int64_t inlineElapsed = HandshakeStorm();
+    double inlineMedian = DecryptPercentile(50);
+    double inlineTail = DecryptPercentile(99);
+    ASSERT_EQ(numberOfClients, RoundTrip());
+    for (int i = 0; i < numberOfClients; i++)
+    {
+        DTLS_Reset(serverAddress_[i]);
+        DTLS_Reset(clientAddress_[i]);
+    }
+
+    DTLS_SetHandshakeWorkers(4);
+    ASSERT_NE(-1, DTLS_GetHandshakeFileDescriptor());
+    decryptTimes.clear();
+    int64_t workersElapsed = HandshakeStorm();
+    double workersMedian = DecryptPercentile(50);
+    double workersTail = DecryptPercentile(99);
+    EXPECT_EQ(numberOfClients, RoundTrip());
+    EXPECT_EQ(0, Metrics_Get(Metric_DtlsHandshakeJobs));
+    EXPECT_EQ(handshakes + 4 * numberOfClients, Metrics_Get(Metric_DtlsHandshakesFull) + Metrics_Get(Metric_DtlsHandshakesResumed));
+    EXPECT_EQ(static_cast<size_t>(2 * numberOfClients), DTLSSessions_Count());
+
+    std::cout << "[ BENCHMARK] " << numberOfClients << " " << DTLS_LibraryName << " PSK handshakes at once, main loop held per record: inline "
+              << inlineMedian << " us median, " << inlineTail << " us p99, " << inlineElapsed / 1000 << " ms in all; on 4 workers "
+              << workersMedian << " us median, " << workersTail << " us p99, " << workersElapsed / 1000 << " ms in all" << std::endl;
+}
@@ -0,0 +1,161 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <string>
+#include "lwm2m_admission_control.h"
+
+// matches the grace period in lwm2m_admission_control.c
+static const uint64_t PendingSlotGraceMs = 30000;
+
+class Lwm2mAdmissionControlTestSuite : public testing::Test
+{
+protected:
+    void TearDown() { AdmissionControl_Free(&admission_); }
+
+    void Create(int rate, int burst, int maxPending)
+    {
+        admission_ = AdmissionControl_New(rate, burst, maxPending);
+        ASSERT_TRUE(admission_ != NULL);
+    }
+
+    AdmissionResult Admit(const std::string & key, uint64_t now)
+    {
+        retryAfter_ = 0;
+        return AdmissionControl_Admit(admission_, key.c_str(), now, &retryAfter_);
+    }
+
+    AdmissionStatistics Statistics()
+    {
+        AdmissionStatistics statistics;
+        AdmissionControl_GetStatistics(admission_, &statistics);
+        return statistics;
+    }
+
+    AdmissionControl * admission_ = NULL;
+    uint32_t retryAfter_ = 0;
+};
+
+TEST_F(Lwm2mAdmissionControlTestSuite, New_rejects_invalid_parameters)
+{
+    EXPECT_EQ(NULL, AdmissionControl_New(0, 1, 1));
+    EXPECT_EQ(NULL, AdmissionControl_New(1, 0, 1));
+    EXPECT_EQ(NULL, AdmissionControl_New(1, 1, -1));
+}
+
+TEST_F(Lwm2mAdmissionControlTestSuite, burst_is_accepted_then_clients_are_deferred_to_their_slots)
+{
+    Create(1, 2, 10);
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("a", 0));
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("b", 0));
+
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("c", 0));
+    EXPECT_EQ(1u, retryAfter_);
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("d", 0));
+    EXPECT_EQ(2u, retryAfter_);
+    EXPECT_EQ(2u, Statistics().Pending);
+
+    // retrying before the slot comes up is deferred again, at or after it is accepted
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("c", 500));
+    EXPECT_EQ(1u, retryAfter_);
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("c", 1000));
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("d", 2500));
+    EXPECT_EQ(0u, Statistics().Pending);
+}
+
+TEST_F(Lwm2mAdmissionControlTestSuite, reserved_tokens_are_not_given_to_new_clients)
+{
+    Create(1, 1, 10);
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("a", 0));
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("b", 0));
+
+    // the token that arrives at 1 s belongs to b
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("c", 1000));
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("b", 1000));
+}
+
+TEST_F(Lwm2mAdmissionControlTestSuite, pending_slot_is_held_for_grace_period)
+{
+    Create(1, 1, 10);
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("a", 0));
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("b", 0));
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("c", 0));
+
+    // b comes back late, but within the grace period of its slot at 1 s
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("b", 1000 + PendingSlotGraceMs - 1));
+    EXPECT_EQ(1u, Statistics().Pending);
+
+    // c never comes back, and its slot at 2 s is dropped once the grace period is over
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("x", 2000 + PendingSlotGraceMs - 1));
+    EXPECT_EQ(1u, Statistics().Pending);
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("y", 2000 + PendingSlotGraceMs));
+    EXPECT_EQ(0u, Statistics().Pending);
+}
+
+TEST_F(Lwm2mAdmissionControlTestSuite, expired_pending_slot_returns_its_token)
+{
+    // more clients are pending than the bucket refills during the grace period, so it is still in debt when the first slot expires
+    const int numberOfPending = 40;
+    Create(1, 1, numberOfPending + 1);
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("a", 0));
+    for (int i = 0; i < numberOfPending; i++)
+    {
+        EXPECT_EQ(AdmissionResult_Deferred, Admit("pending" + std::to_string(i), 0));
+        EXPECT_EQ(static_cast<uint32_t>(i + 1), retryAfter_);
+    }
+
+    // at 31 s the bucket has refilled 31 of the 40 reserved tokens, and the first slot has expired
+    uint64_t now = 1000 + PendingSlotGraceMs;
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("x", now));
+    EXPECT_EQ(numberOfPending - 1 + 1u, Statistics().Pending);
+
+    // x waits for the 8 tokens still owed to later slots, not 9 - the expired slot's token went back in the bucket
+    EXPECT_EQ(9u, retryAfter_);
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("x", now + 9000));
+}
+
+TEST_F(Lwm2mAdmissionControlTestSuite, full_pending_queue_rejects_with_jittered_back_off)
+{
+    Create(1, 1, 2);
+    EXPECT_EQ(AdmissionResult_Accepted, Admit("a", 0));
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("b", 0));
+    EXPECT_EQ(AdmissionResult_Deferred, Admit("c", 0));
+
+    // back off for between one and two times the drain time of the queue, 3 s
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(AdmissionResult_Rejected, Admit("rejected" + std::to_string(i), 0));
+        EXPECT_GE(retryAfter_, 3u);
+        EXPECT_LE(retryAfter_, 6u);
+    }
+
+    AdmissionStatistics statistics = Statistics();
+    EXPECT_EQ(1u, statistics.Accepted);
+    EXPECT_EQ(2u, statistics.Deferred);
+    EXPECT_EQ(100u, statistics.Rejected);
+}
+
+TEST_F(Lwm2mAdmissionControlTestSuite, null_admission_control_accepts_everything)
+{
+    uint32_t retryAfter = 0;
+    EXPECT_EQ(AdmissionResult_Accepted, AdmissionControl_Admit(NULL, "a", 0, &retryAfter));
+}
@@ -0,0 +1,109 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include "lwm2m_attributes.h"
+
+class Lwm2mAttributesTestSuite : public testing::Test
+{
+protected:
+    void SetUp() { store_ = AttributeStore_Create(); ASSERT_TRUE(store_ != NULL); }
+    void TearDown() { AttributeStore_Destroy(store_); }
+
+    NotificationAttributes MinimumPeriod(int minimumPeriod)
+    {
+        NotificationAttributes attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.MinimumPeriod = minimumPeriod;
+        attributes.Valid[AttributeTypeEnum_MinimumPeriod] = true;
+        return attributes;
+    }
+
+    AttributeStore * store_;
+};
+
+TEST_F(Lwm2mAttributesTestSuite, lookup_of_missing_attributes_does_not_add_them)
+{
+    EXPECT_EQ(NULL, AttributeStore_LookupNotificationAttributes(store_, 1, 3, 0, 1));
+    EXPECT_EQ(NULL, AttributeStore_LookupNotificationAttributes(store_, 1, 3, 0, -1));
+    EXPECT_EQ(0u, AttributeStore_Count(store_));
+}
+
+TEST_F(Lwm2mAttributesTestSuite, set_attributes_are_found_by_server_and_path)
+{
+    NotificationAttributes attributes = MinimumPeriod(5);
+    ASSERT_EQ(0, AttributeStore_SetNotificationAttributes(store_, 1, 3, 0, 1, &attributes));
+
+    NotificationAttributes * found = AttributeStore_LookupNotificationAttributes(store_, 1, 3, 0, 1);
+    ASSERT_TRUE(found != NULL);
+    EXPECT_TRUE(found->Valid[AttributeTypeEnum_MinimumPeriod]);
+    EXPECT_EQ(5, found->MinimumPeriod);
+    EXPECT_EQ(1, found->ShortServerID);
+    EXPECT_EQ(3, found->ObjectID);
+    EXPECT_EQ(0, found->ObjectInstanceID);
+    EXPECT_EQ(1, found->ResourceID);
+
+    EXPECT_EQ(NULL, AttributeStore_LookupNotificationAttributes(store_, 2, 3, 0, 1));
+    EXPECT_EQ(NULL, AttributeStore_LookupNotificationAttributes(store_, 1, 3, 0, -1));
+    EXPECT_EQ(NULL, AttributeStore_LookupNotificationAttributes(store_, 1, 3, 1, 1));
+}
+
+TEST_F(Lwm2mAttributesTestSuite, set_replaces_attributes)
+{
+    NotificationAttributes attributes = MinimumPeriod(5);
+    ASSERT_EQ(0, AttributeStore_SetNotificationAttributes(store_, 1, 3, 0, 1, &attributes));
+    attributes = MinimumPeriod(7);
+    ASSERT_EQ(0, AttributeStore_SetNotificationAttributes(store_, 1, 3, 0, 1, &attributes));
+
+    EXPECT_EQ(1u, AttributeStore_Count(store_));
+    EXPECT_EQ(7, AttributeStore_LookupNotificationAttributes(store_, 1, 3, 0, 1)->MinimumPeriod);
+}
+
+TEST_F(Lwm2mAttributesTestSuite, set_without_valid_attributes_removes_them)
+{
+    NotificationAttributes attributes = MinimumPeriod(5);
+    ASSERT_EQ(0, AttributeStore_SetNotificationAttributes(store_, 1, 3, 0, 1, &attributes));
+
+    attributes.Valid[AttributeTypeEnum_MinimumPeriod] = false;
+    ASSERT_EQ(0, AttributeStore_SetNotificationAttributes(store_, 1, 3, 0, 1, &attributes));
+    EXPECT_EQ(NULL, AttributeStore_LookupNotificationAttributes(store_, 1, 3, 0, 1));
+    EXPECT_EQ(0u, AttributeStore_Count(store_));
+}
+
+TEST_F(Lwm2mAttributesTestSuite, many_paths)
+{
+    const int numberOfInstances = 1000;
+    for (int i = 0; i < numberOfInstances; i++)
+    {
+        NotificationAttributes attributes = MinimumPeriod(i);
+        ASSERT_EQ(0, AttributeStore_SetNotificationAttributes(store_, 1, 3, i, 1, &attributes));
+    }
+    EXPECT_EQ(static_cast<size_t>(numberOfInstances), AttributeStore_Count(store_));
+    for (int i = 0; i < numberOfInstances; i++)
+    {
+        NotificationAttributes * found = AttributeStore_LookupNotificationAttributes(store_, 1, 3, i, 1);
+        ASSERT_TRUE(found != NULL);
+        EXPECT_EQ(i, found->MinimumPeriod);
+    }
+}
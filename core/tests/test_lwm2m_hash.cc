@@ -0,0 +1,147 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "lwm2m_hash.h"
+
+namespace {
+
+struct TestEntry
+{
+    HashTableNode Node;
+    int Key;
+};
+
+bool MatchTestEntry(const HashTableNode * node, const void * key)
+{
+    return HashTableEntry(node, TestEntry, Node)->Key == *static_cast<const int *>(key);
+}
+
+uint32_t HashKey(int key)
+{
+    return Hash_Bytes(&key, sizeof(key), HASH_SEED);
+}
+
+TestEntry * Find(const HashTable * table, int key)
+{
+    HashTableNode * node = HashTable_Find(table, HashKey(key), MatchTestEntry, &key);
+    return (node != NULL) ? HashTableEntry(node, TestEntry, Node) : NULL;
+}
+
+} // namespace
+
+class Lwm2mHashTestSuite : public testing::Test
+{
+protected:
+    void SetUp() { ASSERT_EQ(0, HashTable_Init(&table_, 0)); }
+    void TearDown() { HashTable_Destroy(&table_); }
+
+    HashTable table_;
+};
+
+TEST_F(Lwm2mHashTestSuite, Find_in_empty_table_returns_null)
+{
+    EXPECT_EQ(0u, HashTable_Count(&table_));
+    EXPECT_EQ(NULL, Find(&table_, 1));
+}
+
+TEST_F(Lwm2mHashTestSuite, Add_Find_and_Remove_many_entries)
+{
+    const int numberOfEntries = 10000;
+    std::vector<TestEntry> entries(numberOfEntries);
+    for (int i = 0; i < numberOfEntries; i++)
+    {
+        entries[i].Key = i;
+        HashTable_Add(&table_, &entries[i].Node, HashKey(i));
+    }
+    EXPECT_EQ(static_cast<size_t>(numberOfEntries), HashTable_Count(&table_));
+    EXPECT_GE(table_.NumberOfBuckets, static_cast<size_t>(numberOfEntries / 2));
+
+    for (int i = 0; i < numberOfEntries; i++)
+    {
+        EXPECT_EQ(&entries[i], Find(&table_, i));
+    }
+    EXPECT_EQ(NULL, Find(&table_, numberOfEntries));
+
+    for (int i = 0; i < numberOfEntries; i += 2)
+    {
+        EXPECT_TRUE(HashTable_Remove(&table_, &entries[i].Node));
+    }
+    EXPECT_EQ(static_cast<size_t>(numberOfEntries / 2), HashTable_Count(&table_));
+
+    for (int i = 0; i < numberOfEntries; i++)
+    {
+        EXPECT_EQ((i % 2) ? &entries[i] : NULL, Find(&table_, i));
+    }
+}
+
+TEST_F(Lwm2mHashTestSuite, Remove_entry_not_in_table_returns_false)
+{
+    TestEntry entry = { { NULL, 0 }, 1 };
+    HashTable_Add(&table_, &entry.Node, HashKey(entry.Key));
+    EXPECT_TRUE(HashTable_Remove(&table_, &entry.Node));
+    EXPECT_FALSE(HashTable_Remove(&table_, &entry.Node));
+}
+
+TEST_F(Lwm2mHashTestSuite, FindNext_returns_entries_with_same_key)
+{
+    TestEntry entries[3] = { { { NULL, 0 }, 7 }, { { NULL, 0 }, 7 }, { { NULL, 0 }, 8 } };
+    for (auto & entry : entries)
+    {
+        HashTable_Add(&table_, &entry.Node, HashKey(entry.Key));
+    }
+
+    int key = 7;
+    int found = 0;
+    for (HashTableNode * node = HashTable_Find(&table_, HashKey(key), MatchTestEntry, &key); node != NULL; node = HashTable_FindNext(node, MatchTestEntry, &key))
+    {
+        EXPECT_EQ(7, HashTableEntry(node, TestEntry, Node)->Key);
+        found++;
+    }
+    EXPECT_EQ(2, found);
+}
+
+TEST_F(Lwm2mHashTestSuite, ForEach_visits_every_entry)
+{
+    TestEntry entries[5];
+    for (int i = 0; i < 5; i++)
+    {
+        entries[i].Key = i;
+        HashTable_Add(&table_, &entries[i].Node, HashKey(i));
+    }
+
+    int sum = 0;
+    size_t bucket;
+    HashTableNode * node;
+    HashTableForEach(node, bucket, &table_)
+    {
+        sum += HashTableEntry(node, TestEntry, Node)->Key;
+    }
+    EXPECT_EQ(0 + 1 + 2 + 3 + 4, sum);
+}
+
+TEST_F(Lwm2mHashTestSuite, Hash_String_matches_Hash_Bytes)
+{
+    EXPECT_EQ(Hash_Bytes("abc", 3, HASH_SEED), Hash_String("abc", HASH_SEED));
+    EXPECT_NE(Hash_String("abc", HASH_SEED), Hash_String("abd", HASH_SEED));
+}
@@ -0,0 +1,113 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#include <gtest/gtest.h>
+#include <vector>
+#include <algorithm>
+#include "lwm2m_heap.h"
+
+namespace {
+
+struct TestTimer
+{
+    HeapNode Node;
+    int ID;
+};
+
+} // namespace
+
+class Lwm2mHeapTestSuite : public testing::Test
+{
+protected:
+    void SetUp() { ASSERT_EQ(0, Heap_Init(&heap_, 0)); }
+    void TearDown() { Heap_Destroy(&heap_); }
+
+    Heap heap_;
+};
+
+TEST_F(Lwm2mHeapTestSuite, Peek_and_Pop_empty_heap_return_null)
+{
+    EXPECT_EQ(0u, Heap_Count(&heap_));
+    EXPECT_EQ(NULL, Heap_Peek(&heap_));
+    EXPECT_EQ(NULL, Heap_Pop(&heap_));
+}
+
+TEST_F(Lwm2mHeapTestSuite, Pop_returns_entries_in_key_order)
+{
+    const int numberOfEntries = 10000;
+    std::vector<TestTimer> timers(numberOfEntries);
+    std::vector<uint64_t> keys(numberOfEntries);
+    for (int i = 0; i < numberOfEntries; i++)
+    {
+        timers[i].Node.Index = 0;
+        timers[i].ID = i;
+        keys[i] = (static_cast<uint64_t>(i) * 7919) % 1000;     // includes duplicate keys
+        EXPECT_TRUE(Heap_Push(&heap_, &timers[i].Node, keys[i]));
+    }
+    EXPECT_EQ(static_cast<size_t>(numberOfEntries), Heap_Count(&heap_));
+
+    std::sort(keys.begin(), keys.end());
+    for (int i = 0; i < numberOfEntries; i++)
+    {
+        HeapNode * node = Heap_Pop(&heap_);
+        ASSERT_TRUE(NULL != node);
+        EXPECT_EQ(keys[i], node->Key);
+        EXPECT_FALSE(Heap_Contains(node));
+    }
+    EXPECT_EQ(NULL, Heap_Pop(&heap_));
+}
+
+TEST_F(Lwm2mHeapTestSuite, Remove_and_Update_keep_heap_order)
+{
+    TestTimer timers[8];
+    for (int i = 0; i < 8; i++)
+    {
+        timers[i].Node.Index = 0;
+        timers[i].ID = i;
+        Heap_Push(&heap_, &timers[i].Node, 100 + (i * 10));
+    }
+
+    EXPECT_TRUE(Heap_Remove(&heap_, &timers[0].Node));
+    EXPECT_FALSE(Heap_Remove(&heap_, &timers[0].Node));
+    EXPECT_TRUE(Heap_Update(&heap_, &timers[5].Node, 1));      // move to front
+    EXPECT_TRUE(Heap_Update(&heap_, &timers[1].Node, 500));    // move to back
+    EXPECT_TRUE(Heap_Update(&heap_, &timers[0].Node, 125));    // re-add
+
+    int expected[] = { 5, 2, 0, 3, 4, 6, 7, 1 };
+    for (int id : expected)
+    {
+        HeapNode * node = Heap_Pop(&heap_);
+        ASSERT_TRUE(NULL != node);
+        EXPECT_EQ(id, HeapEntry(node, TestTimer, Node)->ID);
+    }
+    EXPECT_EQ(0u, Heap_Count(&heap_));
+}
+
+TEST_F(Lwm2mHeapTestSuite, Push_entry_already_in_heap_returns_false)
+{
+    TestTimer timer = { { 0, 0 }, 1 };
+    EXPECT_TRUE(Heap_Push(&heap_, &timer.Node, 10));
+    EXPECT_FALSE(Heap_Push(&heap_, &timer.Node, 20));
+    EXPECT_EQ(1u, Heap_Count(&heap_));
+    EXPECT_EQ(10u, Heap_Peek(&heap_)->Key);
+}
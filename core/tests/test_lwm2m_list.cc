@@ -0,0 +1,147 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "lwm2m_list.h"
+
+namespace {
+
+struct TestEntry
+{
+    struct ListHead List;
+    int Value;
+};
+
+std::vector<int> Forwards(const struct ListHead * head)
+{
+    std::vector<int> values;
+    struct ListHead * item;
+    ListForEach(item, head)
+    {
+        values.push_back(ListEntry(item, TestEntry, List)->Value);
+    }
+    return values;
+}
+
+// walk the Prev links from the head, and check each entry's neighbours point back at it
+std::vector<int> Backwards(const struct ListHead * head)
+{
+    std::vector<int> values;
+    for (const struct ListHead * item = head->Prev; item != head; item = item->Prev)
+    {
+        EXPECT_EQ(item, item->Next->Prev);
+        EXPECT_EQ(item, item->Prev->Next);
+        values.insert(values.begin(), ListEntry(item, TestEntry, List)->Value);
+    }
+    return values;
+}
+
+} // namespace
+
+class Lwm2mListTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        ListInit(&head_);
+        for (int i = 0; i < 5; i++)
+        {
+            entries_[i].Value = i;
+        }
+    }
+
+    struct ListHead head_;
+    TestEntry entries_[5];
+};
+
+TEST_F(Lwm2mListTestSuite, ListAdd_appends_and_links_head_to_last_entry)
+{
+    EXPECT_TRUE(ListEmpty(&head_));
+    for (int i = 0; i < 5; i++)
+    {
+        ListAdd(&entries_[i].List, &head_);
+        EXPECT_EQ(&entries_[i].List, head_.Prev);
+        EXPECT_EQ(&head_, entries_[i].List.Next);
+    }
+    EXPECT_FALSE(ListEmpty(&head_));
+    EXPECT_EQ(5, ListCount(&head_));
+    EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4 }), Forwards(&head_));
+    EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4 }), Backwards(&head_));
+}
+
+TEST_F(Lwm2mListTestSuite, ListRemove_keeps_links_consistent)
+{
+    for (int i = 0; i < 5; i++)
+    {
+        ListAdd(&entries_[i].List, &head_);
+    }
+
+    // the last entry, so that head's Prev moves back
+    ListRemove(&entries_[4].List);
+    EXPECT_EQ(&entries_[3].List, head_.Prev);
+    ListRemove(&entries_[0].List);
+    ListRemove(&entries_[2].List);
+    EXPECT_EQ(std::vector<int>({ 1, 3 }), Forwards(&head_));
+    EXPECT_EQ(std::vector<int>({ 1, 3 }), Backwards(&head_));
+
+    // a removed entry is left as an empty list, so removing it again is harmless
+    EXPECT_TRUE(ListEmpty(&entries_[2].List));
+    ListRemove(&entries_[2].List);
+    EXPECT_EQ(2, ListCount(&head_));
+
+    // entries added after removals go at the end
+    ListAdd(&entries_[4].List, &head_);
+    ListAdd(&entries_[0].List, &head_);
+    EXPECT_EQ(std::vector<int>({ 1, 3, 4, 0 }), Forwards(&head_));
+    EXPECT_EQ(std::vector<int>({ 1, 3, 4, 0 }), Backwards(&head_));
+
+    ListRemove(&entries_[1].List);
+    ListRemove(&entries_[3].List);
+    ListRemove(&entries_[4].List);
+    ListRemove(&entries_[0].List);
+    EXPECT_TRUE(ListEmpty(&head_));
+    EXPECT_EQ(&head_, head_.Prev);
+}
+
+TEST_F(Lwm2mListTestSuite, ListInsertAfter_keeps_links_consistent)
+{
+    ListInsertAfter(&entries_[0].List, &head_);
+    ListInsertAfter(&entries_[2].List, &entries_[0].List);
+    ListInsertAfter(&entries_[1].List, &entries_[0].List);
+    ListInsertAfter(&entries_[4].List, &entries_[2].List);
+    ListInsertAfter(&entries_[3].List, &entries_[2].List);
+    EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4 }), Forwards(&head_));
+    EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4 }), Backwards(&head_));
+    EXPECT_EQ(&entries_[4].List, head_.Prev);
+}
+
+TEST_F(Lwm2mListTestSuite, static_LIST_INIT_head_can_be_appended_to)
+{
+    static struct ListHead staticHead = LIST_INIT(staticHead);
+    ListAdd(&entries_[0].List, &staticHead);
+    ListAdd(&entries_[1].List, &staticHead);
+    EXPECT_EQ(std::vector<int>({ 0, 1 }), Backwards(&staticHead));
+    ListRemove(&entries_[0].List);
+    ListRemove(&entries_[1].List);
+    EXPECT_TRUE(ListEmpty(&staticHead));
+}
@@ -0,0 +1,142 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "lwm2m_metrics.h"
+
+class Lwm2mMetricsTestSuite : public testing::Test
+{
+protected:
+    void SetUp() { Metrics_Reset(); }
+    void TearDown() { Metrics_Reset(); }
+
+    std::string WritePrometheus()
+    {
+        int length = Metrics_WritePrometheus(NULL, 0);
+        EXPECT_LT(0, length);
+        std::vector<char> buffer(length + 1);
+        EXPECT_EQ(length, Metrics_WritePrometheus(&buffer[0], buffer.size()));
+        return std::string(&buffer[0]);
+    }
+};
+
+TEST_F(Lwm2mMetricsTestSuite, test_counters_and_gauges)
+{
+    EXPECT_EQ(0, Metrics_Get(Metric_CoapRequestsSent));
+    Metrics_Increment(Metric_CoapRequestsSent);
+    Metrics_Increment(Metric_CoapRequestsSent);
+    EXPECT_EQ(2, Metrics_Get(Metric_CoapRequestsSent));
+
+    Metrics_Add(Metric_ObjectStoreValueBytes, 100);
+    Metrics_Add(Metric_ObjectStoreValueBytes, -40);
+    EXPECT_EQ(60, Metrics_Get(Metric_ObjectStoreValueBytes));
+
+    Metrics_Increment(Metric_Observations);
+    Metrics_Decrement(Metric_Observations);
+    EXPECT_EQ(0, Metrics_Get(Metric_Observations));
+
+    Metrics_Set(Metric_IpcReceiveQueueBytes, 1234);
+    EXPECT_EQ(1234, Metrics_Get(Metric_IpcReceiveQueueBytes));
+
+    Metrics_Reset();
+    EXPECT_EQ(0, Metrics_Get(Metric_CoapRequestsSent));
+    EXPECT_EQ(0, Metrics_Get(Metric_ObjectStoreValueBytes));
+}
+
+TEST_F(Lwm2mMetricsTestSuite, test_descriptors)
+{
+    for (int metric = 0; metric < Metric_Count; ++metric)
+    {
+        EXPECT_TRUE(Metrics_GetName(static_cast<MetricID>(metric)) != NULL) << metric;
+        EXPECT_TRUE(Metrics_GetHelp(static_cast<MetricID>(metric)) != NULL) << metric;
+    }
+    for (int histogram = 0; histogram < Histogram_Count; ++histogram)
+    {
+        EXPECT_TRUE(Metrics_GetHistogramName(static_cast<HistogramID>(histogram)) != NULL) << histogram;
+    }
+    EXPECT_EQ(MetricType_Counter, Metrics_GetType(Metric_Registrations));
+    EXPECT_EQ(MetricType_Gauge, Metrics_GetType(Metric_RegisteredClients));
+    EXPECT_STREQ("result=\"rejected\"", Metrics_GetLabels(Metric_AdmissionRejected));
+}
+
+TEST_F(Lwm2mMetricsTestSuite, test_histogram_buckets)
+{
+    Metrics_Observe(Histogram_CoapTransactionDuration, 0);
+    Metrics_Observe(Histogram_CoapTransactionDuration, 1);
+    Metrics_Observe(Histogram_CoapTransactionDuration, 3);
+    Metrics_Observe(Histogram_CoapTransactionDuration, 1000);
+    Metrics_Observe(Histogram_CoapTransactionDuration, 60000);
+
+    MetricsHistogram histogram;
+    Metrics_GetHistogram(Histogram_CoapTransactionDuration, &histogram);
+    EXPECT_EQ(5u, histogram.Count);
+    EXPECT_EQ(61004u, histogram.SumMs);
+
+    EXPECT_EQ(1u, Metrics_GetHistogramBound(0));
+    EXPECT_EQ(UINT32_MAX, Metrics_GetHistogramBound(METRICS_HISTOGRAM_NUM_BUCKETS - 1));
+
+    uint64_t total = 0;
+    for (int bucket = 0; bucket < METRICS_HISTOGRAM_NUM_BUCKETS; ++bucket)
+    {
+        total += histogram.Buckets[bucket];
+    }
+    EXPECT_EQ(histogram.Count, total);
+    EXPECT_EQ(2u, histogram.Buckets[0]);                                   // <= 1ms
+    EXPECT_EQ(1u, histogram.Buckets[2]);                                   // <= 5ms
+    EXPECT_EQ(1u, histogram.Buckets[9]);                                   // <= 1000ms
+    EXPECT_EQ(1u, histogram.Buckets[METRICS_HISTOGRAM_NUM_BUCKETS - 1]);   // +Inf
+}
+
+TEST_F(Lwm2mMetricsTestSuite, test_write_prometheus)
+{
+    Metrics_Increment(Metric_AdmissionAccepted);
+    Metrics_Increment(Metric_AdmissionRejected);
+    Metrics_Observe(Histogram_IpcRequestDuration, 3);
+
+    std::string text = WritePrometheus();
+
+    EXPECT_NE(std::string::npos, text.find("# TYPE awa_registration_admissions_total counter\n"));
+    EXPECT_NE(std::string::npos, text.find("awa_registration_admissions_total{result=\"accepted\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("awa_registration_admissions_total{result=\"rejected\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("# TYPE awa_registered_clients gauge\n"));
+
+    // HELP and TYPE are written once per metric name, not once per label set
+    std::string help = "# HELP awa_registration_admissions_total ";
+    EXPECT_EQ(text.find(help), text.rfind(help));
+
+    EXPECT_NE(std::string::npos, text.find("# TYPE awa_ipc_request_duration_seconds histogram\n"));
+    EXPECT_NE(std::string::npos, text.find("awa_ipc_request_duration_seconds_bucket{le=\"0.002\"} 0\n"));
+    EXPECT_NE(std::string::npos, text.find("awa_ipc_request_duration_seconds_bucket{le=\"0.005\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("awa_ipc_request_duration_seconds_bucket{le=\"+Inf\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("awa_ipc_request_duration_seconds_count 1\n"));
+}
+
+TEST_F(Lwm2mMetricsTestSuite, test_write_prometheus_truncated)
+{
+    char buffer[16];
+    int length = Metrics_WritePrometheus(buffer, sizeof(buffer));
+    EXPECT_LT(static_cast<int>(sizeof(buffer)), length);
+    EXPECT_EQ(sizeof(buffer) - 1, strlen(buffer));
+}
@@ -0,0 +1,147 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "lwm2m_object_list.h"
+
+class Lwm2mObjectListTestSuite : public testing::Test
+{
+protected:
+    void TearDown()
+    {
+        for (ObjectListType * list : lists_)
+        {
+            ObjectList_Release(&list);
+        }
+        EXPECT_EQ(0u, ObjectList_GetNumberOfUniqueLists());
+    }
+
+    ObjectListType * Acquire(std::vector<ObjectListEntry> entries)
+    {
+        ObjectListType * list = ObjectList_Acquire(entries.data(), entries.size());
+        lists_.push_back(list);
+        return list;
+    }
+
+    std::vector<ObjectListType *> lists_;
+};
+
+TEST_F(Lwm2mObjectListTestSuite, Acquire_sorts_entries_and_removes_duplicates)
+{
+    ObjectListType * list = Acquire({ { 3, 0 }, { 1, 1 }, { 1, -1 }, { 3, 0 }, { 1, 0 } });
+    ASSERT_TRUE(list != NULL);
+    ASSERT_EQ(4u, ObjectList_GetCount(list));
+
+    ObjectListEntry expected[] = { { 1, -1 }, { 1, 0 }, { 1, 1 }, { 3, 0 } };
+    for (size_t i = 0; i < 4; i++)
+    {
+        ObjectListEntry entry = ObjectList_GetEntry(list, i);
+        EXPECT_EQ(expected[i].ObjectID, entry.ObjectID);
+        EXPECT_EQ(expected[i].InstanceID, entry.InstanceID);
+    }
+}
+
+TEST_F(Lwm2mObjectListTestSuite, Acquire_skips_entries_outside_id_range)
+{
+    ObjectListType * list = Acquire({ { 3, 0 }, { -1, 0 }, { 65536, 0 }, { 3, -2 }, { 3, 65535 }, { 65535, 65534 } });
+    ASSERT_EQ(2u, ObjectList_GetCount(list));
+    EXPECT_TRUE(ObjectList_Contains(list, 3, 0));
+    EXPECT_TRUE(ObjectList_Contains(list, 65535, 65534));
+}
+
+TEST_F(Lwm2mObjectListTestSuite, Acquire_empty_list)
+{
+    ObjectListType * list = Acquire({});
+    ASSERT_TRUE(list != NULL);
+    EXPECT_EQ(0u, ObjectList_GetCount(list));
+    EXPECT_FALSE(ObjectList_Contains(list, 3, -1));
+}
+
+TEST_F(Lwm2mObjectListTestSuite, Contains_object_instance)
+{
+    ObjectListType * list = Acquire({ { 1, 0 }, { 3, 0 }, { 3, 2 }, { 5, -1 } });
+    EXPECT_TRUE(ObjectList_Contains(list, 3, 0));
+    EXPECT_TRUE(ObjectList_Contains(list, 3, 2));
+    EXPECT_FALSE(ObjectList_Contains(list, 3, 1));
+    EXPECT_FALSE(ObjectList_Contains(list, 2, 0));
+    EXPECT_FALSE(ObjectList_Contains(list, 5, 0));
+    EXPECT_FALSE(ObjectList_Contains(list, 6, 0));
+}
+
+TEST_F(Lwm2mObjectListTestSuite, Contains_any_instance_of_object)
+{
+    ObjectListType * list = Acquire({ { 1, 0 }, { 3, 2 }, { 5, -1 } });
+    EXPECT_TRUE(ObjectList_Contains(list, 1, -1));
+    EXPECT_TRUE(ObjectList_Contains(list, 3, -1));
+    EXPECT_TRUE(ObjectList_Contains(list, 5, -1));
+    EXPECT_FALSE(ObjectList_Contains(list, 2, -1));
+    EXPECT_FALSE(ObjectList_Contains(list, 4, -1));
+    EXPECT_FALSE(ObjectList_Contains(list, 6, -1));
+}
+
+TEST_F(Lwm2mObjectListTestSuite, Contains_handles_invalid_arguments)
+{
+    ObjectListType * list = Acquire({ { 1, 0 } });
+    EXPECT_FALSE(ObjectList_Contains(NULL, 1, 0));
+    EXPECT_FALSE(ObjectList_Contains(list, -1, 0));
+    EXPECT_FALSE(ObjectList_Contains(list, 1, -2));
+    EXPECT_FALSE(ObjectList_Contains(list, 65536, -1));
+}
+
+TEST_F(Lwm2mObjectListTestSuite, GetEntry_out_of_range_returns_invalid_entry)
+{
+    ObjectListType * list = Acquire({ { 1, 0 } });
+    ObjectListEntry entry = ObjectList_GetEntry(list, 1);
+    EXPECT_EQ(-1, entry.ObjectID);
+    EXPECT_EQ(-1, entry.InstanceID);
+    EXPECT_EQ(0u, ObjectList_GetCount(NULL));
+}
+
+TEST_F(Lwm2mObjectListTestSuite, identical_lists_are_shared)
+{
+    ObjectListType * list1 = Acquire({ { 3, 0 }, { 1, 0 } });
+    ObjectListType * list2 = Acquire({ { 1, 0 }, { 3, 0 }, { 1, 0 } });
+    ObjectListType * list3 = Acquire({ { 1, 0 } });
+    EXPECT_EQ(list1, list2);
+    EXPECT_NE(list1, list3);
+    EXPECT_EQ(2u, ObjectList_GetNumberOfUniqueLists());
+}
+
+TEST_F(Lwm2mObjectListTestSuite, shared_list_is_freed_with_last_reference)
+{
+    std::vector<ObjectListEntry> entries = { { 3, 0 } };
+    ObjectListType * list1 = ObjectList_Acquire(entries.data(), entries.size());
+    ObjectListType * list2 = ObjectList_Acquire(entries.data(), entries.size());
+    EXPECT_EQ(1u, ObjectList_GetNumberOfUniqueLists());
+
+    ObjectList_Release(&list1);
+    EXPECT_EQ(NULL, list1);
+    EXPECT_EQ(1u, ObjectList_GetNumberOfUniqueLists());
+    EXPECT_TRUE(ObjectList_Contains(list2, 3, 0));
+
+    ObjectList_Release(&list2);
+    EXPECT_EQ(0u, ObjectList_GetNumberOfUniqueLists());
+
+    ObjectList_Release(&list2);
+    ObjectList_Release(NULL);
+}
@@ -0,0 +1,481 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <string.h>
+
+#include "lwm2m_core.h"
+#include "common/lwm2m_observers.h"
+#include "lwm2m_security_object.h"
+
+namespace {
+
+const ObjectIDType TestObjectID = 1000;
+
+struct Notification
+{
+    ObjectIDType ObjectID;
+    ObjectInstanceIDType ObjectInstanceID;
+    ResourceIDType ResourceID;
+};
+
+std::vector<Notification> notifications;
+
+int NotificationCallback(void * context, AddressType * addr, int sequence, const char * token, int tokenLength, ObjectIDType objectID,
+                         ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, AwaContentType contentType, void * contextData)
+{
+    notifications.push_back({ objectID, objectInstanceID, resourceID });
+    return 0;
+}
+
+// number of paths in each composite notification, and the paths of the last
+std::vector<int> compositeNotifications;
+std::vector<ObjectInstanceResourceKey> compositePaths;
+
+int CompositeNotificationCallback(void * context, AddressType * addr, int sequence, const char * token, int tokenLength, const ObjectInstanceResourceKey * paths,
+                                  int numberOfPaths, AwaContentType contentType, void * contextData)
+{
+    compositeNotifications.push_back(numberOfPaths);
+    compositePaths.assign(paths, paths + numberOfPaths);
+    return 0;
+}
+
+} // namespace
+
+class Lwm2mObserversTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        Lwm2m_SetLogLevel(DebugLevel_Emerg);
+        context_ = Lwm2mCore_Init(NULL, NULL);
+        memset(&address_, 0, sizeof(address_));
+        notifications.clear();
+        compositeNotifications.clear();
+        compositePaths.clear();
+    }
+
+    void TearDown()
+    {
+        Lwm2mCore_Destroy(context_);
+        Lwm2m_SetLogLevel(DebugLevel_Info);
+    }
+
+    void CreateInstances(int numberOfInstances, int numberOfResources, AwaResourceType resourceType = AwaResourceType_Integer)
+    {
+        Definition_RegisterObjectType(Lwm2mCore_GetDefinitions(context_), (char *)"Test", TestObjectID, MultipleInstancesEnum_Multiple, MandatoryEnum_Optional, &defaultObjectOperationHandlers);
+        for (int resourceID = 0; resourceID < numberOfResources; resourceID++)
+        {
+            Lwm2mCore_RegisterResourceType(context_, (char *)"Value", TestObjectID, resourceID, resourceType, MultipleInstancesEnum_Single, MandatoryEnum_Mandatory,
+                                           AwaResourceOperations_ReadWrite, &defaultResourceOperationHandlers);
+        }
+        for (int objectInstanceID = 0; objectInstanceID < numberOfInstances; objectInstanceID++)
+        {
+            ASSERT_EQ(objectInstanceID, Lwm2mCore_CreateObjectInstance(context_, TestObjectID, objectInstanceID));
+        }
+    }
+
+    void Observe(ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID)
+    {
+        ASSERT_EQ(0, Lwm2m_Observe(context_, &address_, "token", 5, TestObjectID, objectInstanceID, resourceID, AwaContentType_ApplicationPlainText,
+                                   NotificationCallback, NULL));
+    }
+
+    void ObserveComposite(const std::vector<ObjectInstanceResourceKey> & paths)
+    {
+        ASSERT_EQ(0, Lwm2m_ObserveComposite(context_, &address_, "comp", 4, paths.data(), paths.size(), AwaContentType_ApplicationSenmlJson,
+                                            CompositeNotificationCallback, NULL));
+    }
+
+    // notifications are due a millisecond after a change, so keep updating until they are sent or a second has passed
+    void UpdateUntilCompositeNotifications(size_t count)
+    {
+        uint64_t start = Lwm2mCore_GetTickCountMs();
+        while ((compositeNotifications.size() < count) && (Lwm2mCore_GetTickCountMs() - start < 1000))
+        {
+            Lwm2m_UpdateObservers(context_);
+        }
+    }
+
+    void Write(ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, AwaInteger value)
+    {
+        Lwm2mCore_SetResourceInstanceValue(context_, TestObjectID, objectInstanceID, resourceID, 0, &value, sizeof(value));
+    }
+
+    void Write(ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, const void * value, size_t valueLength)
+    {
+        Lwm2mCore_SetResourceInstanceValue(context_, TestObjectID, objectInstanceID, resourceID, 0, value, valueLength);
+    }
+
+    void SetStep(ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, float step)
+    {
+        NotificationAttributes attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.Step = step;
+        attributes.Valid[AttributeTypeEnum_Step] = true;
+        ASSERT_EQ(0, AttributeStore_SetNotificationAttributes(Lwm2mCore_GetAttributes(context_), Lwm2mSecurity_GetShortServerID(context_, &address_),
+                                                              TestObjectID, objectInstanceID, resourceID, &attributes));
+        Lwm2m_RescheduleObservers(context_);
+    }
+
+    void SetPeriods(ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, int minimumPeriod, int maximumPeriod)
+    {
+        NotificationAttributes attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.MinimumPeriod = minimumPeriod;
+        attributes.Valid[AttributeTypeEnum_MinimumPeriod] = true;
+        attributes.MaximumPeriod = maximumPeriod;
+        attributes.Valid[AttributeTypeEnum_MaximumPeriod] = true;
+        ASSERT_EQ(0, AttributeStore_SetNotificationAttributes(Lwm2mCore_GetAttributes(context_), Lwm2mSecurity_GetShortServerID(context_, &address_),
+                                                              TestObjectID, objectInstanceID, resourceID, &attributes));
+        Lwm2m_RescheduleObservers(context_);
+    }
+
+    Lwm2mContextType * context_;
+    AddressType address_;
+};
+
+TEST_F(Lwm2mObserversTestSuite, write_notifies_observers_of_resource_instance_and_object)
+{
+    CreateInstances(2, 2);
+    Observe(0, 0);
+    Observe(0, 1);
+    Observe(0, -1);
+    Observe(1, 0);
+    Observe(1, -1);
+    Observe(-1, -1);
+
+    Write(0, 0, 42);
+    Lwm2m_UpdateObservers(context_);
+
+    ASSERT_EQ(3u, notifications.size());
+    for (const Notification & notification : notifications)
+    {
+        EXPECT_EQ(TestObjectID, notification.ObjectID);
+        EXPECT_TRUE(notification.ObjectInstanceID == 0 || notification.ObjectInstanceID == -1);
+        EXPECT_TRUE(notification.ResourceID == 0 || notification.ResourceID == -1);
+    }
+}
+
+TEST_F(Lwm2mObserversTestSuite, observing_twice_replaces_observation)
+{
+    CreateInstances(1, 1);
+    Observe(0, 0);
+    Observe(0, 0);
+    EXPECT_EQ(1, ListCount(Lwm2mCore_GetObserverList(context_)));
+    EXPECT_EQ(1u, HashTable_Count(Lwm2mCore_GetObserverIndex(context_)));
+
+    Write(0, 0, 42);
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(1u, notifications.size());
+}
+
+TEST_F(Lwm2mObserversTestSuite, cancelled_observation_is_not_notified)
+{
+    CreateInstances(1, 1);
+    Observe(0, 0);
+    EXPECT_EQ(0, Lwm2m_CancelObserve(context_, &address_, TestObjectID, 0, 0));
+    EXPECT_EQ(-1, Lwm2m_CancelObserve(context_, &address_, TestObjectID, 0, 0));
+    EXPECT_EQ(0u, HashTable_Count(Lwm2mCore_GetObserverIndex(context_)));
+
+    Write(0, 0, 42);
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(0u, notifications.size());
+}
+
+TEST_F(Lwm2mObserversTestSuite, remove_observers_for_path)
+{
+    CreateInstances(1, 2);
+    Observe(0, 0);
+    Observe(0, 1);
+    EXPECT_EQ(0, Lwm2m_RemoveAllObserversForOIR(context_, TestObjectID, 0, 0));
+    EXPECT_EQ(-1, Lwm2m_RemoveAllObserversForOIR(context_, TestObjectID, 0, 0));
+
+    Write(0, 0, 42);
+    Write(0, 1, 42);
+    Lwm2m_UpdateObservers(context_);
+    ASSERT_EQ(1u, notifications.size());
+    EXPECT_EQ(1, notifications[0].ResourceID);
+}
+
+TEST_F(Lwm2mObserversTestSuite, idle_observers_are_not_due)
+{
+    CreateInstances(1, 1);
+    Observe(0, 0);
+    EXPECT_EQ(-1, Lwm2m_UpdateObservers(context_));
+    EXPECT_EQ(0u, Heap_Count(Lwm2mCore_GetObserverDeadlines(context_)));
+    EXPECT_EQ(0u, notifications.size());
+}
+
+TEST_F(Lwm2mObserversTestSuite, change_within_minimum_period_waits_for_it)
+{
+    CreateInstances(1, 1);
+    Observe(0, 0);
+    SetPeriods(0, 0, 10, -1);
+
+    Write(0, 0, 1);
+    EXPECT_EQ(-1, Lwm2m_UpdateObservers(context_));
+    EXPECT_EQ(1u, notifications.size());
+
+    // the next change is held back until pmin has elapsed, and the daemon is told when that is
+    Write(0, 0, 2);
+    int timeout = Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(1u, notifications.size());
+    EXPECT_GT(timeout, 9000);
+    EXPECT_LE(timeout, 10001);
+}
+
+TEST_F(Lwm2mObserversTestSuite, maximum_period_notifies_without_change)
+{
+    CreateInstances(1, 1);
+    Observe(0, 0);
+    SetPeriods(0, 0, 0, 0);
+
+    // the first notification is due immediately, and the next once more than pmax has elapsed
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(1u, notifications.size());
+
+    uint64_t start = Lwm2mCore_GetTickCountMs();
+    while ((notifications.size() < 2) && (Lwm2mCore_GetTickCountMs() - start < 1000))
+    {
+        int timeout = Lwm2m_UpdateObservers(context_);
+        EXPECT_LE(timeout, 1);
+    }
+    EXPECT_EQ(2u, notifications.size());
+}
+
+TEST_F(Lwm2mObserversTestSuite, cancelled_observation_is_unscheduled)
+{
+    CreateInstances(1, 1);
+    Observe(0, 0);
+    SetPeriods(0, 0, 0, 60);
+    EXPECT_EQ(1u, Heap_Count(Lwm2mCore_GetObserverDeadlines(context_)));
+
+    EXPECT_EQ(0, Lwm2m_CancelObserve(context_, &address_, TestObjectID, 0, 0));
+    EXPECT_EQ(0u, Heap_Count(Lwm2mCore_GetObserverDeadlines(context_)));
+    EXPECT_EQ(-1, Lwm2m_UpdateObservers(context_));
+}
+
+TEST_F(Lwm2mObserversTestSuite, attributes_are_inherited_from_object)
+{
+    CreateInstances(1, 1);
+    Observe(0, 0);
+    SetPeriods(-1, -1, 10, -1);
+
+    Write(0, 0, 1);
+    Lwm2m_UpdateObservers(context_);
+    Write(0, 0, 2);
+    EXPECT_GT(Lwm2m_UpdateObservers(context_), 9000);
+    EXPECT_EQ(1u, notifications.size());
+}
+
+TEST_F(Lwm2mObserversTestSuite, checking_observers_does_not_add_attributes)
+{
+    CreateInstances(10, 10);
+    for (int objectInstanceID = 0; objectInstanceID < 10; objectInstanceID++)
+    {
+        Observe(objectInstanceID, -1);
+        for (int resourceID = 0; resourceID < 10; resourceID++)
+        {
+            Observe(objectInstanceID, resourceID);
+        }
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        Write(i % 10, (i / 10) % 10, i);
+        Lwm2m_UpdateObservers(context_);
+    }
+    EXPECT_EQ(0u, AttributeStore_Count(Lwm2mCore_GetAttributes(context_)));
+}
+
+TEST_F(Lwm2mObserversTestSuite, float_change_smaller_than_step_is_not_notified)
+{
+    CreateInstances(1, 1, AwaResourceType_Float);
+    AwaFloat value = 1.0;
+    Write(0, 0, &value, sizeof(value));
+    Observe(0, 0);
+    SetStep(0, 0, 0.5);
+
+    value = 1.3;
+    Write(0, 0, &value, sizeof(value));
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(0u, notifications.size());
+
+    value = 1.6;
+    Write(0, 0, &value, sizeof(value));
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(1u, notifications.size());
+}
+
+TEST_F(Lwm2mObserversTestSuite, long_old_values_reuse_their_buffer)
+{
+    CreateInstances(1, 1, AwaResourceType_String);
+    Observe(0, 0);
+
+    std::string value(64, 'a');
+    Write(0, 0, value.c_str(), value.size());
+    Lwm2mObserverType * observer = ListEntry(Lwm2mCore_GetObserverList(context_)->Next, Lwm2mObserverType, list);
+    void * buffer = observer->OldValueBuffer;
+    ASSERT_TRUE(buffer != NULL);
+    EXPECT_EQ(buffer, observer->OldValue);
+
+    // shorter values are copied into the same buffer, and those that fit are kept inline
+    value = std::string(32, 'b');
+    Write(0, 0, value.c_str(), value.size());
+    EXPECT_EQ(buffer, observer->OldValueBuffer);
+    EXPECT_EQ(buffer, observer->OldValue);
+    EXPECT_EQ(0, memcmp(value.c_str(), observer->OldValue, value.size()));
+
+    Write(0, 0, "c", 1);
+    EXPECT_EQ((void *)&observer->InlineValue, observer->OldValue);
+    EXPECT_EQ(1u, observer->OldValueLength);
+}
+
+TEST_F(Lwm2mObserversTestSuite, composite_observation_sends_paths_due_together_in_one_notification)
+{
+    CreateInstances(2, 2);
+    ObserveComposite({ { TestObjectID, 0, 0 }, { TestObjectID, 0, 1 }, { TestObjectID, 1, -1 } });
+    SetPeriods(-1, -1, 0, -1);
+
+    Write(0, 0, 1);
+    Write(0, 1, 1);
+    Write(1, 0, 1);
+    Lwm2m_UpdateObservers(context_);
+    ASSERT_EQ(1u, compositeNotifications.size());
+    EXPECT_EQ(3, compositeNotifications[0]);
+    EXPECT_EQ(0u, notifications.size());
+
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(1u, compositeNotifications.size());
+
+    // only the paths that are due are given to the notification
+    Write(1, 1, 1);
+    UpdateUntilCompositeNotifications(2);
+    ASSERT_EQ(2u, compositeNotifications.size());
+    ASSERT_EQ(1, compositeNotifications[1]);
+    EXPECT_EQ(1, compositePaths[0].InstanceID);
+    EXPECT_EQ(-1, compositePaths[0].ResourceID);
+}
+
+TEST_F(Lwm2mObserversTestSuite, composite_observation_is_separate_from_observation_of_its_paths)
+{
+    CreateInstances(1, 1);
+    ObserveComposite({ { TestObjectID, 0, 0 } });
+    Observe(0, 0);
+    SetPeriods(-1, -1, 0, -1);
+    EXPECT_EQ(2, ListCount(Lwm2mCore_GetObserverList(context_)));
+
+    Write(0, 0, 1);
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(1u, compositeNotifications.size());
+    EXPECT_EQ(1u, notifications.size());
+
+    EXPECT_EQ(0, Lwm2m_CancelObserve(context_, &address_, TestObjectID, 0, 0));
+    EXPECT_EQ(-1, Lwm2m_CancelObserve(context_, &address_, TestObjectID, 0, 0));
+    Write(0, 0, 2);
+    UpdateUntilCompositeNotifications(2);
+    EXPECT_EQ(2u, compositeNotifications.size());
+    EXPECT_EQ(1u, notifications.size());
+}
+
+TEST_F(Lwm2mObserversTestSuite, observing_composite_twice_replaces_observation)
+{
+    CreateInstances(1, 2);
+    ObserveComposite({ { TestObjectID, 0, 0 }, { TestObjectID, 0, 1 } });
+    ObserveComposite({ { TestObjectID, 0, 0 }, { TestObjectID, 0, 1 } });
+    EXPECT_EQ(2, ListCount(Lwm2mCore_GetObserverList(context_)));
+
+    Write(0, 0, 1);
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(1u, compositeNotifications.size());
+}
+
+TEST_F(Lwm2mObserversTestSuite, cancelled_composite_observation_is_not_notified)
+{
+    CreateInstances(1, 2);
+    ObserveComposite({ { TestObjectID, 0, 0 }, { TestObjectID, 0, 1 } });
+    EXPECT_EQ(0, Lwm2m_CancelObserveComposite(context_, &address_, "comp", 4));
+    EXPECT_EQ(-1, Lwm2m_CancelObserveComposite(context_, &address_, "comp", 4));
+    EXPECT_EQ(0, ListCount(Lwm2mCore_GetObserverList(context_)));
+    EXPECT_EQ(0u, HashTable_Count(Lwm2mCore_GetObserverIndex(context_)));
+
+    Write(0, 0, 1);
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(0u, compositeNotifications.size());
+}
+
+TEST_F(Lwm2mObserversTestSuite, removed_path_is_left_out_of_composite_notifications)
+{
+    CreateInstances(2, 1);
+    ObserveComposite({ { TestObjectID, 0, 0 }, { TestObjectID, 1, -1 } });
+    SetPeriods(-1, -1, 0, -1);
+    EXPECT_EQ(0, Lwm2m_RemoveAllObserversForOIR(context_, TestObjectID, 1, -1));
+
+    Write(0, 0, 1);
+    Lwm2m_UpdateObservers(context_);
+    ASSERT_EQ(1u, compositeNotifications.size());
+    ASSERT_EQ(1, compositeNotifications[0]);
+    EXPECT_EQ(0, compositePaths[0].InstanceID);
+    EXPECT_EQ(0, compositePaths[0].ResourceID);
+}
+
+TEST_F(Lwm2mObserversTestSuite, composite_observation_ends_with_its_last_path)
+{
+    CreateInstances(1, 1);
+    ObserveComposite({ { TestObjectID, 0, 0 } });
+    EXPECT_EQ(0, Lwm2m_RemoveAllObserversForOIR(context_, TestObjectID, 0, 0));
+    EXPECT_EQ(-1, Lwm2m_CancelObserveComposite(context_, &address_, "comp", 4));
+}
+
+TEST_F(Lwm2mObserversTestSuite, benchmark_10k_writes_with_1k_observations)
+{
+    const int numberOfInstances = 100;
+    const int numberOfResources = 10;
+    const int numberOfWrites = 10000;
+    CreateInstances(numberOfInstances, numberOfResources);
+    for (int objectInstanceID = 0; objectInstanceID < numberOfInstances; objectInstanceID++)
+    {
+        for (int resourceID = 0; resourceID < numberOfResources; resourceID++)
+        {
+            Observe(objectInstanceID, resourceID);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numberOfWrites; i++)
+    {
+        Write((i / numberOfResources) % numberOfInstances, i % numberOfResources, i);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    Lwm2m_UpdateObservers(context_);
+    EXPECT_EQ(static_cast<size_t>(numberOfInstances * numberOfResources), notifications.size());
+
+    double writesPerSecond = numberOfWrites * 1000000.0 / elapsed;
+    std::cout << "[ BENCHMARK] " << numberOfWrites << " writes with " << numberOfInstances * numberOfResources << " observations: "
+              << elapsed / 1000 << " ms (" << static_cast<int>(writesPerSecond) << " writes/s)" << std::endl;
+}
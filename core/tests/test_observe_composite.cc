@@ -0,0 +1,241 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+
+#include "lwm2m_core.h"
+#include "lwm2m_security_object.h"
+#include "coap_abstraction.h"
+#include "unit_support.h"
+
+extern "C" {
+#include "er-coap.h"
+}
+
+namespace {
+
+const int CLIENT_PORT = 60687;
+const int SERVER_PORT = 60688;
+const ObjectIDType TestObjectID = 1000;
+
+NetworkAddress * NewAddress(int port)
+{
+    std::string uri = "coap://127.0.0.1:" + std::to_string(port);
+    return NetworkAddress_New(uri.c_str(), uri.length());
+}
+
+} // namespace
+
+// Observe-Composite requests, as a server sends them to the client over CoAP
+class ObserveCompositeTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        Lwm2m_SetLogLevel(DebugLevel_Emerg);
+        UnitSupport_SetTickCountMs(1000000);
+        CoapInfo * coap = coap_Init("127.0.0.1", CLIENT_PORT, false, false, 0);
+        ASSERT_TRUE(coap != NULL);
+        context_ = Lwm2mCore_Init(coap, (char *)"client1");
+
+        Definition_RegisterObjectType(Lwm2mCore_GetDefinitions(context_), (char *)"Test", TestObjectID, MultipleInstancesEnum_Multiple, MandatoryEnum_Optional,
+                                      &defaultObjectOperationHandlers);
+        for (ResourceIDType resourceID = 0; resourceID < 2; resourceID++)
+        {
+            Lwm2mCore_RegisterResourceType(context_, (char *)"Value", TestObjectID, resourceID, AwaResourceType_Integer, MultipleInstancesEnum_Single,
+                                           MandatoryEnum_Mandatory, AwaResourceOperations_ReadWrite, &defaultResourceOperationHandlers);
+        }
+        Lwm2mCore_RegisterResourceType(context_, (char *)"Reboot", TestObjectID, 2, AwaResourceType_None, MultipleInstancesEnum_Single,
+                                       MandatoryEnum_Optional, AwaResourceOperations_Execute, &defaultResourceOperationHandlers);
+        for (ObjectInstanceIDType objectInstanceID = 0; objectInstanceID < 2; objectInstanceID++)
+        {
+            ASSERT_EQ(objectInstanceID, Lwm2mCore_CreateObjectInstance(context_, TestObjectID, objectInstanceID));
+            ASSERT_EQ(0, Lwm2mCore_CreateOptionalResource(context_, TestObjectID, objectInstanceID, 2));
+            Write(objectInstanceID, 0, 0);
+            Write(objectInstanceID, 1, 0);
+        }
+
+        server_ = NetworkSocket_New("127.0.0.1", NetworkSocketType_UDP, SERVER_PORT);
+        ASSERT_TRUE(NetworkSocket_StartListening(server_));
+        clientAddress_ = NewAddress(CLIENT_PORT);
+        NetworkAddress * serverAddress = NewAddress(SERVER_PORT);
+        NetworkAddress_SetAddressType(serverAddress, &serverAddress_);
+        NetworkAddress_Free(&serverAddress);
+        mid_ = 1;
+    }
+
+    void TearDown()
+    {
+        Lwm2mCore_Destroy(context_);
+        coap_Destroy();
+        NetworkSocket_Free(&server_);
+        NetworkAddress_Free(&clientAddress_);
+        UnitSupport_UseRealTickCount();
+        Lwm2m_SetLogLevel(DebugLevel_Info);
+    }
+
+    void Write(ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, AwaInteger value)
+    {
+        Lwm2mCore_SetResourceInstanceValue(context_, TestObjectID, objectInstanceID, resourceID, 0, &value, sizeof(value));
+    }
+
+    // Notify of any change as soon as it is made, and not otherwise
+    void NotifyOnChange()
+    {
+        NotificationAttributes attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.MinimumPeriod = 0;
+        attributes.Valid[AttributeTypeEnum_MinimumPeriod] = true;
+        attributes.MaximumPeriod = -1;
+        attributes.Valid[AttributeTypeEnum_MaximumPeriod] = true;
+        ASSERT_EQ(0, AttributeStore_SetNotificationAttributes(Lwm2mCore_GetAttributes(context_), Lwm2mSecurity_GetShortServerID(context_, &serverAddress_),
+                                                              TestObjectID, -1, -1, &attributes));
+        Lwm2m_RescheduleObservers(context_);
+    }
+
+    // Send a FETCH with the given Observe option from the server, naming paths in a SenML JSON payload, and receive the response
+    bool Fetch(uint32_t observe, const std::string & payload, coap_packet_t * response)
+    {
+        coap_packet_t request[1];
+        uint8_t buffer[COAP_MAX_PACKET_SIZE];
+        coap_init_message(request, COAP_TYPE_CON, COAP_FETCH, mid_++);
+        coap_set_token(request, reinterpret_cast<const uint8_t *>("comp"), 4);
+        coap_set_header_observe(request, observe);
+        coap_set_header_content_format(request, AwaContentType_ApplicationSenmlJson);
+        coap_set_payload(request, payload.c_str(), payload.length());
+        size_t length = coap_serialize_message(request, buffer);
+        EXPECT_TRUE(NetworkSocket_Send(server_, clientAddress_, buffer, length));
+        return Receive(response);
+    }
+
+    // Wait for a message from the client, and parse it into message
+    bool Receive(coap_packet_t * message)
+    {
+        for (int i = 0; i < 100; i++)
+        {
+            coap_HandleMessage();
+            Lwm2m_UpdateObservers(context_);
+            coap_Process();
+            NetworkAddress * sourceAddress = NULL;
+            int readLength = 0;
+            if (NetworkSocket_Read(server_, buffer_, sizeof(buffer_), &sourceAddress, &readLength) && (readLength > 0))
+            {
+                return coap_parse_message(message, buffer_, readLength) == NO_ERROR;
+            }
+            usleep(10000);
+        }
+        return false;
+    }
+
+    // Wait for a notification after the clock has moved past its due time
+    bool ReceiveNotification(coap_packet_t * message)
+    {
+        UnitSupport_AdvanceTickCountMs(10);
+        return Receive(message) && (message->type == COAP_TYPE_NON) && IS_OPTION(message, COAP_OPTION_OBSERVE);
+    }
+
+    static std::string Payload(coap_packet_t * message)
+    {
+        const uint8_t * payload = NULL;
+        int length = coap_get_payload(message, &payload);
+        return std::string(reinterpret_cast<const char *>(payload), length);
+    }
+
+    Lwm2mContextType * context_;
+    NetworkSocket * server_;
+    NetworkAddress * clientAddress_;
+    AddressType serverAddress_;
+    uint16_t mid_;
+    uint8_t buffer_[COAP_MAX_PACKET_SIZE];
+};
+
+TEST_F(ObserveCompositeTestSuite, observation_is_registered_notified_and_cancelled)
+{
+    coap_packet_t response[1];
+    ASSERT_TRUE(Fetch(0, "[{\"n\":\"/1000/0/0\"},{\"n\":\"/1000/1/1\"}]", response));
+    EXPECT_EQ(CONTENT_2_05, response->code);
+    EXPECT_TRUE(IS_OPTION(response, COAP_OPTION_OBSERVE));
+    EXPECT_EQ(AwaContentType_ApplicationSenmlJson, response->content_format);
+    EXPECT_NE(std::string::npos, Payload(response).find("\"bn\":\"/1000/0/\""));
+    EXPECT_NE(std::string::npos, Payload(response).find("\"bn\":\"/1000/1/\""));
+    NotifyOnChange();
+
+    // only the path that changed is notified
+    Write(1, 1, 42);
+    coap_packet_t notification[1];
+    ASSERT_TRUE(ReceiveNotification(notification));
+    EXPECT_EQ(4, notification->token_len);
+    EXPECT_EQ(0, memcmp("comp", notification->token, 4));
+    EXPECT_EQ(AwaContentType_ApplicationSenmlJson, notification->content_format);
+    EXPECT_EQ(std::string::npos, Payload(notification).find("\"bn\":\"/1000/0/\""));
+    EXPECT_NE(std::string::npos, Payload(notification).find("\"v\":42"));
+
+    ASSERT_TRUE(Fetch(1, "[{\"n\":\"/1000/0/0\"},{\"n\":\"/1000/1/1\"}]", response));
+    EXPECT_EQ(CONTENT_2_05, response->code);
+    EXPECT_FALSE(IS_OPTION(response, COAP_OPTION_OBSERVE));
+
+    Write(1, 1, 43);
+    EXPECT_FALSE(ReceiveNotification(notification));
+}
+
+TEST_F(ObserveCompositeTestSuite, paths_that_cannot_be_read_are_not_observed)
+{
+    coap_packet_t response[1];
+    ASSERT_TRUE(Fetch(0, "[{\"n\":\"/1000/0/2\"}]", response));
+    EXPECT_EQ(METHOD_NOT_ALLOWED_4_05, response->code);
+    EXPECT_FALSE(IS_OPTION(response, COAP_OPTION_OBSERVE));
+
+    ASSERT_TRUE(Fetch(0, "[{\"n\":\"/1000/0/9\"}]", response));
+    EXPECT_EQ(NOT_FOUND_4_04, response->code);
+    EXPECT_FALSE(IS_OPTION(response, COAP_OPTION_OBSERVE));
+
+    // the paths that can be read are observed without the others
+    ASSERT_TRUE(Fetch(0, "[{\"n\":\"/1000/0/2\"},{\"n\":\"/1000/0/0\"}]", response));
+    EXPECT_EQ(CONTENT_2_05, response->code);
+    EXPECT_TRUE(IS_OPTION(response, COAP_OPTION_OBSERVE));
+    EXPECT_EQ(std::string::npos, Payload(response).find("\"n\":\"2\""));
+    EXPECT_NE(std::string::npos, Payload(response).find("\"bn\":\"/1000/0/\""));
+    EXPECT_EQ(1, ListCount(Lwm2mCore_GetObserverList(context_)));
+}
+
+TEST_F(ObserveCompositeTestSuite, deleting_an_observed_instance_leaves_its_paths_out_of_notifications)
+{
+    coap_packet_t response[1];
+    ASSERT_TRUE(Fetch(0, "[{\"n\":\"/1000/0/0\"},{\"n\":\"/1000/1\"},{\"n\":\"/1000/1/0\"}]", response));
+    EXPECT_EQ(CONTENT_2_05, response->code);
+    NotifyOnChange();
+
+    Write(0, 0, 1);
+    Write(1, 0, 1);
+    coap_packet_t notification[1];
+    ASSERT_TRUE(ReceiveNotification(notification));
+    EXPECT_NE(std::string::npos, Payload(notification).find("\"bn\":\"/1000/1/\""));
+
+    ASSERT_EQ(AwaResult_SuccessDeleted, Lwm2mCore_Delete(context_, Lwm2mRequestOrigin_Client, TestObjectID, 1, -1, -1, false));
+    Write(0, 0, 2);
+    ASSERT_TRUE(ReceiveNotification(notification));
+    EXPECT_EQ(std::string::npos, Payload(notification).find("\"bn\":\"/1000/1/\""));
+    EXPECT_NE(std::string::npos, Payload(notification).find("\"v\":2"));
+}
@@ -0,0 +1,180 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "common/lwm2m_senml_json.h"
+#include "common/lwm2m_tree_node.h"
+#include "common/lwm2m_tree_builder.h"
+#include "common/lwm2m_request_origin.h"
+#include "lwm2m_core.h"
+
+class SenMLJsonTestSuite : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        context_ = Lwm2mCore_Init(NULL, NULL);
+        Definition_RegisterObjectType(Lwm2mCore_GetDefinitions(context_), (char *)"Test", 1000, MultipleInstancesEnum_Multiple, MandatoryEnum_Optional,
+                                      &defaultObjectOperationHandlers);
+        RegisterResource(0, AwaResourceType_Integer, MultipleInstancesEnum_Single);
+        RegisterResource(1, AwaResourceType_String, MultipleInstancesEnum_Single);
+        RegisterResource(2, AwaResourceType_Float, MultipleInstancesEnum_Single);
+        RegisterResource(3, AwaResourceType_Boolean, MultipleInstancesEnum_Single);
+        RegisterResource(4, AwaResourceType_Opaque, MultipleInstancesEnum_Single);
+        RegisterResource(5, AwaResourceType_Integer, MultipleInstancesEnum_Multiple);
+        Lwm2mCore_CreateObjectInstance(context_, 1000, 0);
+        Lwm2mCore_CreateObjectInstance(context_, 1000, 1);
+    }
+
+    void TearDown()
+    {
+        Lwm2mCore_Destroy(context_);
+    }
+
+    void RegisterResource(ResourceIDType resourceID, AwaResourceType type, MultipleInstancesEnum multiple)
+    {
+        Lwm2mCore_RegisterResourceType(context_, (char *)"Value", 1000, resourceID, type, multiple, MandatoryEnum_Optional,
+                                       AwaResourceOperations_ReadWrite, &defaultResourceOperationHandlers);
+    }
+
+    void Set(ObjectInstanceIDType objectInstanceID, ResourceIDType resourceID, ResourceInstanceIDType resourceInstanceID, const void * value, size_t valueLength)
+    {
+        Lwm2mCore_CreateOptionalResource(context_, 1000, objectInstanceID, resourceID);
+        Lwm2mCore_SetResourceInstanceValue(context_, 1000, objectInstanceID, resourceID, resourceInstanceID, value, valueLength);
+    }
+
+    std::string Serialise(const std::vector<ObjectInstanceResourceKey> & paths, int bufferLength = 512)
+    {
+        std::vector<Lwm2mTreeNode *> nodes;
+        for (const ObjectInstanceResourceKey & path : paths)
+        {
+            int oir[3] = { path.ObjectID, path.InstanceID, path.ResourceID };
+            Lwm2mTreeNode * node = NULL;
+            EXPECT_EQ(AwaResult_Success, TreeBuilder_CreateTreeFromOIR(&node, context_, Lwm2mRequestOrigin_Server, oir, (oir[1] == -1) ? 1 : ((oir[2] == -1) ? 2 : 3)));
+            nodes.push_back(node);
+        }
+
+        std::vector<char> buffer(bufferLength);
+        int len = SenMLJson_SerialisePaths(nodes.data(), paths.data(), paths.size(), buffer.data(), buffer.size());
+        for (Lwm2mTreeNode * node : nodes)
+        {
+            Lwm2mTreeNode_DeleteRecursive(node);
+        }
+        return (len >= 0) ? std::string(buffer.data(), len) : std::string("error");
+    }
+
+    Lwm2mContextType * context_;
+};
+
+TEST_F(SenMLJsonTestSuite, serialise_resource)
+{
+    AwaInteger value = 42;
+    Set(0, 0, 0, &value, sizeof(value));
+    EXPECT_EQ("[{\"bn\":\"/1000/0/\",\"n\":\"0\",\"v\":42}]", Serialise({ { 1000, 0, 0 } }));
+}
+
+TEST_F(SenMLJsonTestSuite, serialise_paths_gives_base_name_for_each_object_instance)
+{
+    AwaInteger integer = 7;
+    bool boolean = true;
+    Set(0, 1, 0, "a\"b", 3);
+    Set(1, 0, 0, &integer, sizeof(integer));
+    Set(1, 3, 0, &boolean, sizeof(boolean));
+    EXPECT_EQ("[{\"bn\":\"/1000/0/\",\"n\":\"1\",\"vs\":\"a\\\"b\"},"
+              "{\"bn\":\"/1000/1/\",\"n\":\"0\",\"v\":7},"
+              "{\"n\":\"3\",\"vb\":true}]", Serialise({ { 1000, 0, 1 }, { 1000, 1, 0 }, { 1000, 1, 3 } }));
+}
+
+TEST_F(SenMLJsonTestSuite, serialise_float_opaque_and_multiple_instance_values)
+{
+    AwaFloat number = 1.5;
+    uint8_t opaque[] = { 0xfb, 0xff };
+    AwaInteger first = 1;
+    AwaInteger second = -2;
+    Set(0, 2, 0, &number, sizeof(number));
+    Set(0, 4, 0, opaque, sizeof(opaque));
+    Set(0, 5, 0, &first, sizeof(first));
+    Set(0, 5, 1, &second, sizeof(second));
+    EXPECT_EQ("[{\"bn\":\"/1000/0/\",\"n\":\"2\",\"v\":1.5},"
+              "{\"n\":\"4\",\"vd\":\"-_8\"},"
+              "{\"n\":\"5/0\",\"v\":1},{\"n\":\"5/1\",\"v\":-2}]", Serialise({ { 1000, 0, 2 }, { 1000, 0, 4 }, { 1000, 0, 5 } }));
+}
+
+TEST_F(SenMLJsonTestSuite, serialise_fails_if_pack_does_not_fit)
+{
+    AwaInteger value = 42;
+    Set(0, 0, 0, &value, sizeof(value));
+    std::string pack = Serialise({ { 1000, 0, 0 } });
+    EXPECT_EQ("error", Serialise({ { 1000, 0, 0 } }, pack.size()));
+    EXPECT_EQ(pack, Serialise({ { 1000, 0, 0 } }, pack.size() + 1));
+}
+
+TEST_F(SenMLJsonTestSuite, deserialise_paths_with_base_names)
+{
+    const char * pack = " [ {\"n\":\"/3/0/1\"}, {\"bn\":\"/1/0/\",\"n\":\"1\"},{\"n\":\"2\"},{}, {\"bn\":\"\",\"n\":\"/4\"} ] ";
+    ObjectInstanceResourceKey paths[8];
+    ASSERT_EQ(5, SenMLJson_DeserialisePaths(pack, strlen(pack), paths, 8));
+
+    const ObjectInstanceResourceKey expected[] = { { 3, 0, 1 }, { 1, 0, 1 }, { 1, 0, 2 }, { 1, 0, -1 }, { 4, -1, -1 } };
+    for (int i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(expected[i].ObjectID, paths[i].ObjectID);
+        EXPECT_EQ(expected[i].InstanceID, paths[i].InstanceID);
+        EXPECT_EQ(expected[i].ResourceID, paths[i].ResourceID);
+    }
+}
+
+TEST_F(SenMLJsonTestSuite, deserialise_paths_rejects_invalid_packs)
+{
+    const char * packs[] =
+    {
+        "",
+        "[]",
+        "{\"n\":\"/3\"}",
+        "[{\"n\":\"3/0\"}]",
+        "[{\"n\":\"/3/0/1/2\"}]",
+        "[{\"n\":\"/70000\"}]",
+        "[{\"n\":\"/3/+0\"}]",
+        "[{\"n\":\"/3\",\"v\":1}]",
+        "[{\"n\":\"/3\"}]x",
+        "[{\"n\":\"/3\"},]",
+        "[{\"n\":\"/3\"}",
+    };
+    for (const char * pack : packs)
+    {
+        ObjectInstanceResourceKey paths[8];
+        EXPECT_EQ(-1, SenMLJson_DeserialisePaths(pack, strlen(pack), paths, 8)) << pack;
+    }
+}
+
+TEST_F(SenMLJsonTestSuite, deserialise_paths_rejects_too_many_paths)
+{
+    const char * pack = "[{\"n\":\"/3\"},{\"n\":\"/4\"}]";
+    ObjectInstanceResourceKey paths[1];
+    EXPECT_EQ(-1, SenMLJson_DeserialisePaths(pack, strlen(pack), paths, 1));
+}
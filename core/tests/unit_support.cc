@@ -25,3 +25,33 @@
  *******************************************************/
 
 #include "unit_support.h"
+
+static bool fakeClock = false;
+static uint64_t fakeNow = 0;
+
+extern "C" {
+
+uint64_t __real_Lwm2mCore_GetTickCountMs(void);
+
+uint64_t __wrap_Lwm2mCore_GetTickCountMs(void)
+{
+    return fakeClock ? fakeNow : __real_Lwm2mCore_GetTickCountMs();
+}
+
+}
+
+void UnitSupport_SetTickCountMs(uint64_t now)
+{
+    fakeClock = true;
+    fakeNow = now;
+}
+
+void UnitSupport_AdvanceTickCountMs(uint64_t milliseconds)
+{
+    fakeNow += milliseconds;
+}
+
+void UnitSupport_UseRealTickCount(void)
+{
+    fakeClock = false;
+}
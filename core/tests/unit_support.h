@@ -27,4 +27,13 @@
  *** Unit Test Common Test Support Functions
  *******************************************************/
 
+#include <stdint.h>
+
+/* The test runner is linked with Lwm2mCore_GetTickCountMs wrapped, so that tests can stop the clock and move it
+ * on themselves. The real clock is used unless a fake time has been set.
+ */
+void UnitSupport_SetTickCountMs(uint64_t now);
+void UnitSupport_AdvanceTickCountMs(uint64_t milliseconds);
+void UnitSupport_UseRealTickCount(void);
+
 #endif // UNIT_SUPPORT_H
@@ -194,7 +194,7 @@ static int Bootstrap_Start(Options * options)
 
     srandom((int)time(NULL)*getpid());
 
-    CoapInfo * coap = coap_Init(ipAddress, options->CoapPort, options->Secure, (options->Verbose) ? DebugLevel_Debug : DebugLevel_Info);
+    CoapInfo * coap = coap_Init(ipAddress, options->CoapPort, options->Secure, false, (options->Verbose) ? DebugLevel_Debug : DebugLevel_Info);
     if (coap == NULL)
     {
         printf("Unable to map address to network interface\n");
@@ -233,6 +233,13 @@ static int Bootstrap_Start(Options * options)
 
         timeout = Lwm2mCore_Process(context);
 
+        // wake up in time for the next CoAP retransmission
+        int coapTimeout = coap_Process();
+        if ((coapTimeout >= 0) && (coapTimeout < timeout))
+        {
+            timeout = coapTimeout;
+        }
+
         loop_result = poll(fds, nfds, timeout);
 
         if (loop_result < 0)
@@ -252,7 +259,6 @@ static int Bootstrap_Start(Options * options)
                 coap_HandleMessage();
             }
         }
-        coap_Process();
     }
     Lwm2m_Debug("Exit triggered\n");
 
@@ -49,6 +49,7 @@ const char *gengetopt_args_info_help[] = {
   "  -d, --daemonize               Detach process from terminal and run in the\n                                  background  (default=off)",
   "  -v, --verbose                 Generate verbose output  (default=off)",
   "  -l, --logFile=FILE            Log output to FILE",
+  "  -M, --metricsPort=PORT        Serve Prometheus metrics over HTTP on local\n                            port PORT",
   "  -V, --version                 Print version and exit  (default=off)",
   "\nExample:\n    awa_clientd --port 6000 --endPointName client1 --bootstrap\ncoap://[::1]:2134\n\nPSK Example:\n\n    awa_clientd --port 6000 --endPointName client1 --bootstrap\ncoaps://0.0.0.0:2134 --pskIdentity=myPskIdentity\n--pskKey=2646188672F6CCD4AAEA476C645F2565B83E15BF00D135A3A6944DF72218759F\n\n",
     0
@@ -96,6 +97,7 @@ void clear_given (struct gengetopt_args_info *args_info)
   args_info->daemonize_given = 0 ;
   args_info->verbose_given = 0 ;
   args_info->logFile_given = 0 ;
+  args_info->metricsPort_given = 0 ;
   args_info->version_given = 0 ;
 }
 
@@ -130,6 +132,8 @@ void clear_args (struct gengetopt_args_info *args_info)
   args_info->verbose_flag = 0;
   args_info->logFile_arg = NULL;
   args_info->logFile_orig = NULL;
+  args_info->metricsPort_arg;
+  args_info->metricsPort_orig = NULL;
   args_info->version_flag = 0;
 
 }
@@ -157,7 +161,8 @@ void init_args_info(struct gengetopt_args_info *args_info)
   args_info->daemonize_help = gengetopt_args_info_help[13] ;
   args_info->verbose_help = gengetopt_args_info_help[14] ;
   args_info->logFile_help = gengetopt_args_info_help[15] ;
-  args_info->version_help = gengetopt_args_info_help[16] ;
+  args_info->metricsPort_help = gengetopt_args_info_help[16] ;
+  args_info->version_help = gengetopt_args_info_help[17] ;
 
 }
 
@@ -308,6 +313,7 @@ cmdline_parser_release (struct gengetopt_args_info *args_info)
   free_multiple_string_field (args_info->objDefs_given, &(args_info->objDefs_arg), &(args_info->objDefs_orig));
   free_string_field (&(args_info->logFile_arg));
   free_string_field (&(args_info->logFile_orig));
+  free_string_field (&(args_info->metricsPort_orig));
 
 
   for (i = 0; i < args_info->inputs_num; ++i)
@@ -423,6 +429,8 @@ cmdline_parser_dump(FILE *outfile, struct gengetopt_args_info *args_info)
     write_into_file(outfile, "verbose", 0, 0 );
   if (args_info->logFile_given)
     write_into_file(outfile, "logFile", args_info->logFile_orig, 0);
+  if (args_info->metricsPort_given)
+    write_into_file(outfile, "metricsPort", args_info->metricsPort_orig, 0);
   if (args_info->version_given)
     write_into_file(outfile, "version", 0, 0 );
 
@@ -1595,6 +1603,7 @@ cmdline_parser_internal (
         { "daemonize",	0, NULL, 'd' },
         { "verbose",	0, NULL, 'v' },
         { "logFile",	1, NULL, 'l' },
+        { "metricsPort",	1, NULL, 'M' },
         { "version",	0, NULL, 'V' },
         { 0,  0, 0, 0 }
       };
@@ -1604,7 +1613,7 @@ cmdline_parser_internal (
       custom_opterr = opterr;
       custom_optopt = optopt;
 
-      c = custom_getopt_long (argc, argv, "hp:a:i:e:b:f:sc:t:o:dvl:V", long_options, &option_index);
+      c = custom_getopt_long (argc, argv, "hp:a:i:e:b:f:sc:t:o:dvl:M:V", long_options, &option_index);
 
       optarg = custom_optarg;
       optind = custom_optind;
@@ -1766,6 +1775,18 @@ cmdline_parser_internal (
                          additional_error))
             goto failure;
 
+          break;
+        case 'M':	/* Serve Prometheus metrics over HTTP on local port PORT.  */
+
+
+          if (update_arg( (void *)&(args_info->metricsPort_arg),
+                         &(args_info->metricsPort_orig), &(args_info->metricsPort_given),
+                         &(local_args_info.metricsPort_given), optarg, 0, 0, ARG_INT,
+                         check_ambiguity, override, 0, 0,
+                         "metricsPort", 'M',
+                         additional_error))
+            goto failure;
+
           break;
         case 'V':	/* Print version and exit.  */
 
@@ -82,6 +82,9 @@ struct gengetopt_args_info
   char * logFile_arg;	/**< @brief Log output to FILE.  */
   char * logFile_orig;	/**< @brief Log output to FILE original value given at command line.  */
   const char *logFile_help; /**< @brief Log output to FILE help description.  */
+  int metricsPort_arg;	/**< @brief Serve Prometheus metrics over HTTP on local port PORT.  */
+  char * metricsPort_orig;	/**< @brief Serve Prometheus metrics over HTTP on local port PORT original value given at command line.  */
+  const char *metricsPort_help; /**< @brief Serve Prometheus metrics over HTTP on local port PORT help description.  */
   int version_flag;	/**< @brief Print version and exit (default=off).  */
   const char *version_help; /**< @brief Print version and exit help description.  */
 
@@ -101,6 +104,7 @@ struct gengetopt_args_info
   unsigned int daemonize_given ;	/**< @brief Whether daemonize was given.  */
   unsigned int verbose_given ;	/**< @brief Whether verbose was given.  */
   unsigned int logFile_given ;	/**< @brief Whether logFile was given.  */
+  unsigned int metricsPort_given ;	/**< @brief Whether metricsPort was given.  */
   unsigned int version_given ;	/**< @brief Whether version was given.  */
 
   char **inputs ; /**< @brief unamed options (options without names) */
@@ -53,6 +53,7 @@
 #include "lwm2m_acl_object.h"
 #include "lwm2m_client_xml_handlers.h"
 #include "lwm2m_xml_interface.h"
+#include "lwm2m_metrics_endpoint.h"
 #include "lwm2m_object_defs.h"
 #include "lwm2m_client_cert.h"
 #include "lwm2m_client_psk.h"
@@ -76,6 +77,7 @@ typedef struct
     bool Daemonise;
     bool Verbose;
     char * LogFile;
+    int MetricsPort;
     bool Version;
 } Options;
 
@@ -170,6 +172,7 @@ static int Lwm2mClient_Start(Options * options)
     uint8_t * loadedClientCert = NULL;
     int result = 0;
     uint8_t * key = NULL;
+    int metricsFd = -1;
 
     if (options->Daemonise)
     {
@@ -224,7 +227,7 @@ static int Lwm2mClient_Start(Options * options)
 
     srandom((int)time(NULL)*getpid());
 
-    CoapInfo * coap = coap_Init((options->AddressFamily == AF_INET) ? "0.0.0.0" : "::", options->CoapPort, false /* not a server */, (options->Verbose) ? DebugLevel_Debug : DebugLevel_Info);
+    CoapInfo * coap = coap_Init((options->AddressFamily == AF_INET) ? "0.0.0.0" : "::", options->CoapPort, false /* not a server */, false, (options->Verbose) ? DebugLevel_Debug : DebugLevel_Info);
     if (coap == NULL)
     {
         Lwm2m_Error("Failed to initialise CoAP on port %d\n", options->CoapPort);
@@ -315,11 +318,22 @@ static int Lwm2mClient_Start(Options * options)
     }
     xmlif_RegisterHandlers();
 
+    if (options->MetricsPort > 0)
+    {
+        metricsFd = MetricsEndpoint_Init(options->MetricsPort);
+        if (metricsFd < 0)
+        {
+            Lwm2m_Error("Failed to initialise metrics endpoint on port %d\n", options->MetricsPort);
+            result = 1;
+            goto error_xmlif;
+        }
+    }
+
     // Wait for messages on both the IPC and CoAP interfaces
     while (!quit)
     {
         int loop_result;
-        struct pollfd fds[2];
+        struct pollfd fds[2 + METRICS_ENDPOINT_POLL_FDS];
         int nfds = 2;
         int timeout;
 
@@ -329,8 +343,21 @@ static int Lwm2mClient_Start(Options * options)
         fds[1].fd = xmlFd;
         fds[1].events = POLLIN;
 
+        if (metricsFd >= 0)
+        {
+            MetricsEndpoint_SetPollFds(&fds[2]);
+            nfds += METRICS_ENDPOINT_POLL_FDS;
+        }
+
         timeout = Lwm2mCore_Process(context);
 
+        // wake up in time for the next CoAP retransmission
+        int coapTimeout = coap_Process();
+        if ((coapTimeout >= 0) && (coapTimeout < timeout))
+        {
+            timeout = coapTimeout;
+        }
+
         loop_result = poll(fds, nfds, timeout);
         if (loop_result < 0)
         {
@@ -351,11 +378,16 @@ static int Lwm2mClient_Start(Options * options)
             {
                 xmlif_process(fds[1].fd);
             }
+            if (metricsFd >= 0)
+            {
+                MetricsEndpoint_Process(&fds[2]);
+            }
         }
-        coap_Process();
     }
     Lwm2m_Debug("Exit triggered\n");
 
+    MetricsEndpoint_Destroy(metricsFd);
+error_xmlif:
     xmlif_DestroyExecuteHandlers();
     xmlif_destroy(xmlFd);
 error_core:
@@ -447,6 +479,7 @@ static void PrintOptions(const Options * options)
     printf("  Daemonize            (--daemonize)        : %d\n", options->Daemonise);
     printf("  Verbose              (--verbose)          : %d\n", options->Verbose);
     printf("  LogFile              (--logFile)          : %s\n", options->LogFile ? options->LogFile : "");
+    printf("  MetricsPort          (--metricsPort)      : %d\n", options->MetricsPort);
     printf("  Version              (--version)          : %d\n", options->Version);
 }
 
@@ -485,6 +518,7 @@ static int ParseOptions(int argc, char ** argv, struct gengetopt_args_info * ai,
         options->Daemonise = ai->daemonize_flag;
         options->Verbose = ai->verbose_flag;
         options->LogFile = ai->logFile_arg;
+        options->MetricsPort = ai->metricsPort_given ? ai->metricsPort_arg : 0;
         options->Version = ai->version_flag;
 
         // Check to see if at least one bootstrap option is specified
@@ -522,6 +556,7 @@ int main(int argc, char ** argv)
         .Daemonise = false,
         .Verbose = false,
         .LogFile = NULL,
+        .MetricsPort = 0,
         .Version = false,
     };
 
@@ -0,0 +1,272 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "lwm2m_metrics_endpoint.h"
+#include "lwm2m_metrics.h"
+#include "lwm2m_debug.h"
+#include "lwm2m_util.h"
+
+// Time allowed for a scraper to send its request and read the response
+#define METRICS_CONNECTION_TIMEOUT_MS (5000)
+
+typedef struct
+{
+    int Fd;                 // -1 if unused
+    uint64_t Deadline;
+    char * Response;        // NULL until the request has arrived
+    size_t ResponseLength;
+    size_t Sent;
+
+} MetricsConnection;
+
+static int listenFd = -1;
+static MetricsConnection connections[METRICS_ENDPOINT_MAX_CONNECTIONS];
+
+static int SetNonBlocking(int sockfd)
+{
+    int flags = fcntl(sockfd, F_GETFL);
+    return ((flags == -1) || (fcntl(sockfd, F_SETFL, flags | O_NONBLOCK) == -1)) ? -1 : 0;
+}
+
+static void CloseConnection(MetricsConnection * connection)
+{
+    close(connection->Fd);
+    free(connection->Response);
+    memset(connection, 0, sizeof(*connection));
+    connection->Fd = -1;
+}
+
+int MetricsEndpoint_Init(int port)
+{
+    struct sockaddr_in address;
+    int reuse = 1;
+    int i;
+
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd == -1)
+    {
+        perror("metrics: socket");
+        return -1;
+    }
+
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if ((bind(sockfd, (struct sockaddr *)&address, sizeof(address)) == -1) || (listen(sockfd, 4) == -1) || (SetNonBlocking(sockfd) == -1))
+    {
+        perror("metrics: bind");
+        close(sockfd);
+        return -1;
+    }
+
+    for (i = 0; i < METRICS_ENDPOINT_MAX_CONNECTIONS; i++)
+    {
+        memset(&connections[i], 0, sizeof(connections[i]));
+        connections[i].Fd = -1;
+    }
+    listenFd = sockfd;
+
+    Lwm2m_Info("Metrics available at http://127.0.0.1:%d/metrics\n", port);
+    return sockfd;
+}
+
+static void Accept(void)
+{
+    int i;
+    for (i = 0; i < METRICS_ENDPOINT_MAX_CONNECTIONS; i++)
+    {
+        if (connections[i].Fd == -1)
+        {
+            int connection = accept(listenFd, NULL, NULL);
+            if (connection == -1)
+            {
+                if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+                {
+                    perror("metrics: accept");
+                }
+            }
+            else if (SetNonBlocking(connection) == -1)
+            {
+                perror("metrics: fcntl");
+                close(connection);
+            }
+            else
+            {
+                connections[i].Fd = connection;
+                connections[i].Deadline = Lwm2mCore_GetTickCountMs() + METRICS_CONNECTION_TIMEOUT_MS;
+            }
+            break;
+        }
+    }
+}
+
+// Every request gets the metrics, so the response is prepared as soon as anything arrives
+static void Receive(MetricsConnection * connection)
+{
+    char request[1024];
+    ssize_t received = recv(connection->Fd, request, sizeof(request), 0);
+    if (received > 0)
+    {
+        if (connection->Response == NULL)
+        {
+            char header[256];
+            int length = Metrics_WritePrometheus(NULL, 0);
+            char * body = malloc(length + 1);
+            if (body != NULL)
+            {
+                Metrics_WritePrometheus(body, length + 1);
+                length = strlen(body);
+                int headerLength = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+                                                                    "Content-Type: text/plain; version=0.0.4\r\n"
+                                                                    "Content-Length: %d\r\n"
+                                                                    "Connection: close\r\n\r\n", length);
+                connection->Response = malloc(headerLength + length);
+                if (connection->Response != NULL)
+                {
+                    memcpy(connection->Response, header, headerLength);
+                    memcpy(connection->Response + headerLength, body, length);
+                    connection->ResponseLength = headerLength + length;
+                    connection->Sent = 0;
+                }
+                free(body);
+            }
+            if (connection->Response == NULL)
+            {
+                Lwm2m_Error("Out of memory\n");
+                CloseConnection(connection);
+            }
+        }
+    }
+    else if ((received == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+    {
+        CloseConnection(connection);
+    }
+}
+
+static void Send(MetricsConnection * connection)
+{
+    while (connection->Sent < connection->ResponseLength)
+    {
+        ssize_t sent = send(connection->Fd, connection->Response + connection->Sent, connection->ResponseLength - connection->Sent, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            if ((sent == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+            {
+                CloseConnection(connection);
+            }
+            // otherwise wait for poll to report the socket writable
+            return;
+        }
+        connection->Sent += sent;
+    }
+    CloseConnection(connection);
+}
+
+void MetricsEndpoint_SetPollFds(struct pollfd * fds)
+{
+    uint64_t now = Lwm2mCore_GetTickCountMs();
+    bool full = true;
+    int i;
+
+    for (i = 0; i < METRICS_ENDPOINT_MAX_CONNECTIONS; i++)
+    {
+        MetricsConnection * connection = &connections[i];
+        if ((connection->Fd != -1) && (now >= connection->Deadline))
+        {
+            Lwm2m_Debug("Metrics connection timed out\n");
+            CloseConnection(connection);
+        }
+
+        fds[1 + i].fd = connection->Fd;
+        fds[1 + i].events = (connection->Response == NULL) ? POLLIN : POLLOUT;
+        fds[1 + i].revents = 0;
+        if (connection->Fd == -1)
+        {
+            full = false;
+        }
+    }
+
+    // when every connection is busy, new scrapers wait in the listen backlog
+    fds[0].fd = full ? -1 : listenFd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+}
+
+void MetricsEndpoint_Process(const struct pollfd * fds)
+{
+    int i;
+    for (i = 0; i < METRICS_ENDPOINT_MAX_CONNECTIONS; i++)
+    {
+        MetricsConnection * connection = &connections[i];
+        if ((connection->Fd != -1) && (fds[1 + i].fd == connection->Fd) && (fds[1 + i].revents != 0))
+        {
+            if (connection->Response == NULL)
+            {
+                Receive(connection);
+            }
+            if ((connection->Fd != -1) && (connection->Response != NULL))
+            {
+                Send(connection);
+            }
+        }
+    }
+
+    if ((fds[0].fd != -1) && (fds[0].revents & POLLIN))
+    {
+        Accept();
+    }
+}
+
+void MetricsEndpoint_Destroy(int sockfd)
+{
+    int i;
+    if (sockfd >= 0)
+    {
+        for (i = 0; i < METRICS_ENDPOINT_MAX_CONNECTIONS; i++)
+        {
+            if (connections[i].Fd != -1)
+            {
+                CloseConnection(&connections[i]);
+            }
+        }
+        close(sockfd);
+        listenFd = -1;
+    }
+}
@@ -0,0 +1,60 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+
+#ifndef LWM2M_METRICS_ENDPOINT_H
+#define LWM2M_METRICS_ENDPOINT_H
+
+#include <poll.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maximum number of scrapers served at once
+#define METRICS_ENDPOINT_MAX_CONNECTIONS (4)
+
+// Number of poll entries used by the endpoint - the listening socket and one per connection
+#define METRICS_ENDPOINT_POLL_FDS (1 + METRICS_ENDPOINT_MAX_CONNECTIONS)
+
+/* Serve the daemon's metrics in the Prometheus text format over HTTP, on the loopback interface.
+ * All sockets are non-blocking and are driven by the daemon's poll loop, so a slow scraper cannot hold up CoAP
+ * processing. Returns the listening socket, or -1 on error.
+ */
+int MetricsEndpoint_Init(int port);
+
+/* Fill in METRICS_ENDPOINT_POLL_FDS poll entries for the endpoint, closing connections that have not completed
+ * in time. Unused entries have a negative fd, which poll ignores.
+ */
+void MetricsEndpoint_SetPollFds(struct pollfd * fds);
+
+// Accept, read and write on the sockets that poll reported ready, given the entries filled in by MetricsEndpoint_SetPollFds
+void MetricsEndpoint_Process(const struct pollfd * fds);
+
+void MetricsEndpoint_Destroy(int sockfd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LWM2M_METRICS_ENDPOINT_H
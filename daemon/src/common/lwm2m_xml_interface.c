@@ -37,6 +37,7 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <inttypes.h>
+#include <sys/ioctl.h>
 
 #include "lwm2m_xml_interface.h"
 #include "lwm2m_types.h"
@@ -49,6 +50,7 @@
 #include "ipc_session.h"
 #include "../../api/src/ipc_defs.h"
 #include "lwm2m_core.h"
+#include "lwm2m_metrics.h"
 
 typedef struct
 {
@@ -60,6 +62,8 @@ typedef struct
 static struct ListHead handlerList;
 static void * g_context = NULL;
 
+static int xmlif_HandlerMetricsRequest(RequestInfoType * request, TreeNode content);
+
 
 int xmlif_AddRequestHandler(const char * msgType, XmlRequestHandler handler)
 {
@@ -140,6 +144,9 @@ int xmlif_init(void * context, int port)
     g_context = context;
     ListInit(&handlerList);
 
+    // Handlers common to all daemons
+    xmlif_AddRequestHandler(IPC_MESSAGE_SUB_TYPE_METRICS, xmlif_HandlerMetricsRequest);
+
     IPCSession_Init();
 
     return sockfd;
@@ -171,6 +178,13 @@ int xmlif_process(int sockfd)
 
     Lwm2m_Debug("Received %d bytes on IPC\n%s\n", numbytes, buf);
 
+    int queued = 0;
+    if (ioctl(sockfd, FIONREAD, &queued) == 0)
+    {
+        Metrics_Set(Metric_IpcReceiveQueueBytes, queued);
+    }
+    Metrics_Increment(Metric_IpcRequests);
+
     // assuming we received a full message, process it.
     root = TreeNode_ParseXML(buf, numbytes, true);
     if (root != NULL)
@@ -224,7 +238,9 @@ int xmlif_process(int sockfd)
                             }
                         }
 
+                        uint64_t start = Lwm2mCore_GetTickCountMs();
                         handler->Function(request, content);
+                        Metrics_Observe(Histogram_IpcRequestDuration, Lwm2mCore_GetTickCountMs() - start);
                         handled = true;
                         break;
                     }
@@ -261,6 +277,7 @@ int xmlif_process(int sockfd)
 
 error:
     Tree_Delete(root);
+    Metrics_Increment(Metric_IpcInvalidRequests);
 
     RequestInfoType * request = malloc(sizeof(RequestInfoType));
     if (request != NULL)
@@ -305,6 +322,61 @@ void xmlif_destroy(int sockfd)
     IPCSession_Shutdown();
 }
 
+/* Handle incoming Metrics requests.
+ * Respond with the current value of every counter and gauge, and the buckets of every histogram.
+ */
+static int xmlif_HandlerMetricsRequest(RequestInfoType * request, TreeNode content)
+{
+    TreeNode metricsNode = Xml_CreateNode("Metrics");
+    int metric, histogram, bucket;
+
+    for (metric = 0; metric < Metric_Count; metric++)
+    {
+        TreeNode metricNode = Xml_CreateNode("Metric");
+        TreeNode_AddChild(metricNode, Xml_CreateNodeWithValue("Name", "%s", Metrics_GetName(metric)));
+        if (Metrics_GetLabels(metric) != NULL)
+        {
+            TreeNode_AddChild(metricNode, Xml_CreateNodeWithValue("Labels", "%s", Metrics_GetLabels(metric)));
+        }
+        TreeNode_AddChild(metricNode, Xml_CreateNodeWithValue("Type", "%s", (Metrics_GetType(metric) == MetricType_Counter) ? "Counter" : "Gauge"));
+        TreeNode_AddChild(metricNode, Xml_CreateNodeWithValue("Value", "%" PRId64, Metrics_Get(metric)));
+        TreeNode_AddChild(metricsNode, metricNode);
+    }
+
+    for (histogram = 0; histogram < Histogram_Count; histogram++)
+    {
+        MetricsHistogram snapshot;
+        Metrics_GetHistogram(histogram, &snapshot);
+
+        TreeNode histogramNode = Xml_CreateNode("Histogram");
+        TreeNode_AddChild(histogramNode, Xml_CreateNodeWithValue("Name", "%s", Metrics_GetHistogramName(histogram)));
+        TreeNode_AddChild(histogramNode, Xml_CreateNodeWithValue("Count", "%" PRIu64, snapshot.Count));
+        TreeNode_AddChild(histogramNode, Xml_CreateNodeWithValue("SumMs", "%" PRIu64, snapshot.SumMs));
+        for (bucket = 0; bucket < METRICS_HISTOGRAM_NUM_BUCKETS; bucket++)
+        {
+            TreeNode bucketNode = Xml_CreateNode("Bucket");
+            if (bucket < METRICS_HISTOGRAM_NUM_BUCKETS - 1)
+            {
+                TreeNode_AddChild(bucketNode, Xml_CreateNodeWithValue("UpperBoundMs", "%" PRIu32, Metrics_GetHistogramBound(bucket)));
+            }
+            TreeNode_AddChild(bucketNode, Xml_CreateNodeWithValue("Count", "%" PRIu64, snapshot.Buckets[bucket]));
+            TreeNode_AddChild(histogramNode, bucketNode);
+        }
+        TreeNode_AddChild(metricsNode, histogramNode);
+    }
+
+    TreeNode contentNode = Xml_CreateNode("Content");
+    TreeNode_AddChild(contentNode, metricsNode);
+
+    TreeNode response = IPC_NewResponseNode(IPC_MESSAGE_SUB_TYPE_METRICS, AwaResult_Success, request->SessionID);
+    TreeNode_AddChild(response, contentNode);
+    IPC_SendResponse(response, request->Sockfd, &request->FromAddr, request->AddrLen);
+    Tree_Delete(response);
+
+    free(request);
+    return 0;
+}
+
 TreeNode xmlif_GenerateConnectResponse(DefinitionRegistry * definitionRegistry, IPCSessionID sessionID)
 {
     ObjectDefinition * objFormat = 0;
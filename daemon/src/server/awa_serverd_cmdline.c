@@ -45,6 +45,16 @@ const char *gengetopt_args_info_help[] = {
   "  -d, --daemonize         Detach process from terminal and run in the\n                            background  (default=off)",
   "  -v, --verbose           Generate verbose output  (default=off)",
   "  -l, --logFile=FILE      Log output to FILE",
+  "  -r, --stateFile=FILE    Save client registrations to FILE and restore them at\n                            startup",
+  "  -R, --regRate=RATE      Admit at most RATE registration and update requests\n                            per second, 0 for no limit  (default=`0')",
+  "  -B, --regBurst=COUNT    Admit bursts of up to COUNT registration and update\n                            requests, 0 to use RATE  (default=`0')",
+  "  -Q, --regBacklog=COUNT  Give up to COUNT clients over the rate limit a\n                            reserved retry slot  (default=`1000')",
+  "  -M, --metricsPort=PORT  Serve Prometheus metrics over HTTP on local port PORT",
+  "  -t, --tcp               Also accept CoAP over TCP (RFC 8323) connections on\n                            PORT  (default=off)",
+  "      --dtlsSessions=COUNT\n                          Keep at most COUNT DTLS sessions, evicting the\n                            least recently used  (default=`1024')",
+  "      --dtlsIdleTimeout=SECONDS\n                          Evict DTLS sessions idle for more than SECONDS, 0\n                            to keep them  (default=`0')",
+  "      --dtlsWorkers=COUNT Process DTLS handshakes on COUNT worker threads, 0\n                            to process them in the main loop  (default=`0')",
+  "      --pskFile=FILE      Authenticate DTLS clients by the PSK identities and\n                            keys in FILE, reloaded on SIGHUP",
   "  -V, --version           Print version and exit  (default=off)",
   "\nExample:\n    awa_serverd --interface eth0 --addressFamily 4 --port 5683\n\n",
     0
@@ -89,6 +99,16 @@ void clear_given (struct gengetopt_args_info *args_info)
   args_info->daemonize_given = 0 ;
   args_info->verbose_given = 0 ;
   args_info->logFile_given = 0 ;
+  args_info->stateFile_given = 0 ;
+  args_info->regRate_given = 0 ;
+  args_info->regBurst_given = 0 ;
+  args_info->regBacklog_given = 0 ;
+  args_info->metricsPort_given = 0 ;
+  args_info->tcp_given = 0 ;
+  args_info->dtlsSessions_given = 0 ;
+  args_info->dtlsIdleTimeout_given = 0 ;
+  args_info->dtlsWorkers_given = 0 ;
+  args_info->pskFile_given = 0 ;
   args_info->version_given = 0 ;
 }
 
@@ -115,6 +135,25 @@ void clear_args (struct gengetopt_args_info *args_info)
   args_info->verbose_flag = 0;
   args_info->logFile_arg = NULL;
   args_info->logFile_orig = NULL;
+  args_info->stateFile_arg = NULL;
+  args_info->stateFile_orig = NULL;
+  args_info->regRate_arg = 0;
+  args_info->regRate_orig = NULL;
+  args_info->regBurst_arg = 0;
+  args_info->regBurst_orig = NULL;
+  args_info->regBacklog_arg = 1000;
+  args_info->regBacklog_orig = NULL;
+  args_info->metricsPort_arg;
+  args_info->metricsPort_orig = NULL;
+  args_info->tcp_flag = 0;
+  args_info->dtlsSessions_arg = 1024;
+  args_info->dtlsSessions_orig = NULL;
+  args_info->dtlsIdleTimeout_arg = 0;
+  args_info->dtlsIdleTimeout_orig = NULL;
+  args_info->dtlsWorkers_arg = 0;
+  args_info->dtlsWorkers_orig = NULL;
+  args_info->pskFile_arg = NULL;
+  args_info->pskFile_orig = NULL;
   args_info->version_flag = 0;
 
 }
@@ -138,7 +177,17 @@ void init_args_info(struct gengetopt_args_info *args_info)
   args_info->daemonize_help = gengetopt_args_info_help[9] ;
   args_info->verbose_help = gengetopt_args_info_help[10] ;
   args_info->logFile_help = gengetopt_args_info_help[11] ;
-  args_info->version_help = gengetopt_args_info_help[12] ;
+  args_info->stateFile_help = gengetopt_args_info_help[12] ;
+  args_info->regRate_help = gengetopt_args_info_help[13] ;
+  args_info->regBurst_help = gengetopt_args_info_help[14] ;
+  args_info->regBacklog_help = gengetopt_args_info_help[15] ;
+  args_info->metricsPort_help = gengetopt_args_info_help[16] ;
+  args_info->tcp_help = gengetopt_args_info_help[17] ;
+  args_info->dtlsSessions_help = gengetopt_args_info_help[18] ;
+  args_info->dtlsIdleTimeout_help = gengetopt_args_info_help[19] ;
+  args_info->dtlsWorkers_help = gengetopt_args_info_help[20] ;
+  args_info->pskFile_help = gengetopt_args_info_help[21] ;
+  args_info->version_help = gengetopt_args_info_help[22] ;
 
 }
 
@@ -281,6 +330,17 @@ cmdline_parser_release (struct gengetopt_args_info *args_info)
   free_multiple_string_field (args_info->objDefs_given, &(args_info->objDefs_arg), &(args_info->objDefs_orig));
   free_string_field (&(args_info->logFile_arg));
   free_string_field (&(args_info->logFile_orig));
+  free_string_field (&(args_info->stateFile_arg));
+  free_string_field (&(args_info->stateFile_orig));
+  free_string_field (&(args_info->regRate_orig));
+  free_string_field (&(args_info->regBurst_orig));
+  free_string_field (&(args_info->regBacklog_orig));
+  free_string_field (&(args_info->metricsPort_orig));
+  free_string_field (&(args_info->dtlsSessions_orig));
+  free_string_field (&(args_info->dtlsIdleTimeout_orig));
+  free_string_field (&(args_info->dtlsWorkers_orig));
+  free_string_field (&(args_info->pskFile_arg));
+  free_string_field (&(args_info->pskFile_orig));
 
 
   for (i = 0; i < args_info->inputs_num; ++i)
@@ -388,6 +448,26 @@ cmdline_parser_dump(FILE *outfile, struct gengetopt_args_info *args_info)
     write_into_file(outfile, "verbose", 0, 0 );
   if (args_info->logFile_given)
     write_into_file(outfile, "logFile", args_info->logFile_orig, 0);
+  if (args_info->stateFile_given)
+    write_into_file(outfile, "stateFile", args_info->stateFile_orig, 0);
+  if (args_info->regRate_given)
+    write_into_file(outfile, "regRate", args_info->regRate_orig, 0);
+  if (args_info->regBurst_given)
+    write_into_file(outfile, "regBurst", args_info->regBurst_orig, 0);
+  if (args_info->regBacklog_given)
+    write_into_file(outfile, "regBacklog", args_info->regBacklog_orig, 0);
+  if (args_info->metricsPort_given)
+    write_into_file(outfile, "metricsPort", args_info->metricsPort_orig, 0);
+  if (args_info->tcp_given)
+    write_into_file(outfile, "tcp", 0, 0 );
+  if (args_info->dtlsSessions_given)
+    write_into_file(outfile, "dtlsSessions", args_info->dtlsSessions_orig, 0);
+  if (args_info->dtlsIdleTimeout_given)
+    write_into_file(outfile, "dtlsIdleTimeout", args_info->dtlsIdleTimeout_orig, 0);
+  if (args_info->dtlsWorkers_given)
+    write_into_file(outfile, "dtlsWorkers", args_info->dtlsWorkers_orig, 0);
+  if (args_info->pskFile_given)
+    write_into_file(outfile, "pskFile", args_info->pskFile_orig, 0);
   if (args_info->version_given)
     write_into_file(outfile, "version", 0, 0 );
 
@@ -1556,6 +1636,16 @@ cmdline_parser_internal (
         { "daemonize",	0, NULL, 'd' },
         { "verbose",	0, NULL, 'v' },
         { "logFile",	1, NULL, 'l' },
+        { "stateFile",	1, NULL, 'r' },
+        { "regRate",	1, NULL, 'R' },
+        { "regBurst",	1, NULL, 'B' },
+        { "regBacklog",	1, NULL, 'Q' },
+        { "metricsPort",	1, NULL, 'M' },
+        { "tcp",	0, NULL, 't' },
+        { "dtlsSessions",	1, NULL, 0 },
+        { "dtlsIdleTimeout",	1, NULL, 0 },
+        { "dtlsWorkers",	1, NULL, 0 },
+        { "pskFile",	1, NULL, 0 },
         { "version",	0, NULL, 'V' },
         { 0,  0, 0, 0 }
       };
@@ -1565,7 +1655,7 @@ cmdline_parser_internal (
       custom_opterr = opterr;
       custom_optopt = optopt;
 
-      c = custom_getopt_long (argc, argv, "ha:e:f:p:i:m:so:dvl:V", long_options, &option_index);
+      c = custom_getopt_long (argc, argv, "ha:e:f:p:i:m:so:dvl:r:R:B:Q:M:tV", long_options, &option_index);
 
       optarg = custom_optarg;
       optind = custom_optind;
@@ -1703,6 +1793,76 @@ cmdline_parser_internal (
                          additional_error))
             goto failure;
 
+          break;
+        case 'r':	/* Save client registrations to FILE and restore them at startup.  */
+
+
+          if (update_arg( (void *)&(args_info->stateFile_arg),
+                         &(args_info->stateFile_orig), &(args_info->stateFile_given),
+                         &(local_args_info.stateFile_given), optarg, 0, 0, ARG_STRING,
+                         check_ambiguity, override, 0, 0,
+                         "stateFile", 'r',
+                         additional_error))
+            goto failure;
+
+          break;
+        case 'R':	/* Admit at most RATE registration and update requests per second, 0 for no limit.  */
+
+
+          if (update_arg( (void *)&(args_info->regRate_arg),
+                         &(args_info->regRate_orig), &(args_info->regRate_given),
+                         &(local_args_info.regRate_given), optarg, 0, "0", ARG_INT,
+                         check_ambiguity, override, 0, 0,
+                         "regRate", 'R',
+                         additional_error))
+            goto failure;
+
+          break;
+        case 'B':	/* Admit bursts of up to COUNT registration and update requests, 0 to use RATE.  */
+
+
+          if (update_arg( (void *)&(args_info->regBurst_arg),
+                         &(args_info->regBurst_orig), &(args_info->regBurst_given),
+                         &(local_args_info.regBurst_given), optarg, 0, "0", ARG_INT,
+                         check_ambiguity, override, 0, 0,
+                         "regBurst", 'B',
+                         additional_error))
+            goto failure;
+
+          break;
+        case 'Q':	/* Give up to COUNT clients over the rate limit a reserved retry slot.  */
+
+
+          if (update_arg( (void *)&(args_info->regBacklog_arg),
+                         &(args_info->regBacklog_orig), &(args_info->regBacklog_given),
+                         &(local_args_info.regBacklog_given), optarg, 0, "1000", ARG_INT,
+                         check_ambiguity, override, 0, 0,
+                         "regBacklog", 'Q',
+                         additional_error))
+            goto failure;
+
+          break;
+        case 'M':	/* Serve Prometheus metrics over HTTP on local port PORT.  */
+
+
+          if (update_arg( (void *)&(args_info->metricsPort_arg),
+                         &(args_info->metricsPort_orig), &(args_info->metricsPort_given),
+                         &(local_args_info.metricsPort_given), optarg, 0, 0, ARG_INT,
+                         check_ambiguity, override, 0, 0,
+                         "metricsPort", 'M',
+                         additional_error))
+            goto failure;
+
+          break;
+        case 't':	/* Also accept CoAP over TCP (RFC 8323) connections on PORT.  */
+
+
+          if (update_arg((void *)&(args_info->tcp_flag), 0, &(args_info->tcp_given),
+                         &(local_args_info.tcp_given), optarg, 0, 0, ARG_FLAG,
+                         check_ambiguity, override, 1, 0, "tcp", 't',
+                         additional_error))
+            goto failure;
+
           break;
         case 'V':	/* Print version and exit.  */
 
@@ -1716,6 +1876,64 @@ cmdline_parser_internal (
           break;
 
         case 0:	/* Long option with no short option */
+          /* Keep at most COUNT DTLS sessions, evicting the least recently used.  */
+          if (strcmp (long_options[option_index].name, "dtlsSessions") == 0)
+          {
+
+
+            if (update_arg( (void *)&(args_info->dtlsSessions_arg),
+                           &(args_info->dtlsSessions_orig), &(args_info->dtlsSessions_given),
+                           &(local_args_info.dtlsSessions_given), optarg, 0, "1024", ARG_INT,
+                           check_ambiguity, override, 0, 0,
+                           "dtlsSessions", '-',
+                           additional_error))
+              goto failure;
+
+          }
+          /* Evict DTLS sessions idle for more than SECONDS, 0 to keep them.  */
+          else if (strcmp (long_options[option_index].name, "dtlsIdleTimeout") == 0)
+          {
+
+
+            if (update_arg( (void *)&(args_info->dtlsIdleTimeout_arg),
+                           &(args_info->dtlsIdleTimeout_orig), &(args_info->dtlsIdleTimeout_given),
+                           &(local_args_info.dtlsIdleTimeout_given), optarg, 0, "0", ARG_INT,
+                           check_ambiguity, override, 0, 0,
+                           "dtlsIdleTimeout", '-',
+                           additional_error))
+              goto failure;
+
+          }
+          /* Process DTLS handshakes on COUNT worker threads, 0 to process them in the main loop.  */
+          else if (strcmp (long_options[option_index].name, "dtlsWorkers") == 0)
+          {
+
+
+            if (update_arg( (void *)&(args_info->dtlsWorkers_arg),
+                           &(args_info->dtlsWorkers_orig), &(args_info->dtlsWorkers_given),
+                           &(local_args_info.dtlsWorkers_given), optarg, 0, "0", ARG_INT,
+                           check_ambiguity, override, 0, 0,
+                           "dtlsWorkers", '-',
+                           additional_error))
+              goto failure;
+
+          }
+          /* Authenticate DTLS clients by the PSK identities and keys in FILE, reloaded on SIGHUP.  */
+          else if (strcmp (long_options[option_index].name, "pskFile") == 0)
+          {
+
+
+            if (update_arg( (void *)&(args_info->pskFile_arg),
+                           &(args_info->pskFile_orig), &(args_info->pskFile_given),
+                           &(local_args_info.pskFile_given), optarg, 0, 0, ARG_STRING,
+                           check_ambiguity, override, 0, 0,
+                           "pskFile", '-',
+                           additional_error))
+              goto failure;
+
+          }
+
+          break;
         case '?':	/* Invalid option.  */
           /* `getopt_long' already printed an error message.  */
           goto failure;
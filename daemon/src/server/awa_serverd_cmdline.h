@@ -70,6 +70,35 @@ struct gengetopt_args_info
   char * logFile_arg;	/**< @brief Log output to FILE.  */
   char * logFile_orig;	/**< @brief Log output to FILE original value given at command line.  */
   const char *logFile_help; /**< @brief Log output to FILE help description.  */
+  char * stateFile_arg;	/**< @brief Save client registrations to FILE and restore them at startup.  */
+  char * stateFile_orig;	/**< @brief Save client registrations to FILE and restore them at startup original value given at command line.  */
+  const char *stateFile_help; /**< @brief Save client registrations to FILE and restore them at startup help description.  */
+  int regRate_arg;	/**< @brief Admit at most RATE registration and update requests per second, 0 for no limit (default='0').  */
+  char * regRate_orig;	/**< @brief Admit at most RATE registration and update requests per second, 0 for no limit original value given at command line.  */
+  const char *regRate_help; /**< @brief Admit at most RATE registration and update requests per second, 0 for no limit help description.  */
+  int regBurst_arg;	/**< @brief Admit bursts of up to COUNT registration and update requests, 0 to use RATE (default='0').  */
+  char * regBurst_orig;	/**< @brief Admit bursts of up to COUNT registration and update requests, 0 to use RATE original value given at command line.  */
+  const char *regBurst_help; /**< @brief Admit bursts of up to COUNT registration and update requests, 0 to use RATE help description.  */
+  int regBacklog_arg;	/**< @brief Give up to COUNT clients over the rate limit a reserved retry slot (default='1000').  */
+  char * regBacklog_orig;	/**< @brief Give up to COUNT clients over the rate limit a reserved retry slot original value given at command line.  */
+  const char *regBacklog_help; /**< @brief Give up to COUNT clients over the rate limit a reserved retry slot help description.  */
+  int metricsPort_arg;	/**< @brief Serve Prometheus metrics over HTTP on local port PORT.  */
+  char * metricsPort_orig;	/**< @brief Serve Prometheus metrics over HTTP on local port PORT original value given at command line.  */
+  const char *metricsPort_help; /**< @brief Serve Prometheus metrics over HTTP on local port PORT help description.  */
+  int tcp_flag;	/**< @brief Also accept CoAP over TCP (RFC 8323) connections on PORT (default=off).  */
+  const char *tcp_help; /**< @brief Also accept CoAP over TCP (RFC 8323) connections on PORT help description.  */
+  int dtlsSessions_arg;	/**< @brief Keep at most COUNT DTLS sessions, evicting the least recently used (default='1024').  */
+  char * dtlsSessions_orig;	/**< @brief Keep at most COUNT DTLS sessions, evicting the least recently used original value given at command line.  */
+  const char *dtlsSessions_help; /**< @brief Keep at most COUNT DTLS sessions, evicting the least recently used help description.  */
+  int dtlsIdleTimeout_arg;	/**< @brief Evict DTLS sessions idle for more than SECONDS, 0 to keep them (default='0').  */
+  char * dtlsIdleTimeout_orig;	/**< @brief Evict DTLS sessions idle for more than SECONDS, 0 to keep them original value given at command line.  */
+  const char *dtlsIdleTimeout_help; /**< @brief Evict DTLS sessions idle for more than SECONDS, 0 to keep them help description.  */
+  int dtlsWorkers_arg;	/**< @brief Process DTLS handshakes on COUNT worker threads, 0 to process them in the main loop (default='0').  */
+  char * dtlsWorkers_orig;	/**< @brief Process DTLS handshakes on COUNT worker threads, 0 to process them in the main loop original value given at command line.  */
+  const char *dtlsWorkers_help; /**< @brief Process DTLS handshakes on COUNT worker threads, 0 to process them in the main loop help description.  */
+  char * pskFile_arg;	/**< @brief Authenticate DTLS clients by the PSK identities and keys in FILE, reloaded on SIGHUP.  */
+  char * pskFile_orig;	/**< @brief Authenticate DTLS clients by the PSK identities and keys in FILE, reloaded on SIGHUP original value given at command line.  */
+  const char *pskFile_help; /**< @brief Authenticate DTLS clients by the PSK identities and keys in FILE, reloaded on SIGHUP help description.  */
   int version_flag;	/**< @brief Print version and exit (default=off).  */
   const char *version_help; /**< @brief Print version and exit help description.  */
 
@@ -85,6 +114,16 @@ struct gengetopt_args_info
   unsigned int daemonize_given ;	/**< @brief Whether daemonize was given.  */
   unsigned int verbose_given ;	/**< @brief Whether verbose was given.  */
   unsigned int logFile_given ;	/**< @brief Whether logFile was given.  */
+  unsigned int stateFile_given ;	/**< @brief Whether stateFile was given.  */
+  unsigned int regRate_given ;	/**< @brief Whether regRate was given.  */
+  unsigned int regBurst_given ;	/**< @brief Whether regBurst was given.  */
+  unsigned int regBacklog_given ;	/**< @brief Whether regBacklog was given.  */
+  unsigned int metricsPort_given ;	/**< @brief Whether metricsPort was given.  */
+  unsigned int tcp_given ;	/**< @brief Whether tcp was given.  */
+  unsigned int dtlsSessions_given ;	/**< @brief Whether dtlsSessions was given.  */
+  unsigned int dtlsIdleTimeout_given ;	/**< @brief Whether dtlsIdleTimeout was given.  */
+  unsigned int dtlsWorkers_given ;	/**< @brief Whether dtlsWorkers was given.  */
+  unsigned int pskFile_given ;	/**< @brief Whether pskFile was given.  */
   unsigned int version_given ;	/**< @brief Whether version was given.  */
 
   char **inputs ; /**< @brief unamed options (options without names) */
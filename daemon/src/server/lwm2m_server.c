@@ -52,6 +52,8 @@
 #include "lwm2m_core.h"
 #include "lwm2m_server_cert.h"
 #include "lwm2m_server_psk.h"
+#include "server/lwm2m_registration.h"
+#include "lwm2m_metrics_endpoint.h"
 
 #define DEFAULT_IP_ADDRESS "0.0.0.0"
 #define MAX_OBJDEFS_FILES  (16)
@@ -70,12 +72,23 @@ typedef struct
     bool Daemonise;
     bool Verbose;
     char * LogFile;
+    char * StateFile;
+    int RegistrationRate;
+    int RegistrationBurst;
+    int RegistrationBacklog;
+    int MetricsPort;
+    bool TCP;
+    int DtlsSessions;
+    int DtlsIdleTimeout;
+    int DtlsWorkers;
+    char * PskFile;
     bool Version;
 } Options;
 
 static FILE * logFile = NULL;
 static const char * version = VERSION;  // from Makefile
 static volatile int quit = 0;
+static volatile int reloadKeyStore = 0;
 
 static void PrintOptions(const Options * options);
 
@@ -84,6 +97,11 @@ static void Lwm2m_CtrlCSignalHandler(int dummy)
     quit = 1;
 }
 
+static void Lwm2m_HangupSignalHandler(int dummy)
+{
+    reloadKeyStore = 1;
+}
+
 // Fork off a daemon process, the parent will exit at this point
 static void Daemonise(bool verbose)
 {
@@ -122,7 +140,8 @@ static void Daemonise(bool verbose)
 
 static int Lwm2mServer_Start(Options * options)
 {
-    int xmlFd;
+    int xmlFd = -1;
+    int metricsFd = -1;
     int result = 0;
 
     if (options->Daemonise)
@@ -135,6 +154,7 @@ static int Lwm2mServer_Start(Options * options)
     }
 
     signal(SIGTERM, Lwm2m_CtrlCSignalHandler);
+    signal(SIGHUP, Lwm2m_HangupSignalHandler);
 
     // open log files here
     if (options->LogFile != NULL)
@@ -201,7 +221,7 @@ static int Lwm2mServer_Start(Options * options)
 
     srandom((int)time(NULL)*getpid());
 
-    CoapInfo * coap = coap_Init(ipAddress, options->CoapPort, options->Secure, (options->Verbose) ? DebugLevel_Debug : DebugLevel_Info);
+    CoapInfo * coap = coap_Init(ipAddress, options->CoapPort, options->Secure, options->TCP, (options->Verbose) ? DebugLevel_Debug : DebugLevel_Info);
     if (coap == NULL)
     {
         printf("Unable to map address to network interface\n");
@@ -211,8 +231,17 @@ static int Lwm2mServer_Start(Options * options)
 
     if (options->Secure)
     {
+        DTLS_SetSessionLimits(options->DtlsSessions, options->DtlsIdleTimeout);
+        DTLS_SetHandshakeWorkers(options->DtlsWorkers);
     	coap_SetCertificate(serverCert, sizeof(serverCert), AwaCertificateFormat_PEM);
         coap_SetPSK(pskIdentity, pskKey, sizeof(pskKey));
+
+        if ((options->PskFile != NULL) && !DTLS_LoadKeyStore(options->PskFile))
+        {
+            Lwm2m_Error("Failed to load PSK file %s\n", options->PskFile);
+            result = 1;
+            goto error_coap;
+        }
     }
 
     Lwm2mContextType * context = Lwm2mCore_Init(NULL, options->ContentType);  // NULL, don't map coap with objectStore
@@ -223,7 +252,24 @@ static int Lwm2mServer_Start(Options * options)
     // load any specified objDef files
     if (LoadObjectDefinitionsFromFiles(context, options->ObjDefsFiles, options->NumObjDefsFiles) != 0)
     {
-        goto error_close_log;
+        goto error_destroy;
+    }
+
+    // restore client registrations saved by a previous instance
+    if (options->StateFile != NULL)
+    {
+        if (Lwm2m_RegistrationOpenStore(context, options->StateFile) < 0)
+        {
+            Lwm2m_Error("Failed to open state file %s\n", options->StateFile);
+            result = 1;
+            goto error_destroy;
+        }
+    }
+
+    if (Lwm2m_RegistrationSetAdmissionControl(context, options->RegistrationRate, options->RegistrationBurst, options->RegistrationBacklog) != 0)
+    {
+        result = 1;
+        goto error_destroy;
     }
 
     // listen for UDP packets on IPC port
@@ -235,22 +281,59 @@ static int Lwm2mServer_Start(Options * options)
     }
     xmlif_RegisterHandlers();
 
+    if (options->MetricsPort > 0)
+    {
+        metricsFd = MetricsEndpoint_Init(options->MetricsPort);
+        if (metricsFd < 0)
+        {
+            result = 1;
+            goto error_destroy;
+        }
+    }
+
     // wait for messages on both the IPC and CoAP interfaces
     while (!quit)
     {
         int loop_result;
-        struct pollfd fds[2];
-        int nfds = 2;
+        struct pollfd fds[3 + METRICS_ENDPOINT_POLL_FDS];
+        int nfds = 3;
         int timeout;
 
+        if (reloadKeyStore)
+        {
+            reloadKeyStore = 0;
+            if (options->Secure && (options->PskFile != NULL))
+            {
+                // on failure the previously loaded keys stay in use
+                Lwm2m_Info("Reloading PSK file %s\n", options->PskFile);
+                DTLS_LoadKeyStore(options->PskFile);
+            }
+        }
+
         fds[0].fd = coap->fd;
         fds[0].events = POLLIN;
 
         fds[1].fd = xmlFd;
         fds[1].events = POLLIN;
 
+        fds[2].fd = DTLS_GetHandshakeFileDescriptor();  // ignored by poll if handshakes are not on workers
+        fds[2].events = POLLIN;
+
+        if (metricsFd >= 0)
+        {
+            MetricsEndpoint_SetPollFds(&fds[3]);
+            nfds += METRICS_ENDPOINT_POLL_FDS;
+        }
+
         timeout = Lwm2mCore_Process(context);
 
+        // wake up in time for the next CoAP retransmission
+        int coapTimeout = coap_Process();
+        if ((coapTimeout >= 0) && (coapTimeout < timeout))
+        {
+            timeout = coapTimeout;
+        }
+
         loop_result = poll(fds, nfds, timeout);
 
         if (loop_result < 0)
@@ -272,15 +355,26 @@ static int Lwm2mServer_Start(Options * options)
             {
                 xmlif_process(fds[1].fd);
             }
+            if (fds[2].revents == POLLIN)
+            {
+                DTLS_CompleteHandshakes();
+            }
+            if (metricsFd >= 0)
+            {
+                MetricsEndpoint_Process(&fds[3]);
+            }
         }
-        coap_Process();
     }
     Lwm2m_Debug("Exit triggered\n");
 
 error_destroy:
+    MetricsEndpoint_Destroy(metricsFd);
     xmlif_destroy(xmlFd);
     Lwm2mCore_Destroy(context);
+
+error_coap:
     coap_Destroy();
+    DTLS_LoadKeyStore(NULL);
 
 error_close_log:
     Lwm2m_Info("Server exiting\n");
@@ -310,6 +404,16 @@ static void PrintOptions(const Options * options)
     printf("  Daemonize         (--daemonize)      : %d\n", options->Daemonise);
     printf("  Verbose           (--verbose)        : %d\n", options->Verbose);
     printf("  LogFile           (--logFile)        : %s\n", options->LogFile ? options->LogFile : "");
+    printf("  StateFile         (--stateFile)      : %s\n", options->StateFile ? options->StateFile : "");
+    printf("  RegRate           (--regRate)        : %d\n", options->RegistrationRate);
+    printf("  RegBurst          (--regBurst)       : %d\n", options->RegistrationBurst);
+    printf("  RegBacklog        (--regBacklog)     : %d\n", options->RegistrationBacklog);
+    printf("  MetricsPort       (--metricsPort)    : %d\n", options->MetricsPort);
+    printf("  TCP               (--tcp)            : %d\n", options->TCP);
+    printf("  DtlsSessions      (--dtlsSessions)   : %d\n", options->DtlsSessions);
+    printf("  DtlsIdleTimeout   (--dtlsIdleTimeout): %d\n", options->DtlsIdleTimeout);
+    printf("  DtlsWorkers       (--dtlsWorkers)    : %d\n", options->DtlsWorkers);
+    printf("  PskFile           (--pskFile)        : %s\n", options->PskFile ? options->PskFile : "");
     printf("  Version           (--version)        : %d\n", options->Version);
 }
 
@@ -334,6 +438,16 @@ static int ParseOptions(int argc, char ** argv, struct gengetopt_args_info * ai,
         options->Daemonise = ai->daemonize_flag;
         options->Verbose = ai->verbose_flag;
         options->LogFile = ai->logFile_arg;
+        options->StateFile = ai->stateFile_arg;
+        options->RegistrationRate = ai->regRate_arg;
+        options->RegistrationBurst = ai->regBurst_arg;
+        options->RegistrationBacklog = ai->regBacklog_arg;
+        options->MetricsPort = ai->metricsPort_given ? ai->metricsPort_arg : 0;
+        options->TCP = ai->tcp_flag;
+        options->DtlsSessions = ai->dtlsSessions_arg;
+        options->DtlsIdleTimeout = ai->dtlsIdleTimeout_arg;
+        options->DtlsWorkers = ai->dtlsWorkers_arg;
+        options->PskFile = ai->pskFile_arg;
         options->Version = ai->version_flag;
 
         if (options->Secure && strcmp(DTLS_LibraryName, "None") == 0)
@@ -341,6 +455,19 @@ static int ParseOptions(int argc, char ** argv, struct gengetopt_args_info * ai,
             printf("Error: not built with DTLS support\n\n");
             result = EXIT_FAILURE;
         }
+        // only the GnuTLS backend looks client identities up in the key store
+        else if (options->Secure && (options->PskFile != NULL) && strcmp(DTLS_LibraryName, "GnuTLS") != 0)
+        {
+            printf("Error: --pskFile is not supported with %s\n\n", DTLS_LibraryName);
+            result = EXIT_FAILURE;
+        }
+        // the other backends keep a fixed array of sessions and handshake in the main loop
+        else if (options->Secure && (ai->dtlsSessions_given || ai->dtlsIdleTimeout_given || ai->dtlsWorkers_given) &&
+                 strcmp(DTLS_LibraryName, "GnuTLS") != 0)
+        {
+            printf("Error: --dtlsSessions, --dtlsIdleTimeout and --dtlsWorkers are not supported with %s\n\n", DTLS_LibraryName);
+            result = EXIT_FAILURE;
+        }
     }
     else
     {
@@ -367,6 +494,16 @@ int main(int argc, char ** argv)
         .Daemonise = false,
         .Verbose = false,
         .LogFile = NULL,
+        .StateFile = NULL,
+        .RegistrationRate = 0,
+        .RegistrationBurst = 0,
+        .RegistrationBacklog = 0,
+        .MetricsPort = 0,
+        .TCP = false,
+        .DtlsSessions = 0,
+        .DtlsIdleTimeout = 0,
+        .DtlsWorkers = 0,
+        .PskFile = NULL,
         .Version = false,
     };
 
@@ -327,6 +327,11 @@ const char * xmlif_GetURIForClient(Lwm2mClientType * client, ObjectInstanceResou
         *path = 's';
         path++;
     }
+    if (client->Address.Reliable)
+    {
+        memcpy(path, "+tcp", 4);
+        path += 4;
+    }
 
     if (key->ResourceID != -1)
     {
@@ -0,0 +1,1125 @@
+/************************************************************************************************************************
+ Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+        following disclaimer.
+     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+        following disclaimer in the documentation and/or other materials provided with the distribution.
+     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+        products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************************************************/
+
+
+// Simulate a large number of LWM2M clients to load test an LWM2M server
+//
+//  Usage: awa-loadgen [OPTIONS]...
+//
+//    -h, --help               Print help and exit
+//    -V, --version            Print version and exit
+//    -v, --verbose            Increase program verbosity  (default=off)
+//    -d, --debug              Increase program verbosity  (default=off)
+//    -q, --quiet              Decrease program verbosity  (default=off)
+//    -a, --address=ADDRESS    LWM2M server address  (default=`127.0.0.1')
+//    -p, --port=PORT          LWM2M server CoAP port  (default=`5683')
+//    -c, --clients=COUNT      Number of clients to simulate  (default=`1000')
+//    -e, --namePrefix=PREFIX  Client endpoint name prefix  (default=`loadgen')
+//    -r, --registerRate=RATE  Registrations per second  (default=`100')
+//    -u, --updateRate=RATE    Registration updates per second  (default=`0')
+//    -n, --notifyRate=RATE    Notifications per second for observed resources
+//                             (default=`0')
+//    -l, --lifetime=SECONDS   Registration lifetime  (default=`300')
+//    -t, --duration=SECONDS   Run for SECONDS after starting  (default=`60')
+//    -T, --timeout=MS         Initial CoAP acknowledgement timeout
+//                             (default=`2000')
+//    -D, --deregister         Deregister clients before exiting  (default=off)
+//
+// Each simulated client has its own UDP socket, so the server sees every client at a different address. Messages are
+// built and parsed with the Erbium CoAP codec used by the daemons. Clients register at the requested rate, refresh their
+// registration before it expires, answer requests from the server and send notifications for resources the server
+// observes. Confirmable requests are retransmitted as described in RFC 7252, and clients told to retry later with
+// 5.03 Service Unavailable wait for the Max-Age given by the server.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "er-coap.h"
+#include "awa-loadgen_cmdline.h"
+#include "tools_common.h"
+
+#define MAX_EPOLL_EVENTS            (256)
+#define MAX_RETRANSMIT              (4)          // RFC 7252 section 4.8
+#define ACK_RANDOM_FACTOR_PERCENT   (150)
+#define RETRANSMIT_CHECK_INTERVAL   (10000)      // microseconds
+#define REFRESH_CHECK_INTERVAL      (1000000)    // microseconds
+#define MAX_LOCATION_LENGTH         (32)
+#define MAX_PATH_LENGTH             (32)
+#define MAX_NAME_LENGTH             (64)
+#define REGISTER_PAYLOAD            "</1/0>,</3/0>"
+
+#define CONTENT_TYPE_PLAIN_TEXT     (0)
+#define CONTENT_TYPE_LINK_FORMAT    (40)
+#define CONTENT_TYPE_TLV            (1542)
+
+// Latency histogram: 32 linear sub-buckets per power of two microseconds, giving about 3% resolution
+#define LATENCY_SUB_BUCKET_BITS     (5)
+#define LATENCY_SUB_BUCKETS         (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_NUM_BUCKETS         ((32 - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+typedef enum
+{
+    ClientState_Unregistered,
+    ClientState_Registering,
+    ClientState_Registered,
+    ClientState_Updating,
+    ClientState_Deregistering,
+    ClientState_Deregistered,
+
+} ClientState;
+
+typedef enum
+{
+    Operation_Register,
+    Operation_Update,
+    Operation_Deregister,
+    Operation_Count
+
+} Operation;
+
+typedef enum
+{
+    ServerRequest_Read,
+    ServerRequest_Observe,
+    ServerRequest_CancelObserve,
+    ServerRequest_Write,
+    ServerRequest_Execute,
+    ServerRequest_Create,
+    ServerRequest_Delete,
+    ServerRequest_Count
+
+} ServerRequest;
+
+typedef struct
+{
+    uint64_t Sent;
+    uint64_t Succeeded;
+    uint64_t Failed;
+    uint64_t TimedOut;
+    uint64_t Retransmitted;
+    uint64_t Latency[LATENCY_NUM_BUCKETS];
+    uint32_t MaxLatency;
+
+} OperationStatistics;
+
+typedef struct
+{
+    int Socket;
+    ClientState State;
+    char Location[MAX_LOCATION_LENGTH];     // registration location returned by the server, e.g. "rd/12"
+    uint16_t NextMessageID;
+
+    // outstanding confirmable request
+    Operation PendingOperation;
+    uint16_t PendingMessageID;
+    uint64_t RequestSentTime;
+    uint64_t RetransmitTime;
+    uint32_t RetransmitTimeout;
+    int RetransmitCount;
+
+    uint64_t RefreshTime;                   // time to update the registration before it expires
+    uint64_t RetryTime;                     // earliest time to retry after the server asked the client to back off
+    bool Queued;                            // waiting in the registration queue
+
+    // a single observation per client is enough to generate notification load
+    bool Observed;
+    uint8_t ObserveToken[COAP_TOKEN_LEN];
+    uint8_t ObserveTokenLength;
+    char ObservePath[MAX_PATH_LENGTH];
+    uint32_t ObserveSequence;
+    unsigned int ObserveContentType;
+
+} SimulatedClient;
+
+typedef struct
+{
+    SimulatedClient * Clients;
+    int NumClients;
+    const char * NamePrefix;
+    int Lifetime;
+    uint32_t AckTimeout;                    // microseconds
+    struct sockaddr_storage ServerAddress;
+    socklen_t ServerAddressLength;
+
+    // registration queue, a ring of client indexes
+    int * Queue;
+    int QueueHead;
+    int QueueLength;
+
+    int UpdateCursor;
+    int NotifyCursor;
+    int DeregisterCursor;
+    int Registered;
+    int Pending;
+
+    OperationStatistics Operations[Operation_Count];
+    uint64_t ServerRequests[ServerRequest_Count];
+    uint64_t Notifications;
+    uint64_t ReceiveErrors;
+
+} Simulation;
+
+static const char * operationNames[Operation_Count] =
+{
+    [Operation_Register]   = "Register",
+    [Operation_Update]     = "Update",
+    [Operation_Deregister] = "Deregister",
+};
+
+static const char * serverRequestNames[ServerRequest_Count] =
+{
+    [ServerRequest_Read]          = "Read",
+    [ServerRequest_Observe]       = "Observe",
+    [ServerRequest_CancelObserve] = "Cancel Observe",
+    [ServerRequest_Write]         = "Write",
+    [ServerRequest_Execute]       = "Execute",
+    [ServerRequest_Create]        = "Create",
+    [ServerRequest_Delete]        = "Delete",
+};
+
+static uint64_t GetTimeUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int LatencyToBucket(uint32_t latency)
+{
+    if (latency < LATENCY_SUB_BUCKETS)
+    {
+        return latency;
+    }
+    int msb = 31 - __builtin_clz(latency);
+    int shift = msb - LATENCY_SUB_BUCKET_BITS;
+    return (shift + 1) * LATENCY_SUB_BUCKETS + (int)((latency >> shift) - LATENCY_SUB_BUCKETS);
+}
+
+// Return the midpoint of the range of latencies recorded in a bucket
+static double BucketToLatency(int bucket)
+{
+    if (bucket < LATENCY_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    uint64_t lower = (uint64_t)(LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << shift;
+    return lower + ((1ULL << shift) - 1) / 2.0;
+}
+
+static void RecordLatency(OperationStatistics * statistics, uint64_t latency)
+{
+    uint32_t value = (latency > UINT32_MAX) ? UINT32_MAX : (uint32_t)latency;
+    statistics->Latency[LatencyToBucket(value)]++;
+    if (value > statistics->MaxLatency)
+    {
+        statistics->MaxLatency = value;
+    }
+}
+
+// Return the latency in milliseconds below which the given fraction of recorded latencies fall
+static double GetLatencyPercentile(const OperationStatistics * statistics, double fraction)
+{
+    uint64_t count = 0;
+    int bucket;
+    for (bucket = 0; bucket < LATENCY_NUM_BUCKETS; bucket++)
+    {
+        count += statistics->Latency[bucket];
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(fraction * count + 0.5);
+    uint64_t cumulative = 0;
+    for (bucket = 0; bucket < LATENCY_NUM_BUCKETS; bucket++)
+    {
+        cumulative += statistics->Latency[bucket];
+        if ((cumulative >= rank) && (cumulative > 0))
+        {
+            break;
+        }
+    }
+    return BucketToLatency(bucket < LATENCY_NUM_BUCKETS ? bucket : LATENCY_NUM_BUCKETS - 1) / 1000.0;
+}
+
+static bool ResolveServerAddress(Simulation * simulation, const char * address, int port)
+{
+    struct addrinfo hints = { 0 };
+    struct addrinfo * result = NULL;
+    char service[16];
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    snprintf(service, sizeof(service), "%d", port);
+
+    int error = getaddrinfo(address, service, &hints, &result);
+    if (error != 0)
+    {
+        Error("Failed to resolve %s: %s\n", address, gai_strerror(error));
+        return false;
+    }
+    memcpy(&simulation->ServerAddress, result->ai_addr, result->ai_addrlen);
+    simulation->ServerAddressLength = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+// Each client needs a socket, so make sure the open file limit allows for all of them
+static bool RaiseFileLimit(int numClients)
+{
+    struct rlimit limit;
+    rlim_t required = numClients + 64;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+    {
+        return false;
+    }
+    if (limit.rlim_cur < required)
+    {
+        limit.rlim_cur = (limit.rlim_max < required) ? limit.rlim_max : required;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur < required)
+    {
+        Error("Open file limit %lu is too low for %d clients - raise it with ulimit -n\n", (unsigned long)limit.rlim_cur, numClients);
+        return false;
+    }
+    return true;
+}
+
+static void GetEndPointName(const Simulation * simulation, int index, char * name, size_t nameLength)
+{
+    snprintf(name, nameLength, "%s%d", simulation->NamePrefix, index);
+}
+
+static void QueueRegistration(Simulation * simulation, int index)
+{
+    SimulatedClient * client = &simulation->Clients[index];
+    if (!client->Queued)
+    {
+        simulation->Queue[(simulation->QueueHead + simulation->QueueLength) % simulation->NumClients] = index;
+        simulation->QueueLength++;
+        client->Queued = true;
+    }
+}
+
+static void SendPacket(SimulatedClient * client, coap_packet_t * packet)
+{
+    uint8_t buffer[COAP_MAX_PACKET_SIZE];
+    size_t length = coap_serialize_message(packet, buffer);
+    if ((length > 0) && (send(client->Socket, buffer, length, 0) < 0))
+    {
+        Debug("send failed: %s\n", strerror(errno));
+    }
+}
+
+// Build and send the outstanding request. Retransmissions reuse the message ID, so the server can detect duplicates.
+static void SendRequest(Simulation * simulation, int index)
+{
+    SimulatedClient * client = &simulation->Clients[index];
+    coap_packet_t request;
+    char path[MAX_LOCATION_LENGTH + 1];
+    char query[MAX_NAME_LENGTH + 32];
+    uint8_t token[2] = { client->PendingMessageID >> 8, client->PendingMessageID & 0xff };
+
+    switch (client->PendingOperation)
+    {
+        case Operation_Register:
+        {
+            char name[MAX_NAME_LENGTH];
+            GetEndPointName(simulation, index, name, sizeof(name));
+            coap_init_message(&request, COAP_TYPE_CON, COAP_POST, client->PendingMessageID);
+            coap_set_header_uri_path(&request, "rd");
+            snprintf(query, sizeof(query), "ep=%s&lt=%d&b=U", name, simulation->Lifetime);
+            coap_set_header_uri_query(&request, query);
+            coap_set_header_content_format(&request, CONTENT_TYPE_LINK_FORMAT);
+            coap_set_payload(&request, REGISTER_PAYLOAD, strlen(REGISTER_PAYLOAD));
+            break;
+        }
+        case Operation_Update:
+            coap_init_message(&request, COAP_TYPE_CON, COAP_POST, client->PendingMessageID);
+            snprintf(path, sizeof(path), "%s", client->Location);
+            coap_set_header_uri_path(&request, path);
+            snprintf(query, sizeof(query), "lt=%d", simulation->Lifetime);
+            coap_set_header_uri_query(&request, query);
+            break;
+
+        case Operation_Deregister:
+            coap_init_message(&request, COAP_TYPE_CON, COAP_DELETE, client->PendingMessageID);
+            snprintf(path, sizeof(path), "%s", client->Location);
+            coap_set_header_uri_path(&request, path);
+            break;
+
+        default:
+            return;
+    }
+    coap_set_token(&request, token, sizeof(token));
+    SendPacket(client, &request);
+}
+
+static void StartRequest(Simulation * simulation, int index, Operation operation, uint64_t now)
+{
+    SimulatedClient * client = &simulation->Clients[index];
+
+    client->PendingOperation = operation;
+    client->PendingMessageID = client->NextMessageID++;
+    client->RequestSentTime = now;
+    client->RetransmitCount = 0;
+    client->RetransmitTimeout = simulation->AckTimeout + (uint32_t)((uint64_t)simulation->AckTimeout *
+                                (rand() % (ACK_RANDOM_FACTOR_PERCENT - 100 + 1)) / 100);
+    client->RetransmitTime = now + client->RetransmitTimeout;
+
+    switch (operation)
+    {
+        case Operation_Register:   client->State = ClientState_Registering;   break;
+        case Operation_Update:     client->State = ClientState_Updating;      break;
+        case Operation_Deregister: client->State = ClientState_Deregistering; break;
+        default: break;
+    }
+    simulation->Operations[operation].Sent++;
+    simulation->Pending++;
+    SendRequest(simulation, index);
+}
+
+static void SetRegistered(Simulation * simulation, SimulatedClient * client, uint64_t now)
+{
+    client->State = ClientState_Registered;
+    // refresh the registration well before the server expires it
+    client->RefreshTime = now + (uint64_t)simulation->Lifetime * 1000000 * 3 / 4;
+}
+
+static void SetUnregistered(Simulation * simulation, int index, bool wasRegistered)
+{
+    SimulatedClient * client = &simulation->Clients[index];
+    client->State = ClientState_Unregistered;
+    client->Observed = false;
+    if (wasRegistered)
+    {
+        simulation->Registered--;
+    }
+    QueueRegistration(simulation, index);
+}
+
+static void CompleteRequest(Simulation * simulation, int index, coap_packet_t * response, uint64_t now)
+{
+    SimulatedClient * client = &simulation->Clients[index];
+    OperationStatistics * statistics = &simulation->Operations[client->PendingOperation];
+    bool success = (response->code >= CREATED_2_01) && (response->code < BAD_REQUEST_4_00);
+
+    simulation->Pending--;
+    RecordLatency(statistics, now - client->RequestSentTime);
+
+    if (success)
+    {
+        statistics->Succeeded++;
+    }
+    else
+    {
+        statistics->Failed++;
+        Debug("%s for client %d failed: %d.%02d\n", operationNames[client->PendingOperation], index, response->code >> 5, response->code & 0x1f);
+
+        // wait before trying again, for as long as the server asked if it is overloaded
+        uint32_t maxAge = 0;
+        if ((response->code == SERVICE_UNAVAILABLE_5_03) && coap_get_header_max_age(response, &maxAge))
+        {
+            client->RetryTime = now + (uint64_t)maxAge * 1000000;
+        }
+        else
+        {
+            client->RetryTime = now + simulation->AckTimeout;
+        }
+    }
+
+    switch (client->PendingOperation)
+    {
+        case Operation_Register:
+            if (success)
+            {
+                const char * location = NULL;
+                int length = coap_get_header_location_path(response, &location);
+                if ((length > 0) && (length < MAX_LOCATION_LENGTH))
+                {
+                    memcpy(client->Location, location, length);
+                    client->Location[length] = '\0';
+                    SetRegistered(simulation, client, now);
+                    simulation->Registered++;
+                    break;
+                }
+            }
+            SetUnregistered(simulation, index, false);
+            break;
+
+        case Operation_Update:
+            if (success)
+            {
+                SetRegistered(simulation, client, now);
+            }
+            else if ((response->code == NOT_FOUND_4_04) || (response->code == BAD_REQUEST_4_00))
+            {
+                // the server has lost the registration, so register again
+                SetUnregistered(simulation, index, true);
+            }
+            else
+            {
+                client->State = ClientState_Registered;
+            }
+            break;
+
+        case Operation_Deregister:
+            client->State = ClientState_Deregistered;
+            client->Observed = false;
+            simulation->Registered--;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void TimeoutRequest(Simulation * simulation, int index)
+{
+    SimulatedClient * client = &simulation->Clients[index];
+
+    simulation->Operations[client->PendingOperation].TimedOut++;
+    simulation->Pending--;
+    Debug("%s for client %d timed out\n", operationNames[client->PendingOperation], index);
+
+    switch (client->PendingOperation)
+    {
+        case Operation_Register:
+            SetUnregistered(simulation, index, false);
+            break;
+        case Operation_Update:
+            // try again at the next refresh check, the registration may still be valid
+            client->State = ClientState_Registered;
+            break;
+        case Operation_Deregister:
+            client->State = ClientState_Deregistered;
+            simulation->Registered--;
+            break;
+        default:
+            break;
+    }
+}
+
+static bool IsRequestPending(const SimulatedClient * client)
+{
+    return (client->State == ClientState_Registering) || (client->State == ClientState_Updating) ||
+           (client->State == ClientState_Deregistering);
+}
+
+static void CheckRetransmissions(Simulation * simulation, uint64_t now)
+{
+    int index;
+    for (index = 0; index < simulation->NumClients; index++)
+    {
+        SimulatedClient * client = &simulation->Clients[index];
+        if (IsRequestPending(client) && (now >= client->RetransmitTime))
+        {
+            if (client->RetransmitCount < MAX_RETRANSMIT)
+            {
+                client->RetransmitCount++;
+                client->RetransmitTimeout *= 2;
+                client->RetransmitTime = now + client->RetransmitTimeout;
+                simulation->Operations[client->PendingOperation].Retransmitted++;
+                SendRequest(simulation, index);
+            }
+            else
+            {
+                TimeoutRequest(simulation, index);
+            }
+        }
+    }
+}
+
+// Write a single integer resource in TLV, wrapped in an object instance if the path is not a resource
+static size_t BuildTlvPayload(const char * path, uint8_t * buffer)
+{
+    int objectID = -1, instanceID = -1, resourceID = -1;
+    size_t length = 0;
+
+    sscanf(path, "%d/%d/%d", &objectID, &instanceID, &resourceID);
+    if (resourceID < 0)
+    {
+        buffer[length++] = 0x03;            // object instance, 8-bit ID, 3 byte value
+        buffer[length++] = (instanceID < 0) ? 0 : (uint8_t)instanceID;
+        resourceID = 0;
+    }
+    buffer[length++] = 0xc1;                // resource, 8-bit ID, 1 byte value
+    buffer[length++] = (uint8_t)resourceID;
+    buffer[length++] = 0;
+    return length;
+}
+
+static void SetContent(coap_packet_t * response, const char * path, unsigned int contentType, uint8_t * buffer)
+{
+    if (contentType == CONTENT_TYPE_PLAIN_TEXT)
+    {
+        coap_set_header_content_format(response, CONTENT_TYPE_PLAIN_TEXT);
+        coap_set_payload(response, "0", 1);
+    }
+    else
+    {
+        coap_set_header_content_format(response, CONTENT_TYPE_TLV);
+        coap_set_payload(response, buffer, BuildTlvPayload(path, buffer));
+    }
+}
+
+static void HandleServerRequest(Simulation * simulation, SimulatedClient * client, coap_packet_t * request)
+{
+    coap_packet_t response;
+    const char * uriPath = NULL;
+    char path[MAX_PATH_LENGTH] = { 0 };
+    uint8_t payload[16];
+    unsigned int accept = CONTENT_TYPE_TLV;
+
+    int length = coap_get_header_uri_path(request, &uriPath);
+    if (length > 0)
+    {
+        memcpy(path, uriPath, (length < MAX_PATH_LENGTH) ? length : MAX_PATH_LENGTH - 1);
+    }
+    coap_get_header_accept(request, &accept);
+
+    if (request->type == COAP_TYPE_CON)
+    {
+        coap_init_message(&response, COAP_TYPE_ACK, CONTENT_2_05, request->mid);
+    }
+    else
+    {
+        coap_init_message(&response, COAP_TYPE_NON, CONTENT_2_05, client->NextMessageID++);
+    }
+    coap_set_token(&response, request->token, request->token_len);
+
+    switch (request->code)
+    {
+        case COAP_GET:
+        {
+            uint32_t observe = 0;
+            if (coap_get_header_observe(request, &observe))
+            {
+                if (observe == 0)
+                {
+                    client->Observed = true;
+                    memcpy(client->ObserveToken, request->token, request->token_len);
+                    client->ObserveTokenLength = request->token_len;
+                    strcpy(client->ObservePath, path);
+                    client->ObserveContentType = accept;
+                    client->ObserveSequence = 0;
+                    coap_set_header_observe(&response, client->ObserveSequence++);
+                    simulation->ServerRequests[ServerRequest_Observe]++;
+                }
+                else
+                {
+                    client->Observed = false;
+                    simulation->ServerRequests[ServerRequest_CancelObserve]++;
+                }
+            }
+            else
+            {
+                simulation->ServerRequests[ServerRequest_Read]++;
+            }
+            SetContent(&response, path, accept, payload);
+            break;
+        }
+        case COAP_PUT:
+            coap_set_status_code(&response, CHANGED_2_04);
+            simulation->ServerRequests[ServerRequest_Write]++;
+            break;
+
+        case COAP_POST:
+            if (strchr(path, '/') == NULL)
+            {
+                // create a new instance of the object
+                char location[MAX_PATH_LENGTH + 4];
+                snprintf(location, sizeof(location), "%s/1", path);
+                coap_set_status_code(&response, CREATED_2_01);
+                coap_set_header_location_path(&response, location);
+                simulation->ServerRequests[ServerRequest_Create]++;
+            }
+            else
+            {
+                coap_set_status_code(&response, CHANGED_2_04);
+                simulation->ServerRequests[strchr(strchr(path, '/') + 1, '/') ? ServerRequest_Execute : ServerRequest_Write]++;
+            }
+            break;
+
+        case COAP_DELETE:
+            coap_set_status_code(&response, DELETED_2_02);
+            simulation->ServerRequests[ServerRequest_Delete]++;
+            break;
+
+        default:
+            coap_set_status_code(&response, METHOD_NOT_ALLOWED_4_05);
+            break;
+    }
+    SendPacket(client, &response);
+}
+
+static void HandleMessage(Simulation * simulation, int index, uint8_t * buffer, int length, uint64_t now)
+{
+    SimulatedClient * client = &simulation->Clients[index];
+    coap_packet_t message;
+
+    if (coap_parse_message(&message, buffer, length) != NO_ERROR)
+    {
+        simulation->ReceiveErrors++;
+        return;
+    }
+
+    if (message.code >= COAP_GET && message.code <= COAP_DELETE)
+    {
+        HandleServerRequest(simulation, client, &message);
+    }
+    else if (message.type == COAP_TYPE_ACK)
+    {
+        if (IsRequestPending(client) && (message.mid == client->PendingMessageID))
+        {
+            if (message.code == 0)
+            {
+                // empty acknowledgement, a separate response will follow - stop retransmitting
+                client->RetransmitTime = UINT64_MAX;
+            }
+            else
+            {
+                CompleteRequest(simulation, index, &message, now);
+            }
+        }
+    }
+    else if (message.type == COAP_TYPE_RST)
+    {
+        // the server is no longer interested in our notifications
+        client->Observed = false;
+    }
+    else if (message.code >= CREATED_2_01)
+    {
+        // separate response
+        if (message.type == COAP_TYPE_CON)
+        {
+            coap_packet_t ack;
+            coap_init_message(&ack, COAP_TYPE_ACK, 0, message.mid);
+            SendPacket(client, &ack);
+        }
+        if (IsRequestPending(client) && (message.token_len == 2) &&
+            (((message.token[0] << 8) | message.token[1]) == client->PendingMessageID))
+        {
+            CompleteRequest(simulation, index, &message, now);
+        }
+    }
+}
+
+static void SendNotification(Simulation * simulation, SimulatedClient * client)
+{
+    coap_packet_t notification;
+    uint8_t payload[16];
+
+    coap_init_message(&notification, COAP_TYPE_NON, CONTENT_2_05, client->NextMessageID++);
+    coap_set_token(&notification, client->ObserveToken, client->ObserveTokenLength);
+    coap_set_header_observe(&notification, client->ObserveSequence++);
+    SetContent(&notification, client->ObservePath, client->ObserveContentType, payload);
+    SendPacket(client, &notification);
+    simulation->Notifications++;
+}
+
+// Find the next client after the cursor in the given state, scanning at most all clients once
+static int NextClient(Simulation * simulation, int * cursor, ClientState state, bool observed)
+{
+    int count;
+    for (count = 0; count < simulation->NumClients; count++)
+    {
+        int index = *cursor;
+        *cursor = (*cursor + 1) % simulation->NumClients;
+        SimulatedClient * client = &simulation->Clients[index];
+        if ((client->State == state) && (!observed || client->Observed))
+        {
+            return index;
+        }
+    }
+    return -1;
+}
+
+static void StartRegistrations(Simulation * simulation, double * credit, uint64_t now)
+{
+    while ((*credit >= 1) && (simulation->QueueLength > 0))
+    {
+        int index = simulation->Queue[simulation->QueueHead];
+        SimulatedClient * client = &simulation->Clients[index];
+        if (client->RetryTime > now)
+        {
+            break;
+        }
+        simulation->QueueHead = (simulation->QueueHead + 1) % simulation->NumClients;
+        simulation->QueueLength--;
+        client->Queued = false;
+        StartRequest(simulation, index, Operation_Register, now);
+        *credit -= 1;
+    }
+}
+
+static void StartUpdates(Simulation * simulation, double * credit, uint64_t now)
+{
+    while (*credit >= 1)
+    {
+        int index = NextClient(simulation, &simulation->UpdateCursor, ClientState_Registered, false);
+        if (index < 0)
+        {
+            break;
+        }
+        StartRequest(simulation, index, Operation_Update, now);
+        *credit -= 1;
+    }
+}
+
+static void RefreshRegistrations(Simulation * simulation, uint64_t now)
+{
+    int index;
+    for (index = 0; index < simulation->NumClients; index++)
+    {
+        SimulatedClient * client = &simulation->Clients[index];
+        if ((client->State == ClientState_Registered) && (now >= client->RefreshTime) && (now >= client->RetryTime))
+        {
+            StartRequest(simulation, index, Operation_Update, now);
+        }
+    }
+}
+
+static void SendNotifications(Simulation * simulation, double * credit)
+{
+    while (*credit >= 1)
+    {
+        int index = NextClient(simulation, &simulation->NotifyCursor, ClientState_Registered, true);
+        if (index < 0)
+        {
+            break;
+        }
+        SendNotification(simulation, &simulation->Clients[index]);
+        *credit -= 1;
+    }
+}
+
+static void StartDeregistrations(Simulation * simulation, double * credit, uint64_t now)
+{
+    while ((*credit >= 1) && (simulation->DeregisterCursor < simulation->NumClients))
+    {
+        int index = simulation->DeregisterCursor;
+        SimulatedClient * client = &simulation->Clients[index];
+        if (client->State == ClientState_Registered)
+        {
+            StartRequest(simulation, index, Operation_Deregister, now);
+            *credit -= 1;
+        }
+        else if (IsRequestPending(client))
+        {
+            // wait for the outstanding request to complete first
+            break;
+        }
+        simulation->DeregisterCursor++;
+    }
+}
+
+static bool OpenClientSockets(Simulation * simulation, int epollFd)
+{
+    int index;
+    for (index = 0; index < simulation->NumClients; index++)
+    {
+        SimulatedClient * client = &simulation->Clients[index];
+        client->Socket = socket(simulation->ServerAddress.ss_family, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if (client->Socket < 0)
+        {
+            Error("Failed to create socket for client %d: %s\n", index, strerror(errno));
+            return false;
+        }
+
+        // connecting binds the socket to a unique local port, and filters out datagrams from anywhere but the server
+        if (connect(client->Socket, (struct sockaddr *)&simulation->ServerAddress, simulation->ServerAddressLength) != 0)
+        {
+            Error("Failed to connect socket for client %d: %s\n", index, strerror(errno));
+            return false;
+        }
+
+        struct epoll_event event = { .events = EPOLLIN, .data.u32 = index };
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, client->Socket, &event) != 0)
+        {
+            Error("epoll_ctl failed: %s\n", strerror(errno));
+            return false;
+        }
+        client->NextMessageID = (uint16_t)rand();
+        QueueRegistration(simulation, index);
+    }
+    return true;
+}
+
+static void CloseClientSockets(Simulation * simulation)
+{
+    int index;
+    for (index = 0; index < simulation->NumClients; index++)
+    {
+        if (simulation->Clients[index].Socket >= 0)
+        {
+            close(simulation->Clients[index].Socket);
+        }
+    }
+}
+
+static void ReceiveMessages(Simulation * simulation, int epollFd, int timeout)
+{
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    uint8_t buffer[COAP_MAX_PACKET_SIZE + 1];
+
+    int numEvents = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, timeout);
+    uint64_t now = GetTimeUs();
+    int event;
+    for (event = 0; event < numEvents; event++)
+    {
+        int index = events[event].data.u32;
+        int length;
+        while ((length = recv(simulation->Clients[index].Socket, buffer, sizeof(buffer), 0)) > 0)
+        {
+            HandleMessage(simulation, index, buffer, length, now);
+        }
+    }
+}
+
+static void PrintProgress(const Simulation * simulation, double elapsed, const uint64_t * lastSent)
+{
+    printf("%6.1fs  registered %d/%d  pending %d  queued %d", elapsed, simulation->Registered, simulation->NumClients,
+           simulation->Pending, simulation->QueueLength);
+    int operation;
+    for (operation = 0; operation < Operation_Count; operation++)
+    {
+        printf("  %s/s %" PRIu64, operationNames[operation], simulation->Operations[operation].Sent - lastSent[operation]);
+    }
+    printf("  Notify/s %" PRIu64 "\n", simulation->Notifications - lastSent[Operation_Count]);
+}
+
+static void PrintReport(const Simulation * simulation, double elapsed)
+{
+    int operation, request;
+
+    printf("\nClients: %d, registered: %d, elapsed: %.1f s\n\n", simulation->NumClients, simulation->Registered, elapsed);
+    printf("%-11s %9s %9s %7s %7s %8s %9s %8s %8s %8s %8s %8s\n", "Operation", "Sent", "Succeeded", "Failed", "Timeout",
+           "Retrans", "Done/s", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    for (operation = 0; operation < Operation_Count; operation++)
+    {
+        const OperationStatistics * statistics = &simulation->Operations[operation];
+        printf("%-11s %9" PRIu64 " %9" PRIu64 " %7" PRIu64 " %7" PRIu64 " %8" PRIu64 " %9.1f %8.2f %8.2f %8.2f %8.2f %8.2f\n",
+               operationNames[operation], statistics->Sent, statistics->Succeeded, statistics->Failed, statistics->TimedOut,
+               statistics->Retransmitted, (elapsed > 0) ? (statistics->Succeeded + statistics->Failed) / elapsed : 0,
+               GetLatencyPercentile(statistics, 0.50), GetLatencyPercentile(statistics, 0.90),
+               GetLatencyPercentile(statistics, 0.99), GetLatencyPercentile(statistics, 0.999), statistics->MaxLatency / 1000.0);
+    }
+
+    printf("\nServer requests handled:");
+    for (request = 0; request < ServerRequest_Count; request++)
+    {
+        printf(" %s %" PRIu64 "%s", serverRequestNames[request], simulation->ServerRequests[request], (request < ServerRequest_Count - 1) ? "," : "\n");
+    }
+    printf("Notifications sent: %" PRIu64 " (%.1f/s)\n", simulation->Notifications, (elapsed > 0) ? simulation->Notifications / elapsed : 0);
+    if (simulation->ReceiveErrors > 0)
+    {
+        printf("Invalid messages received: %" PRIu64 "\n", simulation->ReceiveErrors);
+    }
+}
+
+// Credit is capped at about 10ms worth of requests, so that it doesn't accumulate while nothing can use it and then
+// release a burst far above the configured rate
+static double AddCredit(double credit, int rate, double interval)
+{
+    double limit = rate / 100.0 + 1;
+    credit += rate * interval;
+    return (credit > limit) ? limit : credit;
+}
+
+static void Simulate(Simulation * simulation, int epollFd, const struct gengetopt_args_info * ai)
+{
+    uint64_t start = GetTimeUs();
+    uint64_t last = start;
+    uint64_t end = start + (uint64_t)ai->duration_arg * 1000000;
+    uint64_t nextRetransmitCheck = start;
+    uint64_t nextRefreshCheck = start + REFRESH_CHECK_INTERVAL;
+    uint64_t nextProgress = start + 1000000;
+    uint64_t lastSent[Operation_Count + 1] = { 0 };
+    double registerCredit = 1, updateCredit = 0, notifyCredit = 0;
+    bool stopping = false;
+
+    while (true)
+    {
+        ReceiveMessages(simulation, epollFd, 1);
+
+        uint64_t now = GetTimeUs();
+        double interval = (now - last) / 1000000.0;
+        last = now;
+
+        if (!stopping && (g_signal || (now >= end)))
+        {
+            stopping = true;
+            g_signal = false;
+            signal(SIGINT, INThandler);
+            if (!ai->deregister_flag)
+            {
+                break;
+            }
+            Verbose("Deregistering %d clients\n", simulation->Registered);
+        }
+
+        registerCredit = AddCredit(registerCredit, ai->registerRate_arg, interval);
+
+        if (!stopping)
+        {
+            StartRegistrations(simulation, &registerCredit, now);
+
+            updateCredit = AddCredit(updateCredit, ai->updateRate_arg, interval);
+            StartUpdates(simulation, &updateCredit, now);
+
+            notifyCredit = AddCredit(notifyCredit, ai->notifyRate_arg, interval);
+            SendNotifications(simulation, &notifyCredit);
+
+            if (now >= nextRefreshCheck)
+            {
+                RefreshRegistrations(simulation, now);
+                nextRefreshCheck = now + REFRESH_CHECK_INTERVAL;
+            }
+        }
+        else
+        {
+            StartDeregistrations(simulation, &registerCredit, now);
+            if (((simulation->DeregisterCursor >= simulation->NumClients) && (simulation->Pending == 0)) || g_signal)
+            {
+                break;
+            }
+        }
+
+        if (now >= nextRetransmitCheck)
+        {
+            CheckRetransmissions(simulation, now);
+            nextRetransmitCheck = now + RETRANSMIT_CHECK_INTERVAL;
+        }
+
+        if (now >= nextProgress)
+        {
+            if (!ai->quiet_flag)
+            {
+                PrintProgress(simulation, (now - start) / 1000000.0, lastSent);
+            }
+            int operation;
+            for (operation = 0; operation < Operation_Count; operation++)
+            {
+                lastSent[operation] = simulation->Operations[operation].Sent;
+            }
+            lastSent[Operation_Count] = simulation->Notifications;
+            nextProgress += 1000000;
+        }
+    }
+
+    PrintReport(simulation, (GetTimeUs() - start) / 1000000.0);
+}
+
+int main(int argc, char ** argv)
+{
+    int result = 1;
+    struct gengetopt_args_info ai;
+    Simulation simulation = { 0 };
+    int epollFd = -1;
+
+    if (cmdline_parser(argc, argv, &ai) != 0)
+    {
+        exit(1);
+    }
+
+    g_logLevel = ai.debug_given ? 2 : (ai.verbose_given ? 1 : 0);
+
+    if ((ai.clients_arg <= 0) || (ai.registerRate_arg <= 0) || (ai.updateRate_arg < 0) || (ai.notifyRate_arg < 0) ||
+        (ai.lifetime_arg <= 0) || (ai.duration_arg <= 0) || (ai.timeout_arg <= 0))
+    {
+        Error("Client count, rates, lifetime, duration and timeout must be positive\n");
+        goto done;
+    }
+
+    if (!ResolveServerAddress(&simulation, ai.address_arg, ai.port_arg) || !RaiseFileLimit(ai.clients_arg))
+    {
+        goto done;
+    }
+
+    simulation.NumClients = ai.clients_arg;
+    simulation.NamePrefix = ai.namePrefix_arg;
+    simulation.Lifetime = ai.lifetime_arg;
+    simulation.AckTimeout = ai.timeout_arg * 1000;
+    simulation.Clients = calloc(simulation.NumClients, sizeof(SimulatedClient));
+    simulation.Queue = malloc(simulation.NumClients * sizeof(int));
+    if ((simulation.Clients == NULL) || (simulation.Queue == NULL))
+    {
+        Error("Failed to allocate memory for %d clients\n", simulation.NumClients);
+        goto done;
+    }
+
+    int index;
+    for (index = 0; index < simulation.NumClients; index++)
+    {
+        simulation.Clients[index].Socket = -1;
+    }
+
+    epollFd = epoll_create1(0);
+    if (epollFd < 0)
+    {
+        Error("epoll_create1 failed: %s\n", strerror(errno));
+        goto done;
+    }
+
+    srand(time(NULL));
+    signal(SIGINT, INThandler);
+
+    if (OpenClientSockets(&simulation, epollFd))
+    {
+        Verbose("Simulating %d clients against %s:%d\n", simulation.NumClients, ai.address_arg, ai.port_arg);
+        Simulate(&simulation, epollFd, &ai);
+        result = 0;
+    }
+
+done:
+    if (simulation.Clients != NULL)
+    {
+        CloseClientSockets(&simulation);
+    }
+    if (epollFd >= 0)
+    {
+        close(epollFd);
+    }
+    free(simulation.Clients);
+    free(simulation.Queue);
+    cmdline_parser_free(&ai);
+    return result;
+}
@@ -0,0 +1,227 @@
+/** @file awa-loadgen_cmdline.h
+ *  @brief The header file for the command line option parser
+ *  generated by GNU Gengetopt version 2.22.6
+ *  http://www.gnu.org/software/gengetopt.
+ *  DO NOT modify this file, since it can be overwritten
+ *  @author GNU Gengetopt by Lorenzo Bettini */
+
+#ifndef AWA_LOADGEN_CMDLINE_H
+#define AWA_LOADGEN_CMDLINE_H
+
+/* If we use autoconf.  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h> /* for FILE */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#ifndef CMDLINE_PARSER_PACKAGE
+/** @brief the program name (used for printing errors) */
+#define CMDLINE_PARSER_PACKAGE "awa-loadgen"
+#endif
+
+#ifndef CMDLINE_PARSER_PACKAGE_NAME
+/** @brief the complete program name (used for help and version) */
+#define CMDLINE_PARSER_PACKAGE_NAME "awa-loadgen"
+#endif
+
+#ifndef CMDLINE_PARSER_VERSION
+/** @brief the program version */
+#define CMDLINE_PARSER_VERSION "1.0"
+#endif
+
+/** @brief Where the command line options are stored */
+struct gengetopt_args_info
+{
+  const char *help_help; /**< @brief Print help and exit help description.  */
+  const char *version_help; /**< @brief Print version and exit help description.  */
+  int verbose_flag;	/**< @brief Increase program verbosity (default=off).  */
+  const char *verbose_help; /**< @brief Increase program verbosity help description.  */
+  int debug_flag;	/**< @brief Increase program verbosity (default=off).  */
+  const char *debug_help; /**< @brief Increase program verbosity help description.  */
+  int quiet_flag;	/**< @brief Decrease program verbosity (default=off).  */
+  const char *quiet_help; /**< @brief Decrease program verbosity help description.  */
+  char * address_arg;	/**< @brief LWM2M server address (default='127.0.0.1').  */
+  char * address_orig;	/**< @brief LWM2M server address original value given at command line.  */
+  const char *address_help; /**< @brief LWM2M server address help description.  */
+  int port_arg;	/**< @brief LWM2M server CoAP port (default='5683').  */
+  char * port_orig;	/**< @brief LWM2M server CoAP port original value given at command line.  */
+  const char *port_help; /**< @brief LWM2M server CoAP port help description.  */
+  int clients_arg;	/**< @brief Number of clients to simulate (default='1000').  */
+  char * clients_orig;	/**< @brief Number of clients to simulate original value given at command line.  */
+  const char *clients_help; /**< @brief Number of clients to simulate help description.  */
+  char * namePrefix_arg;	/**< @brief Client endpoint name prefix (default='loadgen').  */
+  char * namePrefix_orig;	/**< @brief Client endpoint name prefix original value given at command line.  */
+  const char *namePrefix_help; /**< @brief Client endpoint name prefix help description.  */
+  int registerRate_arg;	/**< @brief Registrations per second (default='100').  */
+  char * registerRate_orig;	/**< @brief Registrations per second original value given at command line.  */
+  const char *registerRate_help; /**< @brief Registrations per second help description.  */
+  int updateRate_arg;	/**< @brief Registration updates per second (default='0').  */
+  char * updateRate_orig;	/**< @brief Registration updates per second original value given at command line.  */
+  const char *updateRate_help; /**< @brief Registration updates per second help description.  */
+  int notifyRate_arg;	/**< @brief Notifications per second for observed resources (default='0').  */
+  char * notifyRate_orig;	/**< @brief Notifications per second for observed resources original value given at command line.  */
+  const char *notifyRate_help; /**< @brief Notifications per second for observed resources help description.  */
+  int lifetime_arg;	/**< @brief Registration lifetime (default='300').  */
+  char * lifetime_orig;	/**< @brief Registration lifetime original value given at command line.  */
+  const char *lifetime_help; /**< @brief Registration lifetime help description.  */
+  int duration_arg;	/**< @brief Run for SECONDS after starting (default='60').  */
+  char * duration_orig;	/**< @brief Run for SECONDS after starting original value given at command line.  */
+  const char *duration_help; /**< @brief Run for SECONDS after starting help description.  */
+  int timeout_arg;	/**< @brief Initial CoAP acknowledgement timeout (default='2000').  */
+  char * timeout_orig;	/**< @brief Initial CoAP acknowledgement timeout original value given at command line.  */
+  const char *timeout_help; /**< @brief Initial CoAP acknowledgement timeout help description.  */
+  int deregister_flag;	/**< @brief Deregister clients before exiting (default=off).  */
+  const char *deregister_help; /**< @brief Deregister clients before exiting help description.  */
+
+  unsigned int help_given ;	/**< @brief Whether help was given.  */
+  unsigned int version_given ;	/**< @brief Whether version was given.  */
+  unsigned int verbose_given ;	/**< @brief Whether verbose was given.  */
+  unsigned int debug_given ;	/**< @brief Whether debug was given.  */
+  unsigned int quiet_given ;	/**< @brief Whether quiet was given.  */
+  unsigned int address_given ;	/**< @brief Whether address was given.  */
+  unsigned int port_given ;	/**< @brief Whether port was given.  */
+  unsigned int clients_given ;	/**< @brief Whether clients was given.  */
+  unsigned int namePrefix_given ;	/**< @brief Whether namePrefix was given.  */
+  unsigned int registerRate_given ;	/**< @brief Whether registerRate was given.  */
+  unsigned int updateRate_given ;	/**< @brief Whether updateRate was given.  */
+  unsigned int notifyRate_given ;	/**< @brief Whether notifyRate was given.  */
+  unsigned int lifetime_given ;	/**< @brief Whether lifetime was given.  */
+  unsigned int duration_given ;	/**< @brief Whether duration was given.  */
+  unsigned int timeout_given ;	/**< @brief Whether timeout was given.  */
+  unsigned int deregister_given ;	/**< @brief Whether deregister was given.  */
+
+  char **inputs ; /**< @brief unamed options (options without names) */
+  unsigned inputs_num ; /**< @brief unamed options number */
+} ;
+
+/** @brief The additional parameters to pass to parser functions */
+struct cmdline_parser_params
+{
+  int override; /**< @brief whether to override possibly already present options (default 0) */
+  int initialize; /**< @brief whether to initialize the option structure gengetopt_args_info (default 1) */
+  int check_required; /**< @brief whether to check that all required options were provided (default 1) */
+  int check_ambiguity; /**< @brief whether to check for options already specified in the option structure gengetopt_args_info (default 0) */
+  int print_errors; /**< @brief whether getopt_long should print an error message for a bad option (default 1) */
+} ;
+
+/** @brief the purpose string of the program */
+extern const char *gengetopt_args_info_purpose;
+/** @brief the usage string of the program */
+extern const char *gengetopt_args_info_usage;
+/** @brief the description string of the program */
+extern const char *gengetopt_args_info_description;
+/** @brief all the lines making the help output */
+extern const char *gengetopt_args_info_help[];
+
+/**
+ * The command line parser
+ * @param argc the number of command line options
+ * @param argv the command line options
+ * @param args_info the structure where option information will be stored
+ * @return 0 if everything went fine, NON 0 if an error took place
+ */
+int cmdline_parser (int argc, char **argv,
+  struct gengetopt_args_info *args_info);
+
+/**
+ * The command line parser (version with additional parameters - deprecated)
+ * @param argc the number of command line options
+ * @param argv the command line options
+ * @param args_info the structure where option information will be stored
+ * @param override whether to override possibly already present options
+ * @param initialize whether to initialize the option structure my_args_info
+ * @param check_required whether to check that all required options were provided
+ * @return 0 if everything went fine, NON 0 if an error took place
+ * @deprecated use cmdline_parser_ext() instead
+ */
+int cmdline_parser2 (int argc, char **argv,
+  struct gengetopt_args_info *args_info,
+  int override, int initialize, int check_required);
+
+/**
+ * The command line parser (version with additional parameters)
+ * @param argc the number of command line options
+ * @param argv the command line options
+ * @param args_info the structure where option information will be stored
+ * @param params additional parameters for the parser
+ * @return 0 if everything went fine, NON 0 if an error took place
+ */
+int cmdline_parser_ext (int argc, char **argv,
+  struct gengetopt_args_info *args_info,
+  struct cmdline_parser_params *params);
+
+/**
+ * Save the contents of the option struct into an already open FILE stream.
+ * @param outfile the stream where to dump options
+ * @param args_info the option struct to dump
+ * @return 0 if everything went fine, NON 0 if an error took place
+ */
+int cmdline_parser_dump(FILE *outfile,
+  struct gengetopt_args_info *args_info);
+
+/**
+ * Save the contents of the option struct into a (text) file.
+ * This file can be read by the config file parser (if generated by gengetopt)
+ * @param filename the file where to save
+ * @param args_info the option struct to save
+ * @return 0 if everything went fine, NON 0 if an error took place
+ */
+int cmdline_parser_file_save(const char *filename,
+  struct gengetopt_args_info *args_info);
+
+/**
+ * Print the help
+ */
+void cmdline_parser_print_help(void);
+/**
+ * Print the version
+ */
+void cmdline_parser_print_version(void);
+
+/**
+ * Initializes all the fields a cmdline_parser_params structure
+ * to their default values
+ * @param params the structure to initialize
+ */
+void cmdline_parser_params_init(struct cmdline_parser_params *params);
+
+/**
+ * Allocates dynamically a cmdline_parser_params structure and initializes
+ * all its fields to their default values
+ * @return the created and initialized cmdline_parser_params structure
+ */
+struct cmdline_parser_params *cmdline_parser_params_create(void);
+
+/**
+ * Initializes the passed gengetopt_args_info structure's fields
+ * (also set default values for options that have a default)
+ * @param args_info the structure to initialize
+ */
+void cmdline_parser_init (struct gengetopt_args_info *args_info);
+/**
+ * Deallocates the string fields of the gengetopt_args_info structure
+ * (but does not deallocate the structure itself)
+ * @param args_info the structure to deallocate
+ */
+void cmdline_parser_free (struct gengetopt_args_info *args_info);
+
+/**
+ * Checks that all the required options were specified
+ * @param args_info the structure to check
+ * @param prog_name the name of the program that will be used to print
+ *   possible errors
+ * @return
+ */
+int cmdline_parser_required (struct gengetopt_args_info *args_info,
+  const char *prog_name);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* AWA_LOADGEN_CMDLINE_H */
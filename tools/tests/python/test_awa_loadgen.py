@@ -0,0 +1,68 @@
+#/************************************************************************************************************************
+# Copyright (c) 2016, Imagination Technologies Limited and/or its affiliated group companies.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#     1. Redistributions of source code must retain the above copyright notice, this list of conditions and the
+#        following disclaimer.
+#     2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+#        following disclaimer in the documentation and/or other materials provided with the distribution.
+#     3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+#        products derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+# USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#************************************************************************************************************************/
+
+
+# Tests related to the client simulator used to load test the server
+
+import unittest
+
+import common
+import tools_common
+
+from test_awa_server_list_clients import server_list_clients
+
+def loadgen(config, *args):
+    return tools_common.run(tools_common.LOADGEN,
+                            "--address=%s" % (config.serverAddress, ),
+                            "--port=%d" % (config.serverCoapPort, ),
+                            *args)
+
+class TestLoadgen(common.SpawnDaemonsTestCase):
+
+    def setUp(self):
+        common.setConfigurationClass(tools_common.NoClientTestConfiguration)
+        super(TestLoadgen, self).setUp()
+
+    def test_loadgen_registers_clients(self):
+        # test that all simulated clients register, and remain registered when the tool exits
+        result = loadgen(self.config, "--clients=5", "--registerRate=50", "--duration=1", "--quiet")
+        self.assertEqual(0, result.code)
+        self.assertRegexpMatches(result.stdout, r"Register\s+5\s+5\s+0\s+0\s+0")
+
+        result = server_list_clients(self.config)
+        self.assertEqual("Client: loadgen0\n\nClient: loadgen1\n\nClient: loadgen2\n\nClient: loadgen3\n\nClient: loadgen4\n\n", result.stdout)
+
+    def test_loadgen_deregister(self):
+        # test that simulated clients send updates, and deregister before the tool exits
+        result = loadgen(self.config, "--clients=5", "--registerRate=50", "--updateRate=10", "--duration=2", "--deregister", "--quiet")
+        self.assertEqual(0, result.code)
+        self.assertRegexpMatches(result.stdout, r"Register\s+5\s+5\s+0\s+0\s+0")
+        self.assertRegexpMatches(result.stdout, r"Update\s+(\d+)\s+\1\s+0\s+0\s+0")
+        self.assertRegexpMatches(result.stdout, r"Deregister\s+5\s+5\s+0\s+0\s+0")
+
+        result = server_list_clients(self.config)
+        self.assertEqual("No clients connected.\n", result.stdout)
+
+    def test_loadgen_invalid_client_count(self):
+        result = loadgen(self.config, "--clients=0")
+        self.assertEqual(1, result.code)
+        self.assertEqual("Client count, rates, lifetime, duration and timeout must be positive\n", result.stderr)
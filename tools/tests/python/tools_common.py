@@ -53,6 +53,8 @@ SERVER_READ             = os.path.join(LWM2M_TOOLS_PATH, "./awa-server-read")
 SERVER_WRITE            = os.path.join(LWM2M_TOOLS_PATH, "./awa-server-write")
 SERVER_WRITE_ATTRIBUTES = os.path.join(LWM2M_TOOLS_PATH, "./awa-server-write-attributes")
 
+LOADGEN                 = os.path.join(LWM2M_TOOLS_PATH, "./awa-loadgen")
+
 # tuples for tool response and dummy object creation
 RunResult = namedtuple("RunResult", ["code", "stdout", "stderr"])
 CustomObject = namedtuple("CustomObject", ["name", "ID", "mandatory", "instances", "resources"])